@@ -0,0 +1,35 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/api/common/sync_access_tensor.h"
+#include "oneflow/core/common/spin_counter.h"
+#include "oneflow/core/framework/instructions_builder.h"
+#include "oneflow/core/framework/tensor.h"
+
+namespace oneflow {
+
+Maybe<void> SyncAccessTensor(const std::shared_ptr<one::Tensor>& tensor,
+                             const std::function<void(uint64_t)>& Callback,
+                             const std::string& modifier) {
+  const auto& local_tensor = JUST(tensor->AsMirroredTensor());
+  const auto& callback = std::make_shared<std::function<void(uint64_t)>>(Callback);
+  return SpinCounter::SpinWait(1, [&](const std::shared_ptr<SpinCounter>& sc) -> Maybe<void> {
+    return PhysicalRun([&](InstructionsBuilder* builder) -> Maybe<void> {
+      return builder->SyncAccessBlobByCallback(local_tensor, sc, callback, modifier);
+    });
+  });
+}
+
+}  // namespace oneflow
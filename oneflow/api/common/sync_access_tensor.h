@@ -0,0 +1,40 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_API_COMMON_SYNC_ACCESS_TENSOR_H_
+#define ONEFLOW_API_COMMON_SYNC_ACCESS_TENSOR_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include "oneflow/core/common/maybe.h"
+
+namespace oneflow {
+
+namespace one {
+
+class Tensor;
+
+}  // namespace one
+
+// Blocks the host until `Callback` has been called with the OfBlob pointer of the local tensor,
+// `modifier` is "const" for reading and "mut" for writing the blob.
+Maybe<void> SyncAccessTensor(const std::shared_ptr<one::Tensor>& tensor,
+                             const std::function<void(uint64_t)>& Callback,
+                             const std::string& modifier);
+
+}  // namespace oneflow
+
+#endif  // !ONEFLOW_API_COMMON_SYNC_ACCESS_TENSOR_H_
@@ -19,5 +19,8 @@ limitations under the License.
 
 #include "env.h"
 #include "device.h"
+#include "tensor.h"
+#include "graph.h"
+#include "batching.h"
 
 #endif  // ONELFOW_API_H_
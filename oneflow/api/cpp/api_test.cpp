@@ -15,8 +15,16 @@ limitations under the License.
 */
 
 #include <gtest/gtest.h>
+#include <chrono>
+#include <fstream>
 #include "oneflow/api/cpp/api.h"
+#include "oneflow/api/cpp/batching.h"
 #include "oneflow/api/cpp/device.h"
+#include "oneflow/api/cpp/graph.h"
+#include "oneflow/api/cpp/tensor.h"
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/persistence/file_system.h"
 
 namespace oneflow_api {
 namespace {
@@ -27,6 +35,85 @@ class EnvScope {  // NOLINT
   ~EnvScope() { release(); }
 };
 
+// A single-client saved model computing y = relu(x) with x of shape (2, 3).
+constexpr char kReluSavedModel[] = R"(
+name: "relu_model"
+version: 1
+checkpoint_dir: "variables"
+default_graph_name: "main"
+graphs {
+  key: "main"
+  value {
+    op_list {
+      name: "x"
+      input_conf {
+        out: "out"
+        blob_conf {
+          shape { dim: 2 dim: 3 }
+          data_type: kFloat
+          is_dynamic: false
+          nd_sbp { sbp_parallel { broadcast_parallel {} } }
+        }
+      }
+    }
+    op_list {
+      name: "relu"
+      user_conf {
+        op_type_name: "relu"
+        input { key: "in" value { s: "x/out" } }
+        output { key: "out" value { s: "relu/out_0" } }
+      }
+    }
+    op_list {
+      name: "y"
+      return_conf { in: "relu/out_0" out: "out" }
+    }
+    signatures {
+      key: "serving"
+      value {
+        inputs {
+          key: "x"
+          value {
+            lbi { op_name: "x" blob_name: "out" }
+            blob_conf {
+              shape { dim: 2 dim: 3 }
+              data_type: kFloat
+              is_dynamic: false
+              nd_sbp { sbp_parallel { broadcast_parallel {} } }
+            }
+          }
+        }
+        outputs {
+          key: "y"
+          value { lbi { op_name: "y" blob_name: "out" } }
+        }
+      }
+    }
+    default_signature_name: "serving"
+  }
+}
+)";
+
+std::string WriteReluSavedModel() {
+  const std::string model_path = oneflow::JoinPath(oneflow::GetCwd(), "tmp_test_saved_model");
+  const std::string version_path = oneflow::JoinPath(model_path, "1");
+  oneflow::LocalFS()->RecursivelyCreateDirIfNotExist(oneflow::JoinPath(version_path, "variables"));
+  std::ofstream(oneflow::JoinPath(version_path, "saved_model.prototxt")) << kReluSavedModel;
+  return model_path;
+}
+
+Tensor NewFloatTensor(const std::vector<int64_t>& shape, const std::vector<float>& data) {
+  Tensor tensor(shape, DType::kFloat, Device("cpu"));
+  tensor.CopyFrom(data.data());
+  return tensor;
+}
+
+std::vector<float> ToFloatVec(const Tensor& tensor) {
+  std::vector<float> data(tensor.elem_cnt());
+  tensor.CopyTo(data.data());
+  return data;
+}
+
 }  // namespace
 
 TEST(Api, init_and_release) {
@@ -46,4 +133,85 @@ TEST(Api, init_and_release) {
 #endif
 }
 
+TEST(Api, graph_load_and_run) {
+  EnvScope scope;
+  const std::string model_path = WriteReluSavedModel();
+  {
+    const Device device("cpu");
+    Graph graph = Graph::Load(model_path, device);
+    ASSERT_EQ(graph.input_names(), std::vector<std::string>({"x"}));
+    ASSERT_EQ(graph.output_names(), std::vector<std::string>({"y"}));
+    ASSERT_EQ(graph.input_shapes(), std::vector<std::vector<int64_t>>({{2, 3}}));
+    ASSERT_EQ(graph.output_shapes(), std::vector<std::vector<int64_t>>({{2, 3}}));
+
+    const std::vector<float> x_data{-1, 2, -3, 4, -5, 6};
+    Tensor x({2, 3}, DType::kFloat, device);
+    x.CopyFrom(x_data.data());
+    for (int i = 0; i < 2; ++i) {
+      const std::vector<Tensor> outputs = graph.Run({x});
+      ASSERT_EQ(outputs.size(), 1);
+      ASSERT_EQ(outputs.at(0).shape(), std::vector<int64_t>({2, 3}));
+      std::vector<float> y_data(6);
+      outputs.at(0).CopyTo(y_data.data());
+      ASSERT_EQ(y_data, std::vector<float>({0, 2, 0, 4, 0, 6}));
+    }
+
+    // inputs not matching the signature are rejected before running the graph
+    ASSERT_ANY_THROW(graph.Run({}));
+    ASSERT_ANY_THROW(graph.Run({x, x}));
+    ASSERT_ANY_THROW(graph.Run({Tensor({3, 2}, DType::kFloat, device)}));
+    ASSERT_ANY_THROW(graph.Run({Tensor({2, 3}, DType::kDouble, device)}));
+  }
+  oneflow::LocalFS()->RecursivelyDeleteDir(model_path);
+}
+
+TEST(Api, batching_server) {
+  EnvScope scope;
+  const std::string model_path = WriteReluSavedModel();
+  {
+    Graph graph = Graph::Load(model_path, Device("cpu"));
+    {
+      BatchingOptions options;
+      options.max_latency_us = 10 * 1000 * 1000;
+      BatchingServer server(graph, options);
+      // two requests of one sample fill the batch of the graph, so they run without waiting
+      const auto start = std::chrono::steady_clock::now();
+      auto future0 = server.Submit({NewFloatTensor({1, 3}, {-1, 2, -3})});
+      auto future1 = server.Submit({NewFloatTensor({1, 3}, {4, -5, 6})});
+      const std::vector<Tensor> outputs0 = future0.get();
+      const std::vector<Tensor> outputs1 = future1.get();
+      ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+      ASSERT_EQ(outputs0.size(), 1);
+      ASSERT_EQ(outputs0.at(0).shape(), std::vector<int64_t>({1, 3}));
+      ASSERT_EQ(ToFloatVec(outputs0.at(0)), std::vector<float>({0, 2, 0}));
+      ASSERT_EQ(outputs1.size(), 1);
+      ASSERT_EQ(outputs1.at(0).shape(), std::vector<int64_t>({1, 3}));
+      ASSERT_EQ(ToFloatVec(outputs1.at(0)), std::vector<float>({4, 0, 6}));
+      ASSERT_EQ(server.latency_stats().count, 2);
+
+      // requests not matching the graph are rejected by Submit
+      ASSERT_ANY_THROW(server.Submit({}));
+      ASSERT_ANY_THROW(server.Submit({NewFloatTensor({1, 2}, {1, 2})}));
+      ASSERT_ANY_THROW(server.Submit({NewFloatTensor({3, 3}, std::vector<float>(9, 1))}));
+      ASSERT_ANY_THROW(server.Submit({Tensor({1, 3}, DType::kDouble, Device("cpu"))}));
+    }
+    {
+      BatchingOptions options;
+      options.max_latency_us = 100 * 1000;
+      BatchingServer server(graph, options);
+      // a single request does not fill the batch, it is padded and sent after max_latency_us
+      const auto start = std::chrono::steady_clock::now();
+      const std::vector<Tensor> outputs = server.Submit({NewFloatTensor({1, 3}, {7, -8, 9})}).get();
+      ASSERT_GE(std::chrono::steady_clock::now() - start,
+                std::chrono::microseconds(options.max_latency_us));
+      ASSERT_EQ(outputs.at(0).shape(), std::vector<int64_t>({1, 3}));
+      ASSERT_EQ(ToFloatVec(outputs.at(0)), std::vector<float>({7, 0, 9}));
+      const LatencyStats stats = server.latency_stats();
+      ASSERT_EQ(stats.count, 1);
+      ASSERT_GE(stats.max_us, options.max_latency_us);
+    }
+  }
+  oneflow::LocalFS()->RecursivelyDeleteDir(model_path);
+}
+
 }  // namespace oneflow_api
@@ -0,0 +1,352 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include "oneflow/api/common/sync_access_tensor.h"
+#include "oneflow/api/cpp/batching.h"
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/common/scalar.h"
+#include "oneflow/core/framework/tensor.h"
+#include "oneflow/core/framework/tensor_tuple.h"
+#include "oneflow/core/functional/functional.h"
+
+namespace oneflow_api {
+
+namespace of = oneflow;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Request {
+  std::vector<Tensor> inputs;
+  int64_t sample_cnt;
+  Clock::time_point enqueue_time;
+  std::promise<std::vector<Tensor>> promise;
+};
+
+struct Batch {
+  std::vector<std::unique_ptr<Request>> requests;
+  std::vector<Tensor> outputs;
+  std::exception_ptr error;
+};
+
+of::Maybe<void> WaitTensorComputed(const std::shared_ptr<of::one::Tensor>& tensor) {
+  return of::SyncAccessTensor(tensor, [](uint64_t) {}, "const");
+}
+
+}  // namespace
+
+LatencyHistogram::LatencyHistogram()
+    : bucket_counts_(kBucketNum, 0), count_(0), sum_us_(0), max_us_(0) {}
+
+void LatencyHistogram::Add(double latency_us) {
+  const double clamped_us = std::max(latency_us, 1.0);
+  const int bucket = std::min(static_cast<int>(std::log2(clamped_us) * kSubBucketNum),
+                              static_cast<int>(kBucketNum) - 1);
+  std::unique_lock<std::mutex> lock(mutex_);
+  bucket_counts_.at(bucket) += 1;
+  count_ += 1;
+  sum_us_ += latency_us;
+  max_us_ = std::max(max_us_, latency_us);
+}
+
+double LatencyHistogram::BucketUpperBound(int bucket) const {
+  return std::exp2(static_cast<double>(bucket + 1) / kSubBucketNum);
+}
+
+LatencyStats LatencyHistogram::Stats() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  LatencyStats stats;
+  stats.count = count_;
+  if (count_ == 0) { return stats; }
+  stats.mean_us = sum_us_ / count_;
+  stats.max_us = max_us_;
+  const auto& Percentile = [&](double ratio) {
+    const int64_t rank = static_cast<int64_t>(std::ceil(ratio * count_));
+    int64_t acc_cnt = 0;
+    for (int i = 0; i < kBucketNum; ++i) {
+      acc_cnt += bucket_counts_.at(i);
+      if (acc_cnt >= rank) { return std::min(BucketUpperBound(i), max_us_); }
+    }
+    return max_us_;
+  };
+  stats.p50_us = Percentile(0.5);
+  stats.p90_us = Percentile(0.9);
+  stats.p99_us = Percentile(0.99);
+  return stats;
+}
+
+class BatchingServer::Impl final {
+ public:
+  Impl(const Graph& graph, const BatchingOptions& options);
+  ~Impl();
+
+  of::Maybe<void> Init();
+  of::Maybe<void> Submit(std::unique_ptr<Request>&& request);
+  LatencyStats latency_stats() const { return histogram_.Stats(); }
+
+ private:
+  void BatchLoop();
+  void FinishLoop();
+  bool TakeBatch(std::vector<std::unique_ptr<Request>>* requests);
+  of::Maybe<void> RunBatch(Batch* batch) const;
+  of::Maybe<void> FinishBatch(Batch* batch);
+
+  Graph graph_;
+  std::vector<std::vector<int64_t>> input_shapes_;
+  std::vector<DType> input_dtypes_;
+  Device device_;
+  int64_t graph_batch_size_;
+  int64_t max_batch_size_;
+  Clock::duration max_latency_;
+  size_t max_inflight_batches_;
+  LatencyHistogram histogram_;
+
+  std::mutex pending_mutex_;
+  std::condition_variable pending_cond_;
+  std::deque<std::unique_ptr<Request>> pending_;
+  bool shutdown_;
+
+  std::mutex inflight_mutex_;
+  std::condition_variable inflight_cond_;
+  std::deque<std::unique_ptr<Batch>> inflight_;
+  bool batch_loop_done_;
+
+  std::thread batch_thread_;
+  std::thread finish_thread_;
+};
+
+BatchingServer::Impl::Impl(const Graph& graph, const BatchingOptions& options)
+    : graph_(graph),
+      input_shapes_(graph.input_shapes()),
+      input_dtypes_(graph.input_dtypes()),
+      device_(graph.device()),
+      graph_batch_size_(0),
+      max_batch_size_(options.max_batch_size),
+      max_latency_(std::chrono::microseconds(options.max_latency_us)),
+      max_inflight_batches_(std::max(options.max_inflight_batches, 1)),
+      shutdown_(false),
+      batch_loop_done_(false) {}
+
+of::Maybe<void> BatchingServer::Impl::Init() {
+  CHECK_OR_RETURN(!input_shapes_.empty()) << "a graph without inputs can not be batched";
+  for (const auto& shape : input_shapes_) {
+    CHECK_OR_RETURN(!shape.empty()) << "batching needs the batch in dimension 0 of all the inputs";
+    if (graph_batch_size_ == 0) { graph_batch_size_ = shape.at(0); }
+    CHECK_EQ_OR_RETURN(shape.at(0), graph_batch_size_)
+        << "inputs of the graph have different batch sizes";
+  }
+  for (const auto& shape : graph_.output_shapes()) {
+    CHECK_OR_RETURN(!shape.empty() && shape.at(0) == graph_batch_size_)
+        << "batching needs the batch in dimension 0 of all the outputs";
+  }
+  if (max_batch_size_ <= 0 || max_batch_size_ > graph_batch_size_) {
+    max_batch_size_ = graph_batch_size_;
+  }
+  batch_thread_ = std::thread(&Impl::BatchLoop, this);
+  finish_thread_ = std::thread(&Impl::FinishLoop, this);
+  return of::Maybe<void>::Ok();
+}
+
+BatchingServer::Impl::~Impl() {
+  {
+    std::unique_lock<std::mutex> lock(pending_mutex_);
+    shutdown_ = true;
+  }
+  pending_cond_.notify_all();
+  if (batch_thread_.joinable()) { batch_thread_.join(); }
+  if (finish_thread_.joinable()) { finish_thread_.join(); }
+}
+
+of::Maybe<void> BatchingServer::Impl::Submit(std::unique_ptr<Request>&& request) {
+  CHECK_EQ_OR_RETURN(request->inputs.size(), input_shapes_.size())
+      << "the graph expects " << input_shapes_.size() << " inputs";
+  request->sample_cnt = 0;
+  for (int i = 0; i < request->inputs.size(); ++i) {
+    const std::vector<int64_t>& shape = request->inputs.at(i).shape();
+    const std::vector<int64_t>& graph_shape = input_shapes_.at(i);
+    // NOTE: inputs are concatenated into one batch, so a wrong one would fail the whole batch.
+    CHECK_OR_RETURN(request->inputs.at(i).dtype() == input_dtypes_.at(i))
+        << "data type of input " << i << " mismatch";
+    const Device device = request->inputs.at(i).device();
+    CHECK_OR_RETURN(device.type() == device_.type() && device.device_id() == device_.device_id())
+        << "device of input " << i << " mismatch";
+    CHECK_EQ_OR_RETURN(shape.size(), graph_shape.size()) << "ndim of input " << i << " mismatch";
+    CHECK_OR_RETURN(std::equal(shape.begin() + 1, shape.end(), graph_shape.begin() + 1))
+        << "shape of input " << i << " mismatch";
+    if (i == 0) { request->sample_cnt = shape.at(0); }
+    CHECK_EQ_OR_RETURN(shape.at(0), request->sample_cnt)
+        << "inputs of a request have different batch sizes";
+  }
+  CHECK_GT_OR_RETURN(request->sample_cnt, 0);
+  CHECK_LE_OR_RETURN(request->sample_cnt, max_batch_size_)
+      << "request batch size is larger than the max batch size";
+  request->enqueue_time = Clock::now();
+  {
+    std::unique_lock<std::mutex> lock(pending_mutex_);
+    CHECK_OR_RETURN(!shutdown_) << "batching server is shut down";
+    pending_.push_back(std::move(request));
+  }
+  pending_cond_.notify_one();
+  return of::Maybe<void>::Ok();
+}
+
+// Returns false when shut down and no request is left.
+bool BatchingServer::Impl::TakeBatch(std::vector<std::unique_ptr<Request>>* requests) {
+  std::unique_lock<std::mutex> lock(pending_mutex_);
+  pending_cond_.wait(lock, [this]() { return shutdown_ || !pending_.empty(); });
+  if (pending_.empty()) { return false; }
+  const Clock::time_point deadline = pending_.front()->enqueue_time + max_latency_;
+  int64_t sample_cnt = 0;
+  bool timeout = false;
+  while (true) {
+    while (!pending_.empty() && sample_cnt + pending_.front()->sample_cnt <= max_batch_size_) {
+      sample_cnt += pending_.front()->sample_cnt;
+      requests->push_back(std::move(pending_.front()));
+      pending_.pop_front();
+    }
+    // The batch is sent once it is full, the next request does not fit in or it is too late.
+    if (timeout || shutdown_ || sample_cnt == max_batch_size_ || !pending_.empty()) { break; }
+    timeout = pending_cond_.wait_until(lock, deadline) == std::cv_status::timeout;
+  }
+  return true;
+}
+
+void BatchingServer::Impl::BatchLoop() {
+  while (true) {
+    auto batch = std::make_unique<Batch>();
+    if (!TakeBatch(&batch->requests)) { break; }
+    {
+      std::unique_lock<std::mutex> lock(inflight_mutex_);
+      inflight_cond_.wait(lock, [this]() { return inflight_.size() < max_inflight_batches_; });
+    }
+    // NOTE: outputs are computed asynchronously, so the next batch is formed while it runs.
+    try {
+      RunBatch(batch.get()).GetOrThrow();
+    } catch (...) { batch->error = std::current_exception(); }
+    {
+      std::unique_lock<std::mutex> lock(inflight_mutex_);
+      inflight_.push_back(std::move(batch));
+    }
+    inflight_cond_.notify_all();
+  }
+  {
+    std::unique_lock<std::mutex> lock(inflight_mutex_);
+    batch_loop_done_ = true;
+  }
+  inflight_cond_.notify_all();
+}
+
+of::Maybe<void> BatchingServer::Impl::RunBatch(Batch* batch) const {
+  int64_t sample_cnt = 0;
+  for (const auto& request : batch->requests) { sample_cnt += request->sample_cnt; }
+  std::vector<Tensor> batch_inputs;
+  for (int i = 0; i < input_shapes_.size(); ++i) {
+    of::one::TensorTuple samples;
+    for (const auto& request : batch->requests) {
+      samples.push_back(request->inputs.at(i).internal_tensor());
+    }
+    if (sample_cnt < graph_batch_size_) {
+      const auto& first = samples.front();
+      of::DimVector pad_dims(input_shapes_.at(i).begin(), input_shapes_.at(i).end());
+      pad_dims.at(0) = graph_batch_size_ - sample_cnt;
+      samples.push_back(JUST(of::one::functional::Constant(
+          of::Shape(pad_dims), of::Scalar(0), first->dtype(), JUST(first->device()))));
+    }
+    if (samples.size() == 1) {
+      batch_inputs.emplace_back(samples.front());
+    } else {
+      batch_inputs.emplace_back(JUST(of::one::functional::Concat(samples, 0)));
+    }
+  }
+  batch->outputs = graph_.Run(batch_inputs);
+  return of::Maybe<void>::Ok();
+}
+
+of::Maybe<void> BatchingServer::Impl::FinishBatch(Batch* batch) {
+  for (const Tensor& output : batch->outputs) {
+    JUST(WaitTensorComputed(output.internal_tensor()));
+  }
+  int64_t offset = 0;
+  for (const auto& request : batch->requests) {
+    std::vector<Tensor> outputs;
+    for (const Tensor& output : batch->outputs) {
+      outputs.emplace_back(JUST(of::one::functional::Narrow(output.internal_tensor(), 0, offset,
+                                                            request->sample_cnt)));
+    }
+    offset += request->sample_cnt;
+    const auto& latency = Clock::now() - request->enqueue_time;
+    histogram_.Add(std::chrono::duration<double, std::micro>(latency).count());
+    request->promise.set_value(std::move(outputs));
+  }
+  return of::Maybe<void>::Ok();
+}
+
+void BatchingServer::Impl::FinishLoop() {
+  while (true) {
+    std::unique_ptr<Batch> batch;
+    {
+      std::unique_lock<std::mutex> lock(inflight_mutex_);
+      inflight_cond_.wait(lock, [this]() { return batch_loop_done_ || !inflight_.empty(); });
+      if (inflight_.empty()) { break; }
+      batch = std::move(inflight_.front());
+    }
+    if (!batch->error) {
+      try {
+        FinishBatch(batch.get()).GetOrThrow();
+      } catch (...) { batch->error = std::current_exception(); }
+    }
+    if (batch->error) {
+      for (const auto& request : batch->requests) {
+        try {
+          request->promise.set_exception(batch->error);
+        } catch (const std::future_error&) {
+          // the request has got its outputs before the error
+        }
+      }
+    }
+    {
+      // NOTE: the batch stays in flight until it is finished, it throttles BatchLoop.
+      std::unique_lock<std::mutex> lock(inflight_mutex_);
+      inflight_.pop_front();
+    }
+    inflight_cond_.notify_all();
+  }
+}
+
+BatchingServer::BatchingServer(const Graph& graph, const BatchingOptions& options)
+    : impl_(new Impl(graph, options)) {
+  impl_->Init().GetOrThrow();
+}
+
+BatchingServer::~BatchingServer() = default;
+
+std::future<std::vector<Tensor>> BatchingServer::Submit(const std::vector<Tensor>& inputs) {
+  auto request = std::make_unique<Request>();
+  request->inputs = inputs;
+  std::future<std::vector<Tensor>> future = request->promise.get_future();
+  impl_->Submit(std::move(request)).GetOrThrow();
+  return future;
+}
+
+LatencyStats BatchingServer::latency_stats() const { return impl_->latency_stats(); }
+
+}  // namespace oneflow_api
@@ -0,0 +1,98 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_API_CPP_BATCHING_H_
+#define ONEFLOW_API_CPP_BATCHING_H_
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "graph.h"
+#include "tensor.h"
+
+namespace oneflow_api {
+
+struct BatchingOptions {
+  // Max number of samples in one batch, 0 means the static batch size of the graph.
+  int64_t max_batch_size = 0;
+  // A batch which is not full is sent once its oldest request has waited this long.
+  int64_t max_latency_us = 2000;
+  // Number of batches running in the lazy runtime at the same time.
+  int32_t max_inflight_batches = 2;
+};
+
+struct LatencyStats {
+  int64_t count = 0;
+  double mean_us = 0;
+  double p50_us = 0;
+  double p90_us = 0;
+  double p99_us = 0;
+  double max_us = 0;
+};
+
+// Log-scale histogram with kSubBucketNum buckets per power of two, so percentiles are accurate
+// within about 9% for latencies from 1us up to several minutes.
+class LatencyHistogram final {
+ public:
+  LatencyHistogram();
+  ~LatencyHistogram() = default;
+
+  void Add(double latency_us);
+  LatencyStats Stats() const;
+
+ private:
+  static constexpr int kSubBucketNum = 8;
+  static constexpr int kBucketNum = 28 * kSubBucketNum;
+
+  double BucketUpperBound(int bucket) const;
+
+  mutable std::mutex mutex_;
+  std::vector<int64_t> bucket_counts_;
+  int64_t count_;
+  double sum_us_;
+  double max_us_;
+};
+
+// Queues single requests of a compiled graph and runs them in batches. Requests are concatenated
+// along dimension 0 and zero padded up to the static batch size of the graph, the outputs are
+// sliced back to the requests in the same way. So all the inputs and outputs of the graph must
+// have the batch in dimension 0.
+class BatchingServer final {
+ public:
+  explicit BatchingServer(const Graph& graph, const BatchingOptions& options = BatchingOptions());
+  BatchingServer(const BatchingServer&) = delete;
+  BatchingServer& operator=(const BatchingServer&) = delete;
+  // Runs the pending requests before returning.
+  ~BatchingServer();
+
+  // `inputs` hold the samples of one request, their dimension 0 is the request batch size and
+  // the other dimensions must match the graph. The future holds the outputs once they are
+  // computed, or the error of the batch.
+  std::future<std::vector<Tensor>> Submit(const std::vector<Tensor>& inputs);
+
+  // Latency from Submit to the outputs being computed, over all the finished requests.
+  LatencyStats latency_stats() const;
+
+  class Impl;
+
+ private:
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace oneflow_api
+
+#endif  // !ONEFLOW_API_CPP_BATCHING_H_
@@ -38,6 +38,9 @@ class Device final {
   int64_t device_id() const;
 
  private:
+  friend class Tensor;
+  friend class Graph;
+
   std::shared_ptr<oneflow::Symbol<oneflow::Device>> device_ = nullptr;
 };
 
@@ -27,10 +27,14 @@ limitations under the License.
 #include "oneflow/core/common/just.h"
 #include "oneflow/core/common/multi_client.h"
 #include "oneflow/core/common/optional.h"
+#include "oneflow/core/framework/multi_client_session_context.h"
+#include "oneflow/core/framework/session_util.h"
 #include "oneflow/core/framework/shut_down_util.h"
 #include "oneflow/core/job/cluster_instruction.h"
 #include "oneflow/core/job/env.pb.h"
 #include "oneflow/core/job/env_global_objects_scope.h"
+#include "oneflow/core/job/job_set.pb.h"
+#include "oneflow/core/job/session.h"
 #include "oneflow/core/control/ctrl_bootstrap.h"
 #include "oneflow/core/rpc/include/base.h"
 #include "oneflow/core/vm/vm_util.h"
@@ -116,14 +120,39 @@ of::Maybe<void> initEnv() {
   return of::Maybe<void>::Ok();
 }
 
+inline bool isSessionInited() {
+  return of::Global<of::MultiClientSessionContext>::Get() != nullptr;
+}
+
+of::Maybe<void> initSession() {
+  const int64_t session_id = of::NewSessionId();
+  JUST(of::RegsiterSession(session_id));
+  of::ConfigProto config_proto;
+  config_proto.mutable_resource();
+  config_proto.set_session_id(session_id);
+  of::Global<of::MultiClientSessionContext>::New();
+  JUST(of::Global<of::MultiClientSessionContext>::Get()->TryInit(config_proto));
+  return of::Maybe<void>::Ok();
+}
+
+of::Maybe<void> releaseSession() {
+  const int64_t session_id = JUST(of::GetDefaultSessionId());
+  JUST(of::Global<of::MultiClientSessionContext>::Get()->TryClose());
+  of::Global<of::MultiClientSessionContext>::Delete();
+  JUST(of::ClearSessionById(session_id));
+  return of::Maybe<void>::Ok();
+}
+
 }  // namespace
 
 void initialize() {
   of::SetIsMultiClient(true).GetOrThrow();
   if (!isEnvInited()) { initEnv().GetOrThrow(); }
+  if (!isSessionInited()) { initSession().GetOrThrow(); }
 }
 
 void release() {
+  if (isSessionInited()) { releaseSession().GetOrThrow(); }
   if (isEnvInited()) {
     // sync multi_client
     of::vm::ClusterSync().GetOrThrow();
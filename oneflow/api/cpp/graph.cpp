@@ -0,0 +1,413 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include "oneflow/api/common/sync_access_tensor.h"
+#include "oneflow/api/cpp/graph.h"
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/common/protobuf.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/framework/device.h"
+#include "oneflow/core/framework/dtype.h"
+#include "oneflow/core/framework/instructions_builder.h"
+#include "oneflow/core/framework/multi_client_session_context.h"
+#include "oneflow/core/framework/nn_graph.h"
+#include "oneflow/core/framework/session_util.h"
+#include "oneflow/core/framework/tensor.h"
+#include "oneflow/core/framework/tensor_tuple.h"
+#include "oneflow/core/functional/functional.h"
+#include "oneflow/core/job/job_build_and_infer_ctx_mgr.h"
+#include "oneflow/core/job/job_conf.cfg.h"
+#include "oneflow/core/job/scope.h"
+#include "oneflow/core/operator/operator.h"
+#include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/register/ofblob.h"
+#include "oneflow/core/rpc/include/global_process_ctx.h"
+#include "oneflow/core/serving/saved_model.pb.h"
+
+namespace oneflow_api {
+
+namespace of = oneflow;
+
+namespace {
+
+of::Maybe<std::string> GetSavedModelVersionPath(const std::string& model_path, int64_t version) {
+  of::fs::FileSystem* fs = of::LocalFS();
+  CHECK_OR_RETURN(fs->IsDirectory(model_path)) << model_path << " is not a valid directory";
+  if (version < 0) {
+    for (const std::string& sub_dir : fs->ListDir(model_path)) {
+      if (!fs->IsDirectory(of::JoinPath(model_path, sub_dir))) { continue; }
+      char* end = nullptr;
+      const int64_t sub_version = std::strtoll(sub_dir.c_str(), &end, 10);
+      if (end == sub_dir.c_str() || *end != '\0') { continue; }
+      version = std::max(version, sub_version);
+    }
+    CHECK_GE_OR_RETURN(version, 0) << "no version of saved model found in " << model_path;
+  }
+  const std::string version_path = of::JoinPath(model_path, std::to_string(version));
+  CHECK_OR_RETURN(fs->IsDirectory(version_path))
+      << "version " << version << " of saved model in dir " << model_path << " does not exist";
+  return version_path;
+}
+
+of::Maybe<void> ParseSavedModel(const std::string& version_path, of::SavedModel* saved_model) {
+  const std::string pb_path = of::JoinPath(version_path, "saved_model.pb");
+  const std::string prototxt_path = of::JoinPath(version_path, "saved_model.prototxt");
+  if (of::LocalFS()->FileExists(pb_path)) {
+    CHECK_OR_RETURN(of::TryParseProtoFromPbFile(pb_path, saved_model))
+        << "failed to parse " << pb_path;
+  } else {
+    CHECK_OR_RETURN(of::LocalFS()->FileExists(prototxt_path))
+        << "saved model meta file does not exist in " << version_path;
+    CHECK_OR_RETURN(of::TryParseProtoFromTextFile(prototxt_path, saved_model))
+        << "failed to parse " << prototxt_path;
+  }
+  return of::Maybe<void>::Ok();
+}
+
+template<typename MapT>
+std::vector<std::string> SortedKeys(const MapT& map) {
+  std::vector<std::string> keys;
+  for (const auto& pair : map) { keys.push_back(pair.first); }
+  std::sort(keys.begin(), keys.end());
+  return keys;
+}
+
+std::vector<std::vector<int64_t>> ToShapeVecs(const std::vector<of::Shape>& shapes) {
+  std::vector<std::vector<int64_t>> shape_vecs;
+  for (const of::Shape& shape : shapes) {
+    shape_vecs.emplace_back(shape.dim_vec().begin(), shape.dim_vec().end());
+  }
+  return shape_vecs;
+}
+
+std::string NewJobName(const std::string& graph_name) {
+  static std::atomic<int64_t> job_cnt(0);
+  return "_cpp_api_" + graph_name + "_" + std::to_string(job_cnt++);
+}
+
+of::Maybe<int64_t> NewScopeSymbolId(const of::JobConfigProto& job_conf,
+                                    const of::Symbol<of::Device>& device) {
+  const auto& cfg_job_conf = std::make_shared<of::cfg::JobConfigProto>(job_conf);
+  const std::string& device_tag = JUST(device->of_type());
+  const std::vector<std::string> machine_device_ids{std::to_string(of::GlobalProcessCtx::Rank())
+                                                    + ":" + std::to_string(device->device_id())};
+  const int64_t session_id = JUST(of::GetDefaultSessionId());
+  std::shared_ptr<of::Scope> scope;
+  JUST(of::PhysicalRun([&](of::InstructionsBuilder* builder) -> of::Maybe<void> {
+    scope = JUST(builder->BuildInitialScope(session_id, cfg_job_conf, device_tag,
+                                            machine_device_ids, nullptr, /*is_mirrored=*/false));
+    return of::Maybe<void>::Ok();
+  }));
+  return JUST(scope->symbol_id());
+}
+
+// Variables are saved as raw bytes in `<checkpoint_dir>/<variable_op_name>/out`
+of::Maybe<of::one::Tensor> LoadVariableTensor(const std::string& checkpoint_dir,
+                                              const of::OperatorConf& op_conf,
+                                              of::DataType default_data_type,
+                                              const of::Symbol<of::Device>& device) {
+  const of::VariableOpConf& var_conf = op_conf.variable_conf();
+  const of::Shape shape(var_conf.shape());
+  const of::DataType data_type =
+      var_conf.has_data_type() ? var_conf.data_type() : default_data_type;
+  const int64_t byte_size = shape.elem_cnt() * of::GetSizeOfDataType(data_type);
+  const std::string path = of::JoinPath(checkpoint_dir, op_conf.name(), "out");
+  std::ifstream in_stream(path, std::ios::binary | std::ios::ate);
+  CHECK_OR_RETURN(in_stream.is_open()) << "failed to open variable file " << path;
+  CHECK_EQ_OR_RETURN(static_cast<int64_t>(in_stream.tellg()), byte_size)
+      << "size of " << path << " does not match variable " << op_conf.name();
+  std::vector<char> buffer(byte_size);
+  in_stream.seekg(0);
+  in_stream.read(buffer.data(), byte_size);
+  CHECK_OR_RETURN(in_stream.good()) << "failed to read variable file " << path;
+
+  const auto& tensor =
+      JUST(of::one::functional::Empty(shape, JUST(of::DType::Get(data_type)), device));
+  JUST(of::SyncAccessTensor(
+      tensor,
+      [&buffer, byte_size](uint64_t of_blob_ptr) {
+        auto* of_blob = reinterpret_cast<of::OfBlob*>(of_blob_ptr);
+        of::MemoryCase host_mem_case;
+        host_mem_case.mutable_host_mem();
+        of::SyncAutoMemcpy(of_blob->mut_device_ctx(), of_blob->mut_blob()->mut_dptr(),
+                           buffer.data(), byte_size, of_blob->mut_blob()->mem_case(),
+                           host_mem_case);
+      },
+      "mut"));
+  return tensor;
+}
+
+}  // namespace
+
+class Graph::GraphImpl final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(GraphImpl);
+  explicit GraphImpl(const of::Symbol<of::Device>& device) : device_(device) {}
+  ~GraphImpl() = default;
+
+  of::Maybe<void> Load(const std::string& model_path, int64_t version,
+                       const std::string& graph_name, const std::string& signature_name);
+  of::Maybe<void> Run(const std::vector<Tensor>& inputs, std::vector<Tensor>* outputs) const;
+
+  const std::vector<std::string>& input_names() const { return input_names_; }
+  const std::vector<std::string>& output_names() const { return output_names_; }
+  const std::vector<of::Shape>& input_shapes() const { return input_shapes_; }
+  const std::vector<of::Shape>& output_shapes() const { return output_shapes_; }
+  const std::vector<of::Symbol<of::DType>>& input_dtypes() const { return input_dtypes_; }
+  const of::Symbol<of::Device>& device() const { return device_; }
+
+ private:
+  of::Maybe<void> BuildJob(const of::JobConfigProto& job_conf, const of::GraphDef& graph_def,
+                           const of::JobSignatureDef& signature);
+  of::Maybe<void> AddOpsAndComplete(const of::JobConfigProto& job_conf,
+                                    const of::GraphDef& graph_def,
+                                    const of::JobSignatureDef& signature);
+  of::Maybe<void> CompileAndInitRuntime(const std::string& job_name);
+
+  of::Symbol<of::Device> device_;
+  std::shared_ptr<of::NNGraph> nn_graph_;
+  std::vector<std::string> input_names_;
+  std::vector<std::string> output_names_;
+  std::vector<std::string> input_op_names_;
+  std::vector<std::string> output_op_names_;
+  std::vector<of::Shape> input_shapes_;
+  std::vector<of::Symbol<of::DType>> input_dtypes_;
+  std::vector<of::Shape> output_shapes_;
+  std::vector<of::Symbol<of::DType>> output_dtypes_;
+  std::vector<of::OperatorConf> variable_op_confs_;
+  std::vector<std::string> variable_op_names_;
+  of::one::TensorTuple variable_tensors_;
+};
+
+of::Maybe<void> Graph::GraphImpl::Load(const std::string& model_path, int64_t version,
+                                       const std::string& graph_name,
+                                       const std::string& signature_name) {
+  const std::string version_path = *JUST(GetSavedModelVersionPath(model_path, version));
+  of::SavedModel saved_model;
+  JUST(ParseSavedModel(version_path, &saved_model));
+
+  const std::string& cur_graph_name =
+      graph_name.empty() ? saved_model.default_graph_name() : graph_name;
+  const auto& graph_it = saved_model.graphs().find(cur_graph_name);
+  CHECK_OR_RETURN(graph_it != saved_model.graphs().end())
+      << "graph " << cur_graph_name << " does not exist";
+  const of::GraphDef& graph_def = graph_it->second;
+  const std::string& cur_signature_name =
+      signature_name.empty() ? graph_def.default_signature_name() : signature_name;
+  const auto& signature_it = graph_def.signatures().find(cur_signature_name);
+  CHECK_OR_RETURN(signature_it != graph_def.signatures().end())
+      << "signature " << cur_signature_name << " does not exist";
+
+  of::JobConfigProto job_conf;
+  job_conf.set_job_name(NewJobName(cur_graph_name));
+  job_conf.mutable_predict_conf();
+  JUST(BuildJob(job_conf, graph_def, signature_it->second));
+
+  const std::string checkpoint_dir = of::JoinPath(version_path, saved_model.checkpoint_dir());
+  for (const auto& op_conf : variable_op_confs_) {
+    variable_op_names_.push_back(op_conf.name());
+    variable_tensors_.push_back(JUST(
+        LoadVariableTensor(checkpoint_dir, op_conf, job_conf.default_data_type(), device_)));
+  }
+  JUST(CompileAndInitRuntime(job_conf.job_name()));
+  return of::Maybe<void>::Ok();
+}
+
+of::Maybe<void> Graph::GraphImpl::BuildJob(const of::JobConfigProto& job_conf,
+                                           const of::GraphDef& graph_def,
+                                           const of::JobSignatureDef& signature) {
+  auto* mgr = JUST(of::GlobalJobBuildAndInferCtxMgr());
+  JUST(mgr->OpenJobBuildAndInferCtx(job_conf.job_name()));
+  const auto& maybe_completed = TRY(AddOpsAndComplete(job_conf, graph_def, signature));
+  JUST(mgr->CloseCurrentJobBuildAndInferCtx());
+  return maybe_completed;
+}
+
+of::Maybe<void> Graph::GraphImpl::AddOpsAndComplete(const of::JobConfigProto& job_conf,
+                                                    const of::GraphDef& graph_def,
+                                                    const of::JobSignatureDef& signature) {
+  auto* ctx = JUST(of::GetCurInferCtx());
+  JUST(ctx->SetJobConf(job_conf));
+  const int64_t scope_symbol_id = JUST(NewScopeSymbolId(job_conf, device_));
+  const std::string& device_tag = JUST(device_->of_type());
+
+  // NOTE: return ops of the single-client saved model are replaced by output ops below.
+  of::HashMap<std::string, std::string> return_op_name2in_lbn;
+  of::HashSet<std::string> output_op_names;
+  for (const of::OperatorConf& origin_op_conf : graph_def.op_list()) {
+    if (origin_op_conf.has_return_conf()) {
+      return_op_name2in_lbn.emplace(origin_op_conf.name(), origin_op_conf.return_conf().in());
+      continue;
+    }
+    of::OperatorConf op_conf(origin_op_conf);
+    op_conf.set_scope_symbol_id(scope_symbol_id);
+    op_conf.set_device_tag(device_tag);
+    if (op_conf.has_variable_conf()) {
+      // NOTE: variables are initialized by the eager tensors loaded from checkpoint.
+      op_conf.mutable_variable_conf()->mutable_initializer()->mutable_empty_conf();
+      variable_op_confs_.push_back(op_conf);
+    }
+    if (op_conf.has_output_conf()) { output_op_names.insert(op_conf.name()); }
+    JUST(ctx->AddAndInferConsistentOp(op_conf));
+  }
+
+  for (const std::string& input_name : SortedKeys(signature.inputs())) {
+    const of::LogicalBlobId& lbi = signature.inputs().at(input_name).lbi();
+    const std::string lbn = of::GenLogicalBlobName(lbi);
+    input_names_.push_back(input_name);
+    input_op_names_.push_back(lbi.op_name());
+    input_shapes_.push_back(*JUST(ctx->GetStaticShape(lbn)));
+    input_dtypes_.push_back(JUST(of::DType::Get(JUST(ctx->GetDataType(lbn)))));
+  }
+
+  for (const std::string& output_name : SortedKeys(signature.outputs())) {
+    const of::LogicalBlobId& lbi = signature.outputs().at(output_name).lbi();
+    output_names_.push_back(output_name);
+    if (output_op_names.count(lbi.op_name()) > 0) {
+      const std::string lbn = of::GenLogicalBlobName(lbi);
+      output_op_names_.push_back(lbi.op_name());
+      output_shapes_.push_back(*JUST(ctx->GetStaticShape(lbn)));
+      output_dtypes_.push_back(JUST(of::DType::Get(JUST(ctx->GetDataType(lbn)))));
+      continue;
+    }
+    const auto& return_it = return_op_name2in_lbn.find(lbi.op_name());
+    const std::string in_lbn = return_it == return_op_name2in_lbn.end()
+                                   ? of::GenLogicalBlobName(lbi)
+                                   : return_it->second;
+    const of::Shape shape = *JUST(ctx->GetStaticShape(in_lbn));
+    const of::DataType data_type = JUST(ctx->GetDataType(in_lbn));
+
+    of::OperatorConf op_conf;
+    op_conf.set_name("_" + job_conf.job_name() + "-output_" + output_name);
+    op_conf.set_scope_symbol_id(scope_symbol_id);
+    op_conf.set_device_tag(device_tag);
+    of::OutputOpConf* output_conf = op_conf.mutable_output_conf();
+    output_conf->set_in(in_lbn);
+    output_conf->set_out("out");
+    of::InterfaceBlobConf* blob_conf = output_conf->mutable_blob_conf();
+    shape.ToProto(blob_conf->mutable_shape());
+    blob_conf->set_data_type(data_type);
+    blob_conf->set_is_dynamic(false);
+    blob_conf->mutable_nd_sbp()->add_sbp_parallel()->mutable_broadcast_parallel();
+    JUST(ctx->AddAndInferConsistentOp(op_conf));
+
+    output_op_names_.push_back(op_conf.name());
+    output_shapes_.push_back(shape);
+    output_dtypes_.push_back(JUST(of::DType::Get(data_type)));
+  }
+  JUST(ctx->Complete());
+  return of::Maybe<void>::Ok();
+}
+
+of::Maybe<void> Graph::GraphImpl::CompileAndInitRuntime(const std::string& job_name) {
+  nn_graph_ = std::make_shared<of::NNGraph>(job_name);
+  // NOTE: registered tensors only provide the static tensor meta of the inputs and outputs.
+  std::vector<std::shared_ptr<of::one::Tensor>> input_tensors;
+  for (int i = 0; i < input_op_names_.size(); ++i) {
+    input_tensors.push_back(
+        JUST(of::one::functional::Empty(input_shapes_.at(i), input_dtypes_.at(i), device_)));
+  }
+  std::vector<std::shared_ptr<of::one::Tensor>> output_tensors;
+  for (int i = 0; i < output_op_names_.size(); ++i) {
+    output_tensors.push_back(
+        JUST(of::one::functional::Empty(output_shapes_.at(i), output_dtypes_.at(i), device_)));
+  }
+  JUST(nn_graph_->RegisterInputOpNamesAndTensors(input_op_names_, input_tensors));
+  JUST(nn_graph_->RegisterOutputOpNamesAndTensors(output_op_names_, output_tensors));
+  JUST(nn_graph_->RegisterVariableOpNamesAndTensors(
+      variable_op_names_, std::vector<std::shared_ptr<of::one::Tensor>>(
+                              variable_tensors_.begin(), variable_tensors_.end())));
+  JUST(nn_graph_->CompileAndInitRuntime());
+  JUST(of::Global<of::MultiClientSessionContext>::Get()->AddCGraph(nn_graph_));
+  return of::Maybe<void>::Ok();
+}
+
+of::Maybe<void> Graph::GraphImpl::Run(const std::vector<Tensor>& inputs,
+                                      std::vector<Tensor>* outputs) const {
+  CHECK_EQ_OR_RETURN(inputs.size(), input_names_.size())
+      << "graph " << nn_graph_->job_name() << " expects " << input_names_.size() << " inputs";
+  of::one::TensorTuple input_tuple;
+  input_tuple.reserve(inputs.size());
+  for (int i = 0; i < inputs.size(); ++i) {
+    const auto& tensor = inputs.at(i).internal_tensor();
+    CHECK_OR_RETURN(*tensor->shape() == input_shapes_.at(i))
+        << "input " << input_names_.at(i) << " of graph " << nn_graph_->job_name()
+        << " expects shape " << input_shapes_.at(i).ToString() << ", but got "
+        << tensor->shape()->ToString();
+    CHECK_OR_RETURN(tensor->dtype() == input_dtypes_.at(i))
+        << "input " << input_names_.at(i) << " of graph " << nn_graph_->job_name()
+        << " expects data type " << input_dtypes_.at(i)->name() << ", but got "
+        << tensor->dtype()->name();
+    CHECK_OR_RETURN(JUST(tensor->device()) == device_)
+        << "input " << input_names_.at(i) << " of graph " << nn_graph_->job_name()
+        << " expects device " << device_->ToString() << ", but got "
+        << JUST(tensor->device())->ToString();
+    input_tuple.push_back(tensor);
+  }
+  of::one::TensorTuple output_tuple;
+  output_tuple.reserve(output_op_names_.size());
+  for (int i = 0; i < output_op_names_.size(); ++i) {
+    output_tuple.push_back(
+        JUST(of::one::functional::Empty(output_shapes_.at(i), output_dtypes_.at(i), device_)));
+  }
+  JUST(of::RunLazyNNGraph(input_tuple, output_tuple, variable_tensors_, nn_graph_));
+  outputs->clear();
+  outputs->reserve(output_tuple.size());
+  for (const auto& output : output_tuple) { outputs->emplace_back(output); }
+  return of::Maybe<void>::Ok();
+}
+
+Graph Graph::Load(const std::string& model_path, const Device& device, int64_t version,
+                  const std::string& graph_name, const std::string& signature_name) {
+  const auto& impl = std::make_shared<GraphImpl>(*device.device_);
+  impl->Load(model_path, version, graph_name, signature_name).GetOrThrow();
+  return Graph(impl);
+}
+
+const std::vector<std::string>& Graph::input_names() const { return impl_->input_names(); }
+
+const std::vector<std::string>& Graph::output_names() const { return impl_->output_names(); }
+
+std::vector<std::vector<int64_t>> Graph::input_shapes() const {
+  return ToShapeVecs(impl_->input_shapes());
+}
+
+std::vector<std::vector<int64_t>> Graph::output_shapes() const {
+  return ToShapeVecs(impl_->output_shapes());
+}
+
+std::vector<DType> Graph::input_dtypes() const {
+  std::vector<DType> dtypes;
+  for (const auto& dtype : impl_->input_dtypes()) {
+    dtypes.push_back(static_cast<DType>(dtype->data_type()));
+  }
+  return dtypes;
+}
+
+Device Graph::device() const {
+  return Device(impl_->device()->type(), impl_->device()->device_id());
+}
+
+std::vector<Tensor> Graph::Run(const std::vector<Tensor>& inputs) const {
+  std::vector<Tensor> outputs;
+  impl_->Run(inputs, &outputs).GetOrThrow();
+  return outputs;
+}
+
+}  // namespace oneflow_api
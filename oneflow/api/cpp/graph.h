@@ -0,0 +1,62 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_API_CPP_GRAPH_H_
+#define ONEFLOW_API_CPP_GRAPH_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "device.h"
+#include "tensor.h"
+
+namespace oneflow_api {
+
+class Graph final {
+ public:
+  // Loads `<model_path>/<version>/saved_model.pb` (or `saved_model.prototxt`) together with its
+  // checkpoint, and compiles the chosen graph to a plan on `device` once. A negative version means
+  // the latest one, empty names mean the defaults recorded in the SavedModel.
+  static Graph Load(const std::string& model_path, const Device& device, int64_t version = -1,
+                    const std::string& graph_name = "", const std::string& signature_name = "");
+
+  // Names of the signature inputs/outputs, in the order used by Run.
+  const std::vector<std::string>& input_names() const;
+  const std::vector<std::string>& output_names() const;
+  // Static shapes compiled into the plan, in the same order as the names.
+  std::vector<std::vector<int64_t>> input_shapes() const;
+  std::vector<std::vector<int64_t>> output_shapes() const;
+  std::vector<DType> input_dtypes() const;
+  // The device the graph is compiled on, which is also the device of the inputs.
+  Device device() const;
+
+  // Input tensors are fed to the lazy runtime without copy, their number, shapes, data types and
+  // device must match the signature or an error is thrown. Output tensors are returned before the
+  // job finishes, reading them blocks until they are ready. Run can be called from several
+  // threads at the same time, the calls are pipelined by the runtime.
+  std::vector<Tensor> Run(const std::vector<Tensor>& inputs) const;
+
+  class GraphImpl;
+
+ private:
+  explicit Graph(const std::shared_ptr<GraphImpl>& impl) : impl_(impl) {}
+
+  std::shared_ptr<GraphImpl> impl_;
+};
+
+}  // namespace oneflow_api
+
+#endif  // !ONEFLOW_API_CPP_GRAPH_H_
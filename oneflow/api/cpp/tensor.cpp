@@ -0,0 +1,93 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/api/common/sync_access_tensor.h"
+#include "oneflow/api/cpp/tensor.h"
+#include "oneflow/core/common/data_type.h"
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/common/symbol.h"
+#include "oneflow/core/framework/device.h"
+#include "oneflow/core/framework/dtype.h"
+#include "oneflow/core/framework/tensor.h"
+#include "oneflow/core/functional/functional.h"
+#include "oneflow/core/register/ofblob.h"
+
+namespace oneflow_api {
+
+namespace of = oneflow;
+
+namespace {
+
+of::Maybe<of::one::Tensor> NewEmptyTensor(const std::vector<int64_t>& shape, DType dtype,
+                                          const of::Symbol<of::Device>& device) {
+  const auto& of_dtype = JUST(of::DType::Get(static_cast<of::DataType>(dtype)));
+  return of::one::functional::Empty(of::Shape(of::DimVector(shape.begin(), shape.end())),
+                                    of_dtype, device);
+}
+
+}  // namespace
+
+Tensor::Tensor(const std::vector<int64_t>& shape, DType dtype, const Device& device)
+    : tensor_(NewEmptyTensor(shape, dtype, *device.device_).GetPtrOrThrow()) {}
+
+Tensor::Tensor(const std::shared_ptr<oneflow::one::Tensor>& tensor) : tensor_(tensor) {}
+
+std::vector<int64_t> Tensor::shape() const {
+  const auto& dim_vec = tensor_->shape()->dim_vec();
+  return std::vector<int64_t>(dim_vec.begin(), dim_vec.end());
+}
+
+int64_t Tensor::elem_cnt() const { return tensor_->shape()->elem_cnt(); }
+
+DType Tensor::dtype() const { return static_cast<DType>(tensor_->dtype()->data_type()); }
+
+Device Tensor::device() const {
+  const auto& device = tensor_->device().GetOrThrow();
+  return Device(device->type(), device->device_id());
+}
+
+template<typename T>
+void Tensor::CopyFrom(const T* buffer) {
+  const int64_t elem_cnt = this->elem_cnt();
+  of::SyncAccessTensor(
+      tensor_,
+      [buffer, elem_cnt](uint64_t of_blob_ptr) {
+        reinterpret_cast<of::OfBlob*>(of_blob_ptr)->AutoMemCopyFrom<T>(buffer, elem_cnt);
+      },
+      "mut")
+      .GetOrThrow();
+}
+
+template<typename T>
+void Tensor::CopyTo(T* buffer) const {
+  const int64_t elem_cnt = this->elem_cnt();
+  of::SyncAccessTensor(
+      tensor_,
+      [buffer, elem_cnt](uint64_t of_blob_ptr) {
+        reinterpret_cast<of::OfBlob*>(of_blob_ptr)->AutoMemCopyTo<T>(buffer, elem_cnt);
+      },
+      "const")
+      .GetOrThrow();
+}
+
+#define INSTANTIATE_TENSOR_COPY_FUNCS(cpp_type, data_type)           \
+  template void Tensor::CopyFrom<cpp_type>(const cpp_type* buffer); \
+  template void Tensor::CopyTo<cpp_type>(cpp_type* buffer) const;
+
+OF_PP_FOR_EACH_TUPLE(INSTANTIATE_TENSOR_COPY_FUNCS, POD_DATA_TYPE_SEQ)
+
+#undef INSTANTIATE_TENSOR_COPY_FUNCS
+
+}  // namespace oneflow_api
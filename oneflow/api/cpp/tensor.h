@@ -0,0 +1,72 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_API_CPP_TENSOR_H_
+#define ONEFLOW_API_CPP_TENSOR_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "device.h"
+
+namespace oneflow {
+
+namespace one {
+
+class Tensor;
+
+}  // namespace one
+
+}  // namespace oneflow
+
+namespace oneflow_api {
+
+// Keeps the same values as oneflow::DataType
+enum class DType {
+  kInvalidDataType = 0,
+  kChar = 1,
+  kFloat = 2,
+  kDouble = 3,
+  kInt8 = 4,
+  kInt32 = 5,
+  kInt64 = 6,
+  kUInt8 = 7,
+};
+
+class Tensor final {
+ public:
+  Tensor(const std::vector<int64_t>& shape, DType dtype, const Device& device);
+  explicit Tensor(const std::shared_ptr<oneflow::one::Tensor>& tensor);
+
+  std::vector<int64_t> shape() const;
+  int64_t elem_cnt() const;
+  DType dtype() const;
+  Device device() const;
+
+  // Both block the host until all the instructions touching this tensor are done.
+  template<typename T>
+  void CopyFrom(const T* buffer);
+  template<typename T>
+  void CopyTo(T* buffer) const;
+
+  const std::shared_ptr<oneflow::one::Tensor>& internal_tensor() const { return tensor_; }
+
+ private:
+  std::shared_ptr<oneflow::one::Tensor> tensor_ = nullptr;
+};
+
+}  // namespace oneflow_api
+
+#endif  // !ONEFLOW_API_CPP_TENSOR_H_
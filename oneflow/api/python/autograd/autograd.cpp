@@ -26,6 +26,8 @@ limitations under the License.
 #include "oneflow/core/functional/functional.h"
 #include "oneflow/core/common/util.h"
 
+namespace py = pybind11;
+
 namespace oneflow {
 namespace autograd {
 
@@ -67,26 +69,28 @@ Maybe<one::TensorTuple> CheckAndInitOutGrads(const one::TensorTuple& outputs,
 }  // namespace
 
 Maybe<one::TensorTuple> Backward(const one::TensorTuple& outputs, const one::TensorTuple& out_grads,
-                                 bool retain_graph, bool create_graph) {
+                                 bool retain_graph, bool create_graph, int32_t thread_num) {
   if (create_graph) { retain_graph = true; }
   std::shared_ptr<one::TensorTuple> gradients = JUST(CheckAndInitOutGrads(outputs, out_grads));
   JUST(one::GetThreadLocalAutogradEngine()->RunBackwardAndSaveGrads4LeafTensorIf(
-      outputs, *gradients, retain_graph, create_graph));
+      outputs, *gradients, retain_graph, create_graph, thread_num));
   return std::make_shared<one::TensorTuple>(0);
 }
 
 Maybe<one::TensorTuple> Grad(const one::TensorTuple& outputs, const one::TensorTuple& inputs,
                              const one::TensorTuple& out_grads, bool retain_graph,
-                             bool create_graph) {
+                             bool create_graph, int32_t thread_num) {
   if (create_graph) { retain_graph = true; }
-  if (inputs.empty()) { return Backward(outputs, out_grads, retain_graph, create_graph); }
+  if (inputs.empty()) {
+    return Backward(outputs, out_grads, retain_graph, create_graph, thread_num);
+  }
   CHECK_OR_RETURN(std::all_of(
       inputs.begin(), inputs.end(),
       [](const std::shared_ptr<one::Tensor>& tensor) { return tensor->requires_grad(); }))
       << "All input tensors `.requires_grad` should be true";
   std::shared_ptr<one::TensorTuple> gradients = JUST(CheckAndInitOutGrads(outputs, out_grads));
   return one::GetThreadLocalAutogradEngine()->RunBackwardAndReturnInputsTensorGradIf(
-      outputs, inputs, *gradients, retain_graph, create_graph);
+      outputs, inputs, *gradients, retain_graph, create_graph, thread_num);
 }
 
 }  // namespace autograd
@@ -96,8 +100,9 @@ namespace {
 std::shared_ptr<oneflow::one::TensorTuple> BackwardOrThrow(
     const std::shared_ptr<oneflow::one::TensorTuple>& outputs,
     const std::shared_ptr<oneflow::one::TensorTuple>& out_grads, bool retain_graph,
-    bool create_graph) {
-  return oneflow::autograd::Backward(*outputs, *out_grads.get(), retain_graph, create_graph)
+    bool create_graph, int32_t thread_num) {
+  return oneflow::autograd::Backward(*outputs, *out_grads.get(), retain_graph, create_graph,
+                                     thread_num)
       .GetPtrOrThrow();
 }
 
@@ -105,14 +110,17 @@ std::shared_ptr<oneflow::one::TensorTuple> GradOrThrow(
     const std::shared_ptr<oneflow::one::TensorTuple>& outputs,
     const std::shared_ptr<oneflow::one::TensorTuple>& inputs,
     const std::shared_ptr<oneflow::one::TensorTuple>& out_grads, bool retain_graph,
-    bool create_graph) {
-  return oneflow::autograd::Grad(*outputs, *inputs, *out_grads.get(), retain_graph, create_graph)
+    bool create_graph, int32_t thread_num) {
+  return oneflow::autograd::Grad(*outputs, *inputs, *out_grads.get(), retain_graph, create_graph,
+                                 thread_num)
       .GetPtrOrThrow();
 }
 
 ONEFLOW_API_PYBIND11_MODULE("autograd", m) {
-  m.def("backward", &BackwardOrThrow);
-  m.def("grad", &GradOrThrow);
+  m.def("backward", &BackwardOrThrow, py::arg("outputs"), py::arg("out_grads"),
+        py::arg("retain_graph"), py::arg("create_graph"), py::arg("thread_num") = 1);
+  m.def("grad", &GradOrThrow, py::arg("outputs"), py::arg("inputs"), py::arg("out_grads"),
+        py::arg("retain_graph"), py::arg("create_graph"), py::arg("thread_num") = 1);
 }
 
 }  // namespace
@@ -60,10 +60,17 @@ py::object PackTensorTuple(const one::TensorTuple& tp) {
 
 // wrap PyFunction, unpack the inputs from TensorTuple and pack outputs to TensorTuple
 one::AutogradFunctionBase::FType PackPyFunctionToFType(const py::function& func) {
-  return [func](const std::shared_ptr<one::FunctionAutoGradCaptureState>& ctx,
-                const one::TensorTuple& inputs) {
+  // Backward may run on the worker threads of a parallel backward without the GIL, which is
+  // needed to call the function and to release it as well.
+  std::shared_ptr<py::function> func_ptr(new py::function(func), [](py::function* func) {
+    py::gil_scoped_acquire acquire;
+    delete func;
+  });
+  return [func_ptr](const std::shared_ptr<one::FunctionAutoGradCaptureState>& ctx,
+                    const one::TensorTuple& inputs) {
+    py::gil_scoped_acquire acquire;
     const py::tuple& a = py::cast(inputs);
-    py::object res = func(ctx, *a);
+    py::object res = (*func_ptr)(ctx, *a);
     return UnpackTensorTuple(res).GetPtrOrThrow();
   };
 }
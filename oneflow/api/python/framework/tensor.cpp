@@ -94,8 +94,20 @@ std::tuple<std::vector<Shape>, std::vector<Symbol<DType>>> GetTensorBufferShapes
   return MaybeGetTensorBufferShapesAndDTypes(tensor).GetOrThrow();
 }
 
-void ApiRegisterTensorHook(const std::shared_ptr<Tensor>& self, const AutogradMeta::Hook& hook) {
-  return RegisterTensorHook(self, hook).GetOrThrow();
+void ApiRegisterTensorHook(const std::shared_ptr<Tensor>& self, const py::function& hook) {
+  // Hooks may fire on the worker threads of a parallel backward, which do not hold the GIL.
+  std::shared_ptr<py::function> hook_ptr(new py::function(hook), [](py::function* hook) {
+    py::gil_scoped_acquire acquire;
+    delete hook;
+  });
+  const AutogradMeta::Hook wrapped_hook =
+      [hook_ptr](const std::shared_ptr<const Tensor>& grad) -> std::shared_ptr<Tensor> {
+    py::gil_scoped_acquire acquire;
+    py::object res = (*hook_ptr)(grad);
+    if (res.is_none()) { return nullptr; }
+    return res.cast<std::shared_ptr<Tensor>>();
+  };
+  return RegisterTensorHook(self, wrapped_hook).GetOrThrow();
 }
 
 bool ApiIsContiguous(const std::shared_ptr<Tensor>& tensor) {
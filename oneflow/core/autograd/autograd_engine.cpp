@@ -16,6 +16,8 @@ limitations under the License.
 
 #include <stack>
 #include <queue>
+#include <mutex>
+#include <condition_variable>
 #include "oneflow/core/autograd/autograd_engine.h"
 #include "oneflow/core/autograd/autograd_meta.h"
 #include "oneflow/core/framework/tensor.h"
@@ -25,6 +27,9 @@ limitations under the License.
 #include "oneflow/core/autograd/autograd_mode.h"
 #include "oneflow/core/eager/dev_vm_dep_object_consume_mode.h"
 #include "oneflow/core/functional/functional.h"
+#include "oneflow/core/common/blocking_counter.h"
+#include "oneflow/core/common/foreign_lock_helper.h"
+#include "oneflow/core/thread/thread_pool.h"
 
 namespace oneflow {
 namespace one {
@@ -79,27 +84,54 @@ Maybe<void> CheckConsistentTensorsMeta(const TensorTuple& tensor_tuple) {
   return Maybe<void>::Ok();
 }
 
+// Backward worker threads are kept apart from Global<ThreadPool>, which cpu kernels may block on
+// while a worker is waiting for its successors. One pool with at least `thread_num` threads is
+// shared by all the backward calls. It is replaced by a larger one when more threads are asked
+// for, and the old one is freed once the backward calls using it are done.
+std::shared_ptr<ThreadPool> GetBackwardThreadPool(int32_t thread_num) {
+  static std::mutex mutex;
+  static std::shared_ptr<ThreadPool> thread_pool;
+  std::unique_lock<std::mutex> lock(mutex);
+  if (!thread_pool || thread_pool->thread_num() < thread_num) {
+    thread_pool = std::make_shared<ThreadPool>(thread_num);
+  }
+  return thread_pool;
+}
+
+bool HasConsistentTensor(const TensorTuple& tensor_tuple) {
+  return std::any_of(tensor_tuple.begin(), tensor_tuple.end(),
+                     [](const std::shared_ptr<Tensor>& tensor) { return tensor->is_consistent(); });
+}
+
 }  // namespace
 
 Maybe<void> AutogradEngine::RunBackwardAndSaveGrads4LeafTensorIf(const TensorTuple& outputs,
                                                                  const TensorTuple& out_grads,
                                                                  bool retain_graph,
-                                                                 bool create_graph) {
+                                                                 bool create_graph,
+                                                                 int32_t thread_num) {
+  CHECK_GT_OR_RETURN(thread_num, 0);
   JUST(CheckConsistentTensorsMeta(outputs));
   JUST(CheckConsistentTensorsMeta(out_grads));
   DisableCheckConsistentTensorMetaScope disable_meta_check;
-  return RunBackwardAndSaveGrads4LeafTensor(outputs, out_grads, retain_graph, create_graph);
+  // Consistent backward issues collective instructions, which must keep the same order on all
+  // ranks.
+  if (HasConsistentTensor(outputs)) { thread_num = 1; }
+  return RunBackwardAndSaveGrads4LeafTensor(outputs, out_grads, retain_graph, create_graph,
+                                            thread_num);
 }
 
 Maybe<TensorTuple> AutogradEngine::RunBackwardAndReturnInputsTensorGradIf(
     const TensorTuple& outputs, const TensorTuple& inputs, const TensorTuple& out_grads,
-    bool retain_graph, bool create_graph) {
+    bool retain_graph, bool create_graph, int32_t thread_num) {
+  CHECK_GT_OR_RETURN(thread_num, 0);
   JUST(CheckConsistentTensorsMeta(outputs));
   JUST(CheckConsistentTensorsMeta(inputs));
   JUST(CheckConsistentTensorsMeta(out_grads));
   DisableCheckConsistentTensorMetaScope disable_meta_check;
+  if (HasConsistentTensor(outputs) || HasConsistentTensor(inputs)) { thread_num = 1; }
   return RunBackwardAndReturnInputsTensorGrad(outputs, inputs, out_grads, retain_graph,
-                                              create_graph);
+                                              create_graph, thread_num);
 }
 
 StackFunctionNode::StackFunctionNode(
@@ -200,7 +232,8 @@ void StackAutogradEngine::ClearReleasedFunctionNodes() {
 Maybe<void> StackAutogradEngine::RunBackwardAndSaveGrads4LeafTensor(const TensorTuple& outputs,
                                                                     const TensorTuple& out_grads,
                                                                     bool retain_graph,
-                                                                    bool create_graph) {
+                                                                    bool create_graph,
+                                                                    int32_t thread_num) {
   ClearReleasedFunctionNodes();
   for (int i = 0; i < outputs.size(); ++i) {
     JUST(JUST(outputs.at(i)->current_grad())->PushPartialTensor(out_grads.at(i)));
@@ -222,7 +255,7 @@ Maybe<void> StackAutogradEngine::RunBackwardAndSaveGrads4LeafTensor(const Tensor
 
 Maybe<TensorTuple> StackAutogradEngine::RunBackwardAndReturnInputsTensorGrad(
     const TensorTuple& outputs, const TensorTuple& inputs, const TensorTuple& out_grads,
-    bool retain_graph, bool create_graph) {
+    bool retain_graph, bool create_graph, int32_t thread_num) {
   ClearReleasedFunctionNodes();
   std::shared_ptr<TensorTuple> input_current_grad = std::make_shared<TensorTuple>(inputs.size());
   std::vector<bool> ori_retain_grad(inputs.size());
@@ -315,8 +348,9 @@ GraphFunctionNode::GraphFunctionNode(
   backward_fn_ = backward_fn;
 }
 
-GraphTask::GraphTask(const TensorTuple& outputs, bool retain_graph, bool create_graph)
-    : retain_graph_(retain_graph), create_graph_(create_graph) {
+GraphTask::GraphTask(const TensorTuple& outputs, bool retain_graph, bool create_graph,
+                     int32_t thread_num)
+    : retain_graph_(retain_graph), create_graph_(create_graph), thread_num_(thread_num) {
   roots_.reserve(outputs.size());
   for (const auto& out_tensor : outputs) {
     FunctionNode* node = out_tensor->mut_grad_fn_node().get();
@@ -399,6 +433,24 @@ Maybe<void> GraphTask::ComputeDependenciesAndPruneNode(const TensorTuple& inputs
 }
 
 Maybe<void> GraphTask::Apply(bool save_grad_for_leaf) {
+  if (thread_num_ > 1) { return ParallelApply(save_grad_for_leaf); }
+  return SequentialApply(save_grad_for_leaf);
+}
+
+Maybe<bool> GraphTask::ApplyNode(FunctionNode* node, bool save_grad_for_leaf) {
+  if (!need_execute_.empty() && need_execute_.find(node) == need_execute_.end()) {
+    node->ReleaseOutTensorArgs();
+    return false;
+  }
+  if (/*bool not_ready_to_apply=*/!(JUST(node->Apply(create_graph_)))) { return false; }
+  if (save_grad_for_leaf) { JUST(node->AccGrad4LeafTensor(create_graph_)); }
+  JUST(node->AccGrad4RetainGradTensor());
+  node->ReleaseOutTensorArgs();
+  if (!retain_graph_) { node->ReleaseData(); }
+  return true;
+}
+
+Maybe<void> GraphTask::SequentialApply(bool save_grad_for_leaf) {
   std::queue<FunctionNode*> queue;
   for (FunctionNode* node : roots_) {
     if (dependencies_[node] == 0) { queue.push(node); }
@@ -407,16 +459,7 @@ Maybe<void> GraphTask::Apply(bool save_grad_for_leaf) {
   while (!queue.empty()) {
     FunctionNode* node = queue.front();
     queue.pop();
-    if (!need_execute_.empty() && need_execute_.find(node) == need_execute_.end()) {
-      node->ReleaseOutTensorArgs();
-      continue;
-    }
-    if (/*bool not_ready_to_apply=*/!(JUST(node->Apply(create_graph_)))) { continue; }
-    if (save_grad_for_leaf) { JUST(node->AccGrad4LeafTensor(create_graph_)); }
-    JUST(node->AccGrad4RetainGradTensor());
-    node->ReleaseOutTensorArgs();
-    if (!retain_graph_) { node->ReleaseData(); }
-
+    if (/*bool skip_next=*/!JUST(ApplyNode(node, save_grad_for_leaf))) { continue; }
     for (const auto& next_grad_fn : *(node->GetNextFunctions())) {
       FunctionNode* next_node = next_grad_fn.get();
       dependencies_[next_node] -= 1;
@@ -426,14 +469,80 @@ Maybe<void> GraphTask::Apply(bool save_grad_for_leaf) {
   return Maybe<void>::Ok();
 }
 
+// Each thread pops a ready FunctionNode, applies it and pushes the successors whose dependencies
+// drop to zero. Gradients of one tensor may be pushed by several FunctionNodes concurrently, which
+// is serialized by TensorArg. Accumulating into acc_grad only happens in the unique FunctionNode
+// owning the tensor, after all its dependencies are done.
+Maybe<void> GraphTask::ParallelApply(bool save_grad_for_leaf) {
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::queue<FunctionNode*> ready_queue;
+  int64_t running_cnt = 0;
+  std::shared_ptr<cfg::ErrorProto> error;
+  for (FunctionNode* node : roots_) {
+    if (dependencies_[node] == 0) { ready_queue.push(node); }
+  }
+
+  const bool grad_mode = autograd::GradMode::is_enabled();
+  const auto Worker = [&]() {
+    autograd::AutoGradMode mode(grad_mode);
+    while (true) {
+      FunctionNode* node = nullptr;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&]() { return error || !ready_queue.empty() || running_cnt == 0; });
+        if (error || ready_queue.empty()) { return; }
+        node = ready_queue.front();
+        ready_queue.pop();
+        ++running_cnt;
+      }
+      const auto& maybe_notify_next = TRY(ApplyNode(node, save_grad_for_leaf));
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        --running_cnt;
+        if (!maybe_notify_next.IsOk()) {
+          if (!error) { error = maybe_notify_next.error(); }
+        } else if (CHECK_JUST(maybe_notify_next)) {
+          for (const auto& next_grad_fn : *(node->GetNextFunctions())) {
+            FunctionNode* next_node = next_grad_fn.get();
+            dependencies_[next_node] -= 1;
+            if (dependencies_[next_node] == 0) { ready_queue.push(next_node); }
+          }
+        }
+      }
+      cond.notify_all();
+    }
+  };
+
+  // Backward functions written in python need the GIL on the worker threads.
+  JUST(Global<ForeignLockHelper>::Get()->WithScopedRelease([&]() -> Maybe<void> {
+    const int32_t helper_num = thread_num_ - 1;
+    BlockingCounter bc(helper_num);
+    const std::shared_ptr<ThreadPool> thread_pool = GetBackwardThreadPool(helper_num);
+    for (int32_t i = 0; i < helper_num; ++i) {
+      thread_pool->AddWork([&]() {
+        Worker();
+        bc.Decrease();
+      });
+    }
+    Worker();
+    // Helpers reference this stack frame, wait for them to leave before returning.
+    bc.WaitUntilCntEqualZero();
+    return Maybe<void>::Ok();
+  }));
+  if (error) { return Maybe<void>(error); }
+  return Maybe<void>::Ok();
+}
+
 Maybe<void> GraphAutogradEngine::RunBackwardAndSaveGrads4LeafTensor(const TensorTuple& outputs,
                                                                     const TensorTuple& out_grads,
                                                                     bool retain_graph,
-                                                                    bool create_graph) {
+                                                                    bool create_graph,
+                                                                    int32_t thread_num) {
   for (int i = 0; i < outputs.size(); ++i) {
     JUST(JUST(outputs.at(i)->current_grad())->PushPartialTensor(out_grads.at(i)));
   }
-  GraphTask graph_task(outputs, retain_graph, create_graph);
+  GraphTask graph_task(outputs, retain_graph, create_graph, thread_num);
   JUST(graph_task.ComputeDependencies());
   JUST(graph_task.Apply(/*save_grad_for_leaf=*/true));
   return Maybe<void>::Ok();
@@ -441,9 +550,9 @@ Maybe<void> GraphAutogradEngine::RunBackwardAndSaveGrads4LeafTensor(const Tensor
 
 Maybe<TensorTuple> GraphAutogradEngine::RunBackwardAndReturnInputsTensorGrad(
     const TensorTuple& outputs, const TensorTuple& inputs, const TensorTuple& out_grads,
-    bool retain_graph, bool create_graph) {
+    bool retain_graph, bool create_graph, int32_t thread_num) {
   std::shared_ptr<TensorTuple> input_current_grad = std::make_shared<TensorTuple>(inputs.size());
-  GraphTask graph_task(outputs, retain_graph, create_graph);
+  GraphTask graph_task(outputs, retain_graph, create_graph, thread_num);
   std::vector<bool> ori_retain_grad(inputs.size());
   for (int i = 0; i < inputs.size(); ++i) {
     ori_retain_grad.at(i) = inputs.at(i)->retain_grad();
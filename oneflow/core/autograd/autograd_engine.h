@@ -70,13 +70,16 @@ class AutogradEngine {
  public:
   virtual ~AutogradEngine() = default;
 
+  // `thread_num` > 1 allows the engine to apply independent FunctionNodes concurrently. Engines
+  // without a dependency graph ignore it.
   Maybe<void> RunBackwardAndSaveGrads4LeafTensorIf(const TensorTuple& outputs,
                                                    const TensorTuple& out_grads, bool retain_graph,
-                                                   bool create_graph);
+                                                   bool create_graph, int32_t thread_num = 1);
   Maybe<TensorTuple> RunBackwardAndReturnInputsTensorGradIf(const TensorTuple& outputs,
                                                             const TensorTuple& inputs,
                                                             const TensorTuple& out_grads,
-                                                            bool retain_graph, bool create_graph);
+                                                            bool retain_graph, bool create_graph,
+                                                            int32_t thread_num = 1);
   virtual void ClearEngine() = 0;
   // Builds FunctionNode, binding to all `outputs_` tensors and saving in AutogradEngine
   virtual Maybe<FunctionNode> AddBackwardFuncPtr(
@@ -91,12 +94,14 @@ class AutogradEngine {
  private:
   virtual Maybe<void> RunBackwardAndSaveGrads4LeafTensor(const TensorTuple& outputs,
                                                          const TensorTuple& out_grads,
-                                                         bool retain_graph, bool create_graph) = 0;
+                                                         bool retain_graph, bool create_graph,
+                                                         int32_t thread_num) = 0;
   virtual Maybe<TensorTuple> RunBackwardAndReturnInputsTensorGrad(const TensorTuple& outputs,
                                                                   const TensorTuple& inputs,
                                                                   const TensorTuple& out_grads,
                                                                   bool retain_graph,
-                                                                  bool create_graph) = 0;
+                                                                  bool create_graph,
+                                                                  int32_t thread_num) = 0;
 };
 
 // Stack Autograd Node and Engine
@@ -139,12 +144,12 @@ class StackAutogradEngine final : public AutogradEngine {
   void ClearReleasedFunctionNodes();
   Maybe<void> RunBackwardAndSaveGrads4LeafTensor(const TensorTuple& outputs,
                                                  const TensorTuple& out_grads, bool retain_graph,
-                                                 bool create_graph) override;
+                                                 bool create_graph, int32_t thread_num) override;
   Maybe<TensorTuple> RunBackwardAndReturnInputsTensorGrad(const TensorTuple& outputs,
                                                           const TensorTuple& inputs,
                                                           const TensorTuple& out_grads,
-                                                          bool retain_graph,
-                                                          bool create_graph) override;
+                                                          bool retain_graph, bool create_graph,
+                                                          int32_t thread_num) override;
 };
 
 // Graph Autograd Node and Engine
@@ -166,15 +171,22 @@ class GraphTask final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(GraphTask);
   GraphTask() = delete;
-  GraphTask(const TensorTuple& outputs, bool retain_graph, bool create_graph);
+  GraphTask(const TensorTuple& outputs, bool retain_graph, bool create_graph, int32_t thread_num);
 
   Maybe<void> ComputeDependencies();
   Maybe<void> ComputeDependenciesAndPruneNode(const TensorTuple& inputs);
   Maybe<void> Apply(bool save_grad_for_leaf);
 
  private:
+  // Returns true if the successors of `node` should be notified
+  Maybe<bool> ApplyNode(FunctionNode* node, bool save_grad_for_leaf);
+  Maybe<void> SequentialApply(bool save_grad_for_leaf);
+  // Issues ready FunctionNodes from a shared ready queue on `thread_num_` threads
+  Maybe<void> ParallelApply(bool save_grad_for_leaf);
+
   bool retain_graph_;
   bool create_graph_;
+  int32_t thread_num_;
   std::vector<FunctionNode*> roots_;
   HashMap<FunctionNode*, int> dependencies_;
   HashSet<FunctionNode*> need_execute_;
@@ -196,12 +208,12 @@ class GraphAutogradEngine final : public AutogradEngine {
  private:
   Maybe<void> RunBackwardAndSaveGrads4LeafTensor(const TensorTuple& outputs,
                                                  const TensorTuple& out_grads, bool retain_graph,
-                                                 bool create_graph) override;
+                                                 bool create_graph, int32_t thread_num) override;
   Maybe<TensorTuple> RunBackwardAndReturnInputsTensorGrad(const TensorTuple& outputs,
                                                           const TensorTuple& inputs,
                                                           const TensorTuple& out_grads,
-                                                          bool retain_graph,
-                                                          bool create_graph) override;
+                                                          bool retain_graph, bool create_graph,
+                                                          int32_t thread_num) override;
 };
 
 AutogradEngine* GetThreadLocalAutogradEngine();
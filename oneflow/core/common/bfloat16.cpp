@@ -0,0 +1,47 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/bfloat16.h"
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace oneflow {
+
+void ConvertBFloat16ToFloat(const bfloat16* src, float* dst, int64_t n) {
+  int64_t i = 0;
+#if defined(__AVX512F__)
+  for (; i + 16 <= n; i += 16) {
+    const __m256i half_words = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    const __m512i words = _mm512_slli_epi32(_mm512_cvtepu16_epi32(half_words), 16);
+    _mm512_storeu_ps(dst + i, _mm512_castsi512_ps(words));
+  }
+#endif
+  for (; i < n; ++i) { dst[i] = static_cast<float>(src[i]); }
+}
+
+void ConvertFloatToBFloat16(const float* src, bfloat16* dst, int64_t n) {
+  int64_t i = 0;
+#if defined(__AVX512BF16__)
+  for (; i + 16 <= n; i += 16) {
+    const __m256bh packed = _mm512_cvtneps_pbh(_mm512_loadu_ps(src + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                        reinterpret_cast<const __m256i&>(packed));
+  }
+#endif
+  for (; i < n; ++i) { dst[i] = bfloat16(src[i]); }
+}
+
+}  // namespace oneflow
@@ -0,0 +1,89 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMMON_BFLOAT16_H_
+#define ONEFLOW_CORE_COMMON_BFLOAT16_H_
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace oneflow {
+
+// Host side bfloat16: the upper 16 bits of an IEEE float. Arithmetic is carried out in float and
+// rounded back with round-to-nearest-even.
+struct alignas(2) bfloat16 {
+  uint16_t x;
+
+  bfloat16() = default;
+
+  template<typename T, typename std::enable_if<std::is_convertible<T, float>::value
+                                                   && !std::is_same<T, bfloat16>::value,
+                                               int>::type = 0>
+  explicit bfloat16(T value) : x(RoundFromFloat(static_cast<float>(value))) {}
+
+  operator float() const {
+    const uint32_t bits = static_cast<uint32_t>(x) << 16;
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  static bfloat16 FromBits(uint16_t bits) {
+    bfloat16 ret;
+    ret.x = bits;
+    return ret;
+  }
+
+  static uint16_t RoundFromFloat(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    // keep NaN a quiet NaN instead of letting the rounding carry turn it into infinity
+    if ((bits & 0x7fffffffU) > 0x7f800000U) { return static_cast<uint16_t>((bits >> 16) | 0x40U); }
+    bits += 0x7fffU + ((bits >> 16) & 1U);
+    return static_cast<uint16_t>(bits >> 16);
+  }
+};
+
+static_assert(sizeof(bfloat16) == 2, "sizeof(bfloat16) != 2");
+
+#define OF_BFLOAT16_BINARY_OPERATOR(op)                                   \
+  inline bfloat16 operator op(const bfloat16& lhs, const bfloat16& rhs) { \
+    return bfloat16(static_cast<float>(lhs) op static_cast<float>(rhs));  \
+  }                                                                       \
+  inline bfloat16& operator op##=(bfloat16& lhs, const bfloat16& rhs) {   \
+    lhs = bfloat16(static_cast<float>(lhs) op static_cast<float>(rhs));   \
+    return lhs;                                                           \
+  }
+
+OF_BFLOAT16_BINARY_OPERATOR(+)
+OF_BFLOAT16_BINARY_OPERATOR(-)
+OF_BFLOAT16_BINARY_OPERATOR(*)
+OF_BFLOAT16_BINARY_OPERATOR(/)
+
+#undef OF_BFLOAT16_BINARY_OPERATOR
+
+inline bfloat16 operator-(const bfloat16& value) {
+  return bfloat16::FromBits(static_cast<uint16_t>(value.x ^ 0x8000U));
+}
+
+// Bulk conversions used by kernels which compute bfloat16 tensors with float accumulation.
+// AVX512-BF16 / AVX512F instructions are used when the translation unit is built for them.
+void ConvertBFloat16ToFloat(const bfloat16* src, float* dst, int64_t n);
+void ConvertFloatToBFloat16(const float* src, bfloat16* dst, int64_t n);
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_COMMON_BFLOAT16_H_
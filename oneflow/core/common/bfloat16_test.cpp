@@ -0,0 +1,64 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/bfloat16.h"
+#include "gtest/gtest.h"
+#include <cmath>
+#include <vector>
+
+namespace oneflow {
+
+namespace test {
+
+TEST(bfloat16, round_to_nearest_even) {
+  ASSERT_EQ(bfloat16(1.0f).x, 0x3f80);
+  // halfway between 0x3f80 and 0x3f81 rounds to the even one
+  ASSERT_EQ(bfloat16(1.00390625f).x, 0x3f80);
+  // halfway between 0x3f81 and 0x3f82 rounds to the even one
+  ASSERT_EQ(bfloat16(1.01171875f).x, 0x3f82);
+  ASSERT_EQ(static_cast<float>(bfloat16(-2.5f)), -2.5f);
+  ASSERT_TRUE(std::isnan(static_cast<float>(bfloat16(NAN))));
+  ASSERT_TRUE(std::isinf(static_cast<float>(bfloat16(INFINITY))));
+}
+
+TEST(bfloat16, arithmetic) {
+  const bfloat16 a(1.5f);
+  const bfloat16 b(2);
+  ASSERT_EQ(static_cast<float>(a + b), 3.5f);
+  ASSERT_EQ(static_cast<float>(a * b), 3.0f);
+  ASSERT_EQ(static_cast<float>(-a), -1.5f);
+  bfloat16 c = a;
+  c -= b;
+  ASSERT_EQ(static_cast<float>(c), -0.5f);
+  ASSERT_TRUE(a < b);
+}
+
+TEST(bfloat16, bulk_conversion) {
+  const int64_t n = 37;
+  std::vector<float> src(n);
+  for (int64_t i = 0; i < n; ++i) { src[i] = 0.37f * i - 3.0f; }
+  std::vector<bfloat16> half(n);
+  std::vector<float> dst(n);
+  ConvertFloatToBFloat16(src.data(), half.data(), n);
+  ConvertBFloat16ToFloat(half.data(), dst.data(), n);
+  for (int64_t i = 0; i < n; ++i) {
+    ASSERT_EQ(half[i].x, bfloat16(src[i]).x);
+    ASSERT_NEAR(dst[i], src[i], std::fabs(src[i]) / 128);
+  }
+}
+
+}  // namespace test
+
+}  // namespace oneflow
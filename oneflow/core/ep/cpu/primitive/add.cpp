@@ -23,21 +23,34 @@ namespace primitive {
 
 namespace {
 
+template<typename T>
+struct AddAccType {
+  using type = T;
+};
+
+// sum bfloat16 inputs in float and round once
+template<>
+struct AddAccType<bfloat16> {
+  using type = float;
+};
+
 template<typename T, size_t arity>
 void AddCpu(const T* const* srcs, T* dst, size_t count) {
+  using Acc = typename AddAccType<T>::type;
   for (size_t i = 0; i < count; ++i) {
-    T sum = T(0);
-    for (size_t a = 0; a < arity; ++a) { sum += srcs[a][i]; }
-    dst[i] = sum;
+    Acc sum = Acc(0);
+    for (size_t a = 0; a < arity; ++a) { sum += static_cast<Acc>(srcs[a][i]); }
+    dst[i] = static_cast<T>(sum);
   }
 }
 
 template<typename T>
 void AddCpu(const T* const* srcs, size_t arity, T* dst, size_t count) {
+  using Acc = typename AddAccType<T>::type;
   for (size_t i = 0; i < count; ++i) {
-    T sum = T(0);
-    for (size_t a = 0; a < arity; ++a) { sum += srcs[a][i]; }
-    dst[i] = sum;
+    Acc sum = Acc(0);
+    for (size_t a = 0; a < arity; ++a) { sum += static_cast<Acc>(srcs[a][i]); }
+    dst[i] = static_cast<T>(sum);
   }
 }
 
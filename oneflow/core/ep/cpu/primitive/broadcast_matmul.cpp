@@ -85,6 +85,45 @@ void LaunchCblasBroadcastMatmul(Stream* /*stream*/, DataType data_type,
                              a_batch_dims, b_batch_dims, c_batch_dims, a, b, c, func);
 }
 
+// bfloat16 operands are widened to float and multiplied by sgemm, so accumulation is done in
+// float and the result is rounded once. Operands shared by consecutive batches (broadcast) are
+// converted only once.
+void LaunchBFloat16BroadcastMatmul(Stream* /*stream*/, DataType data_type,
+                                   BlasTransposeType transpose_a, BlasTransposeType transpose_b,
+                                   int64_t num_batch_dims, const int64_t* broadcast_batch_dims,
+                                   const int64_t* a_batch_dims, const int64_t* b_batch_dims,
+                                   const int64_t* c_batch_dims, int64_t m, int64_t n, int64_t k,
+                                   Scalar alpha, const void* a, const void* b, Scalar beta,
+                                   void* c) {
+  const CBLAS_TRANSPOSE cblas_trans_a = GetCblasTranspose(transpose_a);
+  const CBLAS_TRANSPOSE cblas_trans_b = GetCblasTranspose(transpose_b);
+  const float alpha_value = alpha.Value<float>();
+  std::vector<float> a_buf(m * k);
+  std::vector<float> b_buf(k * n);
+  std::vector<float> c_buf(m * n);
+  const void* converted_a = nullptr;
+  const void* converted_b = nullptr;
+  auto func = [&](const void* batch_a, const void* batch_b, void* batch_c, Scalar batch_beta) {
+    const float beta_value = batch_beta.Value<float>();
+    if (batch_a != converted_a) {
+      ConvertBFloat16ToFloat(static_cast<const bfloat16*>(batch_a), a_buf.data(), m * k);
+      converted_a = batch_a;
+    }
+    if (batch_b != converted_b) {
+      ConvertBFloat16ToFloat(static_cast<const bfloat16*>(batch_b), b_buf.data(), k * n);
+      converted_b = batch_b;
+    }
+    if (beta_value != 0) {
+      ConvertBFloat16ToFloat(static_cast<const bfloat16*>(batch_c), c_buf.data(), m * n);
+    }
+    CblasMatmul<float>(cblas_trans_a, cblas_trans_b, m, n, k, alpha_value, a_buf.data(),
+                       b_buf.data(), beta_value, c_buf.data());
+    ConvertFloatToBFloat16(c_buf.data(), static_cast<bfloat16*>(batch_c), m * n);
+  };
+  ForEachMatmul<kMaxNumDims>(data_type, m, n, k, beta, num_batch_dims, broadcast_batch_dims,
+                             a_batch_dims, b_batch_dims, c_batch_dims, a, b, c, func);
+}
+
 void LaunchBroadcastMatmul(Stream* stream, DataType data_type, BlasTransposeType transpose_a,
                            BlasTransposeType transpose_b, int64_t num_batch_dims,
                            const int64_t* broadcast_batch_dims, const int64_t* a_batch_dims,
@@ -99,6 +138,10 @@ void LaunchBroadcastMatmul(Stream* stream, DataType data_type, BlasTransposeType
     LaunchCblasBroadcastMatmul<double>(stream, data_type, transpose_a, transpose_b, num_batch_dims,
                                        broadcast_batch_dims, a_batch_dims, b_batch_dims,
                                        c_batch_dims, m, n, k, alpha, a, b, beta, c);
+  } else if (data_type == DataType::kBFloat16) {
+    LaunchBFloat16BroadcastMatmul(stream, data_type, transpose_a, transpose_b, num_batch_dims,
+                                  broadcast_batch_dims, a_batch_dims, b_batch_dims, c_batch_dims,
+                                  m, n, k, alpha, a, b, beta, c);
   } else {
     UNIMPLEMENTED();
   }
@@ -114,7 +157,8 @@ class BroadcastMatmulFactoryImpl : public BroadcastMatmulFactory {
                                        BlasTransposeType transpose_b,
                                        size_t max_num_dims) override {
     if (max_num_dims > kMaxNumDims) { return nullptr; }
-    if (data_type == DataType::kFloat || data_type == DataType::kDouble) {
+    if (data_type == DataType::kFloat || data_type == DataType::kDouble
+        || data_type == DataType::kBFloat16) {
       return std::make_unique<BroadcastMatmulImpl<kMaxNumDims>>(data_type, transpose_a,
                                                                 transpose_b);
     } else {
@@ -28,6 +28,16 @@ void CastCpu(const From* from, To* to, size_t count) {
   for (size_t i = 0; i < count; ++i) { to[i] = static_cast<To>(from[i]); }
 }
 
+template<>
+void CastCpu<float, bfloat16>(const float* from, bfloat16* to, size_t count) {
+  ConvertFloatToBFloat16(from, to, count);
+}
+
+template<>
+void CastCpu<bfloat16, float>(const bfloat16* from, float* to, size_t count) {
+  ConvertBFloat16ToFloat(from, to, count);
+}
+
 template<typename From, typename To>
 class CastImpl : public Cast {
  public:
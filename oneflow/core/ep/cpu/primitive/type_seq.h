@@ -28,6 +28,7 @@ limitations under the License.
 #define CPU_PRIMITIVE_FLOAT_TYPE_SEQ OF_PP_MAKE_TUPLE_SEQ(float, DataType::kFloat)
 #define CPU_PRIMITIVE_DOUBLE_TYPE_SEQ OF_PP_MAKE_TUPLE_SEQ(double, DataType::kDouble)
 #define CPU_PRIMITIVE_FLOAT16_TYPE_SEQ OF_PP_MAKE_TUPLE_SEQ(float16, DataType::kFloat16)
+#define CPU_PRIMITIVE_BFLOAT16_TYPE_SEQ OF_PP_MAKE_TUPLE_SEQ(bfloat16, DataType::kBFloat16)
 
 #define CPU_PRIMITIVE_NATIVE_TYPE_SEQ \
   CPU_PRIMITIVE_CHAR_TYPE_SEQ         \
@@ -40,7 +41,8 @@ limitations under the License.
 
 #define CPU_PRIMITIVE_ALL_TYPE_SEQ \
   CPU_PRIMITIVE_NATIVE_TYPE_SEQ    \
-  CPU_PRIMITIVE_FLOAT16_TYPE_SEQ
+  CPU_PRIMITIVE_FLOAT16_TYPE_SEQ   \
+  CPU_PRIMITIVE_BFLOAT16_TYPE_SEQ
 
 #define CPU_PRIMITIVE_FLOATING_TYPE_SEQ \
   CPU_PRIMITIVE_FLOAT_TYPE_SEQ          \
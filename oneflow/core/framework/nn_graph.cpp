@@ -33,6 +33,7 @@ limitations under the License.
 #include "oneflow/core/persistence/tee_persistent_log_stream.h"
 #include "oneflow/core/vm/vm_util.h"
 #include "oneflow/core/profiler/profiler.h"
+#include "oneflow/core/profiler/compile_profiler.h"
 
 namespace oneflow {
 
@@ -259,9 +260,16 @@ Maybe<void> NNGraph::CompileAndInitRuntime() {
   auto scope = std::make_unique<GlobalJobDescScope>(job_.job_conf(), job_ctx->job_id());
   if (GlobalProcessCtx::IsThisProcessMaster()) {
     double start = GetCurTime();
-    // TODO(chengcheng): new memory reused by chunk
-    Compiler().Compile(&job_, &plan_, /* need_job_complete */ true);
-    PlanUtil::GenMemBlockAndChunkWithVariableOpNames4Plan(&plan_, variable_op_names_);
+    {
+      profiler::CompileProfileGuard profile_guard(job_ctx->job_id(), "phase", "Compile");
+      // TODO(chengcheng): new memory reused by chunk
+      Compiler().Compile(&job_, &plan_, /* need_job_complete */ true);
+    }
+    {
+      profiler::CompileProfileGuard profile_guard(job_ctx->job_id(), "phase",
+                                                  "GenMemBlockAndChunk");
+      PlanUtil::GenMemBlockAndChunkWithVariableOpNames4Plan(&plan_, variable_op_names_);
+    }
 
     LOG(INFO) << "\njob_id: " << job_ctx->job_id() << " , job_name: " << name_
               << " , compile time: " << (GetCurTime() - start) / 1000000000.0 << " seconds.\n";
@@ -274,6 +282,7 @@ Maybe<void> NNGraph::CompileAndInitRuntime() {
     // PlanUtil::SetForceInplaceMemBlock(&plan_); NOTE(chengcheng): only for ssp.
     PlanUtil::DumpCtrlRegstInfoToPlan(&plan_);
     PlanUtil::PlanMemoryLog(&plan_, name_);
+    profiler::CompileProfiler::Get()->Report(job_ctx->job_id(), name_);
   }
   if (GlobalProcessCtx::WorldSize() > 1) {
     std::string plan_name = "plan:" + job_name();
@@ -21,11 +21,18 @@ limitations under the License.
 namespace oneflow {
 namespace one {
 
-bool TensorArg::Empty() const { return !acc_tensor_; }
+bool TensorArg::Empty() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return !acc_tensor_;
+}
 
-void TensorArg::Release() { acc_tensor_.reset(); }
+void TensorArg::Release() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  acc_tensor_.reset();
+}
 
 Maybe<void> TensorArg::PushPartialTensor(const std::shared_ptr<Tensor>& partial_tensor) {
+  std::unique_lock<std::mutex> lock(mutex_);
   if (!acc_tensor_) {
     acc_tensor_ = partial_tensor;
   } else {
@@ -42,7 +49,8 @@ Maybe<void> TensorArg::PushPartialTensor(const std::shared_ptr<Tensor>& partial_
 }
 
 Maybe<Tensor> TensorArg::GetAccTensor() {
-  CHECK_OR_RETURN(Empty() == false) << "Can not GetAccTensor because it is empty";
+  std::unique_lock<std::mutex> lock(mutex_);
+  CHECK_OR_RETURN(acc_tensor_) << "Can not GetAccTensor because it is empty";
   return acc_tensor_;
 }
 
@@ -0,0 +1,152 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/graph/memory_aware_topo_order.h"
+#include <set>
+
+namespace oneflow {
+
+std::vector<int64_t> MemoryAwareTopoOrder(const std::vector<TaskMemInfo>& tasks,
+                                          const std::vector<RegstMemInfo>& regsts) {
+  const int64_t task_num = tasks.size();
+  std::vector<std::vector<int64_t>> task2produced_regsts(task_num);
+  // Regsts consumed only within the producer's chain are freed by their last consumer.
+  std::vector<std::vector<int64_t>> task2freeable_consumed_regsts(task_num);
+  std::vector<int64_t> remaining_consumer_num(regsts.size(), 0);
+  FOR_RANGE(int64_t, i, 0, regsts.size()) {
+    const RegstMemInfo& regst = regsts.at(i);
+    task2produced_regsts.at(regst.producer).push_back(i);
+    const int64_t chain_id = tasks.at(regst.producer).chain_id;
+    const bool all_consumers_in_chain =
+        std::all_of(regst.consumers.cbegin(), regst.consumers.cend(),
+                    [&](int64_t consumer) { return tasks.at(consumer).chain_id == chain_id; });
+    if (regst.consumers.empty() || !all_consumers_in_chain) { continue; }
+    remaining_consumer_num.at(i) = regst.consumers.size();
+    for (int64_t consumer : regst.consumers) {
+      task2freeable_consumed_regsts.at(consumer).push_back(i);
+    }
+  }
+  const auto MemDelta = [&](int64_t task) {
+    int64_t delta = 0;
+    for (int64_t regst : task2produced_regsts.at(task)) { delta += regsts.at(regst).bytes; }
+    for (int64_t regst : task2freeable_consumed_regsts.at(task)) {
+      if (remaining_consumer_num.at(regst) == 1) { delta -= regsts.at(regst).bytes; }
+    }
+    return delta;
+  };
+  std::vector<int64_t> in_degree(task_num, 0);
+  for (const TaskMemInfo& task : tasks) {
+    for (int64_t out_task : task.out_tasks) { in_degree.at(out_task) += 1; }
+  }
+  // Ready tasks keyed by (mem delta, original index). The delta of a ready task only changes when
+  // one of its consumed regsts is down to its last consumer, so the key is updated in place then.
+  std::set<std::pair<int64_t, int64_t>> ready_tasks;
+  std::vector<int64_t> task2delta(task_num, 0);
+  std::vector<bool> is_ready(task_num, false);
+  const auto MakeReady = [&](int64_t task) {
+    task2delta.at(task) = MemDelta(task);
+    is_ready.at(task) = true;
+    ready_tasks.emplace(task2delta.at(task), task);
+  };
+  FOR_RANGE(int64_t, i, 0, task_num) {
+    if (in_degree.at(i) == 0) { MakeReady(i); }
+  }
+  std::vector<int64_t> order;
+  order.reserve(task_num);
+  while (!ready_tasks.empty()) {
+    const int64_t task = ready_tasks.begin()->second;
+    ready_tasks.erase(ready_tasks.begin());
+    is_ready.at(task) = false;
+    order.push_back(task);
+    for (int64_t regst : task2freeable_consumed_regsts.at(task)) {
+      if (--remaining_consumer_num.at(regst) != 1) { continue; }
+      // A last consumer that is not ready yet gets the right delta once it becomes ready.
+      for (int64_t consumer : regsts.at(regst).consumers) {
+        if (!is_ready.at(consumer)) { continue; }
+        CHECK_EQ(ready_tasks.erase(std::make_pair(task2delta.at(consumer), consumer)), 1);
+        task2delta.at(consumer) -= regsts.at(regst).bytes;
+        ready_tasks.emplace(task2delta.at(consumer), consumer);
+      }
+    }
+    for (int64_t out_task : tasks.at(task).out_tasks) {
+      if (--in_degree.at(out_task) == 0) { MakeReady(out_task); }
+    }
+  }
+  CHECK_EQ(order.size(), tasks.size());
+  return order;
+}
+
+std::vector<int64_t> LowerPeakTopoOrder(
+    const std::vector<TaskMemInfo>& tasks, const std::vector<RegstMemInfo>& regsts,
+    std::map<int64_t, std::pair<int64_t, int64_t>>* chain_id2peaks) {
+  std::vector<int64_t> origin_order(tasks.size());
+  FOR_RANGE(int64_t, i, 0, origin_order.size()) { origin_order.at(i) = i; }
+  std::vector<int64_t> order = MemoryAwareTopoOrder(tasks, regsts);
+  const HashMap<int64_t, int64_t> chain_id2peak_before =
+      ChainId2PeakMemBytes(tasks, regsts, origin_order);
+  const HashMap<int64_t, int64_t> chain_id2peak_after = ChainId2PeakMemBytes(tasks, regsts, order);
+  int64_t total_before = 0;
+  int64_t total_after = 0;
+  chain_id2peaks->clear();
+  for (const auto& pair : chain_id2peak_before) {
+    const int64_t peak_after = chain_id2peak_after.at(pair.first);
+    total_before += pair.second;
+    total_after += peak_after;
+    chain_id2peaks->emplace(pair.first, std::make_pair(pair.second, peak_after));
+  }
+  return total_after < total_before ? order : origin_order;
+}
+
+HashMap<int64_t, int64_t> ChainId2PeakMemBytes(const std::vector<TaskMemInfo>& tasks,
+                                               const std::vector<RegstMemInfo>& regsts,
+                                               const std::vector<int64_t>& order) {
+  std::vector<int64_t> task2index_in_chain(tasks.size(), -1);
+  HashMap<int64_t, int64_t> chain_id2task_num;
+  for (int64_t task : order) {
+    task2index_in_chain.at(task) = chain_id2task_num[tasks.at(task).chain_id]++;
+  }
+  HashMap<int64_t, std::vector<int64_t>> chain_id2mem_deltas;
+  for (const auto& pair : chain_id2task_num) {
+    chain_id2mem_deltas[pair.first].resize(pair.second + 1, 0);
+  }
+  for (const RegstMemInfo& regst : regsts) {
+    const int64_t chain_id = tasks.at(regst.producer).chain_id;
+    const int64_t alloc_index = task2index_in_chain.at(regst.producer);
+    int64_t free_index = alloc_index;
+    for (int64_t consumer : regst.consumers) {
+      if (tasks.at(consumer).chain_id == chain_id) {
+        free_index = std::max(free_index, task2index_in_chain.at(consumer));
+      } else {
+        free_index = chain_id2task_num.at(chain_id) - 1;
+      }
+    }
+    std::vector<int64_t>* mem_deltas = &chain_id2mem_deltas.at(chain_id);
+    mem_deltas->at(alloc_index) += regst.bytes;
+    mem_deltas->at(free_index + 1) -= regst.bytes;
+  }
+  HashMap<int64_t, int64_t> chain_id2peak;
+  for (const auto& pair : chain_id2mem_deltas) {
+    int64_t live_bytes = 0;
+    int64_t peak = 0;
+    for (int64_t delta : pair.second) {
+      live_bytes += delta;
+      peak = std::max(peak, live_bytes);
+    }
+    chain_id2peak.emplace(pair.first, peak);
+  }
+  return chain_id2peak;
+}
+
+}  // namespace oneflow
@@ -0,0 +1,59 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_GRAPH_MEMORY_AWARE_TOPO_ORDER_H_
+#define ONEFLOW_CORE_GRAPH_MEMORY_AWARE_TOPO_ORDER_H_
+
+#include <map>
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// Tasks and regsts are referred to by their index. Tasks are given in their original topological
+// order, which breaks ties in MemoryAwareTopoOrder.
+struct TaskMemInfo {
+  int64_t chain_id;
+  std::vector<int64_t> out_tasks;  // one entry per out edge
+};
+
+struct RegstMemInfo {
+  int64_t bytes;
+  int64_t producer;
+  std::vector<int64_t> consumers;  // distinct tasks
+};
+
+// List scheduling over the whole task graph: among the ready tasks run the one that grows the
+// live mem reused bytes of its chain the least, i.e. prefer tasks that free their inputs, falling
+// back to the original topological order on ties. Returns the task indices in the new order.
+std::vector<int64_t> MemoryAwareTopoOrder(const std::vector<TaskMemInfo>& tasks,
+                                          const std::vector<RegstMemInfo>& regsts);
+
+// MemoryAwareTopoOrder if it lowers the sum of the chain peaks, otherwise the origin order. The
+// greedy order is not always better, so the result never has a higher total peak than the origin
+// one. The peaks of each chain before and after are put in chain_id2peaks.
+std::vector<int64_t> LowerPeakTopoOrder(
+    const std::vector<TaskMemInfo>& tasks, const std::vector<RegstMemInfo>& regsts,
+    std::map<int64_t, std::pair<int64_t, int64_t>>* chain_id2peaks);
+
+// Peak live bytes of the regsts in each chain when tasks run in the given order. A regst lives
+// from its producer to its last consumer in the same chain, or to the end of the chain if it is
+// also consumed by other chains.
+HashMap<int64_t, int64_t> ChainId2PeakMemBytes(const std::vector<TaskMemInfo>& tasks,
+                                               const std::vector<RegstMemInfo>& regsts,
+                                               const std::vector<int64_t>& order);
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_GRAPH_MEMORY_AWARE_TOPO_ORDER_H_
@@ -0,0 +1,144 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/graph/memory_aware_topo_order.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+int64_t TotalPeak(const std::vector<TaskMemInfo>& tasks, const std::vector<RegstMemInfo>& regsts,
+                  const std::vector<int64_t>& order) {
+  int64_t total = 0;
+  for (const auto& pair : ChainId2PeakMemBytes(tasks, regsts, order)) { total += pair.second; }
+  return total;
+}
+
+std::vector<int64_t> OriginOrder(int64_t task_num) {
+  std::vector<int64_t> order(task_num);
+  FOR_RANGE(int64_t, i, 0, task_num) { order.at(i) = i; }
+  return order;
+}
+
+bool IsTopoOrder(const std::vector<TaskMemInfo>& tasks, const std::vector<int64_t>& order) {
+  if (order.size() != tasks.size()) { return false; }
+  std::vector<int64_t> task2pos(tasks.size(), -1);
+  FOR_RANGE(int64_t, i, 0, order.size()) {
+    if (task2pos.at(order.at(i)) != -1) { return false; }
+    task2pos.at(order.at(i)) = i;
+  }
+  FOR_RANGE(int64_t, i, 0, tasks.size()) {
+    for (int64_t out_task : tasks.at(i).out_tasks) {
+      if (task2pos.at(i) >= task2pos.at(out_task)) { return false; }
+    }
+  }
+  return true;
+}
+
+// Adds a regst produced by `producer` and read by `consumers`, with an edge to each consumer.
+void AddRegst(std::vector<TaskMemInfo>* tasks, std::vector<RegstMemInfo>* regsts, int64_t bytes,
+              int64_t producer, const std::vector<int64_t>& consumers) {
+  for (int64_t consumer : consumers) { tasks->at(producer).out_tasks.push_back(consumer); }
+  regsts->push_back(RegstMemInfo{bytes, producer, consumers});
+}
+
+}  // namespace
+
+TEST(MemoryAwareTopoOrder, keep_origin_order_without_regsts) {
+  std::vector<TaskMemInfo> tasks(6, TaskMemInfo{0, {}});
+  tasks.at(0).out_tasks = {3, 4};
+  tasks.at(1).out_tasks = {3};
+  tasks.at(2).out_tasks = {5};
+  const std::vector<int64_t> order = MemoryAwareTopoOrder(tasks, {});
+  ASSERT_EQ(order, OriginOrder(tasks.size()));
+}
+
+TEST(MemoryAwareTopoOrder, run_consumer_before_next_producer) {
+  // Three branches in one chain, producer i -> consumer 3 + i. The breadth first origin order
+  // keeps all three large regsts alive at once, running each consumer right after its producer
+  // keeps one.
+  std::vector<TaskMemInfo> tasks(7, TaskMemInfo{0, {}});
+  std::vector<RegstMemInfo> regsts;
+  FOR_RANGE(int64_t, i, 0, 3) {
+    AddRegst(&tasks, &regsts, 100, i, {3 + i});
+    AddRegst(&tasks, &regsts, 1, 3 + i, {6});
+  }
+  const std::vector<int64_t> order = MemoryAwareTopoOrder(tasks, regsts);
+  ASSERT_TRUE(IsTopoOrder(tasks, order));
+  ASSERT_EQ(order, (std::vector<int64_t>{0, 3, 1, 4, 2, 5, 6}));
+  ASSERT_EQ(TotalPeak(tasks, regsts, OriginOrder(tasks.size())), 301);
+  ASSERT_EQ(TotalPeak(tasks, regsts, order), 103);
+}
+
+TEST(MemoryAwareTopoOrder, regst_consumed_by_other_chain) {
+  // Regst 0 -> 2 is also read by task 3 in chain 1, so it is not freed by task 2 and running
+  // task 2 early does not help.
+  std::vector<TaskMemInfo> tasks = {{0, {}}, {0, {}}, {0, {}}, {1, {}}};
+  std::vector<RegstMemInfo> regsts;
+  AddRegst(&tasks, &regsts, 100, 0, {2, 3});
+  AddRegst(&tasks, &regsts, 10, 1, {2});
+  const std::vector<int64_t> order = MemoryAwareTopoOrder(tasks, regsts);
+  ASSERT_TRUE(IsTopoOrder(tasks, order));
+  ASSERT_LE(TotalPeak(tasks, regsts, order), TotalPeak(tasks, regsts, OriginOrder(tasks.size())));
+}
+
+TEST(MemoryAwareTopoOrder, random_dag) {
+  std::mt19937 gen(0);
+  FOR_RANGE(int64_t, round, 0, 50) {
+    const int64_t task_num = 1 + gen() % 200;
+    const int64_t chain_num = 1 + gen() % 4;
+    std::vector<TaskMemInfo> tasks(task_num);
+    FOR_RANGE(int64_t, i, 0, task_num) { tasks.at(i).chain_id = gen() % chain_num; }
+    std::vector<RegstMemInfo> regsts;
+    FOR_RANGE(int64_t, i, 0, task_num - 1) {
+      std::vector<int64_t> consumers;
+      const int64_t consumer_num = gen() % 4;
+      FOR_RANGE(int64_t, j, 0, consumer_num) {
+        const int64_t consumer = i + 1 + gen() % std::min<int64_t>(task_num - i - 1, 16);
+        if (std::find(consumers.begin(), consumers.end(), consumer) == consumers.end()) {
+          consumers.push_back(consumer);
+        }
+      }
+      if (consumers.empty()) { continue; }
+      if (gen() % 4 == 0) {
+        // ctrl edges only
+        for (int64_t consumer : consumers) { tasks.at(i).out_tasks.push_back(consumer); }
+      } else {
+        AddRegst(&tasks, &regsts, 1 + gen() % 1000, i, consumers);
+      }
+    }
+    ASSERT_TRUE(IsTopoOrder(tasks, MemoryAwareTopoOrder(tasks, regsts)));
+    std::map<int64_t, std::pair<int64_t, int64_t>> chain_id2peaks;
+    const std::vector<int64_t> order = LowerPeakTopoOrder(tasks, regsts, &chain_id2peaks);
+    ASSERT_TRUE(IsTopoOrder(tasks, order));
+    const int64_t origin_peak = TotalPeak(tasks, regsts, OriginOrder(task_num));
+    const int64_t peak = TotalPeak(tasks, regsts, order);
+    ASSERT_LE(peak, origin_peak);
+    int64_t total_before = 0;
+    int64_t total_after = 0;
+    for (const auto& pair : chain_id2peaks) {
+      total_before += pair.second.first;
+      total_after += pair.second.second;
+    }
+    ASSERT_EQ(total_before, origin_peak);
+    ASSERT_EQ(std::min(total_after, total_before), peak);
+  }
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -14,12 +14,57 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/graph/op_graph.h"
+#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/common/blocking_counter.h"
 #include "oneflow/core/job/job_builder.h"
 #include "oneflow/core/job/mirrored_sig_infer_hint.h"
 #include "oneflow/core/framework/device_registry_manager.h"
+#include "oneflow/core/platform/include/pthread_fork.h"
+#include "oneflow/core/thread/thread_pool.h"
 
 namespace oneflow {
 
+namespace {
+
+// Graphs with fewer ops are built serially since the thread pool costs more than it saves. The
+// threshold is read on each build so that it could be changed between graphs, and non-positive
+// means always serial.
+bool IsParallelBuildEnabled(size_t op_num) {
+  const int64_t min_op_num =
+      ParseIntegerFromEnv("ONEFLOW_OP_GRAPH_PARALLEL_BUILD_MIN_OP_NUM", 2048);
+  return min_op_num > 0 && op_num >= min_op_num && std::thread::hardware_concurrency() > 1
+         && !pthread_fork::IsForkedSubProcess();
+}
+
+ThreadPool* OpGraphBuildThreadPool() {
+  // NOTE: it is leaked on purpose since graphs may be built until the process exits.
+  static ThreadPool* thread_pool = new ThreadPool(std::thread::hardware_concurrency());
+  return thread_pool;
+}
+
+// Runs DoEach on [0, num) and waits for all of them. DoEach must not touch the state shared
+// between indexes.
+void ParallelForEachIndex(size_t num, const std::function<void(size_t)>& DoEach) {
+  if (num <= 1) {
+    FOR_RANGE(size_t, i, 0, num) { DoEach(i); }
+    return;
+  }
+  ThreadPool* thread_pool = OpGraphBuildThreadPool();
+  const size_t thread_num = std::min<size_t>(num, thread_pool->thread_num());
+  BalancedSplitter bs(num, thread_num);
+  BlockingCounter counter(thread_num);
+  FOR_RANGE(size_t, range_id, 0, thread_num) {
+    thread_pool->AddWork([&bs, &counter, &DoEach, range_id]() {
+      const Range range = bs.At(range_id);
+      FOR_RANGE(int64_t, i, range.begin(), range.end()) { DoEach(i); }
+      counter.Decrease();
+    });
+  }
+  counter.WaitUntilCntEqualZero();
+}
+
+}  // namespace
+
 std::string OpEdge::VisualStr() const {
   std::string str;
   int32_t idx = 0;
@@ -213,10 +258,22 @@ MakeGetterParallelDesc4OpName(const Job& job) {
 
 void OpGraph::InitNodes(const Job& job) {
   auto ParallelDesc4OpName = MakeGetterParallelDesc4OpName(job);
-  for (const auto& op_conf : job.net().op()) {
-    op_names_.push_back(op_conf.name());
-    OpNode* node = new OpNode(ParallelDesc4OpName(op_conf.name()), op_conf);
-    AddAllocatedNode(node);
+  const size_t op_num = job.net().op_size();
+  std::vector<OpNode*> nodes(op_num);
+  // Constructing the operators is independent between ops, so it could be done in parallel.
+  const auto NewOpNode = [&](size_t i) {
+    const OperatorConf& op_conf = job.net().op(i);
+    nodes.at(i) = new OpNode(ParallelDesc4OpName(op_conf.name()), op_conf);
+  };
+  if (IsParallelBuildEnabled(op_num)) {
+    ParallelForEachIndex(op_num, NewOpNode);
+  } else {
+    FOR_RANGE(size_t, i, 0, op_num) { NewOpNode(i); }
+  }
+  // Add nodes in the order of the job so that the node ids are deterministic.
+  FOR_RANGE(size_t, i, 0, op_num) {
+    op_names_.push_back(job.net().op(i).name());
+    AddAllocatedNode(nodes.at(i));
   }
 }
 
@@ -285,14 +342,41 @@ void OpGraph::InferBlobLastUsed() const {
 }
 
 void OpGraph::InferTimeShape() const {
-  TopoForEachNode([&](OpNode* op_node) {
+  CHECK_JUST(ParallelTopoForEachNodeWithErrorCaptured([&](OpNode* op_node) -> Maybe<void> {
     auto GetInputBlobTimeShape = [&](int32_t index) -> Maybe<const Shape> {
       CHECK_LT_OR_RETURN(index, op_node->input_index2producer_and_output_index_.size());
       return op_node->input_index2producer_and_output_index_.at(index).first->op().GetOpTimeShape();
     };
-    CHECK_JUST(op_node->mut_op()->FillInputBlobTimeShape(GetInputBlobTimeShape));
-    CHECK_JUST(op_node->mut_op()->InferOpTimeShapeIf());
+    JUST(op_node->mut_op()->FillInputBlobTimeShape(GetInputBlobTimeShape));
+    JUST(op_node->mut_op()->InferOpTimeShapeIf());
+    return Maybe<void>::Ok();
+  }));
+}
+
+Maybe<void> OpGraph::ParallelTopoForEachNodeWithErrorCaptured(
+    const std::function<Maybe<void>(OpNode*)>& NodeHandler) const {
+  if (!IsParallelBuildEnabled(node_num())) { return TopoForEachNodeWithErrorCaptured(NodeHandler); }
+  // The level of a node is the length of the longest path from the sources to it, so the nodes
+  // of the same level never depend on each other.
+  HashMap<OpNode*, size_t> node2level;
+  std::vector<std::vector<OpNode*>> level2nodes;
+  TopoForEachNode([&](OpNode* node) {
+    size_t level = 0;
+    node->ForEachNodeOnInEdge(
+        [&](OpNode* in_node) { level = std::max(level, node2level.at(in_node) + 1); });
+    node2level.emplace(node, level);
+    if (level2nodes.size() <= level) { level2nodes.resize(level + 1); }
+    level2nodes.at(level).push_back(node);
   });
+  for (const auto& nodes : level2nodes) {
+    std::vector<std::unique_ptr<Maybe<void>>> results(nodes.size());
+    ParallelForEachIndex(nodes.size(), [&](size_t i) {
+      results.at(i).reset(new Maybe<void>(NodeHandler(nodes.at(i))));
+    });
+    // Report the first error in the order of nodes to keep the error message deterministic.
+    for (const auto& result : results) { JUST(*result); }
+  }
+  return Maybe<void>::Ok();
 }
 
 void OpGraph::InferOpNodeNdSbpSignature(OpNode* op_node,
@@ -347,8 +431,8 @@ const OpNode* OpGraph::OpNode4OpName(const std::string& op_name) const {
 }
 
 Maybe<void> OpGraph::InferLogicalBlobDesc(const Job& job) const {
-  JobParallelViewConf job_parallel_view_conf(job.job_parallel_view_conf());
-  JUST(TopoForEachNodeWithErrorCaptured([&](OpNode* op_node) -> Maybe<void> {
+  const JobParallelViewConf job_parallel_view_conf(job.job_parallel_view_conf());
+  JUST(ParallelTopoForEachNodeWithErrorCaptured([&](OpNode* op_node) -> Maybe<void> {
     auto LogicalBlobDesc4InputIndex = [&](int32_t index) -> Maybe<const BlobDesc> {
       CHECK_LT_OR_RETURN(index, op_node->input_index2producer_and_output_index_.size());
       const auto& producer_info = op_node->input_index2producer_and_output_index_.at(index);
@@ -138,6 +138,10 @@ class OpGraph final : public Graph<OpNode, OpEdge> {
   void InferOpNodeNdSbpSignature(OpNode* op_node, const cfg::NdSbpSignature& nd_sbp_sig_conf) const;
   Maybe<void> InferOpNodeMirroredSignature(OpNode* op_node, bool is_mirrored_conf) const;
   Maybe<void> InferLogicalBlobDesc(const Job& job) const;
+  // Visits the nodes level by level in topological order, and the nodes of the same level are
+  // handled in parallel if the graph is large enough.
+  Maybe<void> ParallelTopoForEachNodeWithErrorCaptured(
+      const std::function<Maybe<void>(OpNode*)>& NodeHandler) const;
   std::string GetOpNameKey(const std::string& op_name, const LogicalBlobId& lbi) const;
   LogicalBlobId GetLogicalBlobIdKey(const std::string& op_name, const LogicalBlobId& lbi) const;
 
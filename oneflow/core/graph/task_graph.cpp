@@ -29,6 +29,7 @@ limitations under the License.
 #include "oneflow/core/graph/boxing/sub_task_graph_builder_util.h"
 #include "oneflow/core/graph/boxing/hierarchical_sub_task_graph_builder_impl.h"
 #include "oneflow/core/graph/task_stream_index_manager.h"
+#include "oneflow/core/graph/memory_aware_topo_order.h"
 #include "oneflow/core/ep/include/primitive/memcpy.h"
 
 namespace oneflow {
@@ -418,6 +419,15 @@ void ForEachOpGraphNecessaryCtrlEdge(
   });
 }
 
+int64_t ReusedMemBytes4Regst(RegstDesc* regst) {
+  if (!regst->enable_reuse_mem()) { return 0; }
+  int64_t bytes = 0;
+  regst->ForEachLbi([&](const LogicalBlobId& lbi) {
+    bytes += regst->GetBlobDesc(lbi)->AlignedTotalByteSize();
+  });
+  return bytes * regst->min_register_num();
+}
+
 }  // namespace
 
 TaskGraph::TaskGraph() {
@@ -592,9 +602,58 @@ void TaskGraph::RemoveEmptyRegsts() {
 
 void TaskGraph::MergeChainAndAddOrderingCtrlEdgeInSameChain() {
   MergeChain();
+  if (GlobalJobDesc().job_conf().enable_memory_aware_task_reorder()) { ReorderTaskByMemory(); }
   BuildCtrlRegstDescInSameChain();
 }
 
+void TaskGraph::ReorderTaskByMemory() {
+  HashMap<const TaskNode*, int64_t> task2index;
+  FOR_RANGE(int64_t, i, 0, ordered_task_nodes_.size()) {
+    task2index.emplace(ordered_task_nodes_.at(i), i);
+  }
+  std::vector<TaskMemInfo> tasks(ordered_task_nodes_.size());
+  std::vector<RegstMemInfo> regsts;
+  FOR_RANGE(int64_t, i, 0, ordered_task_nodes_.size()) {
+    const TaskNode* node = ordered_task_nodes_.at(i);
+    tasks.at(i).chain_id = node->chain_id();
+    for (const TaskEdge* edge : node->out_edges()) {
+      tasks.at(i).out_tasks.push_back(task2index.at(edge->dst_node()));
+    }
+    for (const auto& pair : node->produced_regsts()) {
+      const int64_t bytes = ReusedMemBytes4Regst(pair.second.get());
+      if (bytes == 0) { continue; }
+      RegstMemInfo regst{bytes, i, {}};
+      for (const TaskNode* consumer : pair.second->consumers()) {
+        regst.consumers.push_back(task2index.at(consumer));
+      }
+      regsts.emplace_back(std::move(regst));
+    }
+  }
+  std::map<int64_t, std::pair<int64_t, int64_t>> chain_id2peaks;
+  const std::vector<int64_t> order = LowerPeakTopoOrder(tasks, regsts, &chain_id2peaks);
+  int64_t total_before = 0;
+  int64_t total_after = 0;
+  for (const auto& pair : chain_id2peaks) {
+    if (pair.second.first == 0) { continue; }
+    total_before += pair.second.first;
+    total_after += pair.second.second;
+    LOG(INFO) << "job " << GlobalJobDesc().job_id() << " chain " << pair.first
+              << " peak mem reused bytes: " << pair.second.first << " -> " << pair.second.second;
+  }
+  const bool apply = total_after < total_before;
+  LOG(INFO) << "job " << GlobalJobDesc().job_id() << " memory aware task reorder: total peak "
+            << total_before << " -> " << total_after << " bytes, "
+            << (apply ? "applied" : "kept original order");
+  if (!apply) { return; }
+  std::vector<TaskNode*> reordered;
+  reordered.reserve(order.size());
+  for (int64_t i : order) { reordered.push_back(ordered_task_nodes_.at(i)); }
+  ordered_task_nodes_.swap(reordered);
+  FOR_RANGE(int64_t, i, 0, ordered_task_nodes_.size()) {
+    ordered_task_nodes_.at(i)->update_order_in_graph(i);
+  }
+}
+
 void TaskGraph::SetOrderInGraphForEachNode() {
   int64_t order_in_graph = 0;
   auto SetOrderInGraph = [&](TaskNode* task_node) {
@@ -83,6 +83,9 @@ class TaskGraph final : public Graph<TaskNode, TaskEdge> {
 
   void SetOrderInGraphForEachNode();
   void MergeChain();
+  // Reorders ordered_task_nodes_ to lower the peak of mem reused regsts in each chain before the
+  // ordering ctrl edges are built.
+  void ReorderTaskByMemory();
   void BuildCtrlRegstDescInSameChain();
 
   // inplace
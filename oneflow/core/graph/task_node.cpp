@@ -92,6 +92,11 @@ void TaskNode::set_order_in_graph(int64_t val) {
   order_in_graph_ = val;
 }
 
+void TaskNode::update_order_in_graph(int64_t val) {
+  CHECK_NE(order_in_graph_, -1);
+  order_in_graph_ = val;
+}
+
 void TaskNode::PinConsumedRegst() {
   for (auto& pair : consumed_regsts_) {
     for (const std::shared_ptr<RegstDesc>& regst : pair.second) {
@@ -20,6 +20,7 @@ limitations under the License.
 #include "oneflow/core/persistence/tee_persistent_log_stream.h"
 #include "oneflow/core/graph/op_graph.h"
 #include "oneflow/core/job_rewriter/job_completer.h"
+#include "oneflow/core/profiler/compile_profiler.h"
 #include "oneflow/core/thread/thread_pool.h"
 #include "oneflow/core/common/blocking_counter.h"
 
@@ -46,11 +47,20 @@ void CreateOpAttributeRef(Plan* plan, int64_t job_id, TaskProto* task_proto) {
 }
 
 void Compiler::Compile(Job* job, Plan* plan, bool need_job_complete) const {
+  const int64_t job_id = GlobalJobDesc().job_id();
   // Step1: ensure job is completed.
-  if (need_job_complete) { CHECK_JUST(JobCompleter().Complete(job)); }
+  if (need_job_complete) {
+    profiler::CompileProfileGuard profile_guard(job_id, "phase", "JobCompleter", job);
+    CHECK_JUST(JobCompleter().Complete(job));
+  }
 
   // Step2: new Global<OpGraph> and set log configs.
-  Global<OpGraph>::New(*job);
+  {
+    profiler::CompileProfileGuard profile_guard(job_id, "phase", "BuildOpGraph");
+    Global<OpGraph>::New(*job);
+    profile_guard.SetGraphSize(Global<OpGraph>::Get()->node_num(),
+                               Global<OpGraph>::Get()->edge_num());
+  }
   const JobDesc& job_desc = GlobalJobDesc();
   if (Global<ResourceDesc, ForSession>::Get()->enable_debug_mode()
       || Global<ResourceDesc, ForSession>::Get()->enable_dry_run()) {
@@ -61,57 +71,81 @@ void Compiler::Compile(Job* job, Plan* plan, bool need_job_complete) const {
 
   // Step3: build task_gph.
   // TODO(levi): we can rewrite this part of code in visitor pattern.
-  auto task_gph = std::make_unique<TaskGraph>();
-  using std::placeholders::_1;
-  task_gph->ForEachNode(std::bind(&TaskNode::ProduceAllRegstsAndBindEdges, _1));
-  task_gph->ForEachNode(std::bind(&TaskNode::ConsumeAllRegsts, _1));
-  task_gph->ForEachNode(std::bind(&TaskNode::PinConsumedRegst, _1));
-  task_gph->TopoForEachNode(&TaskNode::Build);
-  task_gph->RemoveEmptyRegsts();
-  // NOTE(chengcheng):
-  //   In Multi-Client, each rank has its own src_tick/dst_tick and input/output with callback,
-  //   which need to be forced sequenced.
-  task_gph->AddCtrlEdgeBetweenSrcDstTickAndInputOutputInSameRank();
-  task_gph->MergeChainAndAddOrderingCtrlEdgeInSameChain();
+  std::unique_ptr<TaskGraph> task_gph;
+  {
+    profiler::CompileProfileGuard profile_guard(job_id, "phase", "BuildTaskGraph");
+    task_gph = std::make_unique<TaskGraph>();
+    profile_guard.SetGraphSize(task_gph->node_num(), task_gph->edge_num());
+  }
+  {
+    profiler::CompileProfileGuard profile_guard(job_id, "phase", "BuildTaskNodes");
+    using std::placeholders::_1;
+    task_gph->ForEachNode(std::bind(&TaskNode::ProduceAllRegstsAndBindEdges, _1));
+    task_gph->ForEachNode(std::bind(&TaskNode::ConsumeAllRegsts, _1));
+    task_gph->ForEachNode(std::bind(&TaskNode::PinConsumedRegst, _1));
+    task_gph->TopoForEachNode(&TaskNode::Build);
+    task_gph->RemoveEmptyRegsts();
+  }
+  {
+    profiler::CompileProfileGuard profile_guard(job_id, "phase", "AddOrderingCtrlEdges");
+    // NOTE(chengcheng):
+    //   In Multi-Client, each rank has its own src_tick/dst_tick and input/output with callback,
+    //   which need to be forced sequenced.
+    task_gph->AddCtrlEdgeBetweenSrcDstTickAndInputOutputInSameRank();
+    task_gph->MergeChainAndAddOrderingCtrlEdgeInSameChain();
+    profile_guard.SetGraphSize(task_gph->node_num(), task_gph->edge_num());
+  }
   auto IsReachable = Global<OpGraph>::Get()->MakePredicatorIsOpNameDataOrCtrlReachable();
-  if (job_desc.enable_inplace()) { task_gph->EnableInplaceMemSharing(IsReachable); }
-  task_gph->TopoForEachNode(&TaskNode::InferTimeShapeIfMeaningful);
-  task_gph->ForEachEdge([&](TaskEdge* task_edge) { task_edge->CheckRegstLbiValid(); });
+  if (job_desc.enable_inplace()) {
+    profiler::CompileProfileGuard profile_guard(job_id, "phase", "EnableInplaceMemSharing");
+    task_gph->EnableInplaceMemSharing(IsReachable);
+  }
+  {
+    profiler::CompileProfileGuard profile_guard(job_id, "phase", "InferTaskTimeShape");
+    task_gph->TopoForEachNode(&TaskNode::InferTimeShapeIfMeaningful);
+    task_gph->ForEachEdge([&](TaskEdge* task_edge) { task_edge->CheckRegstLbiValid(); });
+  }
 
   // Step4: put infomation from task_gph into plan.
-  const int64_t node_num = task_gph->node_num();
-  const int64_t cpu_num = std::thread::hardware_concurrency();
-  const int64_t thread_pool_size = std::min(node_num, cpu_num);
-  BlockingCounter counter(node_num);
-  std::mutex mtx;
-  ThreadPool thread_pool(thread_pool_size);
-  task_gph->ForEachNode([&](TaskNode* task_node) {
-    thread_pool.AddWork([task_node, plan, &job_desc, &counter, &mtx]() {
-      if (!task_node->IsMeaningLess()) {
-        TaskProto task_proto;
-        task_node->ToProto(&task_proto);
-        {
-          std::unique_lock<std::mutex> guard(mtx);
-          if (task_node->GetTaskType() == kNormalForward || task_node->GetTaskType() == kRepeat
-              || task_node->GetTaskType() == kAcc) {
-            CreateOpAttributeRef(plan, job_desc.job_id(), &task_proto);
-          }
-          plan->mutable_task()->Add(std::move(task_proto));
-        }  // guard(mtx)
-      }
-      counter.Decrease();
-    } /* thread_pool.AddWork */);
-  } /* task_gph->ForEachNode */);
-  counter.WaitUntilCntEqualZero();
-  // NOTE(levi): release task_gph here to decrise memory peak.
-  task_gph.reset();
+  {
+    profiler::CompileProfileGuard profile_guard(job_id, "phase", "TaskGraphToPlan");
+    const int64_t node_num = task_gph->node_num();
+    const int64_t cpu_num = std::thread::hardware_concurrency();
+    const int64_t thread_pool_size = std::min(node_num, cpu_num);
+    BlockingCounter counter(node_num);
+    std::mutex mtx;
+    ThreadPool thread_pool(thread_pool_size);
+    task_gph->ForEachNode([&](TaskNode* task_node) {
+      thread_pool.AddWork([task_node, plan, &job_desc, &counter, &mtx]() {
+        if (!task_node->IsMeaningLess()) {
+          TaskProto task_proto;
+          task_node->ToProto(&task_proto);
+          {
+            std::unique_lock<std::mutex> guard(mtx);
+            if (task_node->GetTaskType() == kNormalForward || task_node->GetTaskType() == kRepeat
+                || task_node->GetTaskType() == kAcc) {
+              CreateOpAttributeRef(plan, job_desc.job_id(), &task_proto);
+            }
+            plan->mutable_task()->Add(std::move(task_proto));
+          }  // guard(mtx)
+        }
+        counter.Decrease();
+      } /* thread_pool.AddWork */);
+    } /* task_gph->ForEachNode */);
+    counter.WaitUntilCntEqualZero();
+    // NOTE(levi): release task_gph here to decrise memory peak.
+    task_gph.reset();
+  }
 
   // Step5: post-process for plan and delete Global<OpGraph>.
   auto* job_id2job_conf = plan->mutable_job_confs()->mutable_job_id2job_conf();
   (*job_id2job_conf)[GlobalJobDesc().job_id()] = GlobalJobDesc().job_conf();
-  // NOTE(chengcheng): infer mem blob id & set inplace & add ctrl
-  IntraJobMemSharingUtil::InferMemBlockId4MemReusedRegst(plan, IsReachable);
-  PlanUtil::SetUniqueMemBlockId4UnreusedMemRegst(plan);
+  {
+    profiler::CompileProfileGuard profile_guard(job_id, "phase", "MemSharing");
+    // NOTE(chengcheng): infer mem blob id & set inplace & add ctrl
+    IntraJobMemSharingUtil::InferMemBlockId4MemReusedRegst(plan, IsReachable);
+    PlanUtil::SetUniqueMemBlockId4UnreusedMemRegst(plan);
+  }
   Global<OpGraph>::Delete();
 }
 
@@ -40,6 +40,7 @@ limitations under the License.
 #include "oneflow/core/graph/plan_task_graph.h"
 #include "oneflow/core/graph/boxing/collective_boxing_util.h"
 #include "oneflow/core/profiler/profiler.h"
+#include "oneflow/core/profiler/compile_profiler.h"
 #include "oneflow/core/job/sbp_parallel.cfg.h"
 
 namespace std {
@@ -204,11 +205,19 @@ Maybe<void> CompileCurJobOnMaster(Job* job, Plan* plan, bool need_job_complete)
   const JobDesc& job_desc = GlobalJobDesc();
   if (GlobalProcessCtx::IsThisProcessMaster()) {
     double start = GetCurTime();
-    Compiler().Compile(job, plan, need_job_complete);
-    PlanUtil::GenMemBlockAndChunk4Plan(plan);
+    {
+      profiler::CompileProfileGuard profile_guard(job_desc.job_id(), "phase", "Compile");
+      Compiler().Compile(job, plan, need_job_complete);
+    }
+    {
+      profiler::CompileProfileGuard profile_guard(job_desc.job_id(), "phase",
+                                                  "GenMemBlockAndChunk");
+      PlanUtil::GenMemBlockAndChunk4Plan(plan);
+    }
 
     LOG(INFO) << "\njob_id: " << job_desc.job_id() << " , job_name: " << job_desc.job_name()
               << " , compile time: " << (GetCurTime() - start) / 1000000000.0 << " seconds.\n";
+    profiler::CompileProfiler::Get()->Report(job_desc.job_id(), job_desc.job_name());
     if (Global<ResourceDesc, ForSession>::Get()->enable_debug_mode()) {
       TeePersistentLogStream::Create(StrCat("subplan_job_", job_desc.job_id()))->Write(*plan);
     }
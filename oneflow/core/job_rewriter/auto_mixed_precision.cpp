@@ -14,13 +14,13 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
-#ifdef WITH_CUDA
-
 #include "oneflow/core/job_rewriter/auto_mixed_precision_lists.h"
 
 #include <algorithm>
 
+#ifdef WITH_CUDA
 #include "oneflow/core/device/cuda_util.h"
+#endif  // WITH_CUDA
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/core/job_rewriter/job_pass.h"
 #include "oneflow/core/job_rewriter/pass_util.h"
@@ -53,17 +53,36 @@ bool FindInNoCastRegisry(const std::string& op_type, const OpArg& op_arg) {
   return false;
 }
 
-std::function<bool(OpNode*)> MakePredicatorIsAllowedToRunWithHalf(const OpGraph& op_graph) {
+bool IsAllowedToRunWithCpuBFloat16(const OpNode* node) {
+  if (node->parallel_desc().device_type() != DeviceType::kCPU) { return false; }
+  const OperatorConf& op_conf = node->op().op_conf();
+  if (!op_conf.has_user_conf()) { return false; }
+  const std::string& op_type = op_conf.user_conf().op_type_name();
+  if (!IsKeyFound(AutoMixedPrecisionLists::CpuBFloat16List(), op_type)) { return false; }
+  if (op_type == "conv2d") {
+    // the CPU bfloat16 conv kernels support neither groups nor the bias gradient
+    const user_op::UserOpConfWrapper conv_conf(op_conf);
+    return conv_conf.attr<int32_t>("groups") == 1 && !conv_conf.has_input("bias", 0);
+  }
+  return true;
+}
+
+std::function<bool(OpNode*)> MakePredicatorIsAllowedToRunWithHalf(const OpGraph& op_graph,
+                                                                  bool use_bfloat16) {
   auto allowed_set = std::make_shared<HashSet<OpNode*>>();
   op_graph.ForEachNode([&](OpNode* node) {
-    if (node->parallel_desc().device_type() != DeviceType::kGPU) { return; }
+    if (use_bfloat16) {
+      if (!IsAllowedToRunWithCpuBFloat16(node)) { return; }
+    } else if (node->parallel_desc().device_type() != DeviceType::kGPU) {
+      return;
+    }
     if (node->op().output_bns().size() > 0) { INSERT_CHECK(allowed_set->insert(node)); }
   });
   return [allowed_set](OpNode* node) -> bool { return IsKeyFound(*allowed_set, node); };
 }
 
-void InsertCastOpImpl(bool f2h, const OpGraph& op_graph, const HashSet<OpNode*>& white_set,
-                      JobBuilder* job_builder) {
+void InsertCastOpImpl(bool f2h, DataType half_data_type, const OpGraph& op_graph,
+                      const HashSet<OpNode*>& white_set, JobBuilder* job_builder) {
   HashSet<OpEdge*> white_set_edges;
   {
     std::function<const std::unordered_set<OpEdge*>&(OpNode*)> Node2Edges =
@@ -104,7 +123,7 @@ void InsertCastOpImpl(bool f2h, const OpGraph& op_graph, const HashSet<OpNode*>&
     if (blob_desc.data_type() != DataType::kFloat) { continue; }
 
     std::string cast_suffix = f2h ? "-cast_f2h" : "-cast_h2f";
-    DataType cast_data_type = f2h ? DataType::kFloat16 : DataType::kFloat;
+    DataType cast_data_type = f2h ? half_data_type : DataType::kFloat;
     auto cast_op = user_op::UserOpConfWrapperBuilder(ReplaceSlashToDash4Lbn(lbn) + cast_suffix)
                        .Op("cast")
                        .Input("in", lbn)
@@ -184,8 +203,8 @@ class AutoMixedPrecision final : public JobPass {
                                        std::function<bool(OpNode*)> IsAllowedToRunWithHalf,
                                        const HashSet<OpNode*>& black_set,
                                        HashSet<OpNode*>* white_set) const;
-  void InsertCastOp(const OpGraph& op_graph, const HashSet<OpNode*>& white_set,
-                    JobBuilder* job_builder) const;
+  void InsertCastOp(const OpGraph& op_graph, DataType half_data_type,
+                    const HashSet<OpNode*>& white_set, JobBuilder* job_builder) const;
 
   const AMPList& white_list_;
   const AMPList& black_list_;
@@ -194,13 +213,19 @@ class AutoMixedPrecision final : public JobPass {
 };
 
 Maybe<void> AutoMixedPrecision::Apply(const OpGraph& op_graph, JobBuilder* job_builder) const {
-  CHECK_GE(CUDA_VERSION, 10000);
+  // bfloat16 mode keeps the GPU part of the job in float and casts CPU ops having bfloat16
+  // kernels instead, see AutoMixedPrecisionLists::CpuBFloat16List
+  const bool use_bfloat16 = GlobalJobDesc().job_conf().auto_mixed_precision_use_bfloat16();
+#ifdef WITH_CUDA
+  if (!use_bfloat16) { CHECK_GE(CUDA_VERSION, 10000); }
+#endif  // WITH_CUDA
   CHECK(GlobalJobDesc().DefaultDataType() == DataType::kFloat);
 
   VerifyAMPList(white_list_);
   VerifyAMPList(black_list_);
   VerifyAMPList(gray_list_);
   VerifyAMPList(clear_list_);
+  VerifyAMPList(AutoMixedPrecisionLists::CpuBFloat16List());
 
   std::function<std::string(OpNode* const&)> OpName4Node = [](OpNode* const& node) {
     return node->op().op_name();
@@ -212,7 +237,7 @@ Maybe<void> AutoMixedPrecision::Apply(const OpGraph& op_graph, JobBuilder* job_b
   VLOG(1) << "BlackSet include: "
           << Container2Str<HashSet<OpNode*>, OpNode*>(black_set, OpName4Node);
 
-  auto IsAllowedToRunWithHalf = MakePredicatorIsAllowedToRunWithHalf(op_graph);
+  auto IsAllowedToRunWithHalf = MakePredicatorIsAllowedToRunWithHalf(op_graph, use_bfloat16);
   FillWhiteSet(op_graph, IsAllowedToRunWithHalf, black_set, &white_set);
   VLOG(2) << "WhiteSet Before Propagate include: "
           << Container2Str<HashSet<OpNode*>, OpNode*>(white_set, OpName4Node);
@@ -220,7 +245,8 @@ Maybe<void> AutoMixedPrecision::Apply(const OpGraph& op_graph, JobBuilder* job_b
   VLOG(1) << "WhiteSet include: "
           << Container2Str<HashSet<OpNode*>, OpNode*>(white_set, OpName4Node);
 
-  InsertCastOp(op_graph, white_set, job_builder);
+  InsertCastOp(op_graph, use_bfloat16 ? DataType::kBFloat16 : DataType::kFloat16, white_set,
+               job_builder);
   return Maybe<void>::Ok();
 }
 
@@ -302,10 +328,11 @@ void AutoMixedPrecision::PropagateWhiteThroughClearNodes(
   PropagateIntoOneDirection(false);
 }
 
-void AutoMixedPrecision::InsertCastOp(const OpGraph& op_graph, const HashSet<OpNode*>& white_set,
+void AutoMixedPrecision::InsertCastOp(const OpGraph& op_graph, DataType half_data_type,
+                                      const HashSet<OpNode*>& white_set,
                                       JobBuilder* job_builder) const {
-  InsertCastOpImpl(true, op_graph, white_set, job_builder);
-  InsertCastOpImpl(false, op_graph, white_set, job_builder);
+  InsertCastOpImpl(true, half_data_type, op_graph, white_set, job_builder);
+  InsertCastOpImpl(false, half_data_type, op_graph, white_set, job_builder);
 }
 
 REGISTER_JOB_PASS("AutoMixedPrecision", AutoMixedPrecision);
@@ -342,5 +369,3 @@ REGISTER_NO_CAST_REGISTRY("normalization_add_relu", "beta", 0)
 }  // namespace
 
 }  // namespace oneflow
-
-#endif  // WITH_CUDA
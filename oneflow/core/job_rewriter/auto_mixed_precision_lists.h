@@ -30,6 +30,9 @@ class AutoMixedPrecisionLists final {
   static const AMPList& BlackList();
   static const AMPList& GrayList();
   static const AMPList& ClearList();
+  // ops allowed to run in bfloat16 on CPU, i.e. having CPU bfloat16 kernels for themselves and
+  // for the ops their gradients are built of
+  static const AMPList& CpuBFloat16List();
 };
 
 }  // namespace oneflow
@@ -0,0 +1,281 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job_rewriter/job_pass.h"
+#include "oneflow/core/job_rewriter/auto_parallel_sbp_search.h"
+#include "oneflow/core/job/sbp_parallel.h"
+#include "oneflow/core/persistence/tee_persistent_log_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+using auto_parallel::kInfeasibleCost;
+using auto_parallel::SbpSearchGraph;
+
+double LogicalBytes(const BlobDesc& blob_desc) {
+  return static_cast<double>(blob_desc.shape().elem_cnt())
+         * GetSizeOfDataType(blob_desc.data_type());
+}
+
+double PerDeviceBytes(const BlobDesc& blob_desc, const cfg::SbpParallel& sbp_parallel,
+                      int64_t parallel_num) {
+  const double bytes = LogicalBytes(blob_desc);
+  return sbp_parallel.has_split_parallel() ? bytes / parallel_num : bytes;
+}
+
+// Bytes each device receives to turn the producer's sbp into the consumer's, using the traffic of
+// the collective that boxing would insert.
+double BoxingBytes(const BlobDesc& blob_desc, const ParallelDesc& producer_parallel_desc,
+                   const cfg::SbpParallel& producer_sbp, const ParallelDesc& consumer_parallel_desc,
+                   const cfg::SbpParallel& consumer_sbp) {
+  const bool same_placement = producer_parallel_desc == consumer_parallel_desc;
+  if (same_placement && producer_sbp == consumer_sbp) { return 0; }
+  if (consumer_sbp.has_partial_sum_parallel()) { return kInfeasibleCost; }
+  const int64_t parallel_num = consumer_parallel_desc.parallel_num();
+  const double bytes = LogicalBytes(blob_desc);
+  if (!same_placement) { return PerDeviceBytes(blob_desc, consumer_sbp, parallel_num); }
+  const double ring_bytes = bytes * (parallel_num - 1) / parallel_num;
+  if (producer_sbp.has_partial_sum_parallel()) {
+    // all-reduce or reduce-scatter
+    return consumer_sbp.has_broadcast_parallel() ? 2 * ring_bytes : ring_bytes;
+  }
+  if (producer_sbp.has_broadcast_parallel()) {
+    // each device slices its own part
+    return 0;
+  }
+  // all-gather or all-to-all
+  return consumer_sbp.has_broadcast_parallel() ? ring_bytes : ring_bytes / parallel_num;
+}
+
+bool AllOfInOutBns(const Operator& op, const std::function<bool(const std::string&)>& Pred) {
+  return std::all_of(op.input_bns().cbegin(), op.input_bns().cend(), Pred)
+         && std::all_of(op.output_bns().cbegin(), op.output_bns().cend(), Pred);
+}
+
+bool IsSameSbpSignature(const Operator& op, const cfg::SbpSignature& lhs,
+                        const cfg::SbpSignature& rhs) {
+  const auto& lhs_map = lhs.bn_in_op2sbp_parallel();
+  const auto& rhs_map = rhs.bn_in_op2sbp_parallel();
+  return AllOfInOutBns(op, [&](const std::string& bn) {
+    const auto lhs_it = lhs_map.find(bn);
+    const auto rhs_it = rhs_map.find(bn);
+    return lhs_it != lhs_map.end() && rhs_it != rhs_map.end() && lhs_it->second == rhs_it->second;
+  });
+}
+
+std::string SbpSignatureToString(const Operator& op, const cfg::SbpSignature& sbp_signature) {
+  std::string str;
+  AllOfInOutBns(op, [&](const std::string& bn) {
+    if (!str.empty()) { str += ", "; }
+    str += bn + ":" + SbpParallelToString(sbp_signature.bn_in_op2sbp_parallel().at(bn));
+    return true;
+  });
+  return str;
+}
+
+struct SearchNode {
+  const OpNode* op_node;
+  bool searchable;
+  int64_t greedy_choice;
+  std::vector<cfg::SbpSignature> candidates;
+};
+
+class AutoParallelPass final : public JobPass {
+ public:
+  AutoParallelPass() = default;
+  ~AutoParallelPass() override = default;
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    return ctx.job_desc().job_conf().enable_auto_parallel();
+  }
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
+    if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+    const OpGraph op_graph(*job);
+    JobBuilder job_builder(job);
+    return Apply(*job, op_graph, ctx->job_desc(), &job_builder);
+  }
+
+ private:
+  Maybe<void> Apply(const Job& job, const OpGraph& op_graph, const JobDesc& job_desc,
+                    JobBuilder* job_builder) const;
+  Maybe<void> InitCandidates(const OpNode* op_node, SearchNode* search_node) const;
+};
+
+Maybe<void> AutoParallelPass::InitCandidates(const OpNode* op_node,
+                                             SearchNode* search_node) const {
+  const Operator& op = op_node->op();
+  const ParallelDesc& parallel_desc = op_node->parallel_desc();
+  const cfg::SbpSignature& greedy = op_node->sbp_signature();
+  if (search_node->searchable) {
+    const auto LogicalBlobDesc4Ibn = [&](const std::string& ibn) -> Maybe<const BlobDesc&> {
+      return op_node->LogicalBlobDesc4Lbi(op.BnInOp2Lbi(ibn));
+    };
+    cfg::SbpSignatureList sbp_sig_list;
+    JUST(op.GetSbpSignaturesIf(LogicalBlobDesc4Ibn, parallel_desc, &sbp_sig_list));
+    for (const auto& sbp_signature : sbp_sig_list.sbp_signature()) {
+      // same as the logical shape filter of the greedy inference, applied to outputs as well
+      const bool is_valid = AllOfInOutBns(op, [&](const std::string& bn) {
+        const auto it = sbp_signature.bn_in_op2sbp_parallel().find(bn);
+        if (it == sbp_signature.bn_in_op2sbp_parallel().end()) { return false; }
+        if (!it->second.has_split_parallel()) { return true; }
+        const Shape& shape = op_node->LogicalBlobDesc4Lbi(op.BnInOp2Lbi(bn)).shape();
+        const int64_t axis = it->second.split_parallel().axis();
+        return axis < shape.NumAxes() && shape.At(axis) >= parallel_desc.parallel_num();
+      });
+      if (!is_valid) { continue; }
+      const bool is_duplicated =
+          std::any_of(search_node->candidates.cbegin(), search_node->candidates.cend(),
+                      [&](const cfg::SbpSignature& candidate) {
+                        return IsSameSbpSignature(op, candidate, sbp_signature);
+                      });
+      if (!is_duplicated) { search_node->candidates.push_back(sbp_signature); }
+    }
+  }
+  search_node->greedy_choice = -1;
+  FOR_RANGE(int64_t, i, 0, search_node->candidates.size()) {
+    if (IsSameSbpSignature(op, search_node->candidates.at(i), greedy)) {
+      search_node->greedy_choice = i;
+      break;
+    }
+  }
+  if (search_node->greedy_choice == -1) {
+    search_node->greedy_choice = search_node->candidates.size();
+    search_node->candidates.push_back(greedy);
+  }
+  if (search_node->candidates.size() == 1) { search_node->searchable = false; }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> AutoParallelPass::Apply(const Job& job, const OpGraph& op_graph,
+                                    const JobDesc& job_desc, JobBuilder* job_builder) const {
+  const JobConfigProto& job_conf = job_desc.job_conf();
+  const auto& parallel_view_conf = job.job_parallel_view_conf();
+  const auto IsSearchable = [&](const OpNode* op_node) {
+    const std::string& op_name = op_node->op().op_name();
+    if (op_node->parallel_desc().parallel_num() <= 1) { return false; }
+    if (parallel_view_conf.op_name2nd_sbp_signature_conf().count(op_name) > 0) { return false; }
+    const auto& op_name2is_mirrored = parallel_view_conf.op_name2is_mirrored_parallel_view();
+    const auto mirrored_it = op_name2is_mirrored.find(op_name);
+    return mirrored_it == op_name2is_mirrored.end() || !mirrored_it->second;
+  };
+  // Ops on multi-dimensional hierarchies keep their greedy nd sbp and are left out of the search.
+  std::vector<SearchNode> search_nodes;
+  HashMap<const OpNode*, int64_t> op_node2search_node_id;
+  JUST(op_graph.TopoForEachNodeWithErrorCaptured([&](const OpNode* op_node) -> Maybe<void> {
+    if (op_node->parallel_desc().hierarchy()->NumAxes() != 1) { return Maybe<void>::Ok(); }
+    SearchNode search_node;
+    search_node.op_node = op_node;
+    search_node.searchable = IsSearchable(op_node);
+    JUST(InitCandidates(op_node, &search_node));
+    op_node2search_node_id.emplace(op_node, search_nodes.size());
+    search_nodes.emplace_back(std::move(search_node));
+    return Maybe<void>::Ok();
+  }));
+
+  const double computation_cost_ratio = job_conf.auto_parallel_computation_cost_ratio();
+  SbpSearchGraph graph;
+  std::vector<int64_t> greedy_choices;
+  for (const SearchNode& search_node : search_nodes) {
+    const Operator& op = search_node.op_node->op();
+    const int64_t parallel_num = search_node.op_node->parallel_desc().parallel_num();
+    std::vector<double> compute_costs;
+    std::vector<double> memory_costs;
+    for (const cfg::SbpSignature& candidate : search_node.candidates) {
+      const auto& bn2sbp = candidate.bn_in_op2sbp_parallel();
+      double compute_bytes = 0;
+      double memory_bytes = 0;
+      for (const auto& ibn : op.input_bns()) {
+        const BlobDesc& blob_desc = search_node.op_node->LogicalBlobDesc4Lbi(op.BnInOp2Lbi(ibn));
+        compute_bytes += PerDeviceBytes(blob_desc, bn2sbp.at(ibn), parallel_num);
+      }
+      for (const auto& obn : op.output_bns()) {
+        const BlobDesc& blob_desc = search_node.op_node->LogicalBlobDesc4Lbi(op.BnInOp2Lbi(obn));
+        const double bytes = PerDeviceBytes(blob_desc, bn2sbp.at(obn), parallel_num);
+        compute_bytes += bytes;
+        memory_bytes += bytes;
+      }
+      compute_costs.push_back(computation_cost_ratio * compute_bytes);
+      memory_costs.push_back(memory_bytes);
+    }
+    graph.AddNode(std::move(compute_costs), std::move(memory_costs));
+    greedy_choices.push_back(search_node.greedy_choice);
+  }
+  FOR_RANGE(int64_t, dst, 0, search_nodes.size()) {
+    const SearchNode& consumer = search_nodes.at(dst);
+    const Operator& op = consumer.op_node->op();
+    for (const auto& ibn : op.input_bns()) {
+      const LogicalBlobId& lbi = op.BnInOp2Lbi(ibn);
+      const OpNode* producer_op_node = &consumer.op_node->ProducerOpNode4Lbi(lbi);
+      const auto producer_it = op_node2search_node_id.find(producer_op_node);
+      if (producer_it == op_node2search_node_id.end()) { continue; }
+      const int64_t src = producer_it->second;
+      const SearchNode& producer = search_nodes.at(src);
+      const std::string& obn = *JUST(producer_op_node->op().obn4lbi(lbi));
+      const BlobDesc& blob_desc = consumer.op_node->LogicalBlobDesc4Lbi(lbi);
+      std::vector<double> cost_matrix;
+      for (const cfg::SbpSignature& producer_sbp_sig : producer.candidates) {
+        for (const cfg::SbpSignature& consumer_sbp_sig : consumer.candidates) {
+          cost_matrix.push_back(BoxingBytes(
+              blob_desc, producer_op_node->parallel_desc(),
+              producer_sbp_sig.bn_in_op2sbp_parallel().at(obn), consumer.op_node->parallel_desc(),
+              consumer_sbp_sig.bn_in_op2sbp_parallel().at(ibn)));
+        }
+      }
+      graph.AddEdgeCost(src, dst, cost_matrix);
+    }
+  }
+
+  const double memory_limit = job_conf.auto_parallel_memory_limit_mbyte() * 1024.0 * 1024.0;
+  const double greedy_cost = graph.Cost(greedy_choices);
+  const double greedy_memory = graph.Memory(greedy_choices);
+  const SbpSearchGraph::Plan plan = graph.Search(greedy_choices, memory_limit);
+  const bool greedy_fits = memory_limit <= 0 || greedy_memory <= memory_limit;
+  const bool plan_fits = memory_limit <= 0 || plan.memory <= memory_limit;
+  const bool use_plan = greedy_fits ? (plan_fits && plan.cost < greedy_cost)
+                                    : (plan_fits || plan.memory < greedy_memory);
+  const std::vector<int64_t>& choices = use_plan ? plan.choices : greedy_choices;
+
+  auto log_stream =
+      TeePersistentLogStream::Create("auto_parallel_plan_" + std::to_string(job_desc.job_id()));
+  const double kMByte = 1024.0 * 1024.0;
+  (*log_stream) << "greedy cost: " << std::to_string(greedy_cost)
+                << ", greedy memory(MB): " << std::to_string(greedy_memory / kMByte) << "\n";
+  (*log_stream) << "searched cost: " << std::to_string(plan.cost)
+                << ", searched memory(MB): " << std::to_string(plan.memory / kMByte) << "\n";
+  (*log_stream) << "applied: " << (use_plan ? "searched" : "greedy") << "\n";
+  int64_t changed_op_cnt = 0;
+  FOR_RANGE(int64_t, i, 0, search_nodes.size()) {
+    const SearchNode& search_node = search_nodes.at(i);
+    if (!search_node.searchable) { continue; }
+    const Operator& op = search_node.op_node->op();
+    const cfg::SbpSignature& chosen = search_node.candidates.at(choices.at(i));
+    if (choices.at(i) != greedy_choices.at(i)) { changed_op_cnt += 1; }
+    (*log_stream) << op.op_name() << "\t" << SbpSignatureToString(op, chosen) << "\n";
+    if (use_plan) { job_builder->AddSbpSignature4OpName(op.op_name(), chosen); }
+  }
+  LOG(INFO) << "AutoParallelPass: greedy cost " << greedy_cost << " memory "
+            << greedy_memory / kMByte << "MB, searched cost " << plan.cost << " memory "
+            << plan.memory / kMByte << "MB, " << (use_plan ? "applied" : "kept greedy plan")
+            << ", " << changed_op_cnt << " ops changed";
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_JOB_PASS("AutoParallelPass", AutoParallelPass);
+
+}  // namespace oneflow
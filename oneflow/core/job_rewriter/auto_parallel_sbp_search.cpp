@@ -0,0 +1,217 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job_rewriter/auto_parallel_sbp_search.h"
+
+namespace oneflow {
+
+namespace auto_parallel {
+
+namespace {
+
+constexpr int64_t kMaxRefineRounds = 32;
+constexpr int64_t kMaxMemoryWeightDoublings = 64;
+constexpr int64_t kMemoryWeightBisections = 8;
+
+double Objective(const SbpSearchGraph::Plan& plan, double memory_weight) {
+  return plan.cost + memory_weight * plan.memory;
+}
+
+}  // namespace
+
+int64_t SbpSearchGraph::AddNode(std::vector<double> compute_costs,
+                                std::vector<double> memory_costs) {
+  CHECK(!compute_costs.empty());
+  CHECK_EQ(compute_costs.size(), memory_costs.size());
+  Node node;
+  node.compute_costs = std::move(compute_costs);
+  node.memory_costs = std::move(memory_costs);
+  nodes_.emplace_back(std::move(node));
+  return nodes_.size() - 1;
+}
+
+void SbpSearchGraph::AddEdgeCost(int64_t src, int64_t dst, const std::vector<double>& cost_matrix) {
+  CHECK_LT(src, dst);
+  CHECK_EQ(cost_matrix.size(), candidate_num(src) * candidate_num(dst));
+  const auto it = src_dst2edge_.find(std::make_pair(src, dst));
+  if (it != src_dst2edge_.end()) {
+    std::vector<double>* edge_cost_matrix = &edges_.at(it->second).cost_matrix;
+    FOR_RANGE(size_t, i, 0, cost_matrix.size()) { edge_cost_matrix->at(i) += cost_matrix.at(i); }
+    return;
+  }
+  const int64_t edge_id = edges_.size();
+  edges_.emplace_back(EdgeCost{src, dst, cost_matrix});
+  nodes_.at(src).out_edges.push_back(edge_id);
+  nodes_.at(dst).in_edges.push_back(edge_id);
+  src_dst2edge_.emplace(std::make_pair(src, dst), edge_id);
+}
+
+double SbpSearchGraph::EdgeCostAt(const EdgeCost& edge, int64_t src_choice,
+                                  int64_t dst_choice) const {
+  return edge.cost_matrix.at(src_choice * candidate_num(edge.dst) + dst_choice);
+}
+
+double SbpSearchGraph::Cost(const std::vector<int64_t>& choices) const {
+  CHECK_EQ(choices.size(), nodes_.size());
+  double cost = 0;
+  FOR_RANGE(int64_t, i, 0, node_num()) { cost += nodes_.at(i).compute_costs.at(choices.at(i)); }
+  for (const EdgeCost& edge : edges_) {
+    cost += EdgeCostAt(edge, choices.at(edge.src), choices.at(edge.dst));
+  }
+  return cost;
+}
+
+double SbpSearchGraph::Memory(const std::vector<int64_t>& choices) const {
+  CHECK_EQ(choices.size(), nodes_.size());
+  double memory = 0;
+  FOR_RANGE(int64_t, i, 0, node_num()) { memory += nodes_.at(i).memory_costs.at(choices.at(i)); }
+  return memory;
+}
+
+std::vector<std::vector<int64_t>> SbpSearchGraph::LinearChains() const {
+  const auto IsChainLink = [&](int64_t edge_id) {
+    const EdgeCost& edge = edges_.at(edge_id);
+    return nodes_.at(edge.src).out_edges.size() == 1 && nodes_.at(edge.dst).in_edges.size() == 1;
+  };
+  std::vector<std::vector<int64_t>> chains;
+  FOR_RANGE(int64_t, i, 0, node_num()) {
+    const Node& node = nodes_.at(i);
+    if (node.in_edges.size() == 1 && IsChainLink(node.in_edges.front())) { continue; }
+    std::vector<int64_t> chain{i};
+    while (nodes_.at(chain.back()).out_edges.size() == 1
+           && IsChainLink(nodes_.at(chain.back()).out_edges.front())) {
+      chain.push_back(edges_.at(nodes_.at(chain.back()).out_edges.front()).dst);
+    }
+    chains.emplace_back(std::move(chain));
+  }
+  return chains;
+}
+
+std::vector<double> SbpSearchGraph::UnaryCosts(int64_t node_id, const std::vector<int64_t>& choices,
+                                               double memory_weight, int64_t prev,
+                                               int64_t next) const {
+  const Node& node = nodes_.at(node_id);
+  std::vector<double> costs(candidate_num(node_id));
+  FOR_RANGE(int64_t, c, 0, costs.size()) {
+    double cost = node.compute_costs.at(c) + memory_weight * node.memory_costs.at(c);
+    for (int64_t edge_id : node.in_edges) {
+      const EdgeCost& edge = edges_.at(edge_id);
+      if (edge.src == prev) { continue; }
+      cost += EdgeCostAt(edge, choices.at(edge.src), c);
+    }
+    for (int64_t edge_id : node.out_edges) {
+      const EdgeCost& edge = edges_.at(edge_id);
+      if (edge.dst == next) { continue; }
+      cost += EdgeCostAt(edge, c, choices.at(edge.dst));
+    }
+    costs.at(c) = cost;
+  }
+  return costs;
+}
+
+void SbpSearchGraph::RefineChains(const std::vector<std::vector<int64_t>>& chains,
+                                  double memory_weight, std::vector<int64_t>* choices) const {
+  for (const std::vector<int64_t>& chain : chains) {
+    // dp.at(i).at(c): least cost of chain[0..i] with chain[i] choosing candidate c.
+    std::vector<std::vector<double>> dp(chain.size());
+    std::vector<std::vector<int64_t>> from(chain.size());
+    FOR_RANGE(size_t, i, 0, chain.size()) {
+      const int64_t prev = i > 0 ? chain.at(i - 1) : -1;
+      const int64_t next = i + 1 < chain.size() ? chain.at(i + 1) : -1;
+      const std::vector<double> unary =
+          UnaryCosts(chain.at(i), *choices, memory_weight, prev, next);
+      if (i == 0) {
+        dp.at(i) = unary;
+        continue;
+      }
+      const EdgeCost& edge = edges_.at(src_dst2edge_.at(std::make_pair(prev, chain.at(i))));
+      dp.at(i).assign(unary.size(), 0);
+      from.at(i).assign(unary.size(), 0);
+      FOR_RANGE(int64_t, c, 0, unary.size()) {
+        double best = std::numeric_limits<double>::max();
+        FOR_RANGE(int64_t, p, 0, dp.at(i - 1).size()) {
+          const double cost = dp.at(i - 1).at(p) + EdgeCostAt(edge, p, c);
+          if (cost < best) {
+            best = cost;
+            from.at(i).at(c) = p;
+          }
+        }
+        dp.at(i).at(c) = best + unary.at(c);
+      }
+    }
+    const std::vector<double>& last = dp.back();
+    int64_t choice = std::min_element(last.begin(), last.end()) - last.begin();
+    for (int64_t i = chain.size() - 1; i >= 0; --i) {
+      choices->at(chain.at(i)) = choice;
+      if (i > 0) { choice = from.at(i).at(choice); }
+    }
+  }
+}
+
+SbpSearchGraph::Plan SbpSearchGraph::Search(const std::vector<int64_t>& init_choices,
+                                            double memory_limit) const {
+  CHECK_EQ(init_choices.size(), nodes_.size());
+  const std::vector<std::vector<int64_t>> chains = LinearChains();
+  const auto MakePlan = [&](const std::vector<int64_t>& choices) {
+    return Plan{choices, Cost(choices), Memory(choices)};
+  };
+  const auto Solve = [&](double memory_weight) {
+    Plan plan = MakePlan(init_choices);
+    FOR_RANGE(int64_t, round, 0, kMaxRefineRounds) {
+      std::vector<int64_t> choices = plan.choices;
+      RefineChains(chains, memory_weight, &choices);
+      Plan refined = MakePlan(choices);
+      if (!(Objective(refined, memory_weight) < Objective(plan, memory_weight))) { break; }
+      plan = std::move(refined);
+    }
+    return plan;
+  };
+  Plan plan = Solve(0);
+  if (memory_limit <= 0 || plan.memory <= memory_limit) { return plan; }
+  Plan least_memory_plan = plan;
+  double infeasible_weight = 0;
+  double memory_weight = std::max(plan.cost, 1.0) / std::max(plan.memory, 1.0) * 1e-3;
+  bool found = false;
+  FOR_RANGE(int64_t, i, 0, kMaxMemoryWeightDoublings) {
+    Plan candidate = Solve(memory_weight);
+    if (candidate.memory < least_memory_plan.memory) { least_memory_plan = candidate; }
+    if (candidate.memory <= memory_limit) {
+      plan = std::move(candidate);
+      found = true;
+      break;
+    }
+    infeasible_weight = memory_weight;
+    memory_weight *= 2;
+  }
+  if (!found) { return least_memory_plan; }
+  // Shrink the penalty towards the largest infeasible weight to give back cost where memory
+  // allows.
+  double feasible_weight = memory_weight;
+  FOR_RANGE(int64_t, i, 0, kMemoryWeightBisections) {
+    const double weight = (infeasible_weight + feasible_weight) / 2;
+    Plan candidate = Solve(weight);
+    if (candidate.memory <= memory_limit) {
+      if (candidate.cost < plan.cost) { plan = std::move(candidate); }
+      feasible_weight = weight;
+    } else {
+      infeasible_weight = weight;
+    }
+  }
+  return plan;
+}
+
+}  // namespace auto_parallel
+
+}  // namespace oneflow
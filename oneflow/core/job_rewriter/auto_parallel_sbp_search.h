@@ -0,0 +1,93 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_JOB_REWRITER_AUTO_PARALLEL_SBP_SEARCH_H_
+#define ONEFLOW_CORE_JOB_REWRITER_AUTO_PARALLEL_SBP_SEARCH_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+namespace auto_parallel {
+
+// Cost of a choice that can not be realized, e.g. a partial-sum consumer fed by a non partial-sum
+// producer.
+constexpr double kInfeasibleCost = 1e20;
+
+// A graph whose nodes are ops with a list of candidate sbp signatures and whose edges carry the
+// boxing cost between every pair of candidates of the producer and the consumer. The search picks
+// one candidate per node minimizing the total of unary and edge costs while keeping the summed
+// per-device memory under a limit.
+class SbpSearchGraph final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SbpSearchGraph);
+  SbpSearchGraph() = default;
+  ~SbpSearchGraph() = default;
+
+  struct Plan {
+    std::vector<int64_t> choices;
+    double cost;
+    double memory;
+  };
+
+  // Nodes must be added in topological order, which is the order chains are discovered in.
+  int64_t AddNode(std::vector<double> compute_costs, std::vector<double> memory_costs);
+  // cost_matrix is row major with one row per src candidate. Repeated edges accumulate.
+  void AddEdgeCost(int64_t src, int64_t dst, const std::vector<double>& cost_matrix);
+
+  int64_t node_num() const { return nodes_.size(); }
+  int64_t candidate_num(int64_t node) const { return nodes_.at(node).compute_costs.size(); }
+
+  double Cost(const std::vector<int64_t>& choices) const;
+  double Memory(const std::vector<int64_t>& choices) const;
+
+  // Improves init_choices by dynamic programming over linear chains, each solved exactly with its
+  // neighbours fixed, until no chain improves. A positive memory_limit is enforced with a
+  // Lagrangian penalty on memory; if no feasible plan is found the plan with the least memory is
+  // returned.
+  Plan Search(const std::vector<int64_t>& init_choices, double memory_limit) const;
+
+ private:
+  struct Node {
+    std::vector<double> compute_costs;
+    std::vector<double> memory_costs;
+    std::vector<int64_t> in_edges;
+    std::vector<int64_t> out_edges;
+  };
+  struct EdgeCost {
+    int64_t src;
+    int64_t dst;
+    std::vector<double> cost_matrix;
+  };
+
+  double EdgeCostAt(const EdgeCost& edge, int64_t src_choice, int64_t dst_choice) const;
+  std::vector<std::vector<int64_t>> LinearChains() const;
+  // Cost of choosing each candidate of node with all nodes outside the chain fixed. prev and next
+  // are the neighbours inside the chain whose edge costs are accounted for by the chain itself.
+  std::vector<double> UnaryCosts(int64_t node, const std::vector<int64_t>& choices,
+                                 double memory_weight, int64_t prev, int64_t next) const;
+  void RefineChains(const std::vector<std::vector<int64_t>>& chains, double memory_weight,
+                    std::vector<int64_t>* choices) const;
+
+  std::vector<Node> nodes_;
+  std::vector<EdgeCost> edges_;
+  HashMap<std::pair<int64_t, int64_t>, int64_t> src_dst2edge_;
+};
+
+}  // namespace auto_parallel
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_JOB_REWRITER_AUTO_PARALLEL_SBP_SEARCH_H_
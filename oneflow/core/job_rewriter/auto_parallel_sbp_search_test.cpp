@@ -0,0 +1,115 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job_rewriter/auto_parallel_sbp_search.h"
+
+namespace oneflow {
+
+namespace auto_parallel {
+
+namespace test {
+
+namespace {
+
+double BruteForceCost(const SbpSearchGraph& graph, double memory_limit) {
+  std::vector<int64_t> choices(graph.node_num(), 0);
+  double best = std::numeric_limits<double>::max();
+  while (true) {
+    if (memory_limit <= 0 || graph.Memory(choices) <= memory_limit) {
+      best = std::min(best, graph.Cost(choices));
+    }
+    int64_t i = 0;
+    for (; i < graph.node_num(); ++i) {
+      if (++choices.at(i) < graph.candidate_num(i)) { break; }
+      choices.at(i) = 0;
+    }
+    if (i == graph.node_num()) { break; }
+  }
+  return best;
+}
+
+// Two candidates per node: 0 is "broadcast" (no boxing when neighbours agree, full memory) and 1
+// is "split" (cheap compute, boxing to a broadcast neighbour).
+std::vector<double> SwitchCost(double cost) { return {0, cost, cost, 0}; }
+
+}  // namespace
+
+TEST(SbpSearchGraph, chain_escapes_greedy_local_optimum) {
+  SbpSearchGraph graph;
+  // Switching any single node to split costs more boxing than it saves, switching the whole
+  // chain saves compute on every node.
+  const int64_t n = 6;
+  FOR_RANGE(int64_t, i, 0, n) { graph.AddNode({10, 4}, {0, 0}); }
+  FOR_RANGE(int64_t, i, 1, n) { graph.AddEdgeCost(i - 1, i, SwitchCost(8)); }
+  const std::vector<int64_t> greedy(n, 0);
+  const SbpSearchGraph::Plan plan = graph.Search(greedy, 0);
+  ASSERT_DOUBLE_EQ(graph.Cost(greedy), 60);
+  ASSERT_DOUBLE_EQ(plan.cost, 24);
+  for (int64_t choice : plan.choices) { ASSERT_EQ(choice, 1); }
+}
+
+TEST(SbpSearchGraph, matches_brute_force_on_small_dags) {
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<double> dis(0, 10);
+  FOR_RANGE(int64_t, trial, 0, 20) {
+    SbpSearchGraph graph;
+    const int64_t n = 6;
+    FOR_RANGE(int64_t, i, 0, n) {
+      const int64_t candidate_num = 2 + (i + trial) % 2;
+      std::vector<double> compute(candidate_num);
+      std::vector<double> memory(candidate_num);
+      FOR_RANGE(int64_t, c, 0, candidate_num) {
+        compute.at(c) = dis(gen);
+        memory.at(c) = dis(gen);
+      }
+      graph.AddNode(compute, memory);
+    }
+    FOR_RANGE(int64_t, i, 1, n) {
+      std::vector<double> cost(graph.candidate_num(i - 1) * graph.candidate_num(i));
+      for (double& c : cost) { c = dis(gen); }
+      graph.AddEdgeCost(i - 1, i, cost);
+    }
+    const std::vector<int64_t> init(n, 0);
+    // A pure chain is solved exactly.
+    ASSERT_NEAR(graph.Search(init, 0).cost, BruteForceCost(graph, 0), 1e-9);
+    // Extra edges make the search a local refinement that never gets worse than its start.
+    std::vector<double> cost(graph.candidate_num(0) * graph.candidate_num(n - 1));
+    for (double& c : cost) { c = dis(gen); }
+    graph.AddEdgeCost(0, n - 1, cost);
+    const SbpSearchGraph::Plan plan = graph.Search(init, 0);
+    ASSERT_LE(plan.cost, graph.Cost(init));
+    ASSERT_GE(plan.cost, BruteForceCost(graph, 0) - 1e-9);
+  }
+}
+
+TEST(SbpSearchGraph, memory_limit) {
+  SbpSearchGraph graph;
+  // Broadcast is cheaper but holds the whole tensor on every device.
+  FOR_RANGE(int64_t, i, 0, 4) { graph.AddNode({1, 3}, {8, 2}); }
+  FOR_RANGE(int64_t, i, 1, 4) { graph.AddEdgeCost(i - 1, i, SwitchCost(5)); }
+  const std::vector<int64_t> init(4, 0);
+  const SbpSearchGraph::Plan unlimited = graph.Search(init, 0);
+  ASSERT_DOUBLE_EQ(unlimited.cost, 4);
+  ASSERT_DOUBLE_EQ(unlimited.memory, 32);
+  const SbpSearchGraph::Plan limited = graph.Search(init, 10);
+  ASSERT_LE(limited.memory, 10);
+  ASSERT_DOUBLE_EQ(limited.cost, BruteForceCost(graph, 10));
+}
+
+}  // namespace test
+
+}  // namespace auto_parallel
+
+}  // namespace oneflow
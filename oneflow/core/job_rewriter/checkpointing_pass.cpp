@@ -58,32 +58,250 @@ bool IsForwardPassScope(const Scope& scope) {
   return scope.scope_proto().calculation_pass_name() == kForwardPass;
 }
 
+// System ops added by earlier passes may have no scope.
+bool HasScope(const OpNode* op_node) {
+  const OperatorConf& op_conf = op_node->op().op_conf();
+  return op_conf.has_scope_symbol_id()
+         && Global<symbol::Storage<Scope>>::Get()->Has(op_conf.scope_symbol_id());
+}
+
 bool IsForwardPass7CheckpointingScope(const Scope& scope) {
   return IsForwardPassScope(scope) && scope.Bool("checkpointing");
 }
 
-void CollectAllCheckpointingOpsInForwardPass(
-    const OpGraph& op_graph, HashMap<std::string, const OpNode*>* checkpointing_op_name2op_node) {
+bool IsOpTypeRecomputable(const OperatorConf& op_conf) {
+  if (!op_conf.has_user_conf()) { return false; }
   // NOTE(chengcheng):
   //   ignore batch_norm ops because of recompute bn will repeat the calculation of 'm' and 'v'.
   //   in the future, we need to support the recomputation version of batch_norm which do NOT
   //   update forward variables.
-  HashSet<std::string> ignore_op_type_names = {"normalization", "normalization_add_relu",
-                                               "cudnn_fused_normalization_add_relu", "repeat",
-                                               "unpack"};
+  static const HashSet<std::string> ignore_op_type_names = {
+      "normalization", "normalization_add_relu", "cudnn_fused_normalization_add_relu", "repeat",
+      "unpack"};
+  return ignore_op_type_names.find(op_conf.user_conf().op_type_name())
+         == ignore_op_type_names.end();
+}
+
+void CollectAllCheckpointingOpsInForwardPass(
+    const OpGraph& op_graph, HashMap<std::string, const OpNode*>* checkpointing_op_name2op_node) {
   op_graph.ForEachNode([&](const OpNode* op_node) {
     const OperatorConf& op_conf = op_node->op().op_conf();
-    if (!op_conf.has_user_conf()) { return; }
-    if (ignore_op_type_names.find(op_conf.user_conf().op_type_name())
-        != ignore_op_type_names.end()) {
-      return;
-    }
+    if (!IsOpTypeRecomputable(op_conf)) { return; }
     if (IsForwardPass7CheckpointingScope(Scope4OpNode(op_node))) {
       CHECK(checkpointing_op_name2op_node->emplace(op_conf.name(), op_node).second);
     }
   });
 }
 
+// Ops the automatic mode may pick on its own. Besides the ops that can never be recomputed, random
+// ops are left out since recomputing them would not reproduce the forward result, and source ops
+// (e.g. data readers) since they advance their state when run.
+bool IsAutoCheckpointingCandidate(const OpNode* op_node) {
+  const OperatorConf& op_conf = op_node->op().op_conf();
+  if (!IsOpTypeRecomputable(op_conf)) { return false; }
+  if (!HasScope(op_node) || !IsForwardPassScope(Scope4OpNode(op_node))) { return false; }
+  if (op_node->in_edges().empty()) { return false; }
+  const std::string& op_type_name = op_conf.user_conf().op_type_name();
+  static const HashSet<std::string> random_op_type_names = {
+      "dropout", "random_mask_like", "uniform", "uniform_int", "normal", "randperm", "bernoulli",
+      "generate_random_batch_permutation_indices"};
+  if (random_op_type_names.find(op_type_name) != random_op_type_names.end()) { return false; }
+  return op_type_name.find("random") == std::string::npos;
+}
+
+double PerDeviceBytes4Lbi(const OpNode* producer, const LogicalBlobId& lbi) {
+  const BlobDesc& blob_desc = producer->LogicalBlobDesc4Lbi(lbi);
+  double bytes =
+      static_cast<double>(blob_desc.shape().elem_cnt()) * GetSizeOfDataType(blob_desc.data_type());
+  const cfg::NdSbp& nd_sbp = producer->NdSbp4Lbi(lbi);
+  const Shape& hierarchy = *producer->parallel_desc().hierarchy();
+  FOR_RANGE(int64_t, i, 0, nd_sbp.sbp_parallel_size()) {
+    if (nd_sbp.sbp_parallel(i).has_split_parallel()) { bytes /= hierarchy.At(i); }
+  }
+  return bytes;
+}
+
+// Rough FLOPs of running the op once more: matmuls and convolutions by their multiply-adds, all
+// other ops by the elements they touch.
+double RecomputeCost4OpNode(const OpNode* op_node) {
+  const Operator& op = op_node->op();
+  const auto ElemCnt4Bn = [&](const std::string& bn) -> double {
+    return op_node->LogicalBlobDesc4Lbi(op.BnInOp2Lbi(bn)).shape().elem_cnt();
+  };
+  const user_op::UserOpConfWrapper conf(op.op_conf());
+  const std::string& op_type_name = conf.op_type_name();
+  double out_elem_cnt = 0;
+  for (const auto& obn : op.output_bns()) { out_elem_cnt += ElemCnt4Bn(obn); }
+  if (op_type_name == "matmul" || op_type_name == "batch_matmul"
+      || op_type_name == "broadcast_matmul") {
+    const Shape& a_shape =
+        op_node->LogicalBlobDesc4Lbi(GenLogicalBlobId(conf.input("a", 0))).shape();
+    const int64_t k_axis = conf.attr<bool>("transpose_a") ? a_shape.NumAxes() - 2
+                                                         : a_shape.NumAxes() - 1;
+    return 2 * out_elem_cnt * a_shape.At(k_axis);
+  }
+  if (op_type_name == "conv1d" || op_type_name == "conv2d" || op_type_name == "conv3d") {
+    const Shape& weight_shape =
+        op_node->LogicalBlobDesc4Lbi(GenLogicalBlobId(conf.input("weight", 0))).shape();
+    return 2 * out_elem_cnt * weight_shape.elem_cnt() / weight_shape.At(0);
+  }
+  double in_elem_cnt = 0;
+  for (const auto& ibn : op.input_bns()) { in_elem_cnt += ElemCnt4Bn(ibn); }
+  return in_elem_cnt + out_elem_cnt;
+}
+
+// Estimates the per-device activation memory kept from the forward pass to the backward pass when
+// a set of forward ops is recomputed, and picks that set under a budget.
+class ActivationMemoryModel final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ActivationMemoryModel);
+  explicit ActivationMemoryModel(const OpGraph& op_graph);
+  ~ActivationMemoryModel() = default;
+
+  // Adds ops to checkpointing_op_name2op_node, cheapest recompute per freed byte first, while that
+  // lowers the estimated peak, until it fits memory_budget.
+  void SelectCheckpointingOps(
+      double memory_budget, HashMap<std::string, const OpNode*>* checkpointing_op_name2op_node);
+
+ private:
+  struct OutBlob {
+    double bytes;
+    bool consumed_by_backward;
+    std::vector<int64_t> forward_consumers;
+  };
+  struct ForwardOp {
+    const OpNode* op_node;
+    std::vector<OutBlob> out_blobs;
+    double out_bytes;
+  };
+
+  // Activations kept for the backward pass plus the largest recompute segment, which is
+  // materialized again during the backward pass.
+  double EstimatePeak(const std::vector<bool>& is_recomputed) const;
+
+  std::vector<ForwardOp> forward_ops_;
+  HashMap<const OpNode*, int64_t> op_node2index_;
+};
+
+ActivationMemoryModel::ActivationMemoryModel(const OpGraph& op_graph) {
+  op_graph.TopoForEachNode([&](const OpNode* op_node) {
+    if (op_node->op().op_conf().has_variable_conf()) { return; }
+    if (!HasScope(op_node) || !IsForwardPassScope(Scope4OpNode(op_node))) { return; }
+    op_node2index_.emplace(op_node, forward_ops_.size());
+    forward_ops_.push_back(ForwardOp{op_node, {}, 0});
+  });
+  for (ForwardOp& forward_op : forward_ops_) {
+    HashMap<LogicalBlobId, OutBlob> lbi2out_blob;
+    for (const OpEdge* edge : forward_op.op_node->out_edges()) {
+      const auto consumer_it = op_node2index_.find(edge->dst_node());
+      for (const LogicalBlobId& lbi : edge->lbis()) {
+        auto it = lbi2out_blob.find(lbi);
+        if (it == lbi2out_blob.end()) {
+          it = lbi2out_blob
+                   .emplace(lbi, OutBlob{PerDeviceBytes4Lbi(forward_op.op_node, lbi), false, {}})
+                   .first;
+        }
+        if (consumer_it == op_node2index_.end()) {
+          const OpNode* consumer = edge->dst_node();
+          it->second.consumed_by_backward |=
+              HasScope(consumer) && !IsForwardPassScope(Scope4OpNode(consumer));
+        } else {
+          it->second.forward_consumers.push_back(consumer_it->second);
+        }
+      }
+    }
+    for (auto& pair : lbi2out_blob) {
+      forward_op.out_bytes += pair.second.bytes;
+      forward_op.out_blobs.emplace_back(std::move(pair.second));
+    }
+  }
+}
+
+double ActivationMemoryModel::EstimatePeak(const std::vector<bool>& is_recomputed) const {
+  const int64_t op_num = forward_ops_.size();
+  std::vector<int64_t> parent(op_num);
+  FOR_RANGE(int64_t, i, 0, op_num) { parent.at(i) = i; }
+  const std::function<int64_t(int64_t)> Find = [&](int64_t i) {
+    while (parent.at(i) != i) { i = parent.at(i) = parent.at(parent.at(i)); }
+    return i;
+  };
+  double kept_bytes = 0;
+  FOR_RANGE(int64_t, i, 0, op_num) {
+    const ForwardOp& forward_op = forward_ops_.at(i);
+    for (const OutBlob& out_blob : forward_op.out_blobs) {
+      bool is_kept = !is_recomputed.at(i) && out_blob.consumed_by_backward;
+      for (int64_t consumer : out_blob.forward_consumers) {
+        if (!is_recomputed.at(consumer)) { continue; }
+        if (!is_recomputed.at(i)) {
+          // needed as the input of the recomputation
+          is_kept = true;
+        } else if (forward_op.op_node->parallel_desc()
+                   == forward_ops_.at(consumer).op_node->parallel_desc()) {
+          parent.at(Find(consumer)) = Find(i);
+        }
+      }
+      if (is_kept) { kept_bytes += out_blob.bytes; }
+    }
+  }
+  HashMap<int64_t, double> segment2bytes;
+  double max_segment_bytes = 0;
+  FOR_RANGE(int64_t, i, 0, op_num) {
+    if (!is_recomputed.at(i)) { continue; }
+    double* segment_bytes = &segment2bytes[Find(i)];
+    *segment_bytes += forward_ops_.at(i).out_bytes;
+    max_segment_bytes = std::max(max_segment_bytes, *segment_bytes);
+  }
+  return kept_bytes + max_segment_bytes;
+}
+
+void ActivationMemoryModel::SelectCheckpointingOps(
+    double memory_budget, HashMap<std::string, const OpNode*>* checkpointing_op_name2op_node) {
+  const int64_t op_num = forward_ops_.size();
+  std::vector<bool> is_recomputed(op_num, false);
+  std::vector<std::pair<double, int64_t>> cost_per_byte7index;
+  FOR_RANGE(int64_t, i, 0, op_num) {
+    const OpNode* op_node = forward_ops_.at(i).op_node;
+    if (checkpointing_op_name2op_node->count(op_node->op().op_name()) > 0) {
+      is_recomputed.at(i) = true;
+    } else if (IsAutoCheckpointingCandidate(op_node) && forward_ops_.at(i).out_bytes > 0) {
+      cost_per_byte7index.emplace_back(
+          RecomputeCost4OpNode(op_node) / forward_ops_.at(i).out_bytes, i);
+    }
+  }
+  std::sort(cost_per_byte7index.begin(), cost_per_byte7index.end());
+  const double origin_peak = EstimatePeak(is_recomputed);
+  double peak = origin_peak;
+  double recompute_cost = 0;
+  int64_t selected_op_cnt = 0;
+  // A rejected op may pay off once its neighbours are recomputed, so give it a second chance.
+  for (int64_t round = 0; round < 2 && peak > memory_budget; ++round) {
+    for (const auto& pair : cost_per_byte7index) {
+      if (peak <= memory_budget) { break; }
+      const int64_t i = pair.second;
+      if (is_recomputed.at(i)) { continue; }
+      is_recomputed.at(i) = true;
+      const double new_peak = EstimatePeak(is_recomputed);
+      if (new_peak < peak) {
+        peak = new_peak;
+        const OpNode* op_node = forward_ops_.at(i).op_node;
+        CHECK(checkpointing_op_name2op_node->emplace(op_node->op().op_name(), op_node).second);
+        recompute_cost += RecomputeCost4OpNode(op_node);
+        selected_op_cnt += 1;
+      } else {
+        is_recomputed.at(i) = false;
+      }
+    }
+  }
+  const double kMByte = 1024.0 * 1024.0;
+  LOG(INFO) << "CheckpointingPass: estimated activation peak " << origin_peak / kMByte << "MB -> "
+            << peak / kMByte << "MB with budget " << memory_budget / kMByte << "MB, "
+            << selected_op_cnt << " ops recomputed automatically, extra cost about "
+            << recompute_cost << " flops";
+  if (peak > memory_budget) {
+    LOG(WARNING) << "CheckpointingPass: activation memory budget can not be met by recomputation";
+  }
+}
+
 void GenConnectedCheckpointingSubgraphs(
     const HashMap<std::string, const OpNode*>& checkpointing_op_name2op_node,
     std::vector<HashSet<const OpNode*>>* checkpointing_subgraphs) {
@@ -125,6 +343,12 @@ Maybe<void> CheckpointingPass::Apply(const OpGraph& op_graph, JobBuilder* job_bu
   // step 1. collect all checkpointing ops in forwardpass.
   HashMap<std::string, const OpNode*> checkpointing_op_name2op_node;
   CollectAllCheckpointingOpsInForwardPass(op_graph, &checkpointing_op_name2op_node);
+  // step 1.1 in automatic mode, recompute more ops until the activations fit the budget.
+  const int64_t budget_mbyte = GlobalJobDesc().job_conf().auto_checkpointing_memory_budget_mbyte();
+  if (budget_mbyte > 0) {
+    ActivationMemoryModel(op_graph).SelectCheckpointingOps(budget_mbyte * 1024.0 * 1024.0,
+                                                           &checkpointing_op_name2op_node);
+  }
   if (checkpointing_op_name2op_node.empty()) { return Maybe<void>::Ok(); }
 
   // step 2. get all connected subgraphs in checkpointing ops.
@@ -23,6 +23,7 @@ limitations under the License.
 #include "oneflow/core/job_rewriter/group_boxing_by_dst_parallel.h"
 #include "oneflow/core/framework/config_def.h"
 #include "oneflow/core/job_rewriter/xrt_compilation.h"
+#include "oneflow/core/profiler/compile_profiler.h"
 
 namespace oneflow {
 
@@ -123,7 +124,11 @@ Maybe<void> SetCtrlInOpName4VariableOp(const OpGraph& op_graph, JobBuilder* job_
 
 Maybe<void> JobCompleter::Complete(Job* job) const {
   JobPassCtx job_pass_ctx(GlobalJobDesc());
-  JUST(JobPass4Name("DumpBlobParallelConfPass")(job, &job_pass_ctx));
+  auto DoPass = [&](const std::string& pass_name) -> Maybe<void> {
+    profiler::CompileProfileGuard profile_guard(GlobalJobDesc().job_id(), "pass", pass_name, job);
+    return JobPass4Name(pass_name)(job, &job_pass_ctx);
+  };
+  JUST(DoPass("DumpBlobParallelConfPass"));
   // NOTE(chengcheng): disable this pass for reduce boxing memory life cycle to memory cost.
   if (!Global<ResourceDesc, ForSession>::Get()->resource().disable_group_boxing_by_dst_parallel()) {
     JUST(WithOpGraphAndMutJobBuilder(job, &GroupBoxingByDstParallel));
@@ -136,8 +141,8 @@ Maybe<void> JobCompleter::Complete(Job* job) const {
   JUST(WithOpGraphAndMutJobBuilder(job, &SingleClientAddGlobalInputCriticalSections));
   JUST(WithOpGraphAndMutJobBuilder(job, &SingleClientAddGlobalOutputCriticalSections));
   JUST(WithOpGraphAndMutJob(job, &MultiClientAutoSourceAndSinkTick));
-  JUST(JobPass4Name("SystemOpFillJobNamePass")(job, &job_pass_ctx));
-  JUST(JobPass4Name("DumpBlobParallelConfPass")(job, &job_pass_ctx));
+  JUST(DoPass("SystemOpFillJobNamePass"));
+  JUST(DoPass("DumpBlobParallelConfPass"));
   if (XrtCompilationEnabled(GlobalJobDesc())) {
 #ifdef OF_WITH_XRT
     JUST(WithOpGraphAndMutJob(job, &RebuildXrtCompiledJob));
@@ -149,9 +154,9 @@ Maybe<void> JobCompleter::Complete(Job* job) const {
 #ifdef WITH_CUDA
   if (Global<ResourceDesc, ForSession>::Get()->nccl_use_compute_stream()) {
     // NOTE(chengcheng): this pass need as last pass for insert correct op with nccl boxing.
-    JUST(JobPass4Name("InsertNcclLogicalOpPass")(job, &job_pass_ctx));
+    JUST(DoPass("InsertNcclLogicalOpPass"));
     // NOTE(chengcheng): Becasue insert new logical nccl op, MUST dump time shape, sbp again.
-    JUST(JobPass4Name("DumpBlobParallelConfPass")(job, &job_pass_ctx));
+    JUST(DoPass("DumpBlobParallelConfPass"));
   }
 #endif  // WITH_CUDA
   JUST(CheckOpGraph(OpGraph(*job)));
@@ -0,0 +1,161 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job_rewriter/job_pass.h"
+#include "oneflow/core/framework/framework.h"
+
+namespace oneflow {
+
+namespace {
+
+// Per-model inputs of each update op that has a multi-tensor counterpart. All other inputs are
+// scalars shared by the whole group.
+const HashMap<std::string, std::vector<std::string>>& MultiTensorUpdateArgs() {
+  static const HashMap<std::string, std::vector<std::string>> op_type2args = {
+      {"sgd_update", {"model", "model_diff"}},
+      {"momentum_update", {"model", "model_diff", "momentum"}},
+      {"adam_update", {"model", "model_diff", "m", "v"}},
+  };
+  return op_type2args;
+}
+
+const std::vector<std::string>& SharedScalarArgs() {
+  static const std::vector<std::string> args = {"learning_rate", "scale_by_tensor", "skip_if",
+                                                "bias_correction1", "bias_correction2"};
+  return args;
+}
+
+bool IsBroadcastNdSbp(const cfg::NdSbp& nd_sbp) {
+  for (const auto& sbp_parallel : nd_sbp.sbp_parallel()) {
+    if (!sbp_parallel.has_broadcast_parallel()) { return false; }
+  }
+  return true;
+}
+
+// Update ops sharing every attr, every scalar input, the placement and the data types can be
+// applied by a single multi-tensor op without changing the result.
+std::string GroupKey(const OpNode* op_node, const user_op::UserOpConfWrapper& conf) {
+  std::string key = conf.op_type_name();
+  key += "\n" + op_node->parallel_desc().parallel_conf().DebugString();
+  key += "\n" + std::to_string(conf.op_conf().scope_symbol_id());
+  for (const std::string& arg_name : {"model", "model_diff"}) {
+    const LogicalBlobId lbi = GenLogicalBlobId(conf.input(arg_name, 0));
+    key += "\n" + DataType_Name(op_node->LogicalBlobDesc4Lbi(lbi).data_type());
+  }
+  for (const auto& arg_name : SharedScalarArgs()) {
+    key += "\n" + arg_name + ":";
+    if (conf.has_input(arg_name, 0)) { key += conf.input(arg_name, 0); }
+  }
+  std::map<std::string, std::string> sorted_attrs;
+  for (const auto& pair : conf.op_conf().user_conf().attr()) {
+    sorted_attrs.emplace(pair.first, pair.second.SerializeAsString());
+  }
+  for (const auto& pair : sorted_attrs) { key += "\n" + pair.first + "=" + pair.second; }
+  return key;
+}
+
+class MultiTensorModelUpdatePass final : public JobPass {
+ public:
+  MultiTensorModelUpdatePass() = default;
+  ~MultiTensorModelUpdatePass() override = default;
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    return ctx.job_desc().job_conf().enable_multi_tensor_model_update();
+  }
+  Maybe<void> Apply(const OpGraph& op_graph, JobBuilder* job_builder) const;
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
+    if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+    const OpGraph op_graph(*job);
+    JobBuilder job_builder(job);
+    return Apply(op_graph, &job_builder);
+  }
+};
+
+Maybe<void> MultiTensorModelUpdatePass::Apply(const OpGraph& op_graph,
+                                              JobBuilder* job_builder) const {
+  HashSet<std::string> ctrl_in_op_names;
+  op_graph.ForEachNode([&](const OpNode* op_node) {
+    for (const std::string& ctrl_in_op_name : op_node->op().op_conf().ctrl_in_op_name()) {
+      ctrl_in_op_names.insert(ctrl_in_op_name);
+    }
+  });
+  std::vector<std::string> group_keys;
+  HashMap<std::string, std::vector<const OpNode*>> key2op_nodes;
+  op_graph.ForEachNode([&](const OpNode* op_node) {
+    const OperatorConf& op_conf = op_node->op().op_conf();
+    if (!op_conf.has_user_conf()) { return; }
+    if (MultiTensorUpdateArgs().count(op_conf.user_conf().op_type_name()) == 0) { return; }
+    if (op_node->parallel_desc().device_type() != DeviceType::kCPU) { return; }
+    if (ctrl_in_op_names.count(op_conf.name()) > 0) { return; }
+    const user_op::UserOpConfWrapper conf(op_conf);
+    if (conf.op_type_name() == "adam_update" && conf.attr<bool>("amsgrad")) { return; }
+    if (op_node->parallel_desc().parallel_num() > 1
+        && !IsBroadcastNdSbp(op_node->NdSbp4BnInOp(GenRepeatedBn("model", 0)))) {
+      return;
+    }
+    const std::string key = GroupKey(op_node, conf);
+    auto it = key2op_nodes.find(key);
+    if (it == key2op_nodes.end()) {
+      group_keys.push_back(key);
+      it = key2op_nodes.emplace(key, std::vector<const OpNode*>()).first;
+    }
+    it->second.push_back(op_node);
+  });
+  std::vector<std::string> del_op_names;
+  for (const auto& key : group_keys) {
+    const std::vector<const OpNode*>& op_nodes = key2op_nodes.at(key);
+    if (op_nodes.size() < 2) { continue; }
+    const user_op::UserOpConfWrapper first_conf(op_nodes.front()->op().op_conf());
+    const std::string& op_type_name = first_conf.op_type_name();
+    user_op::UserOpConfWrapperBuilder builder("System-MultiTensorModelUpdate-" + op_type_name + "_"
+                                              + NewUniqueId());
+    builder.OpTypeName("multi_tensor_" + op_type_name);
+    HashSet<std::string> ctrl_in_op_name_set;
+    for (const OpNode* op_node : op_nodes) {
+      const user_op::UserOpConfWrapper conf(op_node->op().op_conf());
+      for (const auto& arg_name : MultiTensorUpdateArgs().at(op_type_name)) {
+        builder.Input(arg_name, conf.input(arg_name, 0));
+      }
+      for (const auto& ctrl_in_op_name : conf.op_conf().ctrl_in_op_name()) {
+        ctrl_in_op_name_set.insert(ctrl_in_op_name);
+      }
+      del_op_names.push_back(conf.op_name());
+    }
+    for (const auto& arg_name : SharedScalarArgs()) {
+      if (first_conf.has_input(arg_name, 0)) {
+        builder.Input(arg_name, first_conf.input(arg_name, 0));
+      }
+    }
+    builder.ScopeSymbolId(first_conf.op_conf().scope_symbol_id());
+    OperatorConf multi_tensor_op_conf = builder.Build().op_conf();
+    auto* attrs = multi_tensor_op_conf.mutable_user_conf()->mutable_attr();
+    for (const auto& pair : first_conf.op_conf().user_conf().attr()) {
+      if (attrs->find(pair.first) != attrs->end()) { (*attrs)[pair.first] = pair.second; }
+    }
+    for (const auto& ctrl_in_op_name : ctrl_in_op_name_set) {
+      multi_tensor_op_conf.add_ctrl_in_op_name(ctrl_in_op_name);
+    }
+    job_builder->AddOps(op_nodes.front()->parallel_desc().parallel_conf(), {multi_tensor_op_conf});
+  }
+  job_builder->DelOps(del_op_names);
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_JOB_PASS("MultiTensorModelUpdatePass", MultiTensorModelUpdatePass);
+
+}  // namespace oneflow
@@ -0,0 +1,181 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job_rewriter/job_pass.h"
+#include "oneflow/core/framework/framework.h"
+
+namespace oneflow {
+
+namespace {
+
+const std::string INT8_QUANT_SUFFIX = "-int8-quant";
+const std::string INT8_CAST_SUFFIX = "-int8-cast";
+
+// Lowers conv2d and matmul whose input and weight both come from 8-bit symmetric fake
+// quantization into real int8 ops, e.g.
+//   fake_quantization(x) -> conv2d <- fake_quantization(w)
+// becomes
+//   cast<int8>(quantization(x)) -> quantized_conv2d <- cast<int8>(quantization(w))
+// The int8 op keeps the name and output of the original op, so its consumers are untouched,
+// and reads the scales of the fake quantization ops.
+class QatInt8LoweringPass final : public JobPass {
+ public:
+  QatInt8LoweringPass() = default;
+  ~QatInt8LoweringPass() override = default;
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    const JobConfigProto& job_conf = ctx.job_desc().job_conf();
+    return job_conf.enable_quantization_aware_training()
+           && job_conf.qat_config().lower_to_int8_inference() && !ctx.job_desc().IsTrain();
+  }
+  Maybe<void> Apply(const OpGraph& op_graph, JobBuilder* job_builder) const;
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
+    if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+    const OpGraph op_graph(*job);
+    JobBuilder job_builder(job);
+    return Apply(op_graph, &job_builder);
+  }
+};
+
+// Returns the fake quantization op producing `lbn` if it can be lowered, otherwise nullptr.
+const OpNode* FindLowerableFakeQuantNode(const OpGraph& op_graph, const std::string& lbn) {
+  const OpNode* node = op_graph.OpNode4OpName(GenLogicalBlobId(lbn).op_name());
+  const OperatorConf& op_conf = node->op().op_conf();
+  if (!op_conf.has_user_conf()) { return nullptr; }
+  if (op_conf.user_conf().op_type_name() != "fake_quantization") { return nullptr; }
+  const user_op::UserOpConfWrapper conf(op_conf);
+  if (conf.attr<std::string>("quantization_formula") != "google") { return nullptr; }
+  if (conf.attr<std::string>("quantization_scheme") != "symmetric") { return nullptr; }
+  if (conf.attr<int32_t>("quantization_bit") != 8) { return nullptr; }
+  const BlobDesc& in_desc = node->LogicalBlobDesc4Lbi(GenLogicalBlobId(conf.input("in", 0)));
+  if (in_desc.data_type() != DataType::kFloat) { return nullptr; }
+  return node;
+}
+
+int64_t ScaleSize4FakeQuantNode(const OpNode* node) {
+  const user_op::UserOpConfWrapper conf(node->op().op_conf());
+  return node->LogicalBlobDesc4Lbi(GenLogicalBlobId(conf.input("scale", 0))).shape().elem_cnt();
+}
+
+// Adds quantization and cast ops turning the input of the fake quantization op into int8.
+std::string AddInt8QuantOps(const OpNode* fake_quant_node, const std::string& prefix,
+                            const int64_t scope_symbol_id, JobBuilder* job_builder) {
+  const user_op::UserOpConfWrapper fake_quant_conf(fake_quant_node->op().op_conf());
+  const auto quant_op =
+      user_op::UserOpConfWrapperBuilder(prefix + INT8_QUANT_SUFFIX)
+          .Op("quantization")
+          .Input("in", fake_quant_conf.input("in", 0))
+          .Input("scale", fake_quant_conf.input("scale", 0))
+          .Input("zero_point", fake_quant_conf.input("zero_point", 0))
+          .Output("out")
+          .Attr<std::string>("quantization_formula", "google")
+          .Attr<std::string>("quantization_scheme", "symmetric")
+          .Attr<int32_t>("quantization_bit", 8)
+          .ScopeSymbolId(scope_symbol_id)
+          .Build();
+  const auto cast_op = user_op::UserOpConfWrapperBuilder(prefix + INT8_CAST_SUFFIX)
+                           .Op("cast")
+                           .Input("in", quant_op.output("out", 0))
+                           .Output("out")
+                           .Attr<DataType>("dtype", DataType::kInt8)
+                           .ScopeSymbolId(scope_symbol_id)
+                           .Build();
+  job_builder->AddOps(fake_quant_node->parallel_desc().parallel_conf(),
+                      {quant_op.op_conf(), cast_op.op_conf()});
+  return cast_op.output("out", 0);
+}
+
+std::string ScaleLbn4FakeQuantNode(const OpNode* node) {
+  return user_op::UserOpConfWrapper(node->op().op_conf()).input("scale", 0);
+}
+
+Maybe<void> QatInt8LoweringPass::Apply(const OpGraph& op_graph, JobBuilder* job_builder) const {
+  std::vector<OperatorConf> lowered_op_confs;
+  op_graph.ForEachNode([&](const OpNode* node) {
+    if (node->parallel_desc().device_type() != DeviceType::kCPU) { return; }
+    const OperatorConf& op_conf = node->op().op_conf();
+    if (!op_conf.has_user_conf()) { return; }
+    const std::string& op_type_name = op_conf.user_conf().op_type_name();
+    const user_op::UserOpConfWrapper conf(op_conf);
+    std::string in_arg_name;
+    std::string weight_arg_name;
+    if (op_type_name == "conv2d") {
+      if (conf.attr<std::string>("data_format") != "channels_first") { return; }
+      if (conf.has_input("bias_multiplier", 0)) { return; }
+      in_arg_name = "in";
+      weight_arg_name = "weight";
+    } else if (op_type_name == "matmul") {
+      if (conf.has_input("_add_to_output", 0)) { return; }
+      if (conf.attr<double>("alpha") != 1.0) { return; }
+      in_arg_name = "a";
+      weight_arg_name = "b";
+    } else {
+      return;
+    }
+    const OpNode* in_fake_quant = FindLowerableFakeQuantNode(op_graph, conf.input(in_arg_name, 0));
+    const OpNode* weight_fake_quant =
+        FindLowerableFakeQuantNode(op_graph, conf.input(weight_arg_name, 0));
+    if (in_fake_quant == nullptr || weight_fake_quant == nullptr) { return; }
+    if (ScaleSize4FakeQuantNode(in_fake_quant) != 1) { return; }
+    // NOTE: per-channel scales of matmul weights are only along the output dimension when b is
+    // transposed, otherwise they can not be applied after the int32 accumulation.
+    if (op_type_name == "matmul" && ScaleSize4FakeQuantNode(weight_fake_quant) > 1
+        && !conf.attr<bool>("transpose_b")) {
+      return;
+    }
+
+    const int64_t scope_symbol_id = op_conf.scope_symbol_id();
+    const std::string in_int8 = AddInt8QuantOps(in_fake_quant, op_conf.name() + "-" + in_arg_name,
+                                                scope_symbol_id, job_builder);
+    const std::string weight_int8 = AddInt8QuantOps(
+        weight_fake_quant, op_conf.name() + "-" + weight_arg_name, scope_symbol_id, job_builder);
+    user_op::UserOpConfWrapperBuilder builder(op_conf.name());
+    if (op_type_name == "conv2d") {
+      builder.Op("quantized_conv2d")
+          .Input("in", in_int8)
+          .Input("weight", weight_int8)
+          .Input("in_scale", ScaleLbn4FakeQuantNode(in_fake_quant))
+          .Input("weight_scale", ScaleLbn4FakeQuantNode(weight_fake_quant))
+          .Attr<int32_t>("filters", conf.attr<int32_t>("filters"))
+          .Attr("padding_before", conf.attr<std::vector<int32_t>>("padding_before"))
+          .Attr("kernel_size", conf.attr<std::vector<int32_t>>("kernel_size"))
+          .Attr("strides", conf.attr<std::vector<int32_t>>("strides"))
+          .Attr("dilation_rate", conf.attr<std::vector<int32_t>>("dilation_rate"))
+          .Attr<int32_t>("groups", conf.attr<int32_t>("groups"));
+      if (conf.has_input("bias", 0)) { builder.Input("bias", conf.input("bias", 0)); }
+    } else {
+      builder.Op("quantized_matmul")
+          .Input("a", in_int8)
+          .Input("b", weight_int8)
+          .Input("a_scale", ScaleLbn4FakeQuantNode(in_fake_quant))
+          .Input("b_scale", ScaleLbn4FakeQuantNode(weight_fake_quant))
+          .Attr<bool>("transpose_a", conf.attr<bool>("transpose_a"))
+          .Attr<bool>("transpose_b", conf.attr<bool>("transpose_b"));
+    }
+    OperatorConf lowered_op_conf =
+        builder.Output("out").ScopeSymbolId(scope_symbol_id).Build().op_conf();
+    lowered_op_conf.set_device_tag(op_conf.device_tag());
+    lowered_op_confs.push_back(lowered_op_conf);
+  });
+  job_builder->MutOpsOnlyOnce(lowered_op_confs);
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_JOB_PASS("QatInt8LoweringPass", QatInt8LoweringPass);
+
+}  // namespace oneflow
@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/core/common/channel.h"
 #include "oneflow/core/common/blocking_counter.h"
 #include "oneflow/user/image/random_crop_generator.h"
+#include "oneflow/user/image/jpeg_decoder.h"
 #include <opencv2/opencv.hpp>
 
 #ifdef WITH_CUDA
@@ -143,6 +144,10 @@ class CpuDecodeHandle final : public DecodeHandle {
   void Synchronize() override {
     // do nothing
   }
+
+ private:
+  JpegDecoder jpeg_decoder_;
+  cv::Mat resized_;
 };
 
 void CpuDecodeHandle::DecodeRandomCropResize(const unsigned char* data, size_t length,
@@ -150,21 +155,38 @@ void CpuDecodeHandle::DecodeRandomCropResize(const unsigned char* data, size_t l
                                              unsigned char* workspace, size_t workspace_size,
                                              unsigned char* dst, int target_width,
                                              int target_height) {
-  cv::Mat image =
-      cv::imdecode(cv::Mat(1, length, CV_8UC1, const_cast<unsigned char*>(data)), cv::IMREAD_COLOR);
-  cv::Mat cropped;
+  // JPEGs are decoded by libjpeg-turbo directly into RGB. Only the crop window is decoded, and the
+  // IDCT downscales it as far as the target size allows. Other images go through cv::imdecode.
+  int width = 0;
+  int height = 0;
+  const bool is_jpeg = jpeg_decoder_.ReadHeader(data, length, &width, &height);
+  cv::Mat image;
+  if (!is_jpeg) {
+    image = cv::imdecode(cv::Mat(1, length, CV_8UC1, const_cast<unsigned char*>(data)),
+                         cv::IMREAD_COLOR);
+    width = image.cols;
+    height = image.rows;
+  }
+  cv::Rect roi(0, 0, width, height);
   if (crop_generator) {
-    cv::Rect roi;
-    GenerateRandomCropRoi(crop_generator, image.cols, image.rows, &roi.x, &roi.y, &roi.width,
-                          &roi.height);
-    image(roi).copyTo(cropped);
-  } else {
-    cropped = image;
+    GenerateRandomCropRoi(crop_generator, width, height, &roi.x, &roi.y, &roi.width, &roi.height);
   }
-  cv::Mat resized;
-  cv::resize(cropped, resized, cv::Size(target_width, target_height), 0, 0, cv::INTER_LINEAR);
   cv::Mat dst_mat(target_height, target_width, CV_8UC3, dst, cv::Mat::AUTO_STEP);
-  cv::cvtColor(resized, dst_mat, cv::COLOR_BGR2RGB);
+  JpegImage cropped;
+  if (is_jpeg
+      && jpeg_decoder_.DecodeCrop(roi.x, roi.y, roi.width, roi.height, target_width,
+                                  target_height, "RGB", &cropped)) {
+    cv::Mat cropped_mat(cropped.height, cropped.width, CV_8UC3,
+                        const_cast<unsigned char*>(cropped.data), cv::Mat::AUTO_STEP);
+    cv::resize(cropped_mat, dst_mat, dst_mat.size(), 0, 0, cv::INTER_LINEAR);
+    return;
+  }
+  if (image.empty()) {
+    image = cv::imdecode(cv::Mat(1, length, CV_8UC1, const_cast<unsigned char*>(data)),
+                         cv::IMREAD_COLOR);
+  }
+  cv::resize(image(roi), resized_, dst_mat.size(), 0, 0, cv::INTER_LINEAR);
+  cv::cvtColor(resized_, dst_mat, cv::COLOR_BGR2RGB);
 }
 
 template<>
@@ -17,25 +17,228 @@ limitations under the License.
 #include "oneflow/core/common/preprocessor.h"
 #include "oneflow/core/ndarray/ndarray_reduce_impl.h"
 #include "oneflow/core/ndarray/binary_func.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
 
-#define SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(struct_name)                                        \
-  template<typename T, template<typename> class binary_func>                                   \
-  struct struct_name<DeviceType::kCPU, T, binary_func> final {                                 \
-    static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {          \
-      return false;                                                                            \
-    }                                                                                          \
-    static void Reduce(ep::Stream* stream, const XpuVarNdarray<T>& y,                          \
-                       const XpuVarNdarray<const T>& x, const XpuVarNdarray<T>& tmp_storage) { \
-      UNIMPLEMENTED();                                                                         \
-    }                                                                                          \
+namespace {
+
+constexpr int64_t kReduceLanes = 8;
+constexpr int64_t kPairwiseBlockSize = 128;
+constexpr int64_t kMinElemNumPerReduceTask = 16384;
+constexpr int64_t kMinColsPerReduceTask = 64;
+
+int64_t NumReduceTasks(int64_t elem_num) {
+  if (Global<ThreadPool>::Get() == nullptr) { return 1; }
+  const int64_t thread_num = Global<ThreadPool>::Get()->thread_num();
+  return std::max<int64_t>(std::min(thread_num, elem_num / kMinElemNumPerReduceTask), 1);
+}
+
+template<typename DoEachT>
+void ReduceTaskLoop(int64_t num_tasks, const DoEachT& DoEach) {
+  if (num_tasks == 1) {
+    DoEach(0);
+  } else {
+    MultiThreadLoop(num_tasks, DoEach);
+  }
+}
+
+// Striped over kReduceLanes independent accumulators so the loop vectorizes.
+template<typename T, template<typename> class binary_func>
+T LaneReduce(const T* x, int64_t n) {
+  T lanes[kReduceLanes];
+  std::fill(lanes, lanes + kReduceLanes, UnitOfBinaryFunc<T, binary_func>::Val());
+  const int64_t vec_n = n / kReduceLanes * kReduceLanes;
+  for (int64_t i = 0; i < vec_n; i += kReduceLanes) {
+    for (int64_t l = 0; l < kReduceLanes; ++l) {
+      lanes[l] = binary_func<T>::Invoke(lanes[l], x[i + l]);
+    }
+  }
+  T tail = UnitOfBinaryFunc<T, binary_func>::Val();
+  for (int64_t i = vec_n; i < n; ++i) { tail = binary_func<T>::Invoke(tail, x[i]); }
+  for (int64_t width = kReduceLanes / 2; width > 0; width /= 2) {
+    for (int64_t l = 0; l < width; ++l) {
+      lanes[l] = binary_func<T>::Invoke(lanes[l], lanes[l + width]);
+    }
+  }
+  return binary_func<T>::Invoke(lanes[0], tail);
+}
+
+// Pairwise (cascade) reduction: the rounding error of float sums grows with O(log n) instead of
+// O(n), at the cost of nothing but recursion over blocks of kPairwiseBlockSize.
+template<typename T, template<typename> class binary_func>
+T PairwiseReduce(const T* x, int64_t n) {
+  if (n <= kPairwiseBlockSize) { return LaneReduce<T, binary_func>(x, n); }
+  const int64_t half = (n / 2 + kReduceLanes - 1) / kReduceLanes * kReduceLanes;
+  return binary_func<T>::Invoke(PairwiseReduce<T, binary_func>(x, half),
+                                PairwiseReduce<T, binary_func>(x + half, n - half));
+}
+
+// out[j] = reduce(x[r * row_stride + j]) over r. Rows are folded in blocks of
+// kPairwiseBlockSize before being merged into out, which bounds the error like a two level
+// pairwise sum while keeping the inner loop contiguous.
+template<typename T, template<typename> class binary_func>
+void ReduceRows(const T* x, int64_t num_rows, int64_t row_stride, int64_t num_cols, T* out) {
+  const T unit = UnitOfBinaryFunc<T, binary_func>::Val();
+  std::fill(out, out + num_cols, unit);
+  std::vector<T> block(num_rows > kPairwiseBlockSize ? num_cols : 0);
+  for (int64_t block_begin = 0; block_begin < num_rows; block_begin += kPairwiseBlockSize) {
+    const int64_t block_end = std::min(block_begin + kPairwiseBlockSize, num_rows);
+    T* acc = out;
+    if (!block.empty()) {
+      acc = block.data();
+      std::fill(acc, acc + num_cols, unit);
+    }
+    for (int64_t r = block_begin; r < block_end; ++r) {
+      const T* row = x + r * row_stride;
+      for (int64_t j = 0; j < num_cols; ++j) { acc[j] = binary_func<T>::Invoke(acc[j], row[j]); }
+    }
+    if (acc != out) {
+      for (int64_t j = 0; j < num_cols; ++j) { out[j] = binary_func<T>::Invoke(out[j], acc[j]); }
+    }
+  }
+}
+
+// Reduces a row-major num_rows x num_cols matrix along its rows. Wide matrices are split by
+// columns; narrow ones by rows, with one partial row per task. The partials are kept off
+// tmp_storage on purpose: callers such as layer_norm_param_grad pass tmp_storage aliased to x.
+template<typename T, template<typename> class binary_func>
+void MatrixColReduce(const T* x, int64_t num_rows, int64_t num_cols, T* y) {
+  const int64_t num_tasks = NumReduceTasks(num_rows * num_cols);
+  if (num_tasks == 1) {
+    ReduceRows<T, binary_func>(x, num_rows, num_cols, num_cols, y);
+  } else if (num_cols >= num_tasks * kMinColsPerReduceTask) {
+    BalancedSplitter bs(num_cols, num_tasks);
+    MultiThreadLoop(num_tasks, [&](size_t i) {
+      const Range range = bs.At(i);
+      ReduceRows<T, binary_func>(x + range.begin(), num_rows, num_cols, range.size(),
+                                 y + range.begin());
+    });
+  } else {
+    const int64_t num_chunks = std::min(num_tasks, num_rows);
+    std::vector<T> partials(num_chunks * num_cols);
+    BalancedSplitter bs(num_rows, num_chunks);
+    MultiThreadLoop(num_chunks, [&](size_t i) {
+      const Range range = bs.At(i);
+      ReduceRows<T, binary_func>(x + range.begin() * num_cols, range.size(), num_cols, num_cols,
+                                 partials.data() + i * num_cols);
+    });
+    ReduceRows<T, binary_func>(partials.data(), num_chunks, num_cols, num_cols, y);
+  }
+}
+
+}  // namespace
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayScalarReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    return y.shape().ElemNum() == 1;
   }
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayScalarReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayMatrixRowReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayMatrixColReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayXYZCubeXZReduce);
-#undef SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL
+  static void Reduce(ep::Stream* stream, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    const int64_t n = x.shape().ElemNum();
+    const int64_t num_tasks = NumReduceTasks(n);
+    if (num_tasks == 1) {
+      *y.ptr() = PairwiseReduce<T, binary_func>(x.ptr(), n);
+      return;
+    }
+    std::vector<T> partials(num_tasks);
+    BalancedSplitter bs(n, num_tasks);
+    MultiThreadLoop(num_tasks, [&](size_t i) {
+      const Range range = bs.At(i);
+      partials[i] = PairwiseReduce<T, binary_func>(x.ptr() + range.begin(), range.size());
+    });
+    *y.ptr() = LaneReduce<T, binary_func>(partials.data(), num_tasks);
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayMatrixRowReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    if (x.shape().NumAxes() != 2) { return false; }
+    if (y.shape().NumAxes() != 2) { return false; }
+    return x.shape().At(0) == y.shape().At(0) && y.shape().At(1) == 1;
+  }
+  static void Reduce(ep::Stream* stream, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    const int64_t num_rows = x.shape().At(0);
+    const int64_t num_cols = x.shape().At(1);
+    const int64_t num_tasks = std::min(NumReduceTasks(num_rows * num_cols), num_rows);
+    BalancedSplitter bs(num_rows, num_tasks);
+    ReduceTaskLoop(num_tasks, [&](size_t i) {
+      const Range range = bs.At(i);
+      FOR_RANGE(int64_t, r, range.begin(), range.end()) {
+        y.ptr()[r] = PairwiseReduce<T, binary_func>(x.ptr() + r * num_cols, num_cols);
+      }
+    });
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayMatrixColReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    if (x.shape().NumAxes() != 2) { return false; }
+    if (y.shape().NumAxes() != 2) { return false; }
+    return y.shape().At(0) == 1 && x.shape().At(1) == y.shape().At(1);
+  }
+  static void Reduce(ep::Stream* stream, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    MatrixColReduce<T, binary_func>(x.ptr(), x.shape().At(0), x.shape().At(1), y.ptr());
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayXYZCubeXZReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    if (x.shape().NumAxes() != 3) { return false; }
+    if (y.shape().NumAxes() != 3) { return false; }
+    return y.shape().At(0) == 1 && x.shape().At(1) == y.shape().At(1) && y.shape().At(2) == 1;
+  }
+  static void Reduce(ep::Stream* stream, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    const int64_t dim_x = x.shape().At(0);
+    const int64_t dim_y = x.shape().At(1);
+    const int64_t dim_z = x.shape().At(2);
+    if (dim_z < kPairwiseBlockSize) {
+      // Short z segments: reduce x as a matrix column-wise first, then each y's z segment.
+      std::vector<T> yz(dim_y * dim_z);
+      MatrixColReduce<T, binary_func>(x.ptr(), dim_x, dim_y * dim_z, yz.data());
+      FOR_RANGE(int64_t, j, 0, dim_y) {
+        y.ptr()[j] = LaneReduce<T, binary_func>(yz.data() + j * dim_z, dim_z);
+      }
+      return;
+    }
+    // Long z segments: tasks are (y, x chunk) pairs, so a handful of channels still fans out
+    // over every thread; each task folds pairwise-reduced z segments.
+    const int64_t num_tasks = NumReduceTasks(dim_x * dim_y * dim_z);
+    const int64_t num_x_chunks = std::max<int64_t>(std::min(num_tasks / dim_y, dim_x), 1);
+    BalancedSplitter bs(dim_x, num_x_chunks);
+    const int64_t num_works = dim_y * num_x_chunks;
+    const int64_t num_work_tasks = std::min(num_tasks, num_works);
+    BalancedSplitter work_bs(num_works, num_work_tasks);
+    std::vector<T> partials(num_works);
+    ReduceTaskLoop(num_work_tasks, [&](size_t task) {
+      const Range task_range = work_bs.At(task);
+      FOR_RANGE(int64_t, i, task_range.begin(), task_range.end()) {
+        const int64_t j = i / num_x_chunks;
+        const Range range = bs.At(i % num_x_chunks);
+        T acc = UnitOfBinaryFunc<T, binary_func>::Val();
+        FOR_RANGE(int64_t, k, range.begin(), range.end()) {
+          const T* segment = x.ptr() + (k * dim_y + j) * dim_z;
+          acc = binary_func<T>::Invoke(acc, PairwiseReduce<T, binary_func>(segment, dim_z));
+        }
+        partials[i] = acc;
+      }
+    });
+    FOR_RANGE(int64_t, j, 0, dim_y) {
+      y.ptr()[j] = LaneReduce<T, binary_func>(partials.data() + j * num_x_chunks, num_x_chunks);
+    }
+  }
+};
 
 #define INSTANTIATE_NDARRAY_REDUCE_IMPL(dtype, binary_func)                                       \
   template struct NdarrayScalarReduce<DeviceType::kCPU, OF_PP_PAIR_FIRST(dtype), binary_func>;    \
@@ -0,0 +1,102 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <random>
+#include <gtest/gtest.h>
+#include "oneflow/core/ndarray/ndarray_reduce.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+struct ReduceCase {
+  std::string name;
+  DimVector x_dims;
+  DimVector y_dims;
+};
+
+std::vector<ReduceCase> ReduceCases() {
+  return {
+      {"scalar", {1 << 20}, {1}},
+      {"matrix_row", {1024, 1000}, {1024, 1}},
+      {"matrix_col", {4096, 256}, {1, 256}},
+      {"matrix_col_narrow", {65536, 3}, {1, 3}},
+      {"xyz_cube_xz", {32, 64, 56 * 56}, {1, 64, 1}},
+      {"xyz_cube_xz_short_z", {256, 64, 7}, {1, 64, 1}},
+  };
+}
+
+std::vector<float> RandomData(int64_t n) {
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<float> dis(-1.0, 1.0);
+  std::vector<float> data(n);
+  for (auto& v : data) { v = dis(gen); }
+  return data;
+}
+
+template<template<typename> class binary_func>
+void Reduce(ep::Stream* stream, const ReduceCase& c, const std::vector<float>& x,
+            std::vector<float>* y, std::vector<float>* tmp, bool use_default) {
+  XpuVarNdarray<float> y_ndarray(Shape(c.y_dims), y->data());
+  XpuVarNdarray<const float> x_ndarray(Shape(c.x_dims), x.data());
+  XpuVarNdarray<float> tmp_ndarray(Shape(c.x_dims), tmp->data());
+  if (use_default) {
+    NdarrayDefaultReduce<DeviceType::kCPU, float, binary_func>::Reduce(stream, y_ndarray,
+                                                                       x_ndarray, tmp_ndarray);
+  } else {
+    NdarrayReduce<DeviceType::kCPU, float, binary_func>::Reduce(stream, y_ndarray, x_ndarray,
+                                                                tmp_ndarray);
+  }
+}
+
+template<template<typename> class binary_func>
+void TestMatchesDefaultReduce(float rtol) {
+  ep::CpuStream stream;
+  for (const auto& c : ReduceCases()) {
+    const int64_t x_elem_cnt = Shape(c.x_dims).elem_cnt();
+    const int64_t y_elem_cnt = Shape(c.y_dims).elem_cnt();
+    std::vector<float> x = RandomData(x_elem_cnt);
+    std::vector<float> tmp(x_elem_cnt);
+    std::vector<float> expected(y_elem_cnt);
+    std::vector<float> actual(y_elem_cnt);
+    Reduce<binary_func>(&stream, c, x, &expected, &tmp, true);
+    Reduce<binary_func>(&stream, c, x, &actual, &tmp, false);
+    for (int64_t i = 0; i < y_elem_cnt; ++i) {
+      ASSERT_NEAR(expected[i], actual[i], rtol * std::max(1.0f, std::abs(expected[i])))
+          << c.name << " at " << i;
+    }
+  }
+}
+
+}  // namespace
+
+TEST(NdarrayReduce, cpu_sum_matches_default) { TestMatchesDefaultReduce<BinaryFuncSum>(1e-4); }
+
+TEST(NdarrayReduce, cpu_max_matches_default) { TestMatchesDefaultReduce<BinaryFuncMax>(0); }
+
+TEST(NdarrayReduce, cpu_sum_multi_thread_matches_default) {
+  const bool own_thread_pool = Global<ThreadPool>::Get() == nullptr;
+  if (own_thread_pool) { Global<ThreadPool>::New(4); }
+  TestMatchesDefaultReduce<BinaryFuncSum>(1e-4);
+  if (own_thread_pool) { Global<ThreadPool>::Delete(); }
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -28,6 +28,10 @@ class BinaryInStream {
   // 0: success
   // -1: eof
   virtual int32_t Read(char* s, size_t n) = 0;
+  // Like Read, but returns a pointer into the memory mapped file instead of copying, nullptr if
+  // the file is not mapped.
+  virtual const char* ReadView(size_t n) { return nullptr; }
+  virtual bool IsMapped() const { return false; }
 
   virtual uint64_t file_size() const = 0;
   virtual uint64_t cur_file_pos() const = 0;
@@ -27,11 +27,21 @@ int32_t BinaryInStreamWithoutLocalCopy::Read(char* s, size_t n) {
   return 0;
 }
 
+const char* BinaryInStreamWithoutLocalCopy::ReadView(size_t n) {
+  if (!is_mapped_ || IsEof()) { return nullptr; }
+  CHECK_LE(cur_file_pos_ + n, file_size_);
+  const char* data = file_->MappedData(cur_file_pos_, n);
+  cur_file_pos_ += n;
+  return data;
+}
+
 BinaryInStreamWithoutLocalCopy::BinaryInStreamWithoutLocalCopy(fs::FileSystem* fs,
                                                                const std::string& file_path)
     : cur_file_pos_(0) {
   fs->NewRandomAccessFile(file_path, &file_);
   file_size_ = fs->GetFileSize(file_path);
+  is_mapped_ = file_size_ > 0 && file_->MappedData(0, file_size_) != nullptr;
+  if (is_mapped_) { file_->AdviseSequential(); }
 }
 
 }  // namespace oneflow
@@ -29,6 +29,8 @@ class BinaryInStreamWithoutLocalCopy final : public BinaryInStream {
 
   BinaryInStreamWithoutLocalCopy(fs::FileSystem*, const std::string& file_path);
   int32_t Read(char* s, size_t n) override;
+  const char* ReadView(size_t n) override;
+  bool IsMapped() const override { return is_mapped_; }
 
   uint64_t file_size() const override { return file_size_; }
   uint64_t cur_file_pos() const override { return cur_file_pos_; }
@@ -39,6 +41,7 @@ class BinaryInStreamWithoutLocalCopy final : public BinaryInStream {
   std::unique_ptr<fs::RandomAccessFile> file_;
   uint64_t file_size_;
   uint64_t cur_file_pos_;
+  bool is_mapped_;
 };
 
 }  // namespace oneflow
@@ -132,6 +132,14 @@ void CreateLocalFS(std::unique_ptr<fs::FileSystem>& fs) {
 #endif
 }
 
+void CreateMmapFS(std::unique_ptr<fs::FileSystem>& fs, bool hugepage) {
+#ifdef OF_PLATFORM_POSIX
+  fs.reset(new fs::PosixFileSystem(true, hugepage));
+#else
+  OF_UNIMPLEMENTED();
+#endif
+}
+
 void CreateHadoopFS(std::unique_ptr<fs::FileSystem>& fs, const std::string& namenode) {
   fs.reset(new fs::HadoopFileSystem(namenode));
 }
@@ -151,6 +159,9 @@ void CreateFileSystemFromEnv(std::unique_ptr<fs::FileSystem>& fs, const std::str
 
   if (fs_type_str == "local") {
     CreateLocalFS(fs);
+  } else if (fs_type_str == "mmap") {
+    auto hugepage_env = env_prefix + "_MMAP_HUGEPAGE";
+    CreateMmapFS(fs, ParseBooleanFromEnv(hugepage_env, false));
   } else if (fs_type_str == "hdfs") {
     auto hdfs_nn_env = env_prefix + "_HDFS_NAMENODE";
     const char* hdfs_namenode = std::getenv(hdfs_nn_env.c_str());
@@ -36,6 +36,17 @@ class RandomAccessFile {
   // Safe for concurrent use by multiple threads.
   virtual void Read(uint64_t offset, size_t n, char* result) const = 0;
 
+  // Returns a read-only pointer to the `n` bytes starting at `offset` if the
+  // file is mapped into memory, otherwise returns nullptr and the caller
+  // should fall back to Read. The pointer stays valid as long as the file.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual const char* MappedData(uint64_t offset, size_t n) const { return nullptr; }
+
+  // Access pattern hints, no-ops for files which are not mapped.
+  virtual void AdviseSequential() const {}
+  virtual void AdviseWillNeed(uint64_t offset, size_t n) const {}
+
  private:
 };
 
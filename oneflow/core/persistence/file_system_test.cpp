@@ -14,8 +14,10 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include <gtest/gtest.h>
+#include <cstdlib>
 #include "oneflow/core/common/process_state.h"
 #include "oneflow/core/common/str_util.h"
+#include "oneflow/core/persistence/persistent_in_stream.h"
 #include "oneflow/core/persistence/posix/posix_file_system.h"
 
 namespace oneflow {
@@ -99,6 +101,72 @@ void TestMultiThreadsDirOperation(FileSystem* file_system) {
   ASSERT_TRUE(file_system->IsDirectory(test_root_path));
 }
 
+void WriteFile(FileSystem* file_system, const std::string& file_name, const std::string& content) {
+  std::unique_ptr<WritableFile> file;
+  file_system->NewWritableFile(file_name, &file);
+  file->Append(content.data(), content.size());
+  file->Close();
+}
+
+std::vector<std::string> ReadLines(FileSystem* file_system,
+                                   const std::vector<std::string>& file_names) {
+  PersistentInStream in_stream(file_system, file_names, false, false);
+  std::vector<std::string> lines;
+  std::string line;
+  while (in_stream.ReadLine(&line) == 0) { lines.push_back(line); }
+  return lines;
+}
+
+void TestMappedFile(FileSystem* file_system) {
+  std::string current_dir = GetCwd();
+  StringReplace(&current_dir, '\\', '/');
+  std::string test_root_path = JoinPath(current_dir, "tmp_mmap_test_dir");
+  file_system->RecursivelyCreateDirIfNotExist(test_root_path);
+  // the second line spans the two files, the last one has no newline
+  const std::vector<std::string> file_names = {JoinPath(test_root_path, "part-0"),
+                                               JoinPath(test_root_path, "part-1")};
+  const std::vector<std::string> contents = {"alpha\nbra", "vo\n\ncharlie-delta\necho"};
+  FOR_RANGE(size_t, i, 0, file_names.size()) {
+    WriteFile(file_system, file_names.at(i), contents.at(i));
+  }
+  const std::string empty_file_name = JoinPath(test_root_path, "empty");
+  WriteFile(file_system, empty_file_name, "");
+  const std::vector<std::string> expected_lines = {"alpha", "bravo", "", "charlie-delta", "echo"};
+
+  // spans of the mapping
+  std::unique_ptr<RandomAccessFile> file;
+  file_system->NewRandomAccessFile(file_names.at(1), &file);
+  const char* data = file->MappedData(0, contents.at(1).size());
+  ASSERT_NE(data, nullptr);
+  ASSERT_EQ(std::string(data, contents.at(1).size()), contents.at(1));
+  ASSERT_EQ(file->MappedData(4, 13), data + 4);
+  ASSERT_EQ(std::string(file->MappedData(4, 13), 13), "charlie-delta");
+  file->AdviseSequential();
+  file->AdviseWillNeed(0, contents.at(1).size());
+  // empty files are read with pread, and files of other file systems are not mapped
+  file_system->NewRandomAccessFile(empty_file_name, &file);
+  ASSERT_EQ(file->MappedData(0, 0), nullptr);
+  PosixFileSystem pread_file_system;
+  pread_file_system.NewRandomAccessFile(file_names.at(0), &file);
+  ASSERT_EQ(file->MappedData(0, 1), nullptr);
+
+  // PersistentInStream walks the mapped files in place, and lines span the files
+  ASSERT_EQ(ReadLines(file_system, file_names), expected_lines);
+  {
+    PersistentInStream in_stream(file_system, file_names, 3, false, false);
+    std::string bytes(12, '\0');
+    ASSERT_EQ(in_stream.ReadFully(&bytes[0], bytes.size()), 0);
+    ASSERT_EQ(bytes, "ha\nbravo\n\nch");
+  }
+  // with pread and a small buffer, lines span the buffer end, and a newline ends a buffer
+  setenv("ONEFLOW_PERSISTENT_IN_STREAM_BUFFER_SIZE_BYTES", "6", 1);
+  ASSERT_EQ(ReadLines(&pread_file_system, file_names), expected_lines);
+  setenv("ONEFLOW_PERSISTENT_IN_STREAM_BUFFER_SIZE_BYTES", "4", 1);
+  ASSERT_EQ(ReadLines(&pread_file_system, file_names), expected_lines);
+  unsetenv("ONEFLOW_PERSISTENT_IN_STREAM_BUFFER_SIZE_BYTES");
+  file_system->RecursivelyDeleteDir(test_root_path);
+}
+
 void TestFileSystem(FileSystem* file_system) {
   TestFileOperation(file_system);
   TestDirOperation(file_system);
@@ -114,4 +182,12 @@ TEST(file_system, write_and_read) {
 #endif
 }
 
+TEST(file_system, mmap_write_and_read) {
+#ifdef OF_PLATFORM_POSIX
+  fs::FileSystem* file_system = new fs::PosixFileSystem(true, false);
+  fs::TestFileSystem(file_system);
+  fs::TestMappedFile(file_system);
+#endif
+}
+
 }  // namespace oneflow
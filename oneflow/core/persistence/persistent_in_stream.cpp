@@ -18,6 +18,9 @@ limitations under the License.
 #include "oneflow/core/persistence/binary_in_stream_without_local_copy.h"
 #include "oneflow/core/job/job_set.pb.h"
 #include <cstring>
+#include <condition_variable>
+#include <deque>
+#include <thread>
 #include "oneflow/core/common/constant.h"
 
 namespace oneflow {
@@ -41,8 +44,100 @@ size_t GetBufferSize() {
   return kDefaultBufferSize;
 }
 
+// Number of chunks read ahead by a background thread, 0 means reading synchronously.
+size_t GetReadAheadDepth() {
+  const int64_t depth = ParseIntegerFromEnv("ONEFLOW_PERSISTENT_IN_STREAM_READ_AHEAD_DEPTH", 0);
+  return depth > 0 ? depth : 0;
+}
+
 }  // namespace
 
+// Fills chunks with the stream scanner in a background thread, so that the reader only waits
+// when it consumes faster than the file system delivers. The scanner goes across the file
+// boundaries by itself, so chunks keep in flight over the whole part list.
+class PersistentInStream::ReadAhead final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ReadAhead);
+  ReadAhead(StreamScanner* stream_scanner, size_t depth, size_t buffer_size)
+      : stream_scanner_(stream_scanner),
+        is_stopped_(false),
+        stall_count_(0),
+        stall_seconds_(0.0) {
+    free_buffers_.resize(depth, std::vector<char>(buffer_size));
+    thread_ = std::thread(&ReadAhead::PollChunks, this);
+  }
+  ~ReadAhead() {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      is_stopped_ = true;
+    }
+    cond_.notify_all();
+    thread_.join();
+  }
+
+  // Swaps the next chunk into `buffer` whose content must have been consumed, and returns the
+  // valid size of it. 0 means eof.
+  uint64_t Next(std::vector<char>* buffer) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (filled_chunks_.empty()) {
+      const double start = GetCurTime();
+      cond_.wait(lock, [this]() { return !filled_chunks_.empty(); });
+      ++stall_count_;
+      stall_seconds_ += (GetCurTime() - start) / 1e9;
+    }
+    const uint64_t size = filled_chunks_.front().second;
+    // Keep the eof chunk in the queue so that the following calls return eof too.
+    if (size == 0) { return 0; }
+    buffer->swap(filled_chunks_.front().first);
+    free_buffers_.push_back(std::move(filled_chunks_.front().first));
+    filled_chunks_.pop_front();
+    lock.unlock();
+    cond_.notify_all();
+    return size;
+  }
+
+  int64_t stall_count() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return stall_count_;
+  }
+
+  double stall_seconds() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return stall_seconds_;
+  }
+
+ private:
+  void PollChunks() {
+    while (true) {
+      std::vector<char> buffer;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this]() { return is_stopped_ || !free_buffers_.empty(); });
+        if (is_stopped_) { return; }
+        buffer.swap(free_buffers_.back());
+        free_buffers_.pop_back();
+      }
+      const uint64_t size = stream_scanner_->UpdateBuffer(&buffer);
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        filled_chunks_.emplace_back(std::move(buffer), size);
+      }
+      cond_.notify_all();
+      if (size == 0) { return; }
+    }
+  }
+
+  StreamScanner* stream_scanner_;
+  mutable std::mutex mutex_;
+  std::condition_variable cond_;
+  std::vector<std::vector<char>> free_buffers_;
+  std::deque<std::pair<std::vector<char>, uint64_t>> filled_chunks_;
+  bool is_stopped_;
+  int64_t stall_count_;
+  double stall_seconds_;
+  std::thread thread_;
+};
+
 PersistentInStream::PersistentInStream(fs::FileSystem* fs,
                                        const std::vector<std::string>& file_paths, uint64_t offset,
                                        bool cyclic, bool with_local_copy)
@@ -65,10 +160,21 @@ PersistentInStream::PersistentInStream(int64_t session_id, fs::FileSystem* fs,
   } else {
     stream_scanner_.reset(new AcyclicStreamScanner(fs, streams, offset));
   }
-  buffer_.resize(GetBufferSize() + 1);
+  buffer_.resize(GetBufferSize());
   cur_buf_begin_ = buffer_.data();
   cur_buf_end_ = buffer_.data();
-  *cur_buf_end_ = '\0';
+  const size_t read_ahead_depth = GetReadAheadDepth();
+  // Mapped files are read in place, the page cache reads ahead for them.
+  if (read_ahead_depth > 0 && !stream_scanner_->IsMapped()) {
+    read_ahead_.reset(new ReadAhead(stream_scanner_.get(), read_ahead_depth, buffer_.size()));
+  }
+}
+
+PersistentInStream::~PersistentInStream() {
+  if (read_ahead_ && read_ahead_->stall_count() > 0) {
+    VLOG(1) << "PersistentInStream stalled " << read_ahead_->stall_count() << " times for "
+            << read_ahead_->stall_seconds() << " seconds waiting for read-ahead chunks";
+  }
 }
 
 PersistentInStream::PersistentInStream(fs::FileSystem* fs,
@@ -95,19 +201,21 @@ PersistentInStream::PersistentInStream(int64_t session_id, fs::FileSystem* fs,
 int32_t PersistentInStream::ReadLine(std::string* l) {
   if (IsEof()) { return -1; }
   l->clear();
-  while (*cur_buf_begin_ != '\n') {
+  while (true) {
     if (cur_buf_begin_ == cur_buf_end_) {
       UpdateBuffer();
-      if (cur_buf_begin_ == cur_buf_end_) {
-        return 0;
-      } else {
-        continue;
-      }
+      if (cur_buf_begin_ == cur_buf_end_) { return 0; }
     }
-    l->push_back(*cur_buf_begin_++);
+    const char* line_end =
+        static_cast<const char*>(std::memchr(cur_buf_begin_, '\n', cur_buf_end_ - cur_buf_begin_));
+    if (line_end != nullptr) {
+      l->append(cur_buf_begin_, line_end);
+      cur_buf_begin_ = line_end + 1;
+      return 0;
+    }
+    l->append(cur_buf_begin_, cur_buf_end_);
+    cur_buf_begin_ = cur_buf_end_;
   }
-  ++cur_buf_begin_;
-  return 0;
 }
 
 int32_t PersistentInStream::ReadFully(char* s, size_t n) {
@@ -126,13 +234,33 @@ int32_t PersistentInStream::ReadFully(char* s, size_t n) {
 
 void PersistentInStream::UpdateBuffer() {
   CHECK_EQ(cur_buf_begin_, cur_buf_end_);
-  uint64_t n = stream_scanner_->UpdateBuffer(&buffer_);
+  if (stream_scanner_->IsMapped()) {
+    const char* data = nullptr;
+    const uint64_t n = stream_scanner_->UpdateView(&data);
+    cur_buf_begin_ = data;
+    cur_buf_end_ = data + n;
+    return;
+  }
+  uint64_t n = read_ahead_ ? read_ahead_->Next(&buffer_) : stream_scanner_->UpdateBuffer(&buffer_);
   cur_buf_begin_ = buffer_.data();
   cur_buf_end_ = buffer_.data() + n;
-  *cur_buf_end_ = '\0';
 }
 
-bool PersistentInStream::IsEof() const {
-  return cur_buf_begin_ == cur_buf_end_ && stream_scanner_->IsEof();
+bool PersistentInStream::IsEof() {
+  if (cur_buf_begin_ != cur_buf_end_) { return false; }
+  if (read_ahead_) {
+    // The scanner runs ahead of the reader, so eof is known only by fetching the next chunk.
+    UpdateBuffer();
+    return cur_buf_begin_ == cur_buf_end_;
+  }
+  return stream_scanner_->IsEof();
+}
+
+int64_t PersistentInStream::stall_count() const {
+  return read_ahead_ ? read_ahead_->stall_count() : 0;
+}
+
+double PersistentInStream::stall_seconds() const {
+  return read_ahead_ ? read_ahead_->stall_seconds() : 0.0;
 }
 }  // namespace oneflow
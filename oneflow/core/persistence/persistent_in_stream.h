@@ -24,7 +24,7 @@ namespace oneflow {
 class PersistentInStream {
  public:
   OF_DISALLOW_COPY_AND_MOVE(PersistentInStream);
-  virtual ~PersistentInStream() {}
+  virtual ~PersistentInStream();
   PersistentInStream(fs::FileSystem* fs, const std::vector<std::string>& file_paths,
                      uint64_t offset, bool cyclic, bool with_local_copy);
   PersistentInStream(fs::FileSystem* fs, const std::vector<std::string>& file_paths, bool cyclic,
@@ -44,15 +44,24 @@ class PersistentInStream {
   int32_t ReadLine(std::string* l);
   int32_t ReadFully(char* s, size_t n);
 
+  // Times the reader waited for a chunk which had not been read ahead, and the total waiting
+  // time. Both are 0 if read-ahead is disabled.
+  int64_t stall_count() const;
+  double stall_seconds() const;
+
  private:
-  bool IsEof() const;
+  class ReadAhead;
+
+  bool IsEof();
   void UpdateBuffer();
 
   std::unique_ptr<StreamScanner> stream_scanner_;
+  std::unique_ptr<ReadAhead> read_ahead_;
 
   std::vector<char> buffer_;
-  char* cur_buf_begin_;
-  char* cur_buf_end_;
+  // Point into buffer_, or into the file itself if it is memory mapped.
+  const char* cur_buf_begin_;
+  const char* cur_buf_end_;
 };
 
 }  // namespace oneflow
@@ -0,0 +1,152 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/persistence/persistent_in_stream.h"
+#include "oneflow/core/persistence/posix/posix_file_system.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+// Lines of different lengths, some of them longer than a chunk, split into part files whose
+// boundaries do not align with the lines or the chunks.
+std::vector<std::string> WritePartFiles(fs::FileSystem* file_system, const std::string& dir,
+                                        std::string* content) {
+  content->clear();
+  FOR_RANGE(int32_t, i, 0, 40) {
+    content->append(std::string(i % 13, static_cast<char>('a' + i % 26)));
+    content->append("\n");
+  }
+  content->append("last line without newline");
+  file_system->RecursivelyCreateDirIfNotExist(dir);
+  const std::vector<size_t> part_sizes = {1, 17, 64, 5};
+  std::vector<std::string> file_paths;
+  size_t pos = 0;
+  FOR_RANGE(size_t, i, 0, part_sizes.size() + 1) {
+    const size_t size = i < part_sizes.size() ? part_sizes.at(i) : content->size() - pos;
+    const std::string file_path = JoinPath(dir, "part-" + std::to_string(i));
+    std::unique_ptr<fs::WritableFile> file;
+    file_system->NewWritableFile(file_path, &file);
+    file->Append(content->data() + pos, size);
+    file->Close();
+    file_paths.push_back(file_path);
+    pos += size;
+  }
+  CHECK_EQ(pos, content->size());
+  return file_paths;
+}
+
+std::unique_ptr<PersistentInStream> NewInStream(fs::FileSystem* file_system,
+                                                const std::vector<std::string>& file_paths,
+                                                uint64_t offset, bool cyclic, int64_t depth) {
+  // A small chunk makes the reads cross the chunk boundaries. Both variables are read when the
+  // stream is constructed.
+  setenv("ONEFLOW_PERSISTENT_IN_STREAM_BUFFER_SIZE_BYTES", "7", 1);
+  setenv("ONEFLOW_PERSISTENT_IN_STREAM_READ_AHEAD_DEPTH", std::to_string(depth).c_str(), 1);
+  std::unique_ptr<PersistentInStream> in_stream(
+      new PersistentInStream(file_system, file_paths, offset, cyclic, false));
+  unsetenv("ONEFLOW_PERSISTENT_IN_STREAM_BUFFER_SIZE_BYTES");
+  unsetenv("ONEFLOW_PERSISTENT_IN_STREAM_READ_AHEAD_DEPTH");
+  return in_stream;
+}
+
+// Reads `size` bytes with the read sizes cycling through 1 to 11.
+std::string ReadFully(PersistentInStream* in_stream, size_t size) {
+  std::string result;
+  size_t n = 1;
+  while (result.size() < size) {
+    std::string bytes(std::min(n, size - result.size()), '\0');
+    CHECK_EQ(in_stream->ReadFully(&bytes.at(0), bytes.size()), 0);
+    result.append(bytes);
+    n = n % 11 + 1;
+  }
+  return result;
+}
+
+std::vector<std::string> ReadLines(PersistentInStream* in_stream) {
+  std::vector<std::string> lines;
+  std::string line;
+  while (in_stream->ReadLine(&line) == 0) { lines.push_back(line); }
+  return lines;
+}
+
+class PersistentInStreamTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    std::string current_dir = GetCwd();
+    StringReplace(&current_dir, '\\', '/');
+    dir_ = JoinPath(current_dir, "tmp_persistent_in_stream_test_dir");
+    file_paths_ = WritePartFiles(&file_system_, dir_, &content_);
+  }
+  void TearDown() override { file_system_.RecursivelyDeleteDir(dir_); }
+
+  fs::PosixFileSystem file_system_;
+  std::string dir_;
+  std::string content_;
+  std::vector<std::string> file_paths_;
+};
+
+}  // namespace
+
+TEST_F(PersistentInStreamTest, read_fully_with_read_ahead) {
+  for (const uint64_t offset : {0, 1, 30, 86}) {
+    const std::string expected = content_.substr(offset);
+    for (const int64_t depth : {0, 1, 4}) {
+      auto in_stream = NewInStream(&file_system_, file_paths_, offset, false, depth);
+      ASSERT_EQ(ReadFully(in_stream.get(), expected.size()), expected);
+      char c = '\0';
+      ASSERT_EQ(in_stream->ReadFully(&c, 1), -1);
+      ASSERT_EQ(in_stream->ReadFully(&c, 1), -1);
+      if (depth == 0) {
+        ASSERT_EQ(in_stream->stall_count(), 0);
+        ASSERT_EQ(in_stream->stall_seconds(), 0.0);
+      }
+    }
+  }
+}
+
+TEST_F(PersistentInStreamTest, read_line_with_read_ahead) {
+  const std::vector<std::string> expected =
+      ReadLines(NewInStream(&file_system_, file_paths_, 0, false, 0).get());
+  ASSERT_EQ(expected.size(), 41);
+  ASSERT_EQ(expected.back(), "last line without newline");
+  for (const int64_t depth : {1, 4}) {
+    auto in_stream = NewInStream(&file_system_, file_paths_, 0, false, depth);
+    ASSERT_EQ(ReadLines(in_stream.get()), expected);
+    std::string line;
+    ASSERT_EQ(in_stream->ReadLine(&line), -1);
+  }
+}
+
+TEST_F(PersistentInStreamTest, cyclic_read_with_read_ahead) {
+  // Read a few rounds starting in the middle of a part file.
+  const uint64_t offset = 20;
+  const std::string round = content_.substr(offset) + content_.substr(0, offset);
+  const std::string expected = round + round + round;
+  for (const int64_t depth : {0, 1, 4}) {
+    auto in_stream = NewInStream(&file_system_, file_paths_, offset, true, depth);
+    ASSERT_EQ(ReadFully(in_stream.get(), expected.size()), expected);
+  }
+}
+
+}  // namespace test
+
+}  // namespace oneflow
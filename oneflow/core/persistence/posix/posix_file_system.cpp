@@ -26,6 +26,7 @@ limitations under the License.
 #include <sys/time.h>
 #include <sys/types.h>
 #include <time.h>
+#include <cstring>
 #include <unistd.h>
 
 namespace oneflow {
@@ -62,6 +63,38 @@ class PosixRandomAccessFile : public RandomAccessFile {
   }
 };
 
+class PosixMmapRandomAccessFile : public RandomAccessFile {
+ private:
+  std::string fname_;
+  char* data_;
+  size_t length_;
+
+ public:
+  PosixMmapRandomAccessFile(const std::string& fname, char* data, size_t length)
+      : fname_(fname), data_(data), length_(length) {}
+  ~PosixMmapRandomAccessFile() override { munmap(data_, length_); }
+
+  void Read(uint64_t offset, size_t n, char* result) const override {
+    memcpy(result, MappedData(offset, n), n);
+  }
+
+  const char* MappedData(uint64_t offset, size_t n) const override {
+    CHECK_LE(offset + n, length_) << "Read EOF of file " << fname_;
+    return data_ + offset;
+  }
+
+  void AdviseSequential() const override { madvise(data_, length_, MADV_SEQUENTIAL); }
+
+  void AdviseWillNeed(uint64_t offset, size_t n) const override {
+    if (offset >= length_) { return; }
+    n = std::min<uint64_t>(n, length_ - offset);
+    // madvise requires a page aligned address
+    const uint64_t page_size = sysconf(_SC_PAGESIZE);
+    const uint64_t aligned_offset = offset / page_size * page_size;
+    madvise(data_ + aligned_offset, n + offset - aligned_offset, MADV_WILLNEED);
+  }
+};
+
 class PosixWritableFile : public WritableFile {
  private:
   std::string fname_;
@@ -95,6 +128,24 @@ void PosixFileSystem::NewRandomAccessFile(const std::string& fname,
   std::string translated_fname = TranslateName(fname);
   int fd = open(translated_fname.c_str(), O_RDONLY);
   PCHECK(fd >= 0) << "Fail to open file " << fname << ", errno is " << errno;
+  if (use_mmap_) {
+    struct stat st;
+    // empty files can not be mapped, leave them to pread
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+      const size_t length = st.st_size;
+      void* data = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+      if (data != MAP_FAILED) {
+        // the mapping keeps its own reference to the file
+        close(fd);
+#ifdef MADV_HUGEPAGE
+        if (mmap_hugepage_) { madvise(data, length, MADV_HUGEPAGE); }
+#endif
+        result->reset(new PosixMmapRandomAccessFile(fname, static_cast<char*>(data), length));
+        return;
+      }
+      PLOG(WARNING) << "Fail to mmap file " << fname << ", fall back to pread";
+    }
+  }
   result->reset(new PosixRandomAccessFile(fname, fd));
   CHECK_NOTNULL(result->get());
 }
@@ -27,7 +27,9 @@ namespace fs {
 class PosixFileSystem final : public FileSystem {
  public:
   OF_DISALLOW_COPY_AND_MOVE(PosixFileSystem);
-  PosixFileSystem() = default;
+  PosixFileSystem() : PosixFileSystem(false, false) {}
+  PosixFileSystem(bool use_mmap, bool mmap_hugepage)
+      : use_mmap_(use_mmap), mmap_hugepage_(mmap_hugepage) {}
   ~PosixFileSystem() = default;
 
   void NewRandomAccessFile(const std::string& fname,
@@ -56,6 +58,10 @@ class PosixFileSystem final : public FileSystem {
   bool IsDirectory(const std::string& fname) override;
 
  private:
+  // Random access files are mapped into memory instead of read with pread,
+  // the files must not be modified while they are opened.
+  bool use_mmap_;
+  bool mmap_hugepage_;
 };
 
 }  // namespace fs
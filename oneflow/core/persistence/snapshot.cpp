@@ -58,12 +58,19 @@ void SnapshotReader::Read(const std::string& key, const Shape& logical_blob_shap
         slice.At(0).begin() * slice.shape().Count(1) * GetSizeOfDataType(data_type));
     in_stream.ReadFully(dst, slice.shape().elem_cnt() * GetSizeOfDataType(data_type));
   } else {
-    std::vector<char> buffer(logical_blob_size);
-    PersistentInStream in_stream(SnapshotFS(), path);
-    in_stream.ReadFully(buffer.data(), logical_blob_size);
     TensorSliceCopier copier(slice, logical_blob_slice, data_type, DeviceType::kCPU);
     CpuDeviceCtx device_ctx;
-    copier.Copy(device_ctx.stream(), dst, buffer.data());
+    std::unique_ptr<fs::RandomAccessFile> file;
+    SnapshotFS()->NewRandomAccessFile(path, &file);
+    // copy the slice straight out of a mapped file instead of reading the whole blob first
+    const char* mapped = file->MappedData(0, logical_blob_size);
+    if (mapped != nullptr) {
+      copier.Copy(device_ctx.stream(), dst, mapped);
+    } else {
+      std::vector<char> buffer(logical_blob_size);
+      file->Read(0, logical_blob_size, buffer.data());
+      copier.Copy(device_ctx.stream(), dst, buffer.data());
+    }
   }
 }
 
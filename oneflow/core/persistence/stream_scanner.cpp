@@ -25,6 +25,7 @@ StreamScanner::StreamScanner(fs::FileSystem* fs,
     : whole_file_offset_(offset) {
   stream_num_ = streams.size();
   whole_file_size_ = 0;
+  is_mapped_ = !streams.empty();
   int64_t idx = 0;
   for (auto& stream : streams) {
     AddStream(fs, stream, idx);
@@ -47,6 +48,7 @@ void StreamScanner::AddStream(fs::FileSystem* fs, const std::shared_ptr<BinaryIn
     stream->set_cur_file_pos(0);  // works for both cyclic and acyclic cases
   }
 
+  is_mapped_ = is_mapped_ && stream->IsMapped();
   streams_.emplace_back(stream);
   whole_file_size_ += cur_file_size;
 }
@@ -55,15 +57,24 @@ bool StreamScanner::IsEof() const { return whole_file_pos_ == whole_file_size_;
 
 uint64_t StreamScanner::UpdateBuffer(std::vector<char>* buffer) {
   if (cur_stream_id_ == stream_num_) return 0;
-  uint64_t n =
-      std::min<uint64_t>(buffer->size() - 1, streams_[cur_stream_id_]->file_size()
-                                                 - streams_[cur_stream_id_]->cur_file_pos());
+  uint64_t n = std::min<uint64_t>(buffer->size(), streams_[cur_stream_id_]->file_size()
+                                                     - streams_[cur_stream_id_]->cur_file_pos());
   if (n == 0) { return 0; }
   streams_[cur_stream_id_]->Read(buffer->data(), n);
   AddNForCurFilePos(n);
   return n;
 }
 
+uint64_t StreamScanner::UpdateView(const char** data) {
+  CHECK(is_mapped_);
+  if (cur_stream_id_ == stream_num_) return 0;
+  uint64_t n = streams_[cur_stream_id_]->file_size() - streams_[cur_stream_id_]->cur_file_pos();
+  if (n == 0) { return 0; }
+  *data = CHECK_NOTNULL(streams_[cur_stream_id_]->ReadView(n));
+  AddNForCurFilePos(n);
+  return n;
+}
+
 void AcyclicStreamScanner::AddNForCurFilePos(uint64_t n) {
   whole_file_pos_ += n;
   if (streams_[cur_stream_id_]->IsEof()) { ++cur_stream_id_; }
@@ -32,6 +32,10 @@ class StreamScanner {
                 uint64_t offset);
   bool IsEof() const;
   uint64_t UpdateBuffer(std::vector<char>* buffer);
+  // Points `data` to the rest of the current file instead of copying it, only valid if all the
+  // files are memory mapped.
+  uint64_t UpdateView(const char** data);
+  bool IsMapped() const { return is_mapped_; }
 
  protected:
   virtual void AddNForCurFilePos(uint64_t n) = 0;
@@ -42,6 +46,7 @@ class StreamScanner {
   int32_t cur_stream_id_;
   int32_t stream_num_;
   uint64_t whole_file_offset_;
+  bool is_mapped_;
 
  private:
   void AddStream(fs::FileSystem* fs, const std::shared_ptr<BinaryInStream>& stream, int64_t idx);
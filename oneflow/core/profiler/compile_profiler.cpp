@@ -0,0 +1,176 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/compile_profiler.h"
+#include <unistd.h>
+#include <atomic>
+#include <fstream>
+#include <json.hpp>
+#include "oneflow/core/persistence/tee_persistent_log_stream.h"
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace {
+
+thread_local int64_t compile_profile_depth = 0;
+
+int64_t GetResidentMemoryBytes() {
+  int64_t vm_pages = 0;
+  int64_t rss_pages = 0;
+  std::ifstream ifs("/proc/self/statm");
+  ifs >> vm_pages >> rss_pages;
+  return rss_pages * sysconf(_SC_PAGE_SIZE);
+}
+
+int64_t GetPeakResidentMemoryBytes() {
+  std::ifstream ifs("/proc/self/status");
+  std::string line;
+  while (std::getline(ifs, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) { return std::stoll(line.substr(6)) * 1024; }
+  }
+  return 0;
+}
+
+int64_t NextRecordSeq() {
+  static std::atomic<int64_t> seq(0);
+  return seq++;
+}
+
+std::string FormatRecord(const CompileProfileRecord& record) {
+  std::stringstream ss;
+  ss << record.category << " " << record.name << ": " << record.seconds << "s, rss delta "
+     << (record.rss_end - record.rss_begin) / 1048576.0 << "MiB";
+  if (record.op_num_before >= 0) {
+    ss << ", ops " << record.op_num_before << " -> " << record.op_num_after;
+  }
+  if (record.node_num >= 0) {
+    ss << ", nodes " << record.node_num << ", edges " << record.edge_num;
+  }
+  return ss.str();
+}
+
+}  // namespace
+
+bool IsCompileProfilerEnabled() {
+  static const bool enabled = ParseBooleanFromEnv("ONEFLOW_PROFILE_COMPILATION", false);
+  return enabled;
+}
+
+CompileProfiler* CompileProfiler::Get() {
+  static CompileProfiler profiler;
+  return &profiler;
+}
+
+void CompileProfiler::AddRecord(int64_t job_id, CompileProfileRecord&& record) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  job_id2records_[job_id].push_back(std::move(record));
+}
+
+void CompileProfiler::Report(int64_t job_id, const std::string& job_name) {
+  if (!IsCompileProfilerEnabled()) { return; }
+  std::vector<CompileProfileRecord> records;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = job_id2records_.find(job_id);
+    if (it == job_id2records_.end()) { return; }
+    records.swap(it->second);
+    job_id2records_.erase(it);
+  }
+  std::sort(records.begin(), records.end(),
+            [](const CompileProfileRecord& lhs, const CompileProfileRecord& rhs) {
+              return lhs.seq < rhs.seq;
+            });
+  double total_seconds = 0.0;
+  int64_t peak_rss = 0;
+  nlohmann::json json_records = nlohmann::json::array();
+  for (const auto& record : records) {
+    if (record.depth == 0) { total_seconds += record.seconds; }
+    peak_rss = std::max(peak_rss, record.peak_rss);
+    nlohmann::json json_record;
+    json_record["category"] = record.category;
+    json_record["name"] = record.name;
+    json_record["depth"] = record.depth;
+    json_record["seconds"] = record.seconds;
+    json_record["rss_begin_bytes"] = record.rss_begin;
+    json_record["rss_end_bytes"] = record.rss_end;
+    json_record["peak_rss_bytes"] = record.peak_rss;
+    if (record.op_num_before >= 0) {
+      json_record["op_num_before"] = record.op_num_before;
+      json_record["op_num_after"] = record.op_num_after;
+    }
+    if (record.node_num >= 0) {
+      json_record["node_num"] = record.node_num;
+      json_record["edge_num"] = record.edge_num;
+    }
+    json_records.push_back(json_record);
+  }
+  nlohmann::json report;
+  report["job_id"] = job_id;
+  report["job_name"] = job_name;
+  report["total_seconds"] = total_seconds;
+  report["peak_rss_bytes"] = peak_rss;
+  report["records"] = json_records;
+  TeePersistentLogStream::Create("compile_profile_" + job_name + ".json")->Write(report.dump(2));
+
+  std::vector<const CompileProfileRecord*> slowest;
+  for (const auto& record : records) { slowest.push_back(&record); }
+  std::sort(slowest.begin(), slowest.end(),
+            [](const CompileProfileRecord* lhs, const CompileProfileRecord* rhs) {
+              return lhs->seconds > rhs->seconds;
+            });
+  const size_t top_n =
+      std::max<int64_t>(ParseIntegerFromEnv("ONEFLOW_PROFILE_COMPILATION_TOP_N", 10), 0);
+  if (slowest.size() > top_n) { slowest.resize(top_n); }
+  std::stringstream ss;
+  ss << "\nCompile profile of job_id: " << job_id << " , job_name: " << job_name
+     << " , total time: " << total_seconds << "s, peak rss: " << peak_rss / 1048576.0
+     << "MiB, slowest " << slowest.size() << " passes and phases:";
+  for (const auto* record : slowest) { ss << "\n  " << FormatRecord(*record); }
+  LOG(INFO) << ss.str();
+}
+
+CompileProfileGuard::CompileProfileGuard(int64_t job_id, const std::string& category,
+                                         const std::string& name, const Job* job)
+    : enabled_(IsCompileProfilerEnabled()), job_id_(job_id), job_(job), start_(0.0) {
+  if (!enabled_) { return; }
+  record_.category = category;
+  record_.name = name;
+  record_.seq = NextRecordSeq();
+  record_.depth = compile_profile_depth++;
+  record_.rss_begin = GetResidentMemoryBytes();
+  if (job_ != nullptr) { record_.op_num_before = job_->net().op_size(); }
+  start_ = GetCurTime();
+}
+
+CompileProfileGuard::~CompileProfileGuard() {
+  if (!enabled_) { return; }
+  record_.seconds = (GetCurTime() - start_) / 1e9;
+  record_.rss_end = GetResidentMemoryBytes();
+  record_.peak_rss = GetPeakResidentMemoryBytes();
+  if (job_ != nullptr) { record_.op_num_after = job_->net().op_size(); }
+  --compile_profile_depth;
+  CompileProfiler::Get()->AddRecord(job_id_, std::move(record_));
+}
+
+void CompileProfileGuard::SetGraphSize(int64_t node_num, int64_t edge_num) {
+  record_.node_num = node_num;
+  record_.edge_num = edge_num;
+}
+
+}  // namespace profiler
+
+}  // namespace oneflow
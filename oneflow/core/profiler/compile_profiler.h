@@ -0,0 +1,92 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PROFILER_COMPILE_PROFILER_H_
+#define ONEFLOW_CORE_PROFILER_COMPILE_PROFILER_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/job/job.pb.h"
+
+namespace oneflow {
+
+namespace profiler {
+
+struct CompileProfileRecord {
+  // "pass" for the job passes and "phase" for the other compilation steps.
+  std::string category;
+  std::string name;
+  // Records are ordered by `seq` which is the order they begin in.
+  int64_t seq = 0;
+  int64_t depth = 0;
+  double seconds = 0.0;
+  // Resident memory of the process in bytes.
+  int64_t rss_begin = 0;
+  int64_t rss_end = 0;
+  int64_t peak_rss = 0;
+  // Op number of the job before and after the pass, -1 means unknown.
+  int64_t op_num_before = -1;
+  int64_t op_num_after = -1;
+  // Graph size of the phase building OpGraph or TaskGraph, -1 means unknown.
+  int64_t node_num = -1;
+  int64_t edge_num = -1;
+};
+
+// It is enabled by the environment variable ONEFLOW_PROFILE_COMPILATION.
+bool IsCompileProfilerEnabled();
+
+class CompileProfiler final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CompileProfiler);
+  ~CompileProfiler() = default;
+
+  static CompileProfiler* Get();
+
+  void AddRecord(int64_t job_id, CompileProfileRecord&& record);
+
+  // Writes all the records of the job into `compile_profile_<job_name>.json` under the log
+  // directory, logs a summary with the slowest passes and phases, then clears the records.
+  // The number of the slowest ones is set by ONEFLOW_PROFILE_COMPILATION_TOP_N.
+  void Report(int64_t job_id, const std::string& job_name);
+
+ private:
+  CompileProfiler() = default;
+
+  std::mutex mutex_;
+  HashMap<int64_t, std::vector<CompileProfileRecord>> job_id2records_;
+};
+
+class CompileProfileGuard final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CompileProfileGuard);
+  // The op number of `job` is recorded before and after the guarded scope if it is given.
+  CompileProfileGuard(int64_t job_id, const std::string& category, const std::string& name,
+                      const Job* job = nullptr);
+  ~CompileProfileGuard();
+
+  void SetGraphSize(int64_t node_num, int64_t edge_num);
+
+ private:
+  bool enabled_;
+  int64_t job_id_;
+  const Job* job_;
+  double start_;
+  CompileProfileRecord record_;
+};
+
+}  // namespace profiler
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PROFILER_COMPILE_PROFILER_H_
@@ -42,6 +42,9 @@ class BatchDataset final : public Dataset<LoadTarget> {
     return ret;
   }
 
+  bool SaveState(DatasetState* state) const override { return loader_->SaveState(state); }
+  void LoadState(const DatasetState& state) override { loader_->LoadState(state); }
+
  private:
   int32_t batch_size_;
   std::unique_ptr<Dataset<LoadTarget>> loader_;
@@ -0,0 +1,44 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_COLUMNAR_DATA_READER_H_
+#define ONEFLOW_USER_DATA_COLUMNAR_DATA_READER_H_
+
+#include "oneflow/user/data/data_reader.h"
+#include "oneflow/user/data/columnar_dataset.h"
+#include "oneflow/user/data/columnar_parser.h"
+
+namespace oneflow {
+namespace data {
+
+class ColumnarDataReader final : public DataReader<ColumnarBatch> {
+ public:
+  ColumnarDataReader(user_op::KernelInitContext* ctx) : DataReader<ColumnarBatch>(ctx) {
+    const int64_t batch_size = ctx->TensorDesc4ArgNameAndIndex("out", 0)->shape().At(0);
+    loader_.reset(new ColumnarDataset(ctx, batch_size));
+    parser_.reset(new ColumnarParser());
+    StartLoadThread();
+  }
+  ~ColumnarDataReader() = default;
+
+ protected:
+  using DataReader<ColumnarBatch>::loader_;
+  using DataReader<ColumnarBatch>::parser_;
+};
+
+}  // namespace data
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_COLUMNAR_DATA_READER_H_
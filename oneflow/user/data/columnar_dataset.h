@@ -0,0 +1,178 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_COLUMNAR_DATASET_H_
+#define ONEFLOW_USER_DATA_COLUMNAR_DATASET_H_
+
+#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/common/multi_client.h"
+#include "oneflow/core/framework/op_kernel.h"
+#include "oneflow/core/job/job_set.pb.h"
+#include "oneflow/core/rpc/include/global_process_ctx.h"
+#include "oneflow/core/thread/thread_manager.h"
+#include "oneflow/user/data/columnar_file.h"
+#include "oneflow/user/data/dataset.h"
+
+namespace oneflow {
+namespace data {
+
+// A batch of rows of the requested columns, each column holding the values of the rows back to
+// back, in the layout of the output blob.
+struct ColumnarBatch {
+  int64_t num_rows = 0;
+  std::vector<std::vector<char>> columns;
+};
+
+// Reads the requested columns of the files of this rank row group by row group. The chunks of a
+// row group are read in parallel, one task per column, and the other columns are skipped.
+class ColumnarDataset final : public Dataset<ColumnarBatch> {
+ public:
+  using LoadTargetPtr = std::shared_ptr<ColumnarBatch>;
+  using LoadTargetPtrList = std::vector<LoadTargetPtr>;
+  OF_DISALLOW_COPY_AND_MOVE(ColumnarDataset);
+  ColumnarDataset(user_op::KernelInitContext* ctx, int64_t batch_size)
+      : ColumnarDataset(DataFS(), ctx->Attr<std::vector<std::string>>("files"),
+                        ctx->Attr<std::vector<std::string>>("columns"),
+                        ctx->Attr<std::vector<Shape>>("shapes"),
+                        ctx->Attr<std::vector<DataType>>("data_types"), batch_size,
+                        ctx->Attr<bool>("shuffle_after_epoch"),
+                        IsLocal(ctx) ? GlobalProcessCtx::Rank() : ctx->parallel_ctx().parallel_id(),
+                        IsLocal(ctx) ? GlobalProcessCtx::WorldSize()
+                                     : ctx->parallel_ctx().parallel_num()) {}
+  ColumnarDataset(fs::FileSystem* fs, const std::vector<std::string>& files,
+                  const std::vector<std::string>& columns, const std::vector<Shape>& shapes,
+                  const std::vector<DataType>& data_types, int64_t batch_size,
+                  bool shuffle_after_epoch, int64_t parallel_id, int64_t parallel_num)
+      : fs_(fs),
+        batch_size_(batch_size),
+        current_epoch_(0),
+        shuffle_after_epoch_(shuffle_after_epoch),
+        data_file_paths_(files),
+        column_names_(columns),
+        shapes_(shapes),
+        data_types_(data_types),
+        file_pos_(-1),
+        row_group_(0),
+        row_pos_(0) {
+    CHECK_EQ(shapes_.size(), column_names_.size());
+    CHECK_EQ(data_types_.size(), column_names_.size());
+    for (size_t i = 0; i < column_names_.size(); ++i) {
+      value_sizes_.push_back(shapes_.at(i).elem_cnt() * GetSizeOfDataType(data_types_.at(i)));
+    }
+    CHECK_LE(parallel_num, static_cast<int64_t>(data_file_paths_.size()));
+    range_ = BalancedSplitter(data_file_paths_.size(), parallel_num).At(parallel_id);
+    chunks_.resize(column_names_.size());
+    NextRowGroup();
+  }
+  ~ColumnarDataset() = default;
+
+  LoadTargetPtrList Next() override {
+    LoadTargetPtr batch(new ColumnarBatch());
+    batch->num_rows = batch_size_;
+    batch->columns.resize(column_names_.size());
+    FOR_RANGE(size_t, i, 0, column_names_.size()) {
+      batch->columns.at(i).resize(batch_size_ * value_sizes_.at(i));
+    }
+    int64_t filled = 0;
+    while (filled < batch_size_) {
+      if (row_pos_ == file_->num_rows(row_group_)) {
+        NextRowGroup();
+        continue;
+      }
+      const int64_t n = std::min(batch_size_ - filled, file_->num_rows(row_group_) - row_pos_);
+      MultiThreadLoop(column_names_.size(), [&](size_t i) {
+        const int64_t value_size = value_sizes_.at(i);
+        std::memcpy(batch->columns.at(i).data() + filled * value_size,
+                    chunks_.at(i).data + row_pos_ * value_size, n * value_size);
+      });
+      filled += n;
+      row_pos_ += n;
+    }
+    LoadTargetPtrList ret;
+    ret.push_back(std::move(batch));
+    return ret;
+  }
+
+ private:
+  // Like OFRecordDataset, the reader is not consistent if nd_sbp is empty, and we assume that it
+  // works in DDP, where every rank reads its own files.
+  static bool IsLocal(user_op::KernelInitContext* ctx) {
+    return ctx->Attr<std::vector<std::string>>("nd_sbp").empty() && CHECK_JUST(IsMultiClient());
+  }
+
+  void NextRowGroup() {
+    row_pos_ = 0;
+    row_group_ += 1;
+    // Empty row groups are skipped, ColumnarFile rejects the files without any row.
+    while (true) {
+      if (!file_ || row_group_ >= file_->num_row_groups()) {
+        NextFile();
+        row_group_ = 0;
+      }
+      if (file_->num_rows(row_group_) > 0) { break; }
+      row_group_ += 1;
+    }
+    MultiThreadLoop(column_names_.size(), [&](size_t i) {
+      file_->ReadChunk(row_group_, column_ids_.at(i), &chunks_.at(i));
+    });
+  }
+
+  void NextFile() {
+    file_pos_ += 1;
+    if (file_pos_ == range_.size()) {
+      current_epoch_ += 1;
+      file_pos_ = 0;
+      if (shuffle_after_epoch_) {
+        std::mt19937 g(kOneflowDatasetSeed + current_epoch_);
+        std::shuffle(data_file_paths_.begin(), data_file_paths_.end(), g);
+      }
+    }
+    file_.reset(new ColumnarFile(fs_, data_file_paths_.at(range_.begin() + file_pos_)));
+    column_ids_.clear();
+    FOR_RANGE(size_t, i, 0, column_names_.size()) {
+      const int64_t column_id = file_->ColumnIndex(column_names_.at(i));
+      CHECK_GE(column_id, 0) << "no column " << column_names_.at(i) << " in " << file_->path();
+      const ColumnarColumnMeta& column = file_->meta().column(column_id);
+      CHECK_EQ(column.data_type(), data_types_.at(i))
+          << "unexpected data type of column " << column.name() << " in " << file_->path();
+      CHECK(Shape(column.shape()) == shapes_.at(i))
+          << "unexpected shape of column " << column.name() << " in " << file_->path();
+      column_ids_.push_back(column_id);
+    }
+  }
+
+  fs::FileSystem* fs_;
+  int64_t batch_size_;
+  int32_t current_epoch_;
+  bool shuffle_after_epoch_;
+  std::vector<std::string> data_file_paths_;
+  Range range_;
+  std::vector<std::string> column_names_;
+  std::vector<Shape> shapes_;
+  std::vector<DataType> data_types_;
+  std::vector<int64_t> value_sizes_;
+
+  int64_t file_pos_;
+  std::unique_ptr<ColumnarFile> file_;
+  std::vector<int64_t> column_ids_;
+  int64_t row_group_;
+  int64_t row_pos_;
+  std::vector<ColumnarChunk> chunks_;
+};
+
+}  // namespace data
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_COLUMNAR_DATASET_H_
@@ -0,0 +1,311 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/core/common/global.h"
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/persistence/posix/posix_file_system.h"
+#include "oneflow/core/thread/thread_pool.h"
+#include "oneflow/user/data/columnar_dataset.h"
+
+namespace oneflow {
+
+namespace data {
+
+namespace test {
+
+namespace {
+
+struct TestColumn {
+  std::string name;
+  DataType data_type;
+  Shape shape;
+};
+
+const std::vector<TestColumn> kColumns = {
+    {"a", DataType::kFloat, Shape({2})},
+    {"b", DataType::kInt64, Shape({1})},
+    {"c", DataType::kInt32, Shape({3})},
+};
+
+// The e-th element of the value of column `column` at row `row` of all the files.
+template<typename T>
+T Value(int64_t column, int64_t row, int64_t e) {
+  return static_cast<T>(column * 100000 + row * 10 + e);
+}
+
+void AppendValue(const TestColumn& column, int64_t column_id, int64_t row, std::string* dst) {
+  FOR_RANGE(int64_t, e, 0, column.shape.elem_cnt()) {
+    if (column.data_type == DataType::kFloat) {
+      const float value = Value<float>(column_id, row, e);
+      dst->append(reinterpret_cast<const char*>(&value), sizeof(value));
+    } else if (column.data_type == DataType::kInt64) {
+      const int64_t value = Value<int64_t>(column_id, row, e);
+      dst->append(reinterpret_cast<const char*>(&value), sizeof(value));
+    } else {
+      CHECK(column.data_type == DataType::kInt32);
+      const int32_t value = Value<int32_t>(column_id, row, e);
+      dst->append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+  }
+}
+
+// The byte ranges of the chunks of a file, by row group and then by column.
+using ChunkRanges = std::vector<std::vector<std::pair<int64_t, int64_t>>>;
+
+// Writes a columnar file whose row groups hold `row_group_num_rows` rows, starting from the row
+// `first_row` of all the files.
+ChunkRanges WriteColumnarFile(fs::FileSystem* fs, const std::string& path,
+                              const std::vector<int64_t>& row_group_num_rows, int64_t first_row) {
+  std::string content(ColumnarFile::kMagicCode, ColumnarFile::kMagicCodeLen);
+  ColumnarFileMeta meta;
+  for (const TestColumn& column : kColumns) {
+    ColumnarColumnMeta* column_meta = meta.add_column();
+    column_meta->set_name(column.name);
+    column_meta->set_data_type(column.data_type);
+    column.shape.ToProto(column_meta->mutable_shape());
+  }
+  ChunkRanges chunk_ranges;
+  int64_t row = first_row;
+  for (const int64_t num_rows : row_group_num_rows) {
+    ColumnarRowGroupMeta* row_group = meta.add_row_group();
+    row_group->set_num_rows(num_rows);
+    chunk_ranges.emplace_back();
+    FOR_RANGE(size_t, column_id, 0, kColumns.size()) {
+      const int64_t offset = content.size();
+      FOR_RANGE(int64_t, i, 0, num_rows) {
+        AppendValue(kColumns.at(column_id), column_id, row + i, &content);
+      }
+      ColumnarChunkMeta* chunk = row_group->add_chunk();
+      chunk->set_offset(offset);
+      chunk->set_size(content.size() - offset);
+      chunk_ranges.back().emplace_back(offset, content.size() - offset);
+    }
+    row += num_rows;
+  }
+  const std::string meta_str = meta.SerializeAsString();
+  const int64_t meta_size = meta_str.size();
+  content.append(meta_str);
+  content.append(reinterpret_cast<const char*>(&meta_size), sizeof(meta_size));
+  content.append(ColumnarFile::kMagicCode, ColumnarFile::kMagicCodeLen);
+  std::unique_ptr<fs::WritableFile> file;
+  fs->NewWritableFile(path, &file);
+  file->Append(content.data(), content.size());
+  file->Close();
+  return chunk_ranges;
+}
+
+// Records the byte ranges read or mapped from the files of a POSIX file system.
+class RecordingFileSystem final : public fs::FileSystem {
+ public:
+  struct Access {
+    std::string path;
+    int64_t offset;
+    int64_t size;
+  };
+
+  explicit RecordingFileSystem(bool use_mmap) : base_(use_mmap, false) {}
+
+  void NewRandomAccessFile(const std::string& fname,
+                           std::unique_ptr<fs::RandomAccessFile>* result) override {
+    std::unique_ptr<fs::RandomAccessFile> file;
+    base_.NewRandomAccessFile(fname, &file);
+    result->reset(new RecordingFile(this, fname, std::move(file)));
+  }
+  void NewWritableFile(const std::string& fname,
+                       std::unique_ptr<fs::WritableFile>* result) override {
+    base_.NewWritableFile(fname, result);
+  }
+  void NewAppendableFile(const std::string& fname,
+                         std::unique_ptr<fs::WritableFile>* result) override {
+    base_.NewAppendableFile(fname, result);
+  }
+  bool FileExists(const std::string& fname) override { return base_.FileExists(fname); }
+  std::vector<std::string> ListDir(const std::string& dir) override { return base_.ListDir(dir); }
+  void DelFile(const std::string& fname) override { base_.DelFile(fname); }
+  void CreateDir(const std::string& dirname) override { base_.CreateDir(dirname); }
+  void DeleteDir(const std::string& dirname) override { base_.DeleteDir(dirname); }
+  uint64_t GetFileSize(const std::string& fname) override { return base_.GetFileSize(fname); }
+  void RenameFile(const std::string& old_name, const std::string& new_name) override {
+    base_.RenameFile(old_name, new_name);
+  }
+  bool IsDirectory(const std::string& fname) override { return base_.IsDirectory(fname); }
+
+  std::vector<Access> accesses() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return accesses_;
+  }
+
+ private:
+  class RecordingFile final : public fs::RandomAccessFile {
+   public:
+    RecordingFile(RecordingFileSystem* fs, const std::string& path,
+                  std::unique_ptr<fs::RandomAccessFile>&& file)
+        : fs_(fs), path_(path), file_(std::move(file)) {}
+
+    void Read(uint64_t offset, size_t n, char* result) const override {
+      fs_->Record(path_, offset, n);
+      file_->Read(offset, n, result);
+    }
+    const char* MappedData(uint64_t offset, size_t n) const override {
+      fs_->Record(path_, offset, n);
+      return file_->MappedData(offset, n);
+    }
+
+   private:
+    RecordingFileSystem* fs_;
+    std::string path_;
+    std::unique_ptr<fs::RandomAccessFile> file_;
+  };
+
+  void Record(const std::string& path, int64_t offset, int64_t size) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    accesses_.push_back(Access{path, offset, size});
+  }
+
+  fs::PosixFileSystem base_;
+  mutable std::mutex mutex_;
+  std::vector<Access> accesses_;
+};
+
+// Row groups of different sizes, an empty one among them, so that batches span the row groups
+// and the files.
+const std::vector<std::vector<int64_t>> kFileRowGroups = {{3, 0, 4}, {5}, {2, 2}};
+// Columns "c" and "a" are read in this order, "b" is not.
+const std::vector<int64_t> kRequestedColumns = {2, 0};
+constexpr int64_t kUnrequestedColumn = 1;
+
+class ColumnarDatasetTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    // the chunks and the batch columns are handled by MultiThreadLoop
+    Global<ThreadPool>::New(4);
+    std::string current_dir = GetCwd();
+    StringReplace(&current_dir, '\\', '/');
+    dir_ = JoinPath(current_dir, "tmp_columnar_dataset_test_dir");
+    fs_.RecursivelyCreateDirIfNotExist(dir_);
+    int64_t first_row = 0;
+    FOR_RANGE(size_t, i, 0, kFileRowGroups.size()) {
+      paths_.push_back(JoinPath(dir_, "part-" + std::to_string(i)));
+      chunk_ranges_.push_back(WriteColumnarFile(&fs_, paths_.back(), kFileRowGroups.at(i),
+                                                first_row));
+      file_first_rows_.push_back(first_row);
+      for (const int64_t num_rows : kFileRowGroups.at(i)) { first_row += num_rows; }
+    }
+    file_first_rows_.push_back(first_row);
+  }
+  void TearDown() override {
+    fs_.RecursivelyDeleteDir(dir_);
+    Global<ThreadPool>::Delete();
+  }
+
+  std::unique_ptr<ColumnarDataset> NewDataset(fs::FileSystem* fs, int64_t batch_size,
+                                              int64_t parallel_id, int64_t parallel_num) const {
+    std::vector<std::string> columns;
+    std::vector<Shape> shapes;
+    std::vector<DataType> data_types;
+    for (const int64_t column_id : kRequestedColumns) {
+      columns.push_back(kColumns.at(column_id).name);
+      shapes.push_back(kColumns.at(column_id).shape);
+      data_types.push_back(kColumns.at(column_id).data_type);
+    }
+    return std::make_unique<ColumnarDataset>(fs, paths_, columns, shapes, data_types, batch_size,
+                                             false, parallel_id, parallel_num);
+  }
+
+  // Checks that the batches hold the rows of the files [file_begin, file_end) again and again.
+  void CheckBatches(ColumnarDataset* dataset, int64_t batch_size, int64_t num_batches,
+                    size_t file_begin, size_t file_end) const {
+    const int64_t first_row = file_first_rows_.at(file_begin);
+    const int64_t num_rows = file_first_rows_.at(file_end) - first_row;
+    FOR_RANGE(int64_t, batch_id, 0, num_batches) {
+      const auto batches = dataset->Next();
+      ASSERT_EQ(batches.size(), 1);
+      const ColumnarBatch& batch = *batches.front();
+      ASSERT_EQ(batch.num_rows, batch_size);
+      ASSERT_EQ(batch.columns.size(), kRequestedColumns.size());
+      FOR_RANGE(size_t, i, 0, kRequestedColumns.size()) {
+        const int64_t column_id = kRequestedColumns.at(i);
+        std::string expected;
+        FOR_RANGE(int64_t, j, 0, batch_size) {
+          const int64_t row = first_row + (batch_id * batch_size + j) % num_rows;
+          AppendValue(kColumns.at(column_id), column_id, row, &expected);
+        }
+        ASSERT_EQ(std::string(batch.columns.at(i).data(), batch.columns.at(i).size()), expected)
+            << "batch " << batch_id << ", column " << kColumns.at(column_id).name;
+      }
+    }
+  }
+
+  // Checks that no byte of the chunks of the unrequested column was read or mapped.
+  void CheckUnrequestedChunksNotRead(const RecordingFileSystem& fs) const {
+    const std::vector<RecordingFileSystem::Access> accesses = fs.accesses();
+    ASSERT_FALSE(accesses.empty());
+    for (const auto& access : accesses) {
+      const size_t file_id = std::find(paths_.begin(), paths_.end(), access.path) - paths_.begin();
+      ASSERT_LT(file_id, paths_.size());
+      for (const auto& row_group_ranges : chunk_ranges_.at(file_id)) {
+        const auto& range = row_group_ranges.at(kUnrequestedColumn);
+        const bool overlaps = access.offset < range.first + range.second
+                              && range.first < access.offset + access.size;
+        ASSERT_FALSE(overlaps) << "read [" << access.offset << ", "
+                               << access.offset + access.size << ") of " << access.path;
+      }
+    }
+  }
+
+  fs::PosixFileSystem fs_;
+  std::string dir_;
+  std::vector<std::string> paths_;
+  std::vector<ChunkRanges> chunk_ranges_;
+  std::vector<int64_t> file_first_rows_;
+};
+
+}  // namespace
+
+TEST_F(ColumnarDatasetTest, read_requested_columns) {
+  for (const bool use_mmap : {false, true}) {
+    for (const int64_t batch_size : {1, 4, 7}) {
+      RecordingFileSystem fs(use_mmap);
+      const auto dataset = NewDataset(&fs, batch_size, 0, 1);
+      // more than two epochs
+      CheckBatches(dataset.get(), batch_size, 40 / batch_size + 1, 0, paths_.size());
+      CheckUnrequestedChunksNotRead(fs);
+    }
+  }
+}
+
+TEST_F(ColumnarDatasetTest, split_files_by_rank) {
+  // the first rank reads the first two files, the second one the last file
+  RecordingFileSystem fs(false);
+  CheckBatches(NewDataset(&fs, 3, 0, 2).get(), 3, 10, 0, 2);
+  CheckBatches(NewDataset(&fs, 3, 1, 2).get(), 3, 10, 2, 3);
+  CheckUnrequestedChunksNotRead(fs);
+}
+
+TEST_F(ColumnarDatasetTest, reject_empty_file) {
+  const std::string path = JoinPath(dir_, "empty");
+  WriteColumnarFile(&fs_, path, {0, 0}, 0);
+  ASSERT_DEATH({ ColumnarFile file(&fs_, path); }, "has no rows");
+  WriteColumnarFile(&fs_, path, {}, 0);
+  ASSERT_DEATH({ ColumnarFile file(&fs_, path); }, "has no rows");
+}
+
+}  // namespace test
+
+}  // namespace data
+
+}  // namespace oneflow
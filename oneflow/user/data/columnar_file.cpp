@@ -0,0 +1,89 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/columnar_file.h"
+#include <cstring>
+#include "oneflow/core/common/shape.h"
+
+namespace oneflow {
+
+namespace data {
+
+constexpr char ColumnarFile::kMagicCode[];
+
+ColumnarFile::ColumnarFile(fs::FileSystem* fs, const std::string& path) : path_(path) {
+  const int64_t file_size = fs->GetFileSize(path);
+  const int64_t magic_size = kMagicCodeLen;
+  const int64_t tail_size = sizeof(int64_t) + magic_size;
+  CHECK_GE(file_size, magic_size + tail_size) << "invalid columnar file " << path;
+  fs->NewRandomAccessFile(path, &file_);
+  char head[kMagicCodeLen];
+  file_->Read(0, kMagicCodeLen, head);
+  CHECK_EQ(std::memcmp(head, kMagicCode, kMagicCodeLen), 0) << "invalid columnar file " << path;
+  std::vector<char> tail(tail_size);
+  file_->Read(file_size - tail_size, tail_size, tail.data());
+  CHECK_EQ(std::memcmp(tail.data() + sizeof(int64_t), kMagicCode, kMagicCodeLen), 0)
+      << "invalid columnar file " << path;
+  int64_t meta_size = -1;
+  std::memcpy(&meta_size, tail.data(), sizeof(int64_t));
+  CHECK_GE(meta_size, 0);
+  CHECK_LE(magic_size + meta_size + tail_size, file_size) << "invalid columnar file " << path;
+  std::vector<char> meta(meta_size);
+  file_->Read(file_size - tail_size - meta_size, meta_size, meta.data());
+  CHECK(meta_.ParseFromArray(meta.data(), meta_size)) << "invalid columnar file " << path;
+  const int64_t data_end = file_size - tail_size - meta_size;
+  int64_t total_num_rows = 0;
+  for (const ColumnarRowGroupMeta& row_group : meta_.row_group()) {
+    CHECK_GE(row_group.num_rows(), 0) << "invalid columnar file " << path;
+    total_num_rows += row_group.num_rows();
+    CHECK_EQ(row_group.chunk_size(), meta_.column_size());
+    FOR_RANGE(int64_t, i, 0, meta_.column_size()) {
+      const ColumnarChunkMeta& chunk = row_group.chunk(i);
+      const ColumnarColumnMeta& column = meta_.column(i);
+      const int64_t value_size =
+          Shape(column.shape()).elem_cnt() * GetSizeOfDataType(column.data_type());
+      CHECK_EQ(chunk.size(), row_group.num_rows() * value_size)
+          << "unexpected chunk size of column " << column.name() << " in " << path;
+      CHECK_GE(chunk.offset(), magic_size);
+      CHECK_LE(chunk.offset() + chunk.size(), data_end);
+    }
+  }
+  // the dataset would look for a row forever in a file without any
+  CHECK_GT(total_num_rows, 0) << "columnar file " << path << " has no rows";
+}
+
+int64_t ColumnarFile::ColumnIndex(const std::string& name) const {
+  FOR_RANGE(int64_t, i, 0, meta_.column_size()) {
+    if (meta_.column(i).name() == name) { return i; }
+  }
+  return -1;
+}
+
+void ColumnarFile::ReadChunk(int64_t row_group, int64_t column, ColumnarChunk* chunk) const {
+  const ColumnarChunkMeta& chunk_meta = meta_.row_group(row_group).chunk(column);
+  chunk->size = chunk_meta.size();
+  chunk->data = file_->MappedData(chunk_meta.offset(), chunk_meta.size());
+  if (chunk->data == nullptr) {
+    chunk->buffer.resize(chunk_meta.size());
+    file_->Read(chunk_meta.offset(), chunk_meta.size(), chunk->buffer.data());
+    chunk->data = chunk->buffer.data();
+  } else {
+    chunk->buffer.clear();
+  }
+}
+
+}  // namespace data
+
+}  // namespace oneflow
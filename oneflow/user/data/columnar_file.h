@@ -0,0 +1,66 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_COLUMNAR_FILE_H_
+#define ONEFLOW_USER_DATA_COLUMNAR_FILE_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/persistence/file_system.h"
+#include "oneflow/user/data/columnar_format.pb.h"
+
+namespace oneflow {
+
+namespace data {
+
+// The values of a column in a row group. `data` points into the file itself if it is memory
+// mapped, otherwise into `buffer`.
+struct ColumnarChunk {
+  const char* data = nullptr;
+  int64_t size = 0;
+  std::vector<char> buffer;
+};
+
+// A columnar data file, see columnar_format.proto. Only the footer is read on opening, the
+// chunks are read on demand, so the columns which are not asked for are never read.
+class ColumnarFile final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ColumnarFile);
+  ColumnarFile(fs::FileSystem* fs, const std::string& path);
+  ~ColumnarFile() = default;
+
+  static constexpr char kMagicCode[] = "OFCOLUMN";
+  static constexpr size_t kMagicCodeLen = sizeof(kMagicCode) - 1;
+
+  const ColumnarFileMeta& meta() const { return meta_; }
+  const std::string& path() const { return path_; }
+  int64_t num_row_groups() const { return meta_.row_group_size(); }
+  int64_t num_rows(int64_t row_group) const { return meta_.row_group(row_group).num_rows(); }
+  // Returns the index of the column named `name`, -1 if there is no such column.
+  int64_t ColumnIndex(const std::string& name) const;
+
+  // Safe for concurrent use by multiple threads.
+  void ReadChunk(int64_t row_group, int64_t column, ColumnarChunk* chunk) const;
+
+ private:
+  std::string path_;
+  std::unique_ptr<fs::RandomAccessFile> file_;
+  ColumnarFileMeta meta_;
+};
+
+}  // namespace data
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_COLUMNAR_FILE_H_
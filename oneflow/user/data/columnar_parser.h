@@ -0,0 +1,52 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_COLUMNAR_PARSER_H_
+#define ONEFLOW_USER_DATA_COLUMNAR_PARSER_H_
+
+#include "oneflow/user/data/parser.h"
+#include "oneflow/user/data/columnar_dataset.h"
+#include "oneflow/core/thread/thread_manager.h"
+
+namespace oneflow {
+namespace data {
+
+// Copies the columns of a batch into the output blobs, one blob for each column.
+class ColumnarParser final : public Parser<ColumnarBatch> {
+ public:
+  using LoadTargetPtr = std::shared_ptr<ColumnarBatch>;
+  using LoadTargetPtrList = std::vector<LoadTargetPtr>;
+  ColumnarParser() = default;
+  ~ColumnarParser() = default;
+
+  void Parse(std::shared_ptr<LoadTargetPtrList> batch_data,
+             user_op::KernelComputeContext* ctx) override {
+    CHECK_EQ(batch_data->size(), 1);
+    const ColumnarBatch& batch = *batch_data->front();
+    MultiThreadLoop(batch.columns.size(), [&](size_t i) {
+      user_op::Tensor* out_tensor = ctx->Tensor4ArgNameAndIndex("out", i);
+      const std::vector<char>& column = batch.columns.at(i);
+      CHECK_EQ(out_tensor->shape().At(0), batch.num_rows);
+      CHECK_EQ(out_tensor->shape().elem_cnt() * GetSizeOfDataType(out_tensor->data_type()),
+               column.size());
+      std::memcpy(out_tensor->mut_dptr(), column.data(), column.size());
+    });
+  }
+};
+
+}  // namespace data
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_COLUMNAR_PARSER_H_
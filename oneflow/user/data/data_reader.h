@@ -16,9 +16,12 @@ limitations under the License.
 #ifndef ONEFLOW_USER_DATA_DATA_READER_H_
 #define ONEFLOW_USER_DATA_DATA_READER_H_
 
+#include <deque>
 #include "oneflow/core/common/buffer.h"
 #include "oneflow/core/framework/op_kernel.h"
+#include "oneflow/core/rpc/include/global_process_ctx.h"
 #include "oneflow/user/data/dataset.h"
+#include "oneflow/user/data/data_reader_state.h"
 #include "oneflow/user/data/parser.h"
 
 namespace oneflow {
@@ -34,6 +37,7 @@ class DataReader {
   DataReader(user_op::KernelInitContext* ctx)
       : is_closed_(false), batch_buffer_(kDataReaderBatchBufferSize) {}
   virtual ~DataReader() {
+    if (!state_name_.empty()) { DataReaderStateRegistry::Get()->Unregister(state_name_); }
     Close();
     if (load_thrd_.joinable()) { load_thrd_.join(); }
   }
@@ -64,6 +68,29 @@ class DataReader {
     });
   }
 
+  // Makes the reader resumable by DataReaderStateRegistry, and restores the reader if a state
+  // was saved for it. It must be called before StartLoadThread.
+  void RegisterState(user_op::KernelInitContext* ctx) {
+    CHECK(!load_thrd_.joinable());
+    state_name_ = ctx->op_name() + "-" + std::to_string(GlobalProcessCtx::Rank()) + "-"
+                  + std::to_string(ctx->parallel_ctx().parallel_id());
+    DataReaderState state;
+    if (DataReaderStateRegistry::Get()->FindRestoreState(state_name_, &state)) {
+      loader_->LoadState(state.dataset());
+      for (const auto& batch_proto : state.pending_batch()) {
+        std::shared_ptr<LoadTargetPtrList> batch_data = std::make_shared<LoadTargetPtrList>();
+        for (const auto& sample : batch_proto.sample()) {
+          LoadTargetPtr sample_ptr(new LoadTarget());
+          LoadSample(sample, sample_ptr.get());
+          batch_data->push_back(std::move(sample_ptr));
+        }
+        restored_batches_.push_back(std::move(batch_data));
+      }
+    }
+    DataReaderStateRegistry::Get()->Register(
+        state_name_, [this](DataReaderState* state) { return SaveState(state); });
+  }
+
   std::unique_ptr<Dataset<LoadTarget>> loader_;
   std::unique_ptr<Parser<LoadTarget>> parser_;
 
@@ -71,18 +98,56 @@ class DataReader {
   std::shared_ptr<LoadTargetPtrList> FetchBatchData() {
     std::shared_ptr<LoadTargetPtrList> batch_data(nullptr);
     CHECK_EQ(batch_buffer_.Pull(&batch_data), BufferStatus::kBufferStatusSuccess);
+    {
+      std::unique_lock<std::mutex> lock(pending_batches_mutex_);
+      CHECK(!pending_batches_.empty() && pending_batches_.front() == batch_data);
+      pending_batches_.pop_front();
+    }
     return batch_data;
   }
 
   bool LoadBatch() {
-    std::shared_ptr<LoadTargetPtrList> batch_data =
-        std::make_shared<LoadTargetPtrList>(std::move(loader_->Next()));
+    std::shared_ptr<LoadTargetPtrList> batch_data;
+    {
+      std::unique_lock<std::mutex> lock(loader_mutex_);
+      if (restored_batches_.empty()) {
+        batch_data = std::make_shared<LoadTargetPtrList>(std::move(loader_->Next()));
+      } else {
+        batch_data = std::move(restored_batches_.front());
+        restored_batches_.pop_front();
+      }
+      std::unique_lock<std::mutex> pending_lock(pending_batches_mutex_);
+      pending_batches_.push_back(batch_data);
+    }
     return batch_buffer_.Push(batch_data) == BufferStatus::kBufferStatusSuccess;
   }
 
+  // The saved position is the one right after the last consumed batch: the loader stops
+  // between batches, and the batches loaded ahead are saved as pending ones.
+  bool SaveState(DataReaderState* state) {
+    std::unique_lock<std::mutex> lock(loader_mutex_);
+    std::unique_lock<std::mutex> pending_lock(pending_batches_mutex_);
+    if (!loader_->SaveState(state->mutable_dataset())) { return false; }
+    for (const auto* batches : {&pending_batches_, &restored_batches_}) {
+      for (const auto& batch_data : *batches) {
+        SampleListProto* batch_proto = state->add_pending_batch();
+        for (const auto& sample_ptr : *batch_data) {
+          if (!SaveSample(*sample_ptr, batch_proto->add_sample())) { return false; }
+        }
+      }
+    }
+    return true;
+  }
+
   std::atomic<bool> is_closed_;
   Buffer<std::shared_ptr<LoadTargetPtrList>> batch_buffer_;
   std::thread load_thrd_;
+
+  std::string state_name_;
+  std::mutex loader_mutex_;
+  std::deque<std::shared_ptr<LoadTargetPtrList>> restored_batches_;
+  std::mutex pending_batches_mutex_;
+  std::deque<std::shared_ptr<LoadTargetPtrList>> pending_batches_;
 };
 
 }  // namespace data
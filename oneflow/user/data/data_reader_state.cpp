@@ -0,0 +1,99 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/data_reader_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/persistence/file_system.h"
+
+namespace oneflow {
+
+namespace data {
+
+namespace {
+
+std::string StateFilePath(const std::string& dir, const std::string& name) {
+  std::string file_name = name;
+  std::replace(file_name.begin(), file_name.end(), '/', '_');
+  return JoinPath(dir, file_name + ".state");
+}
+
+}  // namespace
+
+DataReaderStateRegistry* DataReaderStateRegistry::Get() {
+  static DataReaderStateRegistry registry;
+  return &registry;
+}
+
+void DataReaderStateRegistry::Register(const std::string& name, const SaveStateFn& save_state_fn) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  CHECK(name2save_state_fn_.emplace(name, save_state_fn).second)
+      << "data reader " << name << " has been registered";
+}
+
+void DataReaderStateRegistry::Unregister(const std::string& name) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  name2save_state_fn_.erase(name);
+}
+
+Maybe<void> DataReaderStateRegistry::SaveAll(const std::string& dir) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  fs::FileSystem* fs = SnapshotFS();
+  fs->RecursivelyCreateDirIfNotExist(dir);
+  for (const auto& pair : name2save_state_fn_) {
+    DataReaderState state;
+    CHECK_OR_RETURN(pair.second(&state)) << "data reader " << pair.first << " can't be resumed";
+    std::string serialized;
+    CHECK_OR_RETURN(state.SerializeToString(&serialized));
+    const std::string file_path = StateFilePath(dir, pair.first);
+    // write into a temporary file first, a crash while saving keeps the former state whole
+    const std::string tmp_file_path = file_path + ".tmp";
+    std::unique_ptr<fs::WritableFile> file;
+    fs->NewWritableFile(tmp_file_path, &file);
+    file->Append(serialized.data(), serialized.size());
+    file->Close();
+    fs->RenameFile(tmp_file_path, file_path);
+  }
+  return Maybe<void>::Ok();
+}
+
+void DataReaderStateRegistry::SetRestoreDir(const std::string& dir) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!name2save_state_fn_.empty()) {
+    LOG(WARNING) << "the data readers already built are not restored from " << dir;
+  }
+  restore_dir_ = dir;
+}
+
+bool DataReaderStateRegistry::FindRestoreState(const std::string& name, DataReaderState* state) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (restore_dir_.empty()) { return false; }
+  fs::FileSystem* fs = SnapshotFS();
+  const std::string file_path = StateFilePath(restore_dir_, name);
+  if (!fs->FileExists(file_path)) {
+    LOG(WARNING) << "no state of data reader " << name << " in " << restore_dir_;
+    return false;
+  }
+  std::string serialized(fs->GetFileSize(file_path), '\0');
+  std::unique_ptr<fs::RandomAccessFile> file;
+  fs->NewRandomAccessFile(file_path, &file);
+  file->Read(0, serialized.size(), &serialized[0]);
+  CHECK(state->ParseFromString(serialized)) << "malformed data reader state " << file_path;
+  LOG(INFO) << "restore data reader " << name << " from " << file_path;
+  return true;
+}
+
+}  // namespace data
+
+}  // namespace oneflow
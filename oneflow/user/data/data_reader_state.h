@@ -0,0 +1,59 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_DATA_READER_STATE_H_
+#define ONEFLOW_USER_DATA_DATA_READER_STATE_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/user/data/data_reader_state.pb.h"
+
+namespace oneflow {
+
+namespace data {
+
+// Tracks the resumable data readers of this process by name, so that their states can be saved
+// alongside model snapshots and restored when the readers are built again after a restart.
+class DataReaderStateRegistry final {
+ public:
+  using SaveStateFn = std::function<bool(DataReaderState*)>;
+
+  OF_DISALLOW_COPY_AND_MOVE(DataReaderStateRegistry);
+  ~DataReaderStateRegistry() = default;
+
+  static DataReaderStateRegistry* Get();
+
+  void Register(const std::string& name, const SaveStateFn& save_state_fn);
+  void Unregister(const std::string& name);
+
+  // Writes the state of every registered reader into "<dir>/<name>.state".
+  Maybe<void> SaveAll(const std::string& dir);
+  // Readers built from now on restore themselves from the states saved in `dir`.
+  void SetRestoreDir(const std::string& dir);
+  bool FindRestoreState(const std::string& name, DataReaderState* state);
+
+ private:
+  DataReaderStateRegistry() = default;
+
+  std::mutex mutex_;
+  HashMap<std::string, SaveStateFn> name2save_state_fn_;
+  std::string restore_dir_;
+};
+
+}  // namespace data
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_DATA_READER_STATE_H_
@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/common/tensor_buffer.h"
+#include "oneflow/user/data/data_reader_state.pb.h"
 
 namespace oneflow {
 namespace data {
@@ -33,8 +34,37 @@ class Dataset {
   virtual ~Dataset() = default;
 
   virtual LoadTargetPtrList Next() = 0;
+
+  // Saves the reading position, so that the dataset restored by LoadState yields the same
+  // samples from there on. Returns false if the dataset can't be resumed.
+  virtual bool SaveState(DatasetState* state) const { return false; }
+  virtual void LoadState(const DatasetState& state) { UNIMPLEMENTED(); }
 };
 
+// Only the samples of the types which have overloads here can be kept in a saved state.
+template<typename LoadTarget>
+bool SaveSample(const LoadTarget& sample, SampleProto* proto) {
+  return false;
+}
+
+template<typename LoadTarget>
+void LoadSample(const SampleProto& proto, LoadTarget* sample) {
+  UNIMPLEMENTED();
+}
+
+inline bool SaveSample(const TensorBuffer& sample, SampleProto* proto) {
+  sample.shape().ToProto(proto->mutable_shape());
+  proto->set_data_type(sample.data_type());
+  proto->set_data(sample.data(), sample.nbytes());
+  return true;
+}
+
+inline void LoadSample(const SampleProto& proto, TensorBuffer* sample) {
+  sample->Resize(Shape(proto.shape()), proto.data_type());
+  CHECK_EQ(sample->nbytes(), proto.data().size());
+  std::memcpy(sample->mut_data(), proto.data().data(), proto.data().size());
+}
+
 template<typename LoadTarget>
 class RandomAccessDataset : public Dataset<LoadTarget> {
  public:
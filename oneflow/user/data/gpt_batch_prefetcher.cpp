@@ -0,0 +1,56 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/gpt_batch_prefetcher.h"
+
+namespace oneflow {
+
+namespace data {
+
+GPTBatchPrefetcher::GPTBatchPrefetcher(const MegatronGPTMMapDataset* dataset, size_t sample_len,
+                                       size_t batch_size, size_t num_shards, size_t shard_index,
+                                       size_t prefetch_depth)
+    : dataset_(dataset),
+      sample_len_(sample_len),
+      batch_size_(batch_size),
+      num_shards_(num_shards),
+      shard_index_(shard_index),
+      prefetch_depth_(prefetch_depth),
+      is_stopped_(false),
+      generation_(0),
+      next_prefetch_iter_(0),
+      expected_iter_(0) {
+  CHECK_GT(batch_size_, 0);
+  CHECK_LT(shard_index_, num_shards_);
+}
+
+GPTBatchPrefetcher::~GPTBatchPrefetcher() {
+  if (!thread_.joinable()) { return; }
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    is_stopped_ = true;
+  }
+  cond_.notify_all();
+  thread_.join();
+}
+
+GPTBatchPrefetcherMetrics GPTBatchPrefetcher::metrics() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return metrics_;
+}
+
+}  // namespace data
+
+}  // namespace oneflow
@@ -0,0 +1,180 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_GPT_BATCH_PREFETCHER_H_
+#define ONEFLOW_USER_DATA_GPT_BATCH_PREFETCHER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include "oneflow/core/profiler/profiler.h"
+#include "oneflow/user/data/gpt_dataset.h"
+
+namespace oneflow {
+
+namespace data {
+
+struct GPTBatchPrefetcherMetrics {
+  // batches served from the prefetch queue
+  int64_t num_batches = 0;
+  // times a batch had not been prefetched yet when it was asked for, and the waiting time
+  int64_t num_stalls = 0;
+  double stall_seconds = 0.0;
+  // sum of the queue depths seen by the served batches
+  int64_t sum_queue_depth = 0;
+
+  double average_queue_depth() const {
+    return num_batches > 0 ? static_cast<double>(sum_queue_depth) / num_batches : 0.0;
+  }
+};
+
+// Assembles the batches of the following iterations into host buffers in a background thread,
+// and reads ahead the tokens of them from the mapped corpus, so that GetBatch only copies. The
+// batch of iteration `iter` on a shard is always the same as FillBatch gives.
+class GPTBatchPrefetcher final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(GPTBatchPrefetcher);
+  GPTBatchPrefetcher(const MegatronGPTMMapDataset* dataset, size_t sample_len, size_t batch_size,
+                     size_t num_shards, size_t shard_index, size_t prefetch_depth);
+  ~GPTBatchPrefetcher();
+
+  // Starts prefetching from iteration 0, it does nothing if the prefetch depth is 0.
+  template<typename T>
+  void Start();
+  template<typename T>
+  void GetBatch(size_t iter, T* dptr);
+  template<typename T>
+  void FillBatch(size_t iter, T* dptr) const;
+
+  bool IsValidIteration(size_t iter) const {
+    return SampleIndex(iter, batch_size_ - 1) < dataset_->total_num_samples();
+  }
+  GPTBatchPrefetcherMetrics metrics() const;
+
+ private:
+  size_t SampleIndex(size_t iter, size_t i) const {
+    return iter * batch_size_ * num_shards_ + shard_index_ * batch_size_ + i;
+  }
+
+  const MegatronGPTMMapDataset* dataset_;
+  size_t sample_len_;
+  size_t batch_size_;
+  size_t num_shards_;
+  size_t shard_index_;
+  size_t prefetch_depth_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cond_;
+  bool is_stopped_;
+  // bumped when the iteration jumps, to drop the batches being prefetched before
+  size_t generation_;
+  size_t next_prefetch_iter_;
+  size_t expected_iter_;
+  std::deque<std::pair<size_t, std::vector<char>>> prefetched_batches_;
+  std::vector<std::vector<char>> free_buffers_;
+  GPTBatchPrefetcherMetrics metrics_;
+  std::thread thread_;
+};
+
+template<typename T>
+void GPTBatchPrefetcher::Start() {
+  if (prefetch_depth_ == 0) { return; }
+  CHECK(!thread_.joinable());
+  const size_t batch_bytes = batch_size_ * sample_len_ * sizeof(T);
+  thread_ = std::thread([this, batch_bytes]() {
+    OF_PROFILER_NAME_THIS_HOST_THREAD("GPTBatchPrefetcher");
+    while (true) {
+      size_t iter = 0;
+      size_t generation = 0;
+      std::vector<char> buffer;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this]() {
+          return is_stopped_
+                 || (prefetched_batches_.size() < prefetch_depth_
+                     && IsValidIteration(next_prefetch_iter_));
+        });
+        if (is_stopped_) { return; }
+        iter = next_prefetch_iter_++;
+        generation = generation_;
+        if (!free_buffers_.empty()) {
+          buffer.swap(free_buffers_.back());
+          free_buffers_.pop_back();
+        }
+      }
+      buffer.resize(batch_bytes);
+      FOR_RANGE(size_t, i, 0, batch_size_) { dataset_->PrefetchSample(SampleIndex(iter, i)); }
+      FillBatch<T>(iter, reinterpret_cast<T*>(buffer.data()));
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // drop the batch prefetched for an iteration which is no longer expected
+        if (generation != generation_) {
+          free_buffers_.push_back(std::move(buffer));
+          continue;
+        }
+        prefetched_batches_.emplace_back(iter, std::move(buffer));
+      }
+      cond_.notify_all();
+    }
+  });
+}
+
+template<typename T>
+void GPTBatchPrefetcher::GetBatch(size_t iter, T* dptr) {
+  if (!thread_.joinable() || !IsValidIteration(iter)) {
+    FillBatch<T>(iter, dptr);
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (iter != expected_iter_) {
+    // the iteration jumped, e.g. after restoring a snapshot, so restart prefetching from it
+    generation_ += 1;
+    for (auto& pair : prefetched_batches_) { free_buffers_.push_back(std::move(pair.second)); }
+    prefetched_batches_.clear();
+    next_prefetch_iter_ = iter;
+    expected_iter_ = iter;
+    cond_.notify_all();
+  }
+  if (prefetched_batches_.empty()) {
+    OF_PROFILER_RANGE_GUARD("GPTBatchPrefetcher::Stall");
+    const double start = GetCurTime();
+    cond_.wait(lock, [this]() { return !prefetched_batches_.empty(); });
+    metrics_.num_stalls += 1;
+    metrics_.stall_seconds += (GetCurTime() - start) / 1e9;
+  }
+  CHECK_EQ(prefetched_batches_.front().first, iter);
+  metrics_.num_batches += 1;
+  metrics_.sum_queue_depth += prefetched_batches_.size();
+  std::vector<char>& buffer = prefetched_batches_.front().second;
+  std::memcpy(dptr, buffer.data(), buffer.size());
+  free_buffers_.push_back(std::move(buffer));
+  prefetched_batches_.pop_front();
+  expected_iter_ = iter + 1;
+  lock.unlock();
+  cond_.notify_all();
+}
+
+template<typename T>
+void GPTBatchPrefetcher::FillBatch(size_t iter, T* dptr) const {
+  FOR_RANGE(size_t, i, 0, batch_size_) {
+    dataset_->GetSample(SampleIndex(iter, i), dptr + i * sample_len_);
+  }
+}
+
+}  // namespace data
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_GPT_BATCH_PREFETCHER_H_
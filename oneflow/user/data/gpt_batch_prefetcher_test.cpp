@@ -0,0 +1,162 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <fstream>
+#include <numeric>
+#include "oneflow/core/common/global.h"
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/control/ctrl_bootstrap.pb.h"
+#include "oneflow/core/persistence/posix/posix_file_system.h"
+#include "oneflow/core/thread/thread_pool.h"
+#include "oneflow/user/data/gpt_batch_prefetcher.h"
+
+namespace oneflow {
+
+namespace data {
+
+namespace test {
+
+namespace {
+
+constexpr size_t kSeqLen = 16;
+constexpr size_t kBatchSize = 3;
+
+// Writes 50 documents of int32 tokens in the Megatron format.
+void WriteDataset(const std::string& prefix) {
+  std::vector<int32_t> sizes;
+  std::vector<int64_t> addresses;
+  std::ofstream bin(prefix + ".bin", std::ios::binary);
+  int64_t address = 0;
+  FOR_RANGE(int32_t, doc_index, 0, 50) {
+    sizes.push_back(5 + doc_index % 17);
+    addresses.push_back(address);
+    FOR_RANGE(int32_t, pos, 0, sizes.back()) {
+      const int32_t token = doc_index * 1000 + pos;
+      bin.write(reinterpret_cast<const char*>(&token), sizeof(token));
+      address += sizeof(token);
+    }
+  }
+  std::ofstream idx(prefix + ".idx", std::ios::binary);
+  const uint64_t version = 1;
+  const char dtype_code = 4;
+  const uint64_t sizes_size = sizes.size();
+  const uint64_t doc_offsets_size = sizes.size() + 1;
+  std::vector<int64_t> doc_offsets(doc_offsets_size);
+  std::iota(doc_offsets.begin(), doc_offsets.end(), 0);
+  idx.write(MegatronGPTIndex::kMagicCode, MegatronGPTIndex::kMagicCodeLen);
+  idx.write(reinterpret_cast<const char*>(&version), sizeof(version));
+  idx.write(&dtype_code, sizeof(dtype_code));
+  idx.write(reinterpret_cast<const char*>(&sizes_size), sizeof(sizes_size));
+  idx.write(reinterpret_cast<const char*>(&doc_offsets_size), sizeof(doc_offsets_size));
+  idx.write(reinterpret_cast<const char*>(sizes.data()), sizes.size() * sizeof(int32_t));
+  idx.write(reinterpret_cast<const char*>(addresses.data()), addresses.size() * sizeof(int64_t));
+  idx.write(reinterpret_cast<const char*>(doc_offsets.data()),
+            doc_offsets.size() * sizeof(int64_t));
+}
+
+class GPTBatchPrefetcherTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    // the dataset indices are built by MultiThreadLoop, and are not cached
+    Global<ThreadPool>::New(4);
+    Global<ProcessCtx>::New();
+    Global<ProcessCtx>::Get()->set_rank(0);
+    setenv("ONEFLOW_GPT_DATASET_INDICES_CACHE", "0", 1);
+    std::string current_dir = GetCwd();
+    StringReplace(&current_dir, '\\', '/');
+    dir_ = JoinPath(current_dir, "tmp_gpt_batch_prefetcher_test_dir");
+    fs_.RecursivelyCreateDirIfNotExist(dir_);
+    WriteDataset(JoinPath(dir_, "dataset"));
+    dataset_ = std::make_unique<MegatronGPTMMapDataset>(JoinPath(dir_, "dataset"), kSeqLen, 1,
+                                                        40, std::vector<int64_t>{1}, 0, true, 7);
+  }
+  void TearDown() override {
+    dataset_.reset();
+    unsetenv("ONEFLOW_GPT_DATASET_INDICES_CACHE");
+    fs_.RecursivelyDeleteDir(dir_);
+    Global<ProcessCtx>::Delete();
+    Global<ThreadPool>::Delete();
+  }
+
+  std::unique_ptr<GPTBatchPrefetcher> NewPrefetcher(size_t num_shards, size_t shard_index,
+                                                    size_t prefetch_depth) const {
+    auto prefetcher = std::make_unique<GPTBatchPrefetcher>(
+        dataset_.get(), kSeqLen + 1, kBatchSize, num_shards, shard_index, prefetch_depth);
+    prefetcher->Start<int64_t>();
+    return prefetcher;
+  }
+
+  fs::PosixFileSystem fs_;
+  std::string dir_;
+  std::unique_ptr<MegatronGPTMMapDataset> dataset_;
+};
+
+std::vector<int64_t> GetBatch(GPTBatchPrefetcher* prefetcher, size_t iter) {
+  std::vector<int64_t> batch(kBatchSize * (kSeqLen + 1), -1);
+  prefetcher->GetBatch<int64_t>(iter, batch.data());
+  return batch;
+}
+
+std::vector<int64_t> FillBatch(const GPTBatchPrefetcher& prefetcher, size_t iter) {
+  std::vector<int64_t> batch(kBatchSize * (kSeqLen + 1), -1);
+  prefetcher.FillBatch<int64_t>(iter, batch.data());
+  return batch;
+}
+
+}  // namespace
+
+TEST_F(GPTBatchPrefetcherTest, same_batches_as_fill_batch) {
+  for (const size_t num_shards : {1, 2}) {
+    const auto reference = NewPrefetcher(num_shards, num_shards - 1, 0);
+    size_t num_iters = 0;
+    while (reference->IsValidIteration(num_iters)) { num_iters += 1; }
+    ASSERT_GT(num_iters, 4);
+    for (const size_t depth : {0, 1, 3}) {
+      const auto prefetcher = NewPrefetcher(num_shards, num_shards - 1, depth);
+      FOR_RANGE(size_t, iter, 0, num_iters) {
+        ASSERT_EQ(GetBatch(prefetcher.get(), iter), FillBatch(*reference, iter));
+      }
+      const GPTBatchPrefetcherMetrics metrics = prefetcher->metrics();
+      ASSERT_EQ(metrics.num_batches, depth == 0 ? 0 : num_iters);
+      ASSERT_LE(metrics.num_stalls, metrics.num_batches);
+      ASSERT_LE(metrics.average_queue_depth(), depth);
+    }
+  }
+}
+
+TEST_F(GPTBatchPrefetcherTest, jump_iteration) {
+  const auto reference = NewPrefetcher(1, 0, 0);
+  size_t num_iters = 0;
+  while (reference->IsValidIteration(num_iters)) { num_iters += 1; }
+  ASSERT_GT(num_iters, 8);
+  for (const size_t depth : {1, 3}) {
+    const auto prefetcher = NewPrefetcher(1, 0, depth);
+    // forward, backward, repeat an iteration, and jump to the last one
+    const std::vector<size_t> iters = {0, 1, 2, 6, 7, 3, 4, 4, 5, num_iters - 1, 0, 1};
+    for (const size_t iter : iters) {
+      ASSERT_EQ(GetBatch(prefetcher.get(), iter), FillBatch(*reference, iter)) << iter;
+    }
+    ASSERT_EQ(prefetcher->metrics().num_batches, iters.size());
+  }
+}
+
+}  // namespace test
+
+}  // namespace data
+
+}  // namespace oneflow
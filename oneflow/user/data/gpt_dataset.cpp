@@ -14,11 +14,16 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/user/data/gpt_dataset.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/rpc/include/global_process_ctx.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 #ifdef __linux__
 #include <fcntl.h>
 #include <stdio.h>
 #include <errno.h>
+#include <unistd.h>
+#include <sys/file.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
 #endif
@@ -74,6 +79,70 @@ size_t GetNumCompleteEpochs(size_t num_samples, size_t seq_length, size_t tokens
   return separate_last_epoch ? (num_epochs - 1) : num_epochs;
 }
 
+constexpr char kIndicesCacheMagicCode[] = "GPTSIDX\x00";
+constexpr size_t kIndicesCacheMagicCodeLen = sizeof(kIndicesCacheMagicCode) - 1;
+// bump it whenever the way to build the indices changes
+constexpr uint64_t kIndicesCacheVersion = 1;
+
+struct IndicesCacheHeader {
+  char magic_code[kIndicesCacheMagicCodeLen];
+  uint64_t version;
+  uint64_t num_docs;
+  uint64_t tokens_per_epoch;
+  uint64_t num_epochs;
+  uint64_t num_complete_epochs;
+  uint64_t doc_indices_size;
+  uint64_t sample_indices_size;
+  uint64_t shuffle_indices_size;
+};
+
+static_assert(sizeof(std::pair<size_t, size_t>) == 2 * sizeof(size_t), "");
+
+// The cache file is keyed by everything the indices are built from, except the contents of the
+// dataset index which are verified by the header.
+std::string GetIndicesCachePath(const std::string& data_file_prefix, size_t seq_len,
+                                size_t num_samples, const std::vector<int64_t>& split_sizes,
+                                size_t split_index, bool shuffle, uint32_t seed) {
+  if (!ParseBooleanFromEnv("ONEFLOW_GPT_DATASET_INDICES_CACHE", true)) { return ""; }
+  std::string cache_prefix = data_file_prefix;
+  const std::string cache_dir = GetStringFromEnv("ONEFLOW_GPT_DATASET_INDICES_CACHE_DIR", "");
+  if (!cache_dir.empty()) { cache_prefix = JoinPath(cache_dir, Basename(data_file_prefix)); }
+  std::ostringstream ss;
+  ss << cache_prefix << "_seq" << seq_len << "_ns" << num_samples << "_split";
+  for (int64_t split_size : split_sizes) { ss << "-" << split_size; }
+  ss << "_" << split_index;
+  if (shuffle) { ss << "_seed" << seed; }
+  ss << ".sidx";
+  return ss.str();
+}
+
+// Makes the processes on a host which build the same indices cache take turns.
+class FileLock final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(FileLock);
+  explicit FileLock(const std::string& path) : fd_(-1) {
+#ifdef __linux__
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ == -1) {
+      LOG(WARNING) << "open " << path << " failed: " << strerror(errno);
+      return;
+    }
+    CHECK(flock(fd_, LOCK_EX) == 0) << "flock " << path << " failed: " << strerror(errno);
+#endif
+  }
+  ~FileLock() {
+#ifdef __linux__
+    if (fd_ != -1) {
+      flock(fd_, LOCK_UN);
+      close(fd_);
+    }
+#endif
+  }
+
+ private:
+  int fd_;
+};
+
 }  // namespace
 
 constexpr char MegatronGPTIndex::kMagicCode[];
@@ -142,6 +211,17 @@ MappedBuffer::~MappedBuffer() {
 #endif
 }
 
+void MappedBuffer::WillNeed(size_t offset, size_t size) const {
+#ifdef __linux__
+  if (size == 0) { return; }
+  CHECK_LE(offset + size, size_);
+  static const size_t page_size = sysconf(_SC_PAGESIZE);
+  const size_t begin = offset / page_size * page_size;
+  // it is only a hint, failures are harmless
+  madvise(static_cast<char*>(mapped_) + begin, offset + size - begin, MADV_WILLNEED);
+#endif
+}
+
 MegatronGPTMMapDataset::MegatronGPTMMapDataset(const std::string& data_file_prefix, size_t seq_len,
                                                size_t label_len, size_t num_samples,
                                                const std::vector<int64_t>& split_sizes,
@@ -161,11 +241,11 @@ MegatronGPTMMapDataset::MegatronGPTMMapDataset(const std::string& data_file_pref
   tokens_per_epoch_ = GetEpochNumTokens(epoch_doc_indices);
   num_epochs_ = GetNumEpochs(num_samples_, seq_len_, tokens_per_epoch_);
   num_complete_epochs_ = GetNumCompleteEpochs(num_samples_, seq_len_, tokens_per_epoch_);
-  InitDocIndices(epoch_doc_indices, num_epochs_, num_complete_epochs_);
   size_t total_num_samples = static_cast<size_t>(
       std::floor(static_cast<double>(num_epochs_ * tokens_per_epoch_ - 1) / seq_len_));
-  InitSampleIndices(total_num_samples);
-  InitShuffleIndices(sample_indices_.size());
+  InitIndices(epoch_doc_indices, total_num_samples,
+              GetIndicesCachePath(data_file_prefix, seq_len_, num_samples_, split_sizes,
+                                  split_index, shuffle_, seed_));
   std::chrono::duration<double, std::milli> elapse = std::chrono::system_clock::now() - start;
   LOG(INFO) << "Create GPT Dataset successed, sequence length: " << seq_len_
             << ", number of samples: " << num_samples_
@@ -177,69 +257,190 @@ MegatronGPTMMapDataset::MegatronGPTMMapDataset(const std::string& data_file_pref
             << ", elapsed time: " << elapse.count() << " ms";
 }
 
+void MegatronGPTMMapDataset::PrefetchSample(size_t index) const {
+  CHECK_LT(index, shuffle_indices_.size());
+  const size_t sample_index = shuffle_indices_[index];
+  CHECK_LT(sample_index, sample_indices_.size());
+  size_t doc_indices_idx = sample_indices_[sample_index].first;
+  size_t doc_offset = sample_indices_[sample_index].second;
+  size_t remaining_tokens = sample_len_;
+  while (remaining_tokens > 0 && doc_indices_idx < doc_indices_.size()) {
+    const size_t doc_index = doc_indices_[doc_indices_idx];
+    const size_t num_tokens =
+        std::min(index_->doc_length(doc_index) - doc_offset, remaining_tokens);
+    data_->WillNeed(index_->address(doc_index) + doc_offset * dtype_size_,
+                    num_tokens * dtype_size_);
+    remaining_tokens -= num_tokens;
+    doc_indices_idx += 1;
+    doc_offset = 0;
+  }
+}
+
 size_t MegatronGPTMMapDataset::GetEpochNumTokens(const std::vector<size_t>& doc_indices) const {
   size_t num_tokens = 0;
   for (auto doc_index : doc_indices) { num_tokens += index_->doc_length(doc_index); }
   return num_tokens;
 }
 
+void MegatronGPTMMapDataset::InitIndices(const std::vector<size_t>& epoch_doc_indices,
+                                         size_t total_num_samples, const std::string& cache_path) {
+  if (cache_path.empty()) {
+    BuildIndices(epoch_doc_indices, total_num_samples);
+    return;
+  }
+  const size_t num_doc_indices = epoch_doc_indices.size() * num_epochs_;
+  // the first process builds the cache, and the others on the host map the same pages of it
+  FileLock lock(cache_path + ".lock");
+  if (LoadIndicesCache(cache_path, num_doc_indices, total_num_samples)) {
+    LOG(INFO) << "Load GPT Dataset indices cache successed, file_path: " << cache_path;
+    return;
+  }
+  BuildIndices(epoch_doc_indices, total_num_samples);
+  // map the saved cache to release the built indices
+  if (SaveIndicesCache(cache_path)) {
+    CHECK(LoadIndicesCache(cache_path, num_doc_indices, total_num_samples));
+  }
+}
+
+void MegatronGPTMMapDataset::BuildIndices(const std::vector<size_t>& epoch_doc_indices,
+                                          size_t total_num_samples) {
+  std::vector<size_t> doc_indices;
+  InitDocIndices(epoch_doc_indices, num_epochs_, num_complete_epochs_, &doc_indices);
+  std::vector<std::pair<size_t, size_t>> sample_indices;
+  InitSampleIndices(doc_indices, total_num_samples, &sample_indices);
+  std::vector<size_t> shuffle_indices;
+  InitShuffleIndices(sample_indices.size(), &shuffle_indices);
+  doc_indices_.Reset(std::move(doc_indices));
+  sample_indices_.Reset(std::move(sample_indices));
+  shuffle_indices_.Reset(std::move(shuffle_indices));
+}
+
+bool MegatronGPTMMapDataset::LoadIndicesCache(const std::string& cache_path,
+                                              size_t num_doc_indices, size_t total_num_samples) {
+#ifdef __linux__
+  if (access(cache_path.c_str(), R_OK) != 0) { return false; }
+  const size_t expected_size = sizeof(IndicesCacheHeader)
+                               + (num_doc_indices + 3 * total_num_samples) * sizeof(size_t);
+  struct stat s;
+  CHECK(stat(cache_path.c_str(), &s) != -1)
+      << "stat " << cache_path << " failed: " << strerror(errno);
+  if (static_cast<size_t>(s.st_size) != expected_size) {
+    LOG(WARNING) << "Ignore the stale GPT Dataset indices cache " << cache_path;
+    return false;
+  }
+  auto cache = std::make_unique<const MappedBuffer>(cache_path);
+  const auto* header = static_cast<const IndicesCacheHeader*>(cache->ptr());
+  if (std::memcmp(header->magic_code, kIndicesCacheMagicCode, kIndicesCacheMagicCodeLen) != 0
+      || header->version != kIndicesCacheVersion || header->num_docs != index_->num_docs()
+      || header->tokens_per_epoch != tokens_per_epoch_ || header->num_epochs != num_epochs_
+      || header->num_complete_epochs != num_complete_epochs_
+      || header->doc_indices_size != num_doc_indices
+      || header->sample_indices_size != total_num_samples
+      || header->shuffle_indices_size != total_num_samples) {
+    LOG(WARNING) << "Ignore the stale GPT Dataset indices cache " << cache_path;
+    return false;
+  }
+  const char* ptr = static_cast<const char*>(cache->ptr()) + sizeof(IndicesCacheHeader);
+  doc_indices_.Reset(reinterpret_cast<const size_t*>(ptr), num_doc_indices);
+  ptr += num_doc_indices * sizeof(size_t);
+  sample_indices_.Reset(reinterpret_cast<const std::pair<size_t, size_t>*>(ptr),
+                        total_num_samples);
+  ptr += total_num_samples * sizeof(std::pair<size_t, size_t>);
+  shuffle_indices_.Reset(reinterpret_cast<const size_t*>(ptr), total_num_samples);
+  CHECK_GE(sample_indices_.size(), num_samples_);
+  indices_cache_ = std::move(cache);
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool MegatronGPTMMapDataset::SaveIndicesCache(const std::string& cache_path) const {
+  // write into a temporary file first, so that the cache is never seen half written
+  const std::string tmp_path = cache_path + ".tmp" + std::to_string(GlobalProcessCtx::Rank());
+  std::ofstream stream(tmp_path, std::ios::binary | std::ios::trunc);
+  if (!stream.is_open()) {
+    LOG(WARNING) << "can't write GPT Dataset indices cache " << cache_path
+                 << ", the indices are kept in memory";
+    return false;
+  }
+  IndicesCacheHeader header;
+  std::memcpy(header.magic_code, kIndicesCacheMagicCode, kIndicesCacheMagicCodeLen);
+  header.version = kIndicesCacheVersion;
+  header.num_docs = index_->num_docs();
+  header.tokens_per_epoch = tokens_per_epoch_;
+  header.num_epochs = num_epochs_;
+  header.num_complete_epochs = num_complete_epochs_;
+  header.doc_indices_size = doc_indices_.size();
+  header.sample_indices_size = sample_indices_.size();
+  header.shuffle_indices_size = shuffle_indices_.size();
+  stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  stream.write(reinterpret_cast<const char*>(doc_indices_.data()),
+               doc_indices_.size() * sizeof(size_t));
+  stream.write(reinterpret_cast<const char*>(sample_indices_.data()),
+               sample_indices_.size() * sizeof(std::pair<size_t, size_t>));
+  stream.write(reinterpret_cast<const char*>(shuffle_indices_.data()),
+               shuffle_indices_.size() * sizeof(size_t));
+  stream.close();
+  if (!stream || std::rename(tmp_path.c_str(), cache_path.c_str()) != 0) {
+    LOG(WARNING) << "can't write GPT Dataset indices cache " << cache_path
+                 << ", the indices are kept in memory";
+    std::remove(tmp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
 void MegatronGPTMMapDataset::InitDocIndices(const std::vector<size_t>& epoch_doc_indices,
-                                            size_t num_epochs, size_t num_complete_epochs) {
-  doc_indices_.reserve(epoch_doc_indices.size() * num_epochs);
-  InitDocIndices(epoch_doc_indices, num_complete_epochs);
+                                            size_t num_epochs, size_t num_complete_epochs,
+                                            std::vector<size_t>* doc_indices) {
+  doc_indices->reserve(epoch_doc_indices.size() * num_epochs);
+  InitDocIndices(epoch_doc_indices, num_complete_epochs, doc_indices);
   if (num_epochs != num_complete_epochs) {
     CHECK_EQ(num_complete_epochs + 1, num_epochs);
-    InitDocIndices(epoch_doc_indices, 1);
+    InitDocIndices(epoch_doc_indices, 1, doc_indices);
   }
 }
 
 void MegatronGPTMMapDataset::InitDocIndices(const std::vector<size_t>& epoch_doc_indices,
-                                            size_t num_epochs) {
-  auto start = std::distance(doc_indices_.cbegin(), doc_indices_.cend());
+                                            size_t num_epochs, std::vector<size_t>* doc_indices) {
+  auto start = std::distance(doc_indices->cbegin(), doc_indices->cend());
   FOR_RANGE(size_t, i, 0, num_epochs) {
-    doc_indices_.insert(doc_indices_.end(), epoch_doc_indices.cbegin(), epoch_doc_indices.cend());
+    doc_indices->insert(doc_indices->end(), epoch_doc_indices.cbegin(), epoch_doc_indices.cend());
   }
-  if (shuffle_) { std::shuffle(doc_indices_.begin() + start, doc_indices_.end(), gen_); }
+  if (shuffle_) { std::shuffle(doc_indices->begin() + start, doc_indices->end(), gen_); }
 }
 
-void MegatronGPTMMapDataset::InitSampleIndices(size_t total_num_samples) {
-  sample_indices_.reserve(total_num_samples);
-  size_t doc_indices_idx = 0;
-  size_t doc_offset = 0;
-  FOR_RANGE(size_t, i, 0, total_num_samples) {
-    if (doc_indices_idx >= doc_indices_.size()) { break; }
-    sample_indices_.emplace_back(doc_indices_idx, doc_offset);
-    int remaining_tokens = seq_len_;
-    while (remaining_tokens > 0) {
-      CHECK_LT(doc_indices_idx, doc_indices_.size());
-      size_t doc_len = index_->doc_length(doc_indices_[doc_indices_idx]);
-      CHECK_LT(doc_offset, doc_len);
-      doc_len -= doc_offset;
-      if (remaining_tokens < doc_len) {
-        // move offset inside doc
-        doc_offset += remaining_tokens;
-      } else {
-        // move to next doc
-        doc_indices_idx += 1;
-        doc_offset = 0;
-      }
-      remaining_tokens -= doc_len;
-    }
+void MegatronGPTMMapDataset::InitSampleIndices(
+    const std::vector<size_t>& doc_indices, size_t total_num_samples,
+    std::vector<std::pair<size_t, size_t>>* sample_indices) const {
+  // token_offsets[i] is the position of the first token of doc_indices[i] in all the tokens
+  std::vector<size_t> token_offsets(doc_indices.size() + 1, 0);
+  FOR_RANGE(size_t, i, 0, doc_indices.size()) {
+    token_offsets[i + 1] = token_offsets[i] + index_->doc_length(doc_indices[i]);
   }
-  CHECK_EQ(sample_indices_.size(), total_num_samples);
-  CHECK_GE(sample_indices_.size(), num_samples_);
+  CHECK_LE(total_num_samples * seq_len_, token_offsets.back());
+  // the i-th sample starts at token i * seq_len, so the samples are located independently
+  sample_indices->resize(total_num_samples);
+  MultiThreadLoop(total_num_samples, [&](size_t i) {
+    const size_t token_offset = i * seq_len_;
+    auto it = std::upper_bound(token_offsets.cbegin(), token_offsets.cend(), token_offset) - 1;
+    (*sample_indices)[i] = std::make_pair(it - token_offsets.cbegin(), token_offset - *it);
+  });
+  CHECK_GE(sample_indices->size(), num_samples_);
 }
 
-void MegatronGPTMMapDataset::InitShuffleIndices(size_t total_num_samples) {
-  shuffle_indices_.resize(total_num_samples);
-  std::iota(shuffle_indices_.begin(), shuffle_indices_.end(), 0);
+void MegatronGPTMMapDataset::InitShuffleIndices(size_t total_num_samples,
+                                                std::vector<size_t>* shuffle_indices) {
+  shuffle_indices->resize(total_num_samples);
+  std::iota(shuffle_indices->begin(), shuffle_indices->end(), 0);
   if (shuffle_) {
     size_t num_samples = static_cast<size_t>(
         std::floor(static_cast<double>(num_complete_epochs_ * tokens_per_epoch_ - 1) / seq_len_));
-    CHECK_LE(num_samples, shuffle_indices_.size());
-    std::shuffle(shuffle_indices_.begin(), shuffle_indices_.begin() + num_samples, gen_);
+    CHECK_LE(num_samples, shuffle_indices->size());
+    std::shuffle(shuffle_indices->begin(), shuffle_indices->begin() + num_samples, gen_);
     if (num_complete_epochs_ != num_epochs_) {
-      std::shuffle(shuffle_indices_.begin() + num_samples, shuffle_indices_.end(), gen_);
+      std::shuffle(shuffle_indices->begin() + num_samples, shuffle_indices->end(), gen_);
     }
   }
 }
@@ -52,12 +52,42 @@ class MappedBuffer final {
 
   const void* ptr() const { return mapped_; }
   size_t size() const { return size_; }
+  // Asks the kernel to read the range into the page cache asynchronously.
+  void WillNeed(size_t offset, size_t size) const;
 
  private:
   void* mapped_;
   size_t size_;
 };
 
+// An index array which either owns its elements or views them in a mapped cache file.
+template<typename T>
+class IndexArray final {
+ public:
+  IndexArray() : data_(nullptr), size_(0) {}
+  ~IndexArray() = default;
+
+  void Reset(std::vector<T>&& vec) {
+    owned_ = std::move(vec);
+    data_ = owned_.data();
+    size_ = owned_.size();
+  }
+  void Reset(const T* data, size_t size) {
+    std::vector<T>().swap(owned_);
+    data_ = data;
+    size_ = size;
+  }
+
+  const T* data() const { return data_; }
+  size_t size() const { return size_; }
+  const T& operator[](size_t i) const { return data_[i]; }
+
+ private:
+  std::vector<T> owned_;
+  const T* data_;
+  size_t size_;
+};
+
 class MegatronGPTMMapDataset final {
  public:
   MegatronGPTMMapDataset(const std::string& data_file_prefix, size_t seq_len, size_t label_len,
@@ -68,16 +98,27 @@ class MegatronGPTMMapDataset final {
 
   template<typename T>
   void GetSample(size_t index, T* data) const;
+  size_t total_num_samples() const { return shuffle_indices_.size(); }
+  // Starts reading the tokens of a sample ahead, so that GetSample of it hits the page cache.
+  void PrefetchSample(size_t index) const;
 
  private:
   static const HashMap<char, size_t> kDTypeCode2Size;
 
   size_t GetEpochNumTokens(const std::vector<size_t>& doc_indices) const;
+  void InitIndices(const std::vector<size_t>& epoch_doc_indices, size_t total_num_samples,
+                   const std::string& cache_path);
+  void BuildIndices(const std::vector<size_t>& epoch_doc_indices, size_t total_num_samples);
+  bool LoadIndicesCache(const std::string& cache_path, size_t num_doc_indices,
+                        size_t total_num_samples);
+  bool SaveIndicesCache(const std::string& cache_path) const;
+  void InitDocIndices(const std::vector<size_t>& epoch_doc_indices, size_t num_epochs,
+                      size_t num_complete_epochs, std::vector<size_t>* doc_indices);
   void InitDocIndices(const std::vector<size_t>& epoch_doc_indices, size_t num_epochs,
-                      size_t num_complete_epochs);
-  void InitDocIndices(const std::vector<size_t>& doc_indices, size_t num_epochs);
-  void InitSampleIndices(size_t total_num_samples);
-  void InitShuffleIndices(size_t total_num_samples);
+                      std::vector<size_t>* doc_indices);
+  void InitSampleIndices(const std::vector<size_t>& doc_indices, size_t total_num_samples,
+                         std::vector<std::pair<size_t, size_t>>* sample_indices) const;
+  void InitShuffleIndices(size_t total_num_samples, std::vector<size_t>* shuffle_indices);
   template<typename T>
   void ReadTokens(const void* src, size_t offset, T* dst, size_t size) const;
 
@@ -96,9 +137,10 @@ class MegatronGPTMMapDataset final {
   size_t tokens_per_epoch_;
   size_t num_epochs_;
   size_t num_complete_epochs_;
-  std::vector<size_t> doc_indices_;
-  std::vector<std::pair<size_t, size_t>> sample_indices_;
-  std::vector<size_t> shuffle_indices_;
+  std::unique_ptr<const MappedBuffer> indices_cache_;
+  IndexArray<size_t> doc_indices_;
+  IndexArray<std::pair<size_t, size_t>> sample_indices_;
+  IndexArray<size_t> shuffle_indices_;
 };
 
 template<typename T>
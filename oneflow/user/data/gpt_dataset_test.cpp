@@ -0,0 +1,290 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <fstream>
+#include "oneflow/core/common/global.h"
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/control/ctrl_bootstrap.pb.h"
+#include "oneflow/core/persistence/posix/posix_file_system.h"
+#include "oneflow/core/thread/thread_pool.h"
+#include "oneflow/user/data/gpt_dataset.h"
+
+namespace oneflow {
+
+namespace data {
+
+namespace test {
+
+namespace {
+
+constexpr size_t kSeqLen = 8;
+constexpr size_t kLabelLen = 1;
+constexpr uint32_t kSeed = 1234;
+
+int32_t Token(size_t doc_index, size_t pos) { return doc_index * 1000 + pos; }
+
+// Writes a dataset of int32 tokens in the Megatron format, and returns the document lengths.
+std::vector<int32_t> WriteDataset(const std::string& prefix) {
+  std::mt19937 gen(7);
+  std::vector<int32_t> sizes(23);
+  for (auto& size : sizes) { size = 1 + gen() % 20; }
+  std::ofstream bin(prefix + ".bin", std::ios::binary);
+  std::vector<int64_t> addresses;
+  int64_t address = 0;
+  FOR_RANGE(size_t, doc_index, 0, sizes.size()) {
+    addresses.push_back(address);
+    FOR_RANGE(int32_t, pos, 0, sizes.at(doc_index)) {
+      const int32_t token = Token(doc_index, pos);
+      bin.write(reinterpret_cast<const char*>(&token), sizeof(token));
+      address += sizeof(token);
+    }
+  }
+  std::ofstream idx(prefix + ".idx", std::ios::binary);
+  idx.write(MegatronGPTIndex::kMagicCode, MegatronGPTIndex::kMagicCodeLen);
+  const uint64_t version = 1;
+  const char dtype_code = 4;
+  const uint64_t sizes_size = sizes.size();
+  const uint64_t doc_offsets_size = sizes.size() + 1;
+  std::vector<int64_t> doc_offsets(doc_offsets_size);
+  std::iota(doc_offsets.begin(), doc_offsets.end(), 0);
+  idx.write(reinterpret_cast<const char*>(&version), sizeof(version));
+  idx.write(&dtype_code, sizeof(dtype_code));
+  idx.write(reinterpret_cast<const char*>(&sizes_size), sizeof(sizes_size));
+  idx.write(reinterpret_cast<const char*>(&doc_offsets_size), sizeof(doc_offsets_size));
+  idx.write(reinterpret_cast<const char*>(sizes.data()), sizes.size() * sizeof(int32_t));
+  idx.write(reinterpret_cast<const char*>(addresses.data()), addresses.size() * sizeof(int64_t));
+  idx.write(reinterpret_cast<const char*>(doc_offsets.data()),
+            doc_offsets.size() * sizeof(int64_t));
+  return sizes;
+}
+
+// The samples built by walking the documents sequentially, as the dataset used to do before
+// the indices were built in parallel.
+std::vector<std::vector<int32_t>> SequentialSamples(const std::vector<int32_t>& sizes,
+                                                    size_t num_samples, bool shuffle) {
+  const size_t tokens_per_epoch = std::accumulate(sizes.begin(), sizes.end(), size_t(0));
+  const size_t num_epochs = static_cast<size_t>(
+      std::ceil(static_cast<double>(num_samples * kSeqLen + 1) / tokens_per_epoch));
+  size_t num_complete_epochs = num_epochs;
+  if (num_epochs > 1) {
+    const size_t num_samples_per_epoch = (tokens_per_epoch - 1) / kSeqLen;
+    const size_t last_epoch_num_samples =
+        num_samples - ((num_epochs - 1) * tokens_per_epoch - 1) / kSeqLen;
+    if (last_epoch_num_samples < static_cast<size_t>(0.8f * num_samples_per_epoch)) {
+      num_complete_epochs -= 1;
+    }
+  }
+  const size_t total_num_samples = (num_epochs * tokens_per_epoch - 1) / kSeqLen;
+  std::mt19937 gen(kSeed);
+
+  std::vector<size_t> doc_indices;
+  FOR_RANGE(size_t, epoch, 0, num_epochs) {
+    FOR_RANGE(size_t, doc_index, 0, sizes.size()) { doc_indices.push_back(doc_index); }
+    if (shuffle && epoch + 1 == num_complete_epochs) {
+      std::shuffle(doc_indices.begin(), doc_indices.end(), gen);
+    }
+  }
+  if (shuffle && num_complete_epochs != num_epochs) {
+    std::shuffle(doc_indices.end() - sizes.size(), doc_indices.end(), gen);
+  }
+
+  std::vector<std::pair<size_t, size_t>> sample_indices;
+  size_t doc_indices_idx = 0;
+  size_t doc_offset = 0;
+  FOR_RANGE(size_t, i, 0, total_num_samples) {
+    sample_indices.emplace_back(doc_indices_idx, doc_offset);
+    size_t remaining_tokens = kSeqLen;
+    while (remaining_tokens > 0) {
+      const size_t doc_len = sizes.at(doc_indices.at(doc_indices_idx)) - doc_offset;
+      if (remaining_tokens < doc_len) {
+        doc_offset += remaining_tokens;
+        remaining_tokens = 0;
+      } else {
+        doc_indices_idx += 1;
+        doc_offset = 0;
+        remaining_tokens -= doc_len;
+      }
+    }
+  }
+
+  std::vector<size_t> shuffle_indices(total_num_samples);
+  std::iota(shuffle_indices.begin(), shuffle_indices.end(), 0);
+  if (shuffle) {
+    const size_t num_complete_samples = (num_complete_epochs * tokens_per_epoch - 1) / kSeqLen;
+    std::shuffle(shuffle_indices.begin(), shuffle_indices.begin() + num_complete_samples, gen);
+    if (num_complete_epochs != num_epochs) {
+      std::shuffle(shuffle_indices.begin() + num_complete_samples, shuffle_indices.end(), gen);
+    }
+  }
+
+  std::vector<std::vector<int32_t>> samples;
+  for (const size_t sample_index : shuffle_indices) {
+    std::tie(doc_indices_idx, doc_offset) = sample_indices.at(sample_index);
+    std::vector<int32_t> sample;
+    while (sample.size() < kSeqLen + kLabelLen) {
+      const size_t doc_index = doc_indices.at(doc_indices_idx);
+      sample.push_back(Token(doc_index, doc_offset));
+      if (++doc_offset == sizes.at(doc_index)) {
+        doc_indices_idx += 1;
+        doc_offset = 0;
+      }
+    }
+    samples.push_back(sample);
+  }
+  return samples;
+}
+
+std::vector<std::vector<int32_t>> GetSamples(const MegatronGPTMMapDataset& dataset) {
+  std::vector<std::vector<int32_t>> samples(dataset.total_num_samples());
+  FOR_RANGE(size_t, i, 0, samples.size()) {
+    samples.at(i).resize(kSeqLen + kLabelLen);
+    dataset.GetSample(i, samples.at(i).data());
+  }
+  return samples;
+}
+
+class GPTDatasetTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    // the indices are built by MultiThreadLoop, and the cache file is named by the rank
+    Global<ThreadPool>::New(4);
+    Global<ProcessCtx>::New();
+    Global<ProcessCtx>::Get()->set_rank(0);
+    std::string current_dir = GetCwd();
+    StringReplace(&current_dir, '\\', '/');
+    dir_ = JoinPath(current_dir, "tmp_gpt_dataset_test_dir");
+    cache_dir_ = JoinPath(dir_, "cache");
+    fs_.RecursivelyCreateDirIfNotExist(cache_dir_);
+    prefix_ = JoinPath(dir_, "dataset");
+    sizes_ = WriteDataset(prefix_);
+    setenv("ONEFLOW_GPT_DATASET_INDICES_CACHE_DIR", cache_dir_.c_str(), 1);
+  }
+  void TearDown() override {
+    unsetenv("ONEFLOW_GPT_DATASET_INDICES_CACHE_DIR");
+    unsetenv("ONEFLOW_GPT_DATASET_INDICES_CACHE");
+    fs_.RecursivelyDeleteDir(dir_);
+    Global<ProcessCtx>::Delete();
+    Global<ThreadPool>::Delete();
+  }
+
+  std::unique_ptr<MegatronGPTMMapDataset> NewDataset(size_t num_samples, bool shuffle) const {
+    return std::make_unique<MegatronGPTMMapDataset>(prefix_, kSeqLen, kLabelLen, num_samples,
+                                                    std::vector<int64_t>{1}, 0, shuffle, kSeed);
+  }
+
+  std::vector<std::string> CacheFiles() {
+    std::vector<std::string> cache_files;
+    for (const std::string& name : fs_.ListDir(cache_dir_)) {
+      if (name.size() > 5 && name.substr(name.size() - 5) == ".sidx") {
+        cache_files.push_back(JoinPath(cache_dir_, name));
+      }
+    }
+    return cache_files;
+  }
+
+  fs::PosixFileSystem fs_;
+  std::string dir_;
+  std::string cache_dir_;
+  std::string prefix_;
+  std::vector<int32_t> sizes_;
+};
+
+}  // namespace
+
+TEST_F(GPTDatasetTest, same_samples_as_sequential_indices) {
+  setenv("ONEFLOW_GPT_DATASET_INDICES_CACHE", "0", 1);
+  // a single epoch, a merged last epoch and a separate last epoch
+  for (const size_t num_samples : {10, 57, 130}) {
+    for (const bool shuffle : {false, true}) {
+      ASSERT_EQ(GetSamples(*NewDataset(num_samples, shuffle)),
+                SequentialSamples(sizes_, num_samples, shuffle));
+    }
+  }
+  ASSERT_TRUE(CacheFiles().empty());
+}
+
+TEST_F(GPTDatasetTest, save_and_load_indices_cache) {
+  const auto expected = SequentialSamples(sizes_, 57, true);
+  ASSERT_EQ(GetSamples(*NewDataset(57, true)), expected);
+  const std::vector<std::string> cache_files = CacheFiles();
+  ASSERT_EQ(cache_files.size(), 1);
+  const std::string& cache_path = cache_files.front();
+  const size_t total_num_samples = expected.size();
+
+  // Reverse the shuffle indices at the end of the cache file. The loaded dataset follows the
+  // file, which shows that it is loaded instead of rebuilt.
+  {
+    std::fstream file(cache_path, std::ios::in | std::ios::out | std::ios::binary);
+    std::vector<size_t> shuffle_indices(total_num_samples);
+    file.seekg(-static_cast<int64_t>(total_num_samples * sizeof(size_t)), std::ios::end);
+    file.read(reinterpret_cast<char*>(shuffle_indices.data()), total_num_samples * sizeof(size_t));
+    std::reverse(shuffle_indices.begin(), shuffle_indices.end());
+    file.seekp(-static_cast<int64_t>(total_num_samples * sizeof(size_t)), std::ios::end);
+    file.write(reinterpret_cast<const char*>(shuffle_indices.data()),
+               total_num_samples * sizeof(size_t));
+  }
+  const auto loaded = GetSamples(*NewDataset(57, true));
+  FOR_RANGE(size_t, i, 0, total_num_samples) {
+    ASSERT_EQ(loaded.at(i), expected.at(total_num_samples - 1 - i));
+  }
+
+  // Another configuration has its own cache file.
+  ASSERT_EQ(GetSamples(*NewDataset(57, false)), SequentialSamples(sizes_, 57, false));
+  ASSERT_EQ(CacheFiles().size(), 2);
+}
+
+TEST_F(GPTDatasetTest, reject_stale_indices_cache) {
+  const auto expected = SequentialSamples(sizes_, 57, true);
+  ASSERT_EQ(GetSamples(*NewDataset(57, true)), expected);
+  const std::string cache_path = CacheFiles().front();
+  const uint64_t cache_size = fs_.GetFileSize(cache_path);
+
+  // The version follows the 8-byte magic code in the header.
+  const auto ReadVersion = [&]() {
+    std::ifstream file(cache_path, std::ios::binary);
+    uint64_t version = 0;
+    file.seekg(8);
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    return version;
+  };
+  const uint64_t version = ReadVersion();
+  {
+    std::fstream file(cache_path, std::ios::in | std::ios::out | std::ios::binary);
+    const uint64_t stale_version = version + 1;
+    file.seekp(8);
+    file.write(reinterpret_cast<const char*>(&stale_version), sizeof(stale_version));
+  }
+  ASSERT_EQ(GetSamples(*NewDataset(57, true)), expected);
+  // the stale cache is replaced
+  ASSERT_EQ(ReadVersion(), version);
+
+  {
+    std::ofstream file(cache_path, std::ios::binary | std::ios::app);
+    const uint64_t garbage = 0;
+    file.write(reinterpret_cast<const char*>(&garbage), sizeof(garbage));
+  }
+  ASSERT_EQ(fs_.GetFileSize(cache_path), cache_size + sizeof(uint64_t));
+  ASSERT_EQ(GetSamples(*NewDataset(57, true)), expected);
+  ASSERT_EQ(fs_.GetFileSize(cache_path), cache_size);
+}
+
+}  // namespace test
+
+}  // namespace data
+
+}  // namespace oneflow
@@ -0,0 +1,123 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/interleaved_part_reader.h"
+#include <numeric>
+
+namespace oneflow {
+
+namespace data {
+
+namespace {
+
+// Number of samples each slot reads ahead of the merge.
+size_t GetSlotBufferSize() {
+  const int64_t size = ParseIntegerFromEnv("ONEFLOW_DATA_INTERLEAVED_READ_BUFFER_SIZE", 64);
+  CHECK_GT(size, 0);
+  return size;
+}
+
+}  // namespace
+
+InterleavedPartReader::InterleavedPartReader(fs::FileSystem* fs,
+                                             const std::vector<std::string>& part_paths,
+                                             int32_t num_slots, const ReadSampleFn& read_sample_fn)
+    : InterleavedPartReader(fs, part_paths, num_slots, read_sample_fn,
+                            std::vector<int64_t>(part_paths.size(), 0), 0) {}
+
+InterleavedPartReader::InterleavedPartReader(fs::FileSystem* fs,
+                                             const std::vector<std::string>& part_paths,
+                                             int32_t num_slots, const ReadSampleFn& read_sample_fn,
+                                             const std::vector<int64_t>& part_offsets,
+                                             int32_t cur_slot)
+    : fs_(fs),
+      part_paths_(part_paths),
+      read_sample_fn_(read_sample_fn),
+      part_begins_(part_offsets),
+      part_offsets_(part_offsets),
+      cur_slot_(cur_slot) {
+  CHECK_GT(num_slots, 0);
+  CHECK_EQ(part_offsets_.size(), part_paths_.size());
+  num_slots = std::max<int32_t>(std::min<int32_t>(num_slots, part_paths_.size()), 1);
+  CHECK_GE(cur_slot_, 0);
+  cur_slot_ %= num_slots;
+  const size_t slot_buffer_size = GetSlotBufferSize();
+  FOR_RANGE(int32_t, i, 0, num_slots) {
+    slot_buffers_.emplace_back(new Buffer<Sample>(slot_buffer_size));
+  }
+  slot_finished_.resize(num_slots, false);
+  num_active_slots_ = num_slots;
+  FOR_RANGE(int32_t, i, 0, num_slots) {
+    slot_threads_.emplace_back(&InterleavedPartReader::ReadSlot, this, i);
+  }
+}
+
+InterleavedPartReader::~InterleavedPartReader() {
+  for (auto& buffer : slot_buffers_) { buffer->Close(); }
+  for (auto& thread : slot_threads_) { thread.join(); }
+}
+
+std::shared_ptr<TensorBuffer> InterleavedPartReader::Next() {
+  while (num_active_slots_ > 0) {
+    const int32_t slot_id = cur_slot_;
+    cur_slot_ = (cur_slot_ + 1) % slot_buffers_.size();
+    if (slot_finished_.at(slot_id)) { continue; }
+    Sample sample;
+    if (slot_buffers_.at(slot_id)->Pull(&sample) != BufferStatus::kBufferStatusSuccess) {
+      // the slot thread closes the buffer after its last part
+      slot_finished_.at(slot_id) = true;
+      num_active_slots_ -= 1;
+      continue;
+    }
+    part_offsets_.at(sample.part_id) += sample.size;
+    return sample.tensor;
+  }
+  return nullptr;
+}
+
+void InterleavedPartReader::ReadSlot(int32_t slot_id) {
+  Buffer<Sample>* buffer = slot_buffers_.at(slot_id).get();
+  for (size_t part_id = slot_id; part_id < part_paths_.size(); part_id += slot_buffers_.size()) {
+    const int64_t offset = part_begins_.at(part_id);
+    if (offset >= static_cast<int64_t>(fs_->GetFileSize(part_paths_.at(part_id)))) { continue; }
+    PersistentInStream in_stream(fs_, part_paths_.at(part_id), offset);
+    while (true) {
+      Sample sample;
+      sample.tensor.reset(new TensorBuffer());
+      sample.part_id = part_id;
+      sample.size = read_sample_fn_(&in_stream, sample.tensor.get());
+      if (sample.size < 0) { break; }
+      if (buffer->Push(sample) != BufferStatus::kBufferStatusSuccess) { return; }
+    }
+  }
+  buffer->Close();
+}
+
+std::vector<int64_t> SequentialToPartOffsets(const std::vector<int64_t>& part_sizes,
+                                             int64_t offset, bool cyclic) {
+  const int64_t total_size = std::accumulate(part_sizes.begin(), part_sizes.end(), int64_t(0));
+  if (cyclic && total_size > 0) { offset %= total_size; }
+  CHECK_LE(offset, total_size);
+  std::vector<int64_t> part_offsets(part_sizes.size(), 0);
+  FOR_RANGE(size_t, i, 0, part_sizes.size()) {
+    part_offsets.at(i) = std::min<int64_t>(offset, part_sizes.at(i));
+    offset -= part_offsets.at(i);
+  }
+  return part_offsets;
+}
+
+}  // namespace data
+
+}  // namespace oneflow
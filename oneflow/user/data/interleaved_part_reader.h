@@ -0,0 +1,85 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_INTERLEAVED_PART_READER_H_
+#define ONEFLOW_USER_DATA_INTERLEAVED_PART_READER_H_
+
+#include "oneflow/core/common/buffer.h"
+#include "oneflow/core/common/tensor_buffer.h"
+#include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/persistence/persistent_in_stream.h"
+
+namespace oneflow {
+
+namespace data {
+
+// Reads several part files at once. The parts are dealt round-robin to `num_slots` slots, each
+// of which reads its parts one after another in its own thread, and the samples of the slots
+// are merged round-robin too. A slot leaves the rotation once all its parts are read out, so
+// the merged order depends only on the part list and never on the timing of the threads.
+class InterleavedPartReader final {
+ public:
+  // Reads one sample from `in_stream` into `tensor`, returns the bytes consumed from the part
+  // file or -1 on eof.
+  using ReadSampleFn = std::function<int64_t(PersistentInStream* in_stream, TensorBuffer* tensor)>;
+
+  OF_DISALLOW_COPY_AND_MOVE(InterleavedPartReader);
+  InterleavedPartReader(fs::FileSystem* fs, const std::vector<std::string>& part_paths,
+                        int32_t num_slots, const ReadSampleFn& read_sample_fn);
+  // Resumes from the bytes consumed of each part and the slot which is merged next.
+  InterleavedPartReader(fs::FileSystem* fs, const std::vector<std::string>& part_paths,
+                        int32_t num_slots, const ReadSampleFn& read_sample_fn,
+                        const std::vector<int64_t>& part_offsets, int32_t cur_slot);
+  ~InterleavedPartReader();
+
+  // Returns nullptr once all the parts are read out.
+  std::shared_ptr<TensorBuffer> Next();
+
+  const std::vector<int64_t>& part_offsets() const { return part_offsets_; }
+  int32_t cur_slot() const { return cur_slot_; }
+
+ private:
+  struct Sample {
+    std::shared_ptr<TensorBuffer> tensor;
+    size_t part_id;
+    int64_t size;
+  };
+
+  void ReadSlot(int32_t slot_id);
+
+  fs::FileSystem* fs_;
+  std::vector<std::string> part_paths_;
+  ReadSampleFn read_sample_fn_;
+  // where the slot threads start reading each part
+  std::vector<int64_t> part_begins_;
+  // bytes consumed by Next of each part, the slot threads run ahead of them
+  std::vector<int64_t> part_offsets_;
+  std::vector<std::unique_ptr<Buffer<Sample>>> slot_buffers_;
+  std::vector<bool> slot_finished_;
+  int32_t num_active_slots_;
+  int32_t cur_slot_;
+  std::vector<std::thread> slot_threads_;
+};
+
+// Converts the bytes read by a sequential reader, which goes through the parts one after another,
+// into the bytes consumed of each part. A cyclic reader starts over after the last part.
+std::vector<int64_t> SequentialToPartOffsets(const std::vector<int64_t>& part_sizes,
+                                             int64_t offset, bool cyclic);
+
+}  // namespace data
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_INTERLEAVED_PART_READER_H_
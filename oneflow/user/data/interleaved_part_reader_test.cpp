@@ -0,0 +1,209 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdlib>
+#include <limits>
+#include <thread>
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/persistence/posix/posix_file_system.h"
+#include "oneflow/user/data/interleaved_part_reader.h"
+
+namespace oneflow {
+
+namespace data {
+
+namespace test {
+
+namespace {
+
+// Numbers of records in the parts, with an empty part and more parts than slots.
+const std::vector<int64_t> kPartNumRecords = {5, 0, 3, 8, 1, 4, 6};
+
+std::string RecordPayload(size_t part_id, int64_t record_id) {
+  // payloads of different sizes, so that a wrong offset never reads a valid record
+  return "part-" + std::to_string(part_id) + "-record-" + std::to_string(record_id)
+         + std::string(record_id % 5, '#');
+}
+
+int64_t RecordSize(size_t part_id, int64_t record_id) {
+  return sizeof(int64_t) + RecordPayload(part_id, record_id).size();
+}
+
+// Reads a length-prefixed record like OFRecordDataset, after a delay which varies from record to
+// record and from trial to trial, so that the slot threads run at different paces.
+int64_t ReadRecord(int32_t trial, PersistentInStream* in_stream, TensorBuffer* tensor) {
+  int64_t size = -1;
+  if (in_stream->ReadFully(reinterpret_cast<char*>(&size), sizeof(int64_t)) != 0) { return -1; }
+  tensor->Resize(Shape({size}), DataType::kChar);
+  CHECK_EQ(in_stream->ReadFully(tensor->mut_data<char>(), size), 0);
+  const size_t hash = std::hash<std::string>()(std::string(tensor->data<char>(), size));
+  std::this_thread::sleep_for(std::chrono::microseconds((hash + trial * 7919) % 300));
+  return sizeof(int64_t) + size;
+}
+
+std::vector<std::string> ReadAll(InterleavedPartReader* reader,
+                                 size_t max_num_records = std::numeric_limits<size_t>::max()) {
+  std::vector<std::string> records;
+  while (records.size() < max_num_records) {
+    std::shared_ptr<TensorBuffer> tensor = reader->Next();
+    if (!tensor) { break; }
+    records.emplace_back(tensor->data<char>(), tensor->nbytes());
+  }
+  return records;
+}
+
+// The parts are dealt round-robin to the slots, and the slots are merged round-robin.
+std::vector<std::string> ExpectedRecords(int32_t num_slots) {
+  num_slots = std::min<int32_t>(num_slots, kPartNumRecords.size());
+  std::vector<std::vector<std::string>> slot_records(num_slots);
+  FOR_RANGE(size_t, part_id, 0, kPartNumRecords.size()) {
+    FOR_RANGE(int64_t, record_id, 0, kPartNumRecords.at(part_id)) {
+      slot_records.at(part_id % num_slots).push_back(RecordPayload(part_id, record_id));
+    }
+  }
+  std::vector<std::string> records;
+  std::vector<size_t> slot_pos(num_slots, 0);
+  bool any_left = true;
+  while (any_left) {
+    any_left = false;
+    FOR_RANGE(int32_t, slot_id, 0, num_slots) {
+      if (slot_pos.at(slot_id) == slot_records.at(slot_id).size()) { continue; }
+      records.push_back(slot_records.at(slot_id).at(slot_pos.at(slot_id)++));
+      any_left = true;
+    }
+  }
+  return records;
+}
+
+class InterleavedPartReaderTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    std::string current_dir = GetCwd();
+    StringReplace(&current_dir, '\\', '/');
+    dir_ = JoinPath(current_dir, "tmp_interleaved_part_reader_test_dir");
+    fs_.RecursivelyCreateDirIfNotExist(dir_);
+    FOR_RANGE(size_t, part_id, 0, kPartNumRecords.size()) {
+      const std::string part_path = JoinPath(dir_, "part-" + std::to_string(part_id));
+      std::unique_ptr<fs::WritableFile> file;
+      fs_.NewWritableFile(part_path, &file);
+      int64_t part_size = 0;
+      FOR_RANGE(int64_t, record_id, 0, kPartNumRecords.at(part_id)) {
+        const std::string payload = RecordPayload(part_id, record_id);
+        const int64_t size = payload.size();
+        file->Append(reinterpret_cast<const char*>(&size), sizeof(int64_t));
+        file->Append(payload.data(), payload.size());
+        part_size += RecordSize(part_id, record_id);
+      }
+      file->Close();
+      part_paths_.push_back(part_path);
+      part_sizes_.push_back(part_size);
+    }
+  }
+  void TearDown() override {
+    unsetenv("ONEFLOW_DATA_INTERLEAVED_READ_BUFFER_SIZE");
+    fs_.RecursivelyDeleteDir(dir_);
+  }
+
+  std::unique_ptr<InterleavedPartReader> NewReader(int32_t num_slots, int32_t trial) {
+    using namespace std::placeholders;
+    return std::make_unique<InterleavedPartReader>(&fs_, part_paths_, num_slots,
+                                                   std::bind(&ReadRecord, trial, _1, _2));
+  }
+
+  std::unique_ptr<InterleavedPartReader> NewReader(int32_t num_slots, int32_t trial,
+                                                   const std::vector<int64_t>& part_offsets,
+                                                   int32_t cur_slot) {
+    using namespace std::placeholders;
+    return std::make_unique<InterleavedPartReader>(&fs_, part_paths_, num_slots,
+                                                   std::bind(&ReadRecord, trial, _1, _2),
+                                                   part_offsets, cur_slot);
+  }
+
+  fs::PosixFileSystem fs_;
+  std::string dir_;
+  std::vector<std::string> part_paths_;
+  std::vector<int64_t> part_sizes_;
+};
+
+}  // namespace
+
+TEST_F(InterleavedPartReaderTest, order_independent_of_thread_timing) {
+  // with a buffer of one sample, the slot threads wait for the merge all the time
+  for (const char* buffer_size : {"1", "64"}) {
+    setenv("ONEFLOW_DATA_INTERLEAVED_READ_BUFFER_SIZE", buffer_size, 1);
+    for (const int32_t num_slots : {1, 2, 3, 7, 10}) {
+      const std::vector<std::string> expected = ExpectedRecords(num_slots);
+      FOR_RANGE(int32_t, trial, 0, 4) {
+        const auto reader = NewReader(num_slots, trial);
+        ASSERT_EQ(ReadAll(reader.get()), expected) << num_slots << " slots, trial " << trial;
+        ASSERT_EQ(reader->part_offsets(), part_sizes_);
+      }
+    }
+  }
+}
+
+TEST_F(InterleavedPartReaderTest, resume_from_part_offsets) {
+  setenv("ONEFLOW_DATA_INTERLEAVED_READ_BUFFER_SIZE", "2", 1);
+  for (const int32_t num_slots : {2, 3}) {
+    const std::vector<std::string> expected = ExpectedRecords(num_slots);
+    FOR_RANGE(size_t, num_read, 0, expected.size() + 1) {
+      const auto reader = NewReader(num_slots, num_read);
+      ASSERT_EQ(ReadAll(reader.get(), num_read),
+                std::vector<std::string>(expected.begin(), expected.begin() + num_read));
+      const auto resumed =
+          NewReader(num_slots, num_read + 1, reader->part_offsets(), reader->cur_slot());
+      ASSERT_EQ(ReadAll(resumed.get()),
+                std::vector<std::string>(expected.begin() + num_read, expected.end()))
+          << num_slots << " slots, resumed after " << num_read << " records";
+    }
+  }
+}
+
+TEST_F(InterleavedPartReaderTest, resume_from_sequential_offset) {
+  // the records in the order of a sequential reader
+  std::vector<std::string> sequential;
+  std::vector<int64_t> offsets = {0};
+  FOR_RANGE(size_t, part_id, 0, kPartNumRecords.size()) {
+    FOR_RANGE(int64_t, record_id, 0, kPartNumRecords.at(part_id)) {
+      sequential.push_back(RecordPayload(part_id, record_id));
+      offsets.push_back(offsets.back() + RecordSize(part_id, record_id));
+    }
+  }
+  const int64_t total_size = offsets.back();
+  FOR_RANGE(size_t, num_read, 0, sequential.size() + 1) {
+    const std::vector<int64_t> part_offsets =
+        SequentialToPartOffsets(part_sizes_, offsets.at(num_read), false);
+    // a cyclic sequential reader goes on over the parts after the last one
+    ASSERT_EQ(SequentialToPartOffsets(part_sizes_, offsets.at(num_read) + 2 * total_size, true),
+              num_read == sequential.size() ? std::vector<int64_t>(part_sizes_.size(), 0)
+                                            : part_offsets);
+    // the resumed reader reads the records the sequential reader has not read, in its own order
+    const auto resumed = NewReader(3, num_read, part_offsets, 0);
+    std::vector<std::string> records = ReadAll(resumed.get());
+    std::vector<std::string> remaining(sequential.begin() + num_read, sequential.end());
+    std::sort(records.begin(), records.end());
+    std::sort(remaining.begin(), remaining.end());
+    ASSERT_EQ(records, remaining) << "resumed after " << num_read << " records";
+  }
+}
+
+}  // namespace test
+
+}  // namespace data
+
+}  // namespace oneflow
@@ -30,12 +30,17 @@ class OFRecordDataReader final : public DataReader<TensorBuffer> {
  public:
   OFRecordDataReader(user_op::KernelInitContext* ctx) : DataReader<TensorBuffer>(ctx) {
     loader_.reset(new OFRecordDataset(ctx));
-    parser_.reset(new OFRecordParser());
+    if (ctx->Attr<bool>("lazy_parse")) {
+      parser_.reset(new OFRecordSerializedParser());
+    } else {
+      parser_.reset(new OFRecordParser());
+    }
     if (ctx->Attr<bool>("random_shuffle")) {
       loader_.reset(new RandomShuffleDataset<TensorBuffer>(ctx, std::move(loader_)));
     }
     int32_t batch_size = ctx->TensorDesc4ArgNameAndIndex("out", 0)->shape().elem_cnt();
     loader_.reset(new BatchDataset<TensorBuffer>(batch_size, std::move(loader_)));
+    RegisterState(ctx);
     StartLoadThread();
   }
   ~OFRecordDataReader() = default;
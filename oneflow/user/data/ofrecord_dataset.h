@@ -25,6 +25,8 @@ limitations under the License.
 #include "oneflow/core/rpc/include/global_process_ctx.h"
 #include "oneflow/core/job/env_desc.h"
 #include "oneflow/user/data/dataset.h"
+#include "oneflow/user/data/interleaved_part_reader.h"
+#include "oneflow/user/data/ofrecord_index.h"
 
 namespace oneflow {
 namespace data {
@@ -36,6 +38,7 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
   OF_DISALLOW_COPY_AND_MOVE(OFRecordDataset);
   OFRecordDataset(user_op::KernelInitContext* ctx) {
     current_epoch_ = 0;
+    epoch_offset_ = 0;
     shuffle_after_epoch_ = ctx->Attr<bool>("shuffle_after_epoch");
 
     // in stream
@@ -51,8 +54,12 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
       data_file_paths_.push_back(
           JoinPath(data_dir, part_name_prefix + std::string(zero_count, '0') + num));
     }
+    ordered_file_paths_ = data_file_paths_;
 
+    bool global_shuffle = false;
+    int64_t seed = -1;
     bool is_local = false;
+    num_parallel_reads_ = 1;
     // NOTE(zwx): OFRecordDataset is used by OFRecordDataReader and
     // OFRecordImageClassificationDataReader both, the latter has no attr nd_sbp,
     // so it couldn't work in DDP for now. The If condition here could be removed when
@@ -63,6 +70,10 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
       // NOTE(zwx): OFRecordDataset is not consistent since attr nd_sbp is empty,
       // we assume that it works in DDP
       if (nd_sbp_str_vec.empty() && CHECK_JUST(IsMultiClient())) { is_local = true; }
+      global_shuffle = ctx->Attr<bool>("global_shuffle");
+      seed = ctx->Attr<int64_t>("seed");
+      num_parallel_reads_ = ctx->Attr<int32_t>("num_parallel_reads");
+      CHECK_GT(num_parallel_reads_, 0);
     }
     if (is_local) {
       parallel_id_ = GlobalProcessCtx::Rank();
@@ -71,10 +82,21 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
       parallel_id_ = ctx->parallel_ctx().parallel_id();
       parallel_num_ = ctx->parallel_ctx().parallel_num();
     }
+    if (global_shuffle) {
+      // every rank reads all the parts in random access, so there is no part split
+      global_shuffle_reader_.reset(new OFRecordGlobalShuffleReader(
+          DataFS(), data_file_paths_, parallel_id_, parallel_num_, seed));
+      return;
+    }
     CHECK_LE(parallel_num_, data_part_num_);
     BalancedSplitter bs(data_part_num_, parallel_num_);
     range_ = bs.At(parallel_id_);
     std::vector<std::string> local_file_paths = GetLocalFilePaths();
+    if (num_parallel_reads_ > 1) {
+      interleaved_reader_.reset(new InterleavedPartReader(DataFS(), local_file_paths,
+                                                          num_parallel_reads_, &ReadOFRecord));
+      return;
+    }
     in_stream_.reset(
         new PersistentInStream(DataFS(), local_file_paths, !shuffle_after_epoch_, false));
   }
@@ -82,32 +104,131 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
 
   LoadTargetPtrList Next() override {
     LoadTargetPtrList ret;
+    if (global_shuffle_reader_) {
+      ret.push_back(global_shuffle_reader_->Next());
+      return ret;
+    }
+    if (interleaved_reader_) {
+      LoadTargetPtr sample_ptr = interleaved_reader_->Next();
+      if (!sample_ptr) {
+        ResetInterleavedReader();
+        sample_ptr = interleaved_reader_->Next();
+        CHECK(sample_ptr);
+      }
+      ret.push_back(std::move(sample_ptr));
+      return ret;
+    }
     LoadTargetPtr sample_ptr(new TensorBuffer());
     ReadSample(*sample_ptr);
     ret.push_back(std::move(sample_ptr));
     return ret;
   }
 
+  bool SaveState(DatasetState* state) const override {
+    OFRecordDatasetState* ofrecord_state = state->mutable_ofrecord();
+    ofrecord_state->set_epoch(current_epoch_);
+    if (global_shuffle_reader_) {
+      ofrecord_state->set_sample_index(global_shuffle_reader_->sample_index());
+    } else if (interleaved_reader_) {
+      for (int64_t offset : interleaved_reader_->part_offsets()) {
+        ofrecord_state->add_part_offset(offset);
+      }
+      ofrecord_state->set_interleave_slot(interleaved_reader_->cur_slot());
+    } else {
+      ofrecord_state->set_offset(epoch_offset_);
+    }
+    return true;
+  }
+
+  void LoadState(const DatasetState& state) override {
+    CHECK(state.has_ofrecord());
+    const OFRecordDatasetState& ofrecord_state = state.ofrecord();
+    if (global_shuffle_reader_) {
+      global_shuffle_reader_->Seek(ofrecord_state.sample_index());
+      return;
+    }
+    // the part order of an epoch results from the shuffles of all the epochs before
+    data_file_paths_ = ordered_file_paths_;
+    current_epoch_ = 0;
+    while (current_epoch_ < ofrecord_state.epoch()) { ShuffleFilePaths(); }
+    std::vector<std::string> local_file_paths = GetLocalFilePaths();
+    if (interleaved_reader_) {
+      std::vector<int64_t> part_offsets(local_file_paths.size(), 0);
+      if (ofrecord_state.part_offset_size() > 0) {
+        CHECK_EQ(static_cast<size_t>(ofrecord_state.part_offset_size()), local_file_paths.size());
+        std::copy(ofrecord_state.part_offset().begin(), ofrecord_state.part_offset().end(),
+                  part_offsets.begin());
+      } else {
+        // saved by a sequential reader, which is cyclic unless the parts are shuffled
+        std::vector<int64_t> part_sizes;
+        for (const auto& path : local_file_paths) {
+          part_sizes.push_back(DataFS()->GetFileSize(path));
+        }
+        part_offsets =
+            SequentialToPartOffsets(part_sizes, ofrecord_state.offset(), !shuffle_after_epoch_);
+      }
+      interleaved_reader_.reset(new InterleavedPartReader(
+          DataFS(), local_file_paths, num_parallel_reads_, &ReadOFRecord, part_offsets,
+          ofrecord_state.interleave_slot()));
+      return;
+    }
+    CHECK_EQ(ofrecord_state.part_offset_size(), 0)
+        << "the state was saved by an OFRecordReader with num_parallel_reads > 1";
+    epoch_offset_ = ofrecord_state.offset();
+    int64_t stream_offset = epoch_offset_;
+    if (!shuffle_after_epoch_) {
+      // the cyclic stream goes on over the parts again and again
+      int64_t local_size = 0;
+      for (const auto& path : local_file_paths) { local_size += DataFS()->GetFileSize(path); }
+      stream_offset %= local_size;
+    }
+    in_stream_.reset(new PersistentInStream(DataFS(), local_file_paths, stream_offset,
+                                            !shuffle_after_epoch_, false));
+  }
+
  private:
-  void ReadSample(TensorBuffer& tensor) {
+  // Reads a length-prefixed record, returns the bytes consumed or -1 on eof.
+  static int64_t ReadOFRecord(PersistentInStream* in_stream, TensorBuffer* tensor) {
     int64_t OFRecord_size = -1;
     char* size_ptr = reinterpret_cast<char*>(&OFRecord_size);
-    if (in_stream_->ReadFully(size_ptr, sizeof(int64_t)) != 0) {
+    if (in_stream->ReadFully(size_ptr, sizeof(int64_t)) != 0) { return -1; }
+    CHECK_GT(OFRecord_size, 0);
+    tensor->Resize(Shape({OFRecord_size}), DataType::kChar);
+    CHECK_EQ(in_stream->ReadFully(tensor->mut_data<char>(), OFRecord_size), 0);
+    return sizeof(int64_t) + OFRecord_size;
+  }
+
+  void ReadSample(TensorBuffer& tensor) {
+    int64_t size = ReadOFRecord(in_stream_.get(), &tensor);
+    if (size < 0) {
       ShuffleAfterEpoch();
-      CHECK_EQ(in_stream_->ReadFully(size_ptr, sizeof(int64_t)), 0);
+      size = ReadOFRecord(in_stream_.get(), &tensor);
+      CHECK_GT(size, 0);
     }
-    CHECK_GT(OFRecord_size, 0);
-    tensor.Resize(Shape({OFRecord_size}), DataType::kChar);
-    CHECK_EQ(in_stream_->ReadFully(tensor.mut_data<char>(), OFRecord_size), 0);
+    epoch_offset_ += size;
+  }
+
+  // All the local parts are read out. Like the cyclic stream, the parts start over in the same
+  // order unless they are shuffled after every epoch.
+  void ResetInterleavedReader() {
+    if (shuffle_after_epoch_) { ShuffleFilePaths(); }
+    interleaved_reader_.reset();
+    interleaved_reader_.reset(new InterleavedPartReader(DataFS(), GetLocalFilePaths(),
+                                                        num_parallel_reads_, &ReadOFRecord));
   }
 
   void ShuffleAfterEpoch() {
     CHECK(shuffle_after_epoch_);
+    ShuffleFilePaths();
+    std::vector<std::string> local_file_paths = GetLocalFilePaths();
+    in_stream_.reset(new PersistentInStream(DataFS(), local_file_paths, false, false));
+    epoch_offset_ = 0;
+  }
+
+  void ShuffleFilePaths() {
     current_epoch_++;  // move to next epoch
     std::mt19937 g(kOneflowDatasetSeed + current_epoch_);
     std::shuffle(data_file_paths_.begin(), data_file_paths_.end(), g);
-    std::vector<std::string> local_file_paths = GetLocalFilePaths();
-    in_stream_.reset(new PersistentInStream(DataFS(), local_file_paths, false, false));
   }
 
   std::vector<std::string> GetLocalFilePaths() {
@@ -117,14 +238,19 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
   }
 
   int32_t current_epoch_;
+  int64_t epoch_offset_;
   bool shuffle_after_epoch_;
+  int32_t num_parallel_reads_;
 
   int32_t data_part_num_;
   int32_t parallel_id_;
   int32_t parallel_num_;
   Range range_;
+  std::vector<std::string> ordered_file_paths_;
   std::vector<std::string> data_file_paths_;
   std::unique_ptr<PersistentInStream> in_stream_;
+  std::unique_ptr<InterleavedPartReader> interleaved_reader_;
+  std::unique_ptr<OFRecordGlobalShuffleReader> global_shuffle_reader_;
 };
 
 }  // namespace data
@@ -0,0 +1,249 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/ofrecord_index.h"
+#include "oneflow/user/data/dataset.h"
+#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/persistence/persistent_in_stream.h"
+#include "oneflow/core/rpc/include/global_process_ctx.h"
+
+namespace oneflow {
+
+namespace data {
+
+namespace {
+
+constexpr size_t kDefaultGlobalShuffleWindowSize = 256;
+constexpr int64_t kDefaultGlobalShuffleCoalesceGap = 64 * 1024;
+
+struct RecordLocation {
+  size_t part_id;
+  int64_t offset;
+  int64_t size;
+  size_t window_slot;
+};
+
+}  // namespace
+
+constexpr char OFRecordIndex::kMagicCode[];
+
+OFRecordIndex::OFRecordIndex(fs::FileSystem* fs, const std::string& part_path) {
+  if (Load(fs, part_path)) { return; }
+  auto start = std::chrono::system_clock::now();
+  Build(fs, part_path);
+  std::chrono::duration<double, std::milli> elapse = std::chrono::system_clock::now() - start;
+  LOG(INFO) << "Build OFRecord index by scanning " << part_path
+            << ", number of records: " << num_records() << ", elapsed time: " << elapse.count()
+            << " ms";
+  if (ParseBooleanFromEnv("ONEFLOW_OFRECORD_INDEX_SAVE", false)) { Save(fs, part_path); }
+}
+
+bool OFRecordIndex::Load(fs::FileSystem* fs, const std::string& part_path) {
+  const std::string index_path = IndexPath(part_path);
+  if (!fs->FileExists(index_path)) { return false; }
+  const uint64_t index_size = fs->GetFileSize(index_path);
+  const uint64_t header_size = kMagicCodeLen + sizeof(int64_t);
+  if (index_size < header_size) {
+    LOG(WARNING) << "Ignore the truncated OFRecord index " << index_path;
+    return false;
+  }
+  std::unique_ptr<fs::RandomAccessFile> file;
+  fs->NewRandomAccessFile(index_path, &file);
+  std::vector<char> header(header_size);
+  file->Read(0, header_size, header.data());
+  int64_t num_records = 0;
+  std::memcpy(&num_records, header.data() + kMagicCodeLen, sizeof(int64_t));
+  if (std::memcmp(header.data(), kMagicCode, kMagicCodeLen) != 0 || num_records < 0
+      || index_size != header_size + (num_records + 1) * sizeof(int64_t)) {
+    LOG(WARNING) << "Ignore the malformed OFRecord index " << index_path;
+    return false;
+  }
+  offsets_.resize(num_records + 1);
+  file->Read(header_size, offsets_.size() * sizeof(int64_t),
+             reinterpret_cast<char*>(offsets_.data()));
+  // every record holds a size field and a non-empty payload, so the offsets strictly increase
+  if (offsets_.front() != 0
+      || std::adjacent_find(offsets_.cbegin(), offsets_.cend(), std::greater_equal<int64_t>())
+             != offsets_.cend()) {
+    LOG(WARNING) << "Ignore the malformed OFRecord index " << index_path;
+    offsets_.clear();
+    return false;
+  }
+  if (offsets_.back() != static_cast<int64_t>(fs->GetFileSize(part_path))) {
+    LOG(WARNING) << "Ignore the stale OFRecord index " << index_path;
+    offsets_.clear();
+    return false;
+  }
+  return true;
+}
+
+void OFRecordIndex::Build(fs::FileSystem* fs, const std::string& part_path) {
+  PersistentInStream in_stream(fs, part_path);
+  std::vector<char> payload;
+  int64_t offset = 0;
+  int64_t record_size = -1;
+  while (in_stream.ReadFully(reinterpret_cast<char*>(&record_size), sizeof(int64_t)) == 0) {
+    CHECK_GT(record_size, 0);
+    offsets_.push_back(offset);
+    payload.resize(record_size);
+    CHECK_EQ(in_stream.ReadFully(payload.data(), record_size), 0);
+    offset += sizeof(int64_t) + record_size;
+  }
+  CHECK_EQ(offset, static_cast<int64_t>(fs->GetFileSize(part_path)));
+  offsets_.push_back(offset);
+}
+
+void OFRecordIndex::Save(fs::FileSystem* fs, const std::string& part_path) const {
+  const std::string index_path = IndexPath(part_path);
+  // ranks may index the same part concurrently, the rename keeps the index file whole
+  const std::string tmp_path = index_path + ".tmp" + std::to_string(GlobalProcessCtx::Rank());
+  std::unique_ptr<fs::WritableFile> file;
+  fs->NewWritableFile(tmp_path, &file);
+  const int64_t num_records = this->num_records();
+  file->Append(kMagicCode, kMagicCodeLen);
+  file->Append(reinterpret_cast<const char*>(&num_records), sizeof(int64_t));
+  file->Append(reinterpret_cast<const char*>(offsets_.data()), offsets_.size() * sizeof(int64_t));
+  file->Close();
+  fs->RenameFile(tmp_path, index_path);
+}
+
+OFRecordGlobalShuffleReader::OFRecordGlobalShuffleReader(
+    fs::FileSystem* fs, const std::vector<std::string>& part_paths, int64_t parallel_id,
+    int64_t parallel_num, int64_t seed)
+    : fs_(fs),
+      part_paths_(part_paths),
+      parallel_id_(parallel_id),
+      parallel_num_(parallel_num),
+      // a random seed would differ among the ranks, so the default seed is used instead
+      seed_(seed == -1 ? kOneflowDatasetSeed : seed),
+      epoch_(-1),
+      epoch_pos_(0),
+      window_pos_(0) {
+  part_files_.resize(part_paths_.size());
+  part_record_begins_.push_back(0);
+  for (const auto& part_path : part_paths_) {
+    indices_.emplace_back(new OFRecordIndex(fs_, part_path));
+    part_record_begins_.push_back(part_record_begins_.back() + indices_.back()->num_records());
+  }
+  const int64_t num_records = part_record_begins_.back();
+  CHECK_GE(num_records, parallel_num_);
+  num_local_records_ = BalancedSplitter(num_records, parallel_num_).At(parallel_id_).size();
+  window_size_ = std::max<int64_t>(ParseIntegerFromEnv("ONEFLOW_OFRECORD_GLOBAL_SHUFFLE_WINDOW",
+                                                       kDefaultGlobalShuffleWindowSize),
+                                   1);
+  coalesce_gap_ = ParseIntegerFromEnv("ONEFLOW_OFRECORD_GLOBAL_SHUFFLE_COALESCE_GAP",
+                                      kDefaultGlobalShuffleCoalesceGap);
+  Seek(0);
+}
+
+std::shared_ptr<TensorBuffer> OFRecordGlobalShuffleReader::Next() {
+  if (window_pos_ == window_.size()) {
+    if (epoch_pos_ == num_local_records_) {
+      InitEpoch(epoch_ + 1);
+      epoch_pos_ = 0;
+    }
+    FillWindow();
+  }
+  epoch_pos_ += 1;
+  return std::move(window_.at(window_pos_++));
+}
+
+void OFRecordGlobalShuffleReader::Seek(int64_t sample_index) {
+  CHECK_GE(sample_index, 0);
+  const int64_t epoch = sample_index / num_local_records_;
+  if (epoch != epoch_) { InitEpoch(epoch); }
+  epoch_pos_ = sample_index % num_local_records_;
+  window_.clear();
+  window_pos_ = 0;
+}
+
+void OFRecordGlobalShuffleReader::InitEpoch(int64_t epoch) {
+  // every rank draws the same permutation and takes its own slice of it
+  std::vector<int64_t> permutation(part_record_begins_.back());
+  std::iota(permutation.begin(), permutation.end(), 0);
+  std::seed_seq seq({seed_ & 0xffffffff, seed_ >> 32, epoch});
+  std::mt19937 g(seq);
+  std::shuffle(permutation.begin(), permutation.end(), g);
+  Range range = BalancedSplitter(permutation.size(), parallel_num_).At(parallel_id_);
+  epoch_records_.assign(permutation.begin() + range.begin(), permutation.begin() + range.end());
+  epoch_ = epoch;
+}
+
+void OFRecordGlobalShuffleReader::FillWindow() {
+  const size_t window_size = std::min<int64_t>(window_size_, num_local_records_ - epoch_pos_);
+  std::vector<RecordLocation> locations(window_size);
+  FOR_RANGE(size_t, i, 0, window_size) {
+    const int64_t record_id = epoch_records_.at(epoch_pos_ + i);
+    auto it =
+        std::upper_bound(part_record_begins_.begin(), part_record_begins_.end(), record_id) - 1;
+    RecordLocation& location = locations[i];
+    location.part_id = it - part_record_begins_.begin();
+    const OFRecordIndex& index = *indices_.at(location.part_id);
+    location.offset = index.record_offset(record_id - *it);
+    location.size = index.record_size(record_id - *it);
+    location.window_slot = i;
+  }
+  std::sort(locations.begin(), locations.end(),
+            [](const RecordLocation& lhs, const RecordLocation& rhs) {
+              return std::make_pair(lhs.part_id, lhs.offset)
+                     < std::make_pair(rhs.part_id, rhs.offset);
+            });
+  // Let a mapped part file fault in the whole window at once, before the records are copied.
+  for (const RecordLocation& location : locations) {
+    PartFile(location.part_id)->AdviseWillNeed(location.offset, sizeof(int64_t) + location.size);
+  }
+  window_.resize(window_size);
+  size_t i = 0;
+  while (i < locations.size()) {
+    const int64_t read_begin = locations[i].offset;
+    int64_t read_end = read_begin + sizeof(int64_t) + locations[i].size;
+    size_t j = i + 1;
+    while (j < locations.size() && locations[j].part_id == locations[i].part_id
+           && locations[j].offset - read_end <= coalesce_gap_) {
+      read_end = locations[j].offset + sizeof(int64_t) + locations[j].size;
+      j += 1;
+    }
+    fs::RandomAccessFile* file = PartFile(locations[i].part_id);
+    const char* read_data = file->MappedData(read_begin, read_end - read_begin);
+    if (read_data == nullptr) {
+      read_buffer_.resize(read_end - read_begin);
+      file->Read(read_begin, read_buffer_.size(), read_buffer_.data());
+      read_data = read_buffer_.data();
+    }
+    for (; i < j; ++i) {
+      const RecordLocation& location = locations[i];
+      const char* record = read_data + (location.offset - read_begin);
+      int64_t record_size = -1;
+      std::memcpy(&record_size, record, sizeof(int64_t));
+      CHECK_EQ(record_size, location.size) << "OFRecord index mismatches its part file "
+                                           << part_paths_.at(location.part_id);
+      std::shared_ptr<TensorBuffer> tensor(new TensorBuffer());
+      tensor->Resize(Shape({record_size}), DataType::kChar);
+      std::memcpy(tensor->mut_data<char>(), record + sizeof(int64_t), record_size);
+      window_[location.window_slot] = std::move(tensor);
+    }
+  }
+  window_pos_ = 0;
+}
+
+fs::RandomAccessFile* OFRecordGlobalShuffleReader::PartFile(size_t part_id) {
+  auto& file = part_files_.at(part_id);
+  if (!file) { fs_->NewRandomAccessFile(part_paths_.at(part_id), &file); }
+  return file.get();
+}
+
+}  // namespace data
+
+}  // namespace oneflow
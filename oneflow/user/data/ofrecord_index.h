@@ -0,0 +1,103 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_OFRECORD_INDEX_H_
+#define ONEFLOW_USER_DATA_OFRECORD_INDEX_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/tensor_buffer.h"
+#include "oneflow/core/persistence/file_system.h"
+
+namespace oneflow {
+
+namespace data {
+
+// Offsets of the length-prefixed records in an OFRecord part file. The index is kept in the
+// sidecar file "<part>.index": the magic code, the record number N and N + 1 int64 offsets, the
+// last of which is the part file size.
+class OFRecordIndex final {
+ public:
+  OFRecordIndex(fs::FileSystem* fs, const std::string& part_path);
+  ~OFRecordIndex() = default;
+
+  static constexpr char kMagicCode[] = "OFRIDX01";
+  static constexpr size_t kMagicCodeLen = sizeof(kMagicCode) - 1;
+
+  static std::string IndexPath(const std::string& part_path) { return part_path + ".index"; }
+
+  size_t num_records() const { return offsets_.size() - 1; }
+  // offset of the length prefix of the record
+  int64_t record_offset(size_t index) const { return offsets_.at(index); }
+  // size of the record payload which follows the length prefix
+  int64_t record_size(size_t index) const {
+    return offsets_.at(index + 1) - offsets_.at(index) - sizeof(int64_t);
+  }
+
+ private:
+  bool Load(fs::FileSystem* fs, const std::string& part_path);
+  void Build(fs::FileSystem* fs, const std::string& part_path);
+  void Save(fs::FileSystem* fs, const std::string& part_path) const;
+
+  std::vector<int64_t> offsets_;
+};
+
+// Reads the records of all the part files in a seeded global permutation, which is renewed
+// every epoch and split evenly among the ranks. Records are fetched in windows, and the reads
+// of a window are sorted by offset and coalesced, so that nearby records share one read.
+// All the ranks must be given the same seed, and -1 means the default dataset seed.
+class OFRecordGlobalShuffleReader final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(OFRecordGlobalShuffleReader);
+  OFRecordGlobalShuffleReader(fs::FileSystem* fs, const std::vector<std::string>& part_paths,
+                              int64_t parallel_id, int64_t parallel_num, int64_t seed);
+  ~OFRecordGlobalShuffleReader() = default;
+
+  std::shared_ptr<TensorBuffer> Next();
+  // Resumes reading from the `sample_index`-th sample of this rank, counted from the first
+  // epoch. The same sample index always yields the same record.
+  void Seek(int64_t sample_index);
+  int64_t sample_index() const { return epoch_ * num_local_records_ + epoch_pos_; }
+
+ private:
+  void InitEpoch(int64_t epoch);
+  void FillWindow();
+  fs::RandomAccessFile* PartFile(size_t part_id);
+
+  fs::FileSystem* fs_;
+  std::vector<std::string> part_paths_;
+  std::vector<std::unique_ptr<fs::RandomAccessFile>> part_files_;
+  std::vector<std::unique_ptr<const OFRecordIndex>> indices_;
+  // the global index of the first record of each part, and the total number at the end
+  std::vector<int64_t> part_record_begins_;
+  int64_t parallel_id_;
+  int64_t parallel_num_;
+  int64_t seed_;
+  int64_t num_local_records_;
+  size_t window_size_;
+  int64_t coalesce_gap_;
+
+  int64_t epoch_;
+  int64_t epoch_pos_;
+  std::vector<int64_t> epoch_records_;
+  std::vector<std::shared_ptr<TensorBuffer>> window_;
+  size_t window_pos_;
+  std::vector<char> read_buffer_;
+};
+
+}  // namespace data
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_OFRECORD_INDEX_H_
@@ -0,0 +1,253 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/common/global.h"
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/control/ctrl_bootstrap.pb.h"
+#include "oneflow/core/persistence/posix/posix_file_system.h"
+#include "oneflow/user/data/ofrecord_index.h"
+
+namespace oneflow {
+
+namespace data {
+
+namespace test {
+
+namespace {
+
+std::string RecordPayload(int64_t record_id) {
+  // payloads of different sizes, so that a wrong offset never reads a valid record
+  return "record-" + std::to_string(record_id) + std::string(record_id % 7, '#');
+}
+
+// Writes the records [begin, end) as length-prefixed payloads.
+void WritePart(fs::FileSystem* fs, const std::string& part_path, int64_t begin, int64_t end,
+               bool append = false) {
+  std::unique_ptr<fs::WritableFile> file;
+  if (append) {
+    fs->NewAppendableFile(part_path, &file);
+  } else {
+    fs->NewWritableFile(part_path, &file);
+  }
+  FOR_RANGE(int64_t, record_id, begin, end) {
+    const std::string payload = RecordPayload(record_id);
+    const int64_t size = payload.size();
+    file->Append(reinterpret_cast<const char*>(&size), sizeof(int64_t));
+    file->Append(payload.data(), payload.size());
+  }
+  file->Close();
+}
+
+std::string ReadRecord(fs::FileSystem* fs, const std::string& part_path,
+                       const OFRecordIndex& index, size_t i) {
+  std::unique_ptr<fs::RandomAccessFile> file;
+  fs->NewRandomAccessFile(part_path, &file);
+  std::string payload(index.record_size(i), '\0');
+  file->Read(index.record_offset(i) + sizeof(int64_t), payload.size(), &payload.at(0));
+  return payload;
+}
+
+std::string ToString(const TensorBuffer& buffer) {
+  return std::string(buffer.data<char>(), buffer.nbytes());
+}
+
+class OFRecordIndexTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    // saving an index names its temporary file by the rank
+    Global<ProcessCtx>::New();
+    Global<ProcessCtx>::Get()->set_rank(0);
+    std::string current_dir = GetCwd();
+    StringReplace(&current_dir, '\\', '/');
+    dir_ = JoinPath(current_dir, "tmp_ofrecord_index_test_dir");
+    fs_.RecursivelyCreateDirIfNotExist(dir_);
+  }
+  void TearDown() override {
+    unsetenv("ONEFLOW_OFRECORD_INDEX_SAVE");
+    unsetenv("ONEFLOW_OFRECORD_GLOBAL_SHUFFLE_WINDOW");
+    fs_.RecursivelyDeleteDir(dir_);
+    Global<ProcessCtx>::Delete();
+  }
+
+  // Writes consecutive records into parts of the given sizes.
+  std::vector<std::string> WriteParts(const std::vector<int64_t>& part_sizes) {
+    std::vector<std::string> part_paths;
+    int64_t begin = 0;
+    FOR_RANGE(size_t, i, 0, part_sizes.size()) {
+      part_paths.push_back(JoinPath(dir_, "part-" + std::to_string(i)));
+      WritePart(&fs_, part_paths.back(), begin, begin + part_sizes.at(i));
+      begin += part_sizes.at(i);
+    }
+    return part_paths;
+  }
+
+  fs::PosixFileSystem fs_;
+  std::string dir_;
+};
+
+}  // namespace
+
+TEST_F(OFRecordIndexTest, build_save_and_load) {
+  const std::string part_path = WriteParts({10}).front();
+  const std::string index_path = OFRecordIndex::IndexPath(part_path);
+  setenv("ONEFLOW_OFRECORD_INDEX_SAVE", "1", 1);
+  const OFRecordIndex built(&fs_, part_path);
+  unsetenv("ONEFLOW_OFRECORD_INDEX_SAVE");
+  ASSERT_TRUE(fs_.FileExists(index_path));
+  ASSERT_EQ(built.num_records(), 10);
+  FOR_RANGE(size_t, i, 0, 10) {
+    ASSERT_EQ(ReadRecord(&fs_, part_path, built, i), RecordPayload(i));
+  }
+  const OFRecordIndex loaded(&fs_, part_path);
+  ASSERT_EQ(loaded.num_records(), built.num_records());
+  FOR_RANGE(size_t, i, 0, 10) {
+    ASSERT_EQ(loaded.record_offset(i), built.record_offset(i));
+    ASSERT_EQ(loaded.record_size(i), built.record_size(i));
+  }
+
+  // A consistent index is trusted without scanning the part file: an index of one record
+  // spanning the whole part is loaded as it is.
+  std::unique_ptr<fs::WritableFile> file;
+  fs_.NewWritableFile(index_path, &file);
+  const int64_t num_records = 1;
+  const int64_t offsets[2] = {0, static_cast<int64_t>(fs_.GetFileSize(part_path))};
+  file->Append(OFRecordIndex::kMagicCode, OFRecordIndex::kMagicCodeLen);
+  file->Append(reinterpret_cast<const char*>(&num_records), sizeof(int64_t));
+  file->Append(reinterpret_cast<const char*>(offsets), sizeof(offsets));
+  file->Close();
+  ASSERT_EQ(OFRecordIndex(&fs_, part_path).num_records(), 1);
+}
+
+TEST_F(OFRecordIndexTest, reject_stale_and_malformed_index) {
+  const std::string part_path = WriteParts({10}).front();
+  const std::string index_path = OFRecordIndex::IndexPath(part_path);
+  setenv("ONEFLOW_OFRECORD_INDEX_SAVE", "1", 1);
+  OFRecordIndex(&fs_, part_path);
+  unsetenv("ONEFLOW_OFRECORD_INDEX_SAVE");
+
+  // The part grows after the index is saved, so the index is stale and rebuilt.
+  WritePart(&fs_, part_path, 10, 13, /*append=*/true);
+  const OFRecordIndex rebuilt(&fs_, part_path);
+  ASSERT_EQ(rebuilt.num_records(), 13);
+  FOR_RANGE(size_t, i, 0, 13) {
+    ASSERT_EQ(ReadRecord(&fs_, part_path, rebuilt, i), RecordPayload(i));
+  }
+
+  // truncated header
+  std::unique_ptr<fs::WritableFile> file;
+  fs_.NewWritableFile(index_path, &file);
+  file->Append(OFRecordIndex::kMagicCode, 4);
+  file->Close();
+  ASSERT_EQ(OFRecordIndex(&fs_, part_path).num_records(), 13);
+
+  // wrong magic code
+  fs_.NewWritableFile(index_path, &file);
+  const int64_t num_records = 0;
+  const int64_t end_offset = fs_.GetFileSize(part_path);
+  file->Append("NOTINDEX", OFRecordIndex::kMagicCodeLen);
+  file->Append(reinterpret_cast<const char*>(&num_records), sizeof(int64_t));
+  file->Append(reinterpret_cast<const char*>(&end_offset), sizeof(int64_t));
+  file->Close();
+  ASSERT_EQ(OFRecordIndex(&fs_, part_path).num_records(), 13);
+
+  // record number mismatching the file size
+  fs_.NewWritableFile(index_path, &file);
+  const int64_t wrong_num_records = 5;
+  file->Append(OFRecordIndex::kMagicCode, OFRecordIndex::kMagicCodeLen);
+  file->Append(reinterpret_cast<const char*>(&wrong_num_records), sizeof(int64_t));
+  file->Append(reinterpret_cast<const char*>(&end_offset), sizeof(int64_t));
+  file->Close();
+  ASSERT_EQ(OFRecordIndex(&fs_, part_path).num_records(), 13);
+
+  // offsets not starting at zero, or not strictly increasing, though ending at the part size
+  const int64_t two_records = 2;
+  const std::vector<std::vector<int64_t>> bad_offsets = {
+      {8, 16, end_offset}, {0, end_offset + 8, end_offset}, {0, 0, end_offset}};
+  for (const auto& offsets : bad_offsets) {
+    fs_.NewWritableFile(index_path, &file);
+    file->Append(OFRecordIndex::kMagicCode, OFRecordIndex::kMagicCodeLen);
+    file->Append(reinterpret_cast<const char*>(&two_records), sizeof(int64_t));
+    file->Append(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(int64_t));
+    file->Close();
+    const OFRecordIndex index(&fs_, part_path);
+    ASSERT_EQ(index.num_records(), 13);
+    FOR_RANGE(size_t, i, 0, 13) {
+      ASSERT_EQ(ReadRecord(&fs_, part_path, index, i), RecordPayload(i));
+    }
+  }
+}
+
+TEST_F(OFRecordIndexTest, global_shuffle_covers_each_record_once) {
+  const std::vector<std::string> part_paths = WriteParts({5, 11, 1, 20});
+  const int64_t num_records = 37;
+  // a small window makes an epoch span several windows
+  setenv("ONEFLOW_OFRECORD_GLOBAL_SHUFFLE_WINDOW", "4", 1);
+  for (const int64_t parallel_num : {1, 3, 4}) {
+    std::vector<std::vector<std::string>> epoch2records(2);
+    FOR_RANGE(int64_t, parallel_id, 0, parallel_num) {
+      OFRecordGlobalShuffleReader reader(&fs_, part_paths, parallel_id, parallel_num, 7);
+      const int64_t num_local_records =
+          BalancedSplitter(num_records, parallel_num).At(parallel_id).size();
+      for (auto& records : epoch2records) {
+        FOR_RANGE(int64_t, i, 0, num_local_records) {
+          records.push_back(ToString(*reader.Next()));
+        }
+      }
+      ASSERT_EQ(reader.sample_index(), 2 * num_local_records);
+    }
+    std::vector<std::string> expected;
+    FOR_RANGE(int64_t, record_id, 0, num_records) { expected.push_back(RecordPayload(record_id)); }
+    std::sort(expected.begin(), expected.end());
+    for (const auto& records : epoch2records) {
+      std::vector<std::string> sorted_records = records;
+      std::sort(sorted_records.begin(), sorted_records.end());
+      ASSERT_EQ(sorted_records, expected);
+    }
+    // the permutation is renewed every epoch
+    ASSERT_NE(epoch2records.at(0), epoch2records.at(1));
+  }
+}
+
+TEST_F(OFRecordIndexTest, global_shuffle_seed_and_seek) {
+  const std::vector<std::string> part_paths = WriteParts({5, 11, 1, 20});
+  const auto ReadSamples = [&](int64_t seed, int64_t num_samples) {
+    OFRecordGlobalShuffleReader reader(&fs_, part_paths, 1, 2, seed);
+    std::vector<std::string> records;
+    FOR_RANGE(int64_t, i, 0, num_samples) { records.push_back(ToString(*reader.Next())); }
+    return records;
+  };
+  const std::vector<std::string> records = ReadSamples(7, 60);
+  ASSERT_EQ(ReadSamples(7, 60), records);
+  ASSERT_NE(ReadSamples(8, 60), records);
+  ASSERT_EQ(ReadSamples(-1, 60), ReadSamples(-1, 60));
+  // resume in the middle of an epoch, at an epoch boundary and in a later epoch
+  for (const int64_t sample_index : {5, 18, 19, 41}) {
+    OFRecordGlobalShuffleReader reader(&fs_, part_paths, 1, 2, 7);
+    reader.Seek(sample_index);
+    FOR_RANGE(int64_t, i, sample_index, 60) {
+      ASSERT_EQ(ToString(*reader.Next()), records.at(i));
+    }
+  }
+}
+
+}  // namespace test
+
+}  // namespace data
+
+}  // namespace oneflow
@@ -46,6 +46,27 @@ class OFRecordParser final : public Parser<TensorBuffer> {
   }
 };
 
+// Hands the serialized records over as they are, for decoders that read features lazily through
+// OFRecordView instead of deserializing the whole record.
+class OFRecordSerializedParser final : public Parser<TensorBuffer> {
+ public:
+  using LoadTargetPtr = std::shared_ptr<TensorBuffer>;
+  using LoadTargetPtrList = std::vector<LoadTargetPtr>;
+  OFRecordSerializedParser() = default;
+  ~OFRecordSerializedParser() = default;
+
+  void Parse(std::shared_ptr<LoadTargetPtrList> batch_data,
+             user_op::KernelComputeContext* ctx) override {
+    user_op::Tensor* out_tensor = ctx->Tensor4ArgNameAndIndex("out", 0);
+    TensorBuffer* dptr = out_tensor->mut_dptr<TensorBuffer>();
+    FOR_RANGE(size_t, i, 0, batch_data->size()) { dptr[i].Swap(batch_data->at(i).get()); }
+    if (batch_data->size() != out_tensor->shape().elem_cnt()) {
+      CHECK_EQ(out_tensor->mut_shape()->NumAxes(), 1);
+      out_tensor->mut_shape()->Set(0, batch_data->size());
+    }
+  }
+};
+
 }  // namespace data
 }  // namespace oneflow
 
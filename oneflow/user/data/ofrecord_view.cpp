@@ -0,0 +1,299 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/ofrecord_view.h"
+
+namespace oneflow {
+namespace data {
+
+namespace {
+
+// Protobuf wire types, see https://developers.google.com/protocol-buffers/docs/encoding
+constexpr int kWireTypeVarint = 0;
+constexpr int kWireTypeFixed64 = 1;
+constexpr int kWireTypeLengthDelimited = 2;
+constexpr int kWireTypeFixed32 = 5;
+
+constexpr int kOFRecordFeatureField = 1;
+constexpr int kMapEntryKeyField = 1;
+constexpr int kMapEntryValueField = 2;
+constexpr int kListValueField = 1;
+
+class WireReader final {
+ public:
+  WireReader(const char* data, size_t size) : cur_(data), end_(data + size) {}
+  explicit WireReader(const OFRecordBytes& bytes) : WireReader(bytes.data, bytes.size) {}
+
+  bool done() const { return cur_ == end_; }
+
+  bool ReadVarint(uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (cur_ == end_) { return false; }
+      const uint8_t byte = static_cast<uint8_t>(*cur_++);
+      result |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) {
+        *value = result;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool ReadTag(int* field, int* wire_type) {
+    uint64_t tag = 0;
+    if (!ReadVarint(&tag)) { return false; }
+    *field = static_cast<int>(tag >> 3);
+    *wire_type = static_cast<int>(tag & 0x7);
+    return *field > 0;
+  }
+
+  bool ReadBytes(size_t size, OFRecordBytes* bytes) {
+    if (size > static_cast<size_t>(end_ - cur_)) { return false; }
+    bytes->data = cur_;
+    bytes->size = size;
+    cur_ += size;
+    return true;
+  }
+
+  bool ReadLengthDelimited(OFRecordBytes* bytes) {
+    uint64_t size = 0;
+    return ReadVarint(&size) && ReadBytes(size, bytes);
+  }
+
+  bool Skip(int wire_type) {
+    uint64_t varint = 0;
+    OFRecordBytes bytes{};
+    switch (wire_type) {
+      case kWireTypeVarint: return ReadVarint(&varint);
+      case kWireTypeFixed64: return ReadBytes(8, &bytes);
+      case kWireTypeLengthDelimited: return ReadLengthDelimited(&bytes);
+      case kWireTypeFixed32: return ReadBytes(4, &bytes);
+      default: return false;  // groups are not used by record.proto
+    }
+  }
+
+ private:
+  const char* cur_;
+  const char* end_;
+};
+
+template<typename Src, typename T>
+void CopyFixed(const char* src, int64_t count, T* dst) {
+  if (std::is_same<Src, T>::value) {
+    std::memcpy(dst, src, count * sizeof(Src));
+    return;
+  }
+  FOR_RANGE(int64_t, i, 0, count) {
+    Src value;
+    std::memcpy(&value, src + i * sizeof(Src), sizeof(Src));
+    dst[i] = static_cast<T>(value);
+  }
+}
+
+// Walks the values of a numeric list in order. Runs of fixed-width values go to
+// on_fixed(const char* values, int64_t count), varints go to on_varint(uint64_t value).
+template<typename FixedVisitor, typename VarintVisitor>
+void VisitNumericList(const OFRecordBytes& list, size_t fixed_size, const FixedVisitor& on_fixed,
+                      const VarintVisitor& on_varint) {
+  const int fixed_wire_type = fixed_size == 4 ? kWireTypeFixed32 : kWireTypeFixed64;
+  WireReader reader(list);
+  while (!reader.done()) {
+    int field = 0;
+    int wire_type = 0;
+    CHECK(reader.ReadTag(&field, &wire_type)) << "Malformed OFRecord feature";
+    if (field != kListValueField) {
+      CHECK(reader.Skip(wire_type)) << "Malformed OFRecord feature";
+      continue;
+    }
+    OFRecordBytes bytes{};
+    if (wire_type == kWireTypeLengthDelimited) {
+      CHECK(reader.ReadLengthDelimited(&bytes)) << "Malformed OFRecord feature";
+      if (fixed_size > 0) {
+        CHECK_EQ(bytes.size % fixed_size, 0) << "Malformed OFRecord feature";
+        on_fixed(bytes.data, static_cast<int64_t>(bytes.size / fixed_size));
+      } else {
+        WireReader packed(bytes);
+        uint64_t value = 0;
+        while (!packed.done()) {
+          CHECK(packed.ReadVarint(&value)) << "Malformed OFRecord feature";
+          on_varint(value);
+        }
+      }
+    } else if (fixed_size > 0 && wire_type == fixed_wire_type) {
+      CHECK(reader.ReadBytes(fixed_size, &bytes)) << "Malformed OFRecord feature";
+      on_fixed(bytes.data, 1);
+    } else if (fixed_size == 0 && wire_type == kWireTypeVarint) {
+      uint64_t value = 0;
+      CHECK(reader.ReadVarint(&value)) << "Malformed OFRecord feature";
+      on_varint(value);
+    } else {
+      UNIMPLEMENTED() << "Unexpected wire type " << wire_type << " in OFRecord feature";
+    }
+  }
+}
+
+size_t FixedSize4Kind(OFRecordFeatureView::Kind kind) {
+  switch (kind) {
+    case OFRecordFeatureView::kFloatList: return sizeof(float);
+    case OFRecordFeatureView::kDoubleList: return sizeof(double);
+    default: return 0;
+  }
+}
+
+}  // namespace
+
+int64_t OFRecordFeatureView::value_size() const {
+  if (kind_ == kNone) { return 0; }
+  int64_t count = 0;
+  if (kind_ == kBytesList) {
+    WireReader reader(list_);
+    while (!reader.done()) {
+      int field = 0;
+      int wire_type = 0;
+      CHECK(reader.ReadTag(&field, &wire_type)) << "Malformed OFRecord feature";
+      if (field == kListValueField && wire_type == kWireTypeLengthDelimited) { ++count; }
+      CHECK(reader.Skip(wire_type)) << "Malformed OFRecord feature";
+    }
+    return count;
+  }
+  VisitNumericList(
+      list_, FixedSize4Kind(kind_), [&](const char*, int64_t n) { count += n; },
+      [&](uint64_t) { ++count; });
+  return count;
+}
+
+OFRecordBytes OFRecordFeatureView::bytes(int64_t index) const {
+  CHECK_EQ(kind_, kBytesList);
+  CHECK_GE(index, 0);
+  int64_t i = index;
+  WireReader reader(list_);
+  while (!reader.done()) {
+    int field = 0;
+    int wire_type = 0;
+    CHECK(reader.ReadTag(&field, &wire_type)) << "Malformed OFRecord feature";
+    if (field == kListValueField && wire_type == kWireTypeLengthDelimited) {
+      OFRecordBytes value{};
+      CHECK(reader.ReadLengthDelimited(&value)) << "Malformed OFRecord feature";
+      if (i == 0) { return value; }
+      --i;
+    } else {
+      CHECK(reader.Skip(wire_type)) << "Malformed OFRecord feature";
+    }
+  }
+  LOG(FATAL) << "bytes_list index " << index << " out of range, the list has " << index - i
+             << " values";
+  return OFRecordBytes{nullptr, 0};
+}
+
+template<typename T>
+void OFRecordFeatureView::CopyValues(T* dst, int64_t n) const {
+  CHECK(kind_ != kNone && kind_ != kBytesList);
+  int64_t copied = 0;
+  const auto OnFixed = [&](const char* src, int64_t count) {
+    count = std::min(count, n - copied);
+    if (kind_ == kFloatList) {
+      CopyFixed<float>(src, count, dst + copied);
+    } else {
+      CopyFixed<double>(src, count, dst + copied);
+    }
+    copied += count;
+  };
+  const auto OnVarint = [&](uint64_t value) {
+    if (copied == n) { return; }
+    if (kind_ == kInt32List) {
+      dst[copied++] = static_cast<T>(static_cast<int32_t>(value));
+    } else {
+      dst[copied++] = static_cast<T>(static_cast<int64_t>(value));
+    }
+  };
+  VisitNumericList(list_, FixedSize4Kind(kind_), OnFixed, OnVarint);
+  CHECK_EQ(copied, n) << "OFRecord feature has fewer than " << n << " values";
+}
+
+#define INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_VALUES(T) \
+  template void OFRecordFeatureView::CopyValues<T>(T * dst, int64_t n) const;
+INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_VALUES(char)
+INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_VALUES(float)
+INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_VALUES(double)
+INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_VALUES(int8_t)
+INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_VALUES(int32_t)
+INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_VALUES(int64_t)
+INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_VALUES(uint8_t)
+#undef INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_VALUES
+
+OFRecordView::OFRecordView(const char* data, size_t size) {
+  WireReader reader(data, size);
+  while (!reader.done()) {
+    int field = 0;
+    int wire_type = 0;
+    CHECK(reader.ReadTag(&field, &wire_type)) << "Malformed OFRecord";
+    if (field != kOFRecordFeatureField || wire_type != kWireTypeLengthDelimited) {
+      CHECK(reader.Skip(wire_type)) << "Malformed OFRecord";
+      continue;
+    }
+    OFRecordBytes map_entry{};
+    CHECK(reader.ReadLengthDelimited(&map_entry)) << "Malformed OFRecord";
+    Entry entry{{data, 0}, {data, 0}};
+    WireReader entry_reader(map_entry);
+    while (!entry_reader.done()) {
+      CHECK(entry_reader.ReadTag(&field, &wire_type)) << "Malformed OFRecord";
+      if (field == kMapEntryKeyField && wire_type == kWireTypeLengthDelimited) {
+        CHECK(entry_reader.ReadLengthDelimited(&entry.key)) << "Malformed OFRecord";
+      } else if (field == kMapEntryValueField && wire_type == kWireTypeLengthDelimited) {
+        CHECK(entry_reader.ReadLengthDelimited(&entry.value)) << "Malformed OFRecord";
+      } else {
+        CHECK(entry_reader.Skip(wire_type)) << "Malformed OFRecord";
+      }
+    }
+    entries_.push_back(entry);
+  }
+}
+
+bool OFRecordView::Find(const std::string& name, OFRecordFeatureView* feature) const {
+  // Like protobuf maps, the last entry of a duplicated key wins.
+  for (auto it = entries_.rbegin(); it != entries_.rend(); ++it) {
+    if (it->key.size != name.size() || std::memcmp(it->key.data, name.data(), name.size()) != 0) {
+      continue;
+    }
+    OFRecordFeatureView::Kind kind = OFRecordFeatureView::kNone;
+    OFRecordBytes list{it->value.data, 0};
+    WireReader reader(it->value);
+    while (!reader.done()) {
+      int field = 0;
+      int wire_type = 0;
+      CHECK(reader.ReadTag(&field, &wire_type)) << "Malformed OFRecord feature " << name;
+      if (field >= OFRecordFeatureView::kBytesList && field <= OFRecordFeatureView::kInt64List
+          && wire_type == kWireTypeLengthDelimited) {
+        kind = static_cast<OFRecordFeatureView::Kind>(field);
+        CHECK(reader.ReadLengthDelimited(&list)) << "Malformed OFRecord feature " << name;
+      } else {
+        CHECK(reader.Skip(wire_type)) << "Malformed OFRecord feature " << name;
+      }
+    }
+    *feature = OFRecordFeatureView(kind, list);
+    return true;
+  }
+  return false;
+}
+
+OFRecordFeatureView OFRecordView::Get(const std::string& name) const {
+  OFRecordFeatureView feature;
+  CHECK(Find(name, &feature)) << "Field " << name << " not found";
+  return feature;
+}
+
+}  // namespace data
+}  // namespace oneflow
@@ -0,0 +1,93 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_OFRECORD_VIEW_H_
+#define ONEFLOW_USER_DATA_OFRECORD_VIEW_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/tensor_buffer.h"
+
+namespace oneflow {
+namespace data {
+
+// A read-only slice of the serialized record.
+struct OFRecordBytes {
+  const char* data;
+  size_t size;
+};
+
+// Lazy view of one Feature message. Values are decoded straight from the wire format; both the
+// packed and the unpacked encodings of numeric lists are accepted.
+class OFRecordFeatureView final {
+ public:
+  enum Kind {
+    kNone = 0,
+    kBytesList = 1,
+    kFloatList = 2,
+    kDoubleList = 3,
+    kInt32List = 4,
+    kInt64List = 5,
+  };
+
+  OFRecordFeatureView() : kind_(kNone), list_{nullptr, 0} {}
+  OFRecordFeatureView(Kind kind, OFRecordBytes list) : kind_(kind), list_(list) {}
+  ~OFRecordFeatureView() = default;
+
+  Kind kind() const { return kind_; }
+  bool has_bytes_list() const { return kind_ == kBytesList; }
+  bool has_float_list() const { return kind_ == kFloatList; }
+  bool has_double_list() const { return kind_ == kDoubleList; }
+  bool has_int32_list() const { return kind_ == kInt32List; }
+  bool has_int64_list() const { return kind_ == kInt64List; }
+
+  // Number of values in the list, whatever its kind.
+  int64_t value_size() const;
+  // The i-th value of a bytes_list, pointing into the serialized record. Each call walks the list
+  // from its start, so it is meant for the common case of a handful of values.
+  OFRecordBytes bytes(int64_t index) const;
+  // Converts the first n values of a numeric list to T and writes them to dst.
+  template<typename T>
+  void CopyValues(T* dst, int64_t n) const;
+
+ private:
+  Kind kind_;
+  OFRecordBytes list_;
+};
+
+// Scans a serialized OFRecord once and remembers where each feature lives, without copying or
+// deserializing any of the payloads. The view must not outlive the serialized record.
+class OFRecordView final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(OFRecordView);
+  OFRecordView(const char* data, size_t size);
+  explicit OFRecordView(const TensorBuffer& buffer)
+      : OFRecordView(buffer.data<char>(), buffer.nbytes()) {}
+  ~OFRecordView() = default;
+
+  bool Find(const std::string& name, OFRecordFeatureView* feature) const;
+  OFRecordFeatureView Get(const std::string& name) const;
+
+ private:
+  struct Entry {
+    OFRecordBytes key;
+    OFRecordBytes value;
+  };
+  std::vector<Entry> entries_;
+};
+
+}  // namespace data
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_OFRECORD_VIEW_H_
@@ -0,0 +1,230 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/core/record/record.pb.h"
+#include "oneflow/user/data/ofrecord_view.h"
+
+namespace oneflow {
+
+namespace data {
+
+namespace test {
+
+namespace {
+
+void AppendVarint(std::string* dst, uint64_t value) {
+  while (value >= 0x80) {
+    dst->push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  dst->push_back(static_cast<char>(value));
+}
+
+void AppendTag(std::string* dst, int field, int wire_type) {
+  AppendVarint(dst, (static_cast<uint64_t>(field) << 3) | wire_type);
+}
+
+void AppendLengthDelimited(std::string* dst, int field, const std::string& payload) {
+  AppendTag(dst, field, 2);
+  AppendVarint(dst, payload.size());
+  dst->append(payload);
+}
+
+// A numeric list with one tag per value, which protobuf accepts for packed fields too.
+template<typename T>
+std::string UnpackedList(const std::vector<T>& values) {
+  std::string list;
+  for (const T value : values) {
+    if (std::is_floating_point<T>::value) {
+      AppendTag(&list, 1, sizeof(T) == 4 ? 5 : 1);
+      list.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    } else {
+      // negative int32 values are sign extended to 64 bits on the wire
+      AppendTag(&list, 1, 0);
+      AppendVarint(&list, static_cast<uint64_t>(static_cast<int64_t>(value)));
+    }
+  }
+  return list;
+}
+
+std::string RecordEntry(const std::string& key, int kind, const std::string& list) {
+  std::string feature;
+  AppendLengthDelimited(&feature, kind, list);
+  std::string entry;
+  AppendLengthDelimited(&entry, 1, key);
+  AppendLengthDelimited(&entry, 2, feature);
+  std::string record;
+  AppendLengthDelimited(&record, 1, entry);
+  return record;
+}
+
+template<typename T, typename List>
+void CheckNumericValues(const OFRecordFeatureView& view, const List& list) {
+  const int64_t size = list.value_size();
+  std::vector<T> expected(list.value().begin(), list.value().end());
+  std::vector<T> values(size);
+  view.CopyValues<T>(values.data(), size);
+  ASSERT_EQ(values, expected);
+  // a prefix of the values
+  if (size > 1) {
+    std::vector<T> prefix(size - 1);
+    view.CopyValues<T>(prefix.data(), size - 1);
+    ASSERT_EQ(prefix, std::vector<T>(expected.begin(), expected.end() - 1));
+  }
+}
+
+// Compares the view of every feature with the record parsed by protobuf.
+void CheckRecord(const std::string& serialized) {
+  OFRecord record;
+  ASSERT_TRUE(record.ParseFromString(serialized));
+  const OFRecordView view(serialized.data(), serialized.size());
+  for (const auto& pair : record.feature()) {
+    const Feature& feature = pair.second;
+    OFRecordFeatureView feature_view;
+    ASSERT_TRUE(view.Find(pair.first, &feature_view)) << pair.first;
+    ASSERT_EQ(static_cast<int>(feature_view.kind()), static_cast<int>(feature.kind_case()));
+    switch (feature.kind_case()) {
+      case Feature::kBytesList: {
+        ASSERT_EQ(feature_view.value_size(), feature.bytes_list().value_size());
+        FOR_RANGE(int64_t, i, 0, feature_view.value_size()) {
+          const OFRecordBytes bytes = feature_view.bytes(i);
+          ASSERT_EQ(std::string(bytes.data, bytes.size), feature.bytes_list().value(i));
+        }
+        break;
+      }
+      case Feature::kFloatList: {
+        ASSERT_EQ(feature_view.value_size(), feature.float_list().value_size());
+        CheckNumericValues<float>(feature_view, feature.float_list());
+        CheckNumericValues<double>(feature_view, feature.float_list());
+        break;
+      }
+      case Feature::kDoubleList: {
+        ASSERT_EQ(feature_view.value_size(), feature.double_list().value_size());
+        CheckNumericValues<double>(feature_view, feature.double_list());
+        CheckNumericValues<float>(feature_view, feature.double_list());
+        break;
+      }
+      case Feature::kInt32List: {
+        ASSERT_EQ(feature_view.value_size(), feature.int32_list().value_size());
+        CheckNumericValues<int32_t>(feature_view, feature.int32_list());
+        CheckNumericValues<int64_t>(feature_view, feature.int32_list());
+        break;
+      }
+      case Feature::kInt64List: {
+        ASSERT_EQ(feature_view.value_size(), feature.int64_list().value_size());
+        CheckNumericValues<int64_t>(feature_view, feature.int64_list());
+        break;
+      }
+      case Feature::KIND_NOT_SET: {
+        ASSERT_EQ(feature_view.value_size(), 0);
+        break;
+      }
+    }
+  }
+  OFRecordFeatureView missing;
+  ASSERT_FALSE(view.Find("missing", &missing));
+}
+
+}  // namespace
+
+TEST(OFRecordView, packed_features) {
+  OFRecord record;
+  auto* features = record.mutable_feature();
+  for (const std::string& value : {std::string("abc"), std::string(), std::string("\0\1\2", 3)}) {
+    (*features)["bytes"].mutable_bytes_list()->add_value(value);
+  }
+  for (const float value : {1.5f, -2.25f, 1e30f}) {
+    (*features)["float"].mutable_float_list()->add_value(value);
+  }
+  for (const double value : {0.1, -1e300, 3.0}) {
+    (*features)["double"].mutable_double_list()->add_value(value);
+  }
+  for (const int32_t value : {0, -1, 127, 128, -2147483647 - 1, 2147483647}) {
+    (*features)["int32"].mutable_int32_list()->add_value(value);
+  }
+  for (const int64_t value : {int64_t(0), int64_t(-1), int64_t(1) << 40, -(int64_t(1) << 62)}) {
+    (*features)["int64"].mutable_int64_list()->add_value(value);
+  }
+  (*features)["empty_float"].mutable_float_list();
+  (*features)["unset"];
+  CheckRecord(record.SerializeAsString());
+}
+
+TEST(OFRecordView, unpacked_features) {
+  const std::string serialized =
+      RecordEntry("float", 2, UnpackedList<float>({1.5f, -2.25f}))
+      + RecordEntry("double", 3, UnpackedList<double>({0.1, -1e300, 3.0}))
+      + RecordEntry("int32", 4, UnpackedList<int32_t>({0, -1, 300, -2147483647 - 1}))
+      + RecordEntry("int64", 5, UnpackedList<int64_t>({-1, int64_t(1) << 40}));
+  CheckRecord(serialized);
+  // packed and unpacked runs in the same list
+  FloatList packed_list;
+  packed_list.add_value(3.0f);
+  packed_list.add_value(4.0f);
+  CheckRecord(
+      RecordEntry("float", 2, UnpackedList<float>({1.0f, 2.0f}) + packed_list.SerializeAsString()));
+}
+
+TEST(OFRecordView, duplicate_keys) {
+  OFRecord first;
+  (*first.mutable_feature())["x"].mutable_float_list()->add_value(1.0f);
+  (*first.mutable_feature())["y"].mutable_bytes_list()->add_value("y");
+  OFRecord second;
+  (*second.mutable_feature())["x"].mutable_int64_list()->add_value(7);
+  // like protobuf, the last entry of a key wins
+  const std::string serialized = first.SerializeAsString() + second.SerializeAsString();
+  CheckRecord(serialized);
+  const OFRecordView view(serialized.data(), serialized.size());
+  ASSERT_TRUE(view.Get("x").has_int64_list());
+  ASSERT_TRUE(view.Get("y").has_bytes_list());
+}
+
+TEST(OFRecordView, unset_oneof) {
+  OFRecord record;
+  (*record.mutable_feature())["unset"];
+  const std::string serialized = record.SerializeAsString();
+  CheckRecord(serialized);
+  const OFRecordView view(serialized.data(), serialized.size());
+  const OFRecordFeatureView feature = view.Get("unset");
+  ASSERT_EQ(feature.kind(), OFRecordFeatureView::kNone);
+  ASSERT_EQ(feature.value_size(), 0);
+}
+
+TEST(OFRecordView, malformed_input) {
+  OFRecord record;
+  (*record.mutable_feature())["bytes"].mutable_bytes_list()->add_value("abc");
+  const std::string serialized = record.SerializeAsString();
+  // a record cut in the middle of a feature
+  const std::string truncated = serialized.substr(0, serialized.size() - 1);
+  ASSERT_FALSE(OFRecord().ParseFromString(truncated));
+  ASSERT_DEATH(OFRecordView(truncated.data(), truncated.size()), "Malformed OFRecord");
+  // a packed float list whose length is not a multiple of 4
+  std::string bad_list;
+  AppendLengthDelimited(&bad_list, 1, std::string(5, '\0'));
+  const std::string bad_float = RecordEntry("float", 2, bad_list);
+  ASSERT_FALSE(OFRecord().ParseFromString(bad_float));
+  const OFRecordView view(bad_float.data(), bad_float.size());
+  ASSERT_DEATH(view.Get("float").value_size(), "Malformed OFRecord feature");
+  // a bytes_list index out of range
+  const OFRecordView bytes_view(serialized.data(), serialized.size());
+  ASSERT_DEATH(bytes_view.Get("bytes").bytes(1), "index 1 out of range, the list has 1 values");
+}
+
+}  // namespace test
+
+}  // namespace data
+
+}  // namespace oneflow
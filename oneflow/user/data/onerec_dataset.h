@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "oneflow/core/common/blocking_counter.h"
 #include "oneflow/user/data/dataset.h"
+#include "oneflow/user/data/interleaved_part_reader.h"
 #include "oneflow/core/common/balanced_splitter.h"
 #include "oneflow/core/common/str_util.h"
 #include "oneflow/core/framework/op_kernel.h"
@@ -67,6 +68,35 @@ union OneRecFrameFooterView {
   XXH64_hash_t digest;
 };
 
+// Reads a frame and checks its digests, returns the bytes consumed or -1 on eof.
+inline int64_t ReadOneRecFrame(PersistentInStream* in_stream, TensorBuffer* tensor) {
+  static_assert(sizeof(OneRecFrameHeader) == kHeaderSize, "");
+  OneRecFrameHeaderView header_view{};
+  static_assert(sizeof(header_view.header) == kHeaderSize, "");
+  int32_t read_status = in_stream->ReadFully(header_view.raw, kHeaderSize);
+  if (read_status == -1) { return -1; }
+  CHECK_EQ(read_status, 0);
+  CHECK_EQ(header_view.header.magic, kMagicNumber);
+  CHECK_EQ(header_view.header.reserved, kReservedNumber);
+  const int32_t payload_size = header_view.header.payload_size;
+  CHECK_GE(payload_size, 0);
+  CHECK_LE(payload_size, kMaxPayloadSize);
+  XXH64_hash_t const seed = 0;
+  CHECK_EQ(ByteSwap(header_view.header.digest),
+           XXH64(header_view.raw, kHeaderSizeWithoutDigest, seed));
+  const int32_t padded_size = RoundUp(payload_size, kPayloadAlignmentSize) - payload_size;
+  tensor->Resize(Shape({payload_size}), DataType::kChar);
+  char* body = tensor->mut_data<char>();
+  CHECK_EQ(in_stream->ReadFully(body, payload_size), 0);
+  char padded[kPayloadAlignmentSize];
+  CHECK_EQ(in_stream->ReadFully(padded, padded_size), 0);  // read padded
+  static_assert(sizeof(OneRecFrameFooterView) == kDigestFieldSize, "");
+  OneRecFrameFooterView footer_view{};
+  CHECK_EQ(in_stream->ReadFully(footer_view.raw, kDigestFieldSize), 0);  // read footer
+  CHECK_EQ(ByteSwap(footer_view.digest), XXH64(body, payload_size, seed));
+  return kHeaderSize + payload_size + padded_size + kDigestFieldSize;
+}
+
 }  // namespace
 
 namespace data {
@@ -84,56 +114,41 @@ class OneRecDataset final : public Dataset<TensorBuffer> {
     parallel_num_ = ctx->parallel_ctx().parallel_num();
     BalancedSplitter bs(data_file_paths_.size(), parallel_num_);
     range_ = bs.At(parallel_id_);
+    num_parallel_reads_ = ctx->Attr<int32_t>("num_parallel_reads");
+    CHECK_GT(num_parallel_reads_, 0);
     ResetInstream();
-    hash_state_ = LZ4_XXH64_createState();
   }
 
-  ~OneRecDataset() { CHECK_NE(LZ4_XXH64_freeState(hash_state_), XXH_ERROR); }
+  ~OneRecDataset() = default;
 
   LoadTargetPtrList Next() override {
     LoadTargetPtrList ret;
     ret.resize(batch_size_);
     for (int32_t i = 0; i < batch_size_; ++i) {
-      ret.at(i).reset(new TensorBuffer());
-      ReadSample(*ret.at(i).get());
+      ret.at(i) = ReadSample();
     }
     return ret;
   }
 
  private:
-  void ReadSample(TensorBuffer& tensor) {
-    static_assert(sizeof(OneRecFrameHeader) == kHeaderSize, "");
-    OneRecFrameHeaderView header_view{};
-    static_assert(sizeof(header_view.header) == kHeaderSize, "");
-    int32_t read_status = in_stream_->ReadFully(header_view.raw, kHeaderSize);
-    if (read_status == -1) {
+  LoadTargetPtr ReadSample() {
+    if (interleaved_reader_) {
+      LoadTargetPtr sample_ptr = interleaved_reader_->Next();
+      if (!sample_ptr) {
+        ResetInstream();
+        current_epoch_++;
+        sample_ptr = interleaved_reader_->Next();
+        CHECK(sample_ptr);
+      }
+      return sample_ptr;
+    }
+    LoadTargetPtr sample_ptr(new TensorBuffer());
+    if (ReadOneRecFrame(in_stream_.get(), sample_ptr.get()) < 0) {
       ResetInstream();
       current_epoch_++;
-      CHECK_EQ(in_stream_->ReadFully(header_view.raw, kHeaderSize), 0);
-    } else {
-      CHECK_EQ(read_status, 0);
+      CHECK_GE(ReadOneRecFrame(in_stream_.get(), sample_ptr.get()), 0);
     }
-    CHECK_EQ(header_view.header.magic, kMagicNumber);
-    CHECK_EQ(header_view.header.reserved, kReservedNumber);
-    const int32_t payload_size = header_view.header.payload_size;
-    CHECK_GE(payload_size, 0);
-    CHECK_LE(payload_size, kMaxPayloadSize);
-    XXH64_hash_t const seed = 0;
-    CHECK_NE(LZ4_XXH64_reset(hash_state_, seed), XXH_ERROR);
-    CHECK_NE(XXH64_update(hash_state_, header_view.raw, kHeaderSizeWithoutDigest), XXH_ERROR);
-    CHECK_EQ(ByteSwap(header_view.header.digest), LZ4_XXH64_digest(hash_state_));
-    const int32_t padded_size = RoundUp(payload_size, kPayloadAlignmentSize) - payload_size;
-    tensor.Resize(Shape({payload_size}), DataType::kChar);
-    char* body = tensor.mut_data<char>();
-    CHECK_EQ(in_stream_->ReadFully(body, payload_size), 0);
-    char padded[kPayloadAlignmentSize];
-    CHECK_EQ(in_stream_->ReadFully(padded, padded_size), 0);  // read padded
-    static_assert(sizeof(OneRecFrameFooterView) == kDigestFieldSize, "");
-    OneRecFrameFooterView footer_view{};
-    CHECK_EQ(in_stream_->ReadFully(footer_view.raw, kDigestFieldSize), 0);  // read footer
-    CHECK_NE(XXH64_reset(hash_state_, seed), XXH_ERROR);
-    CHECK_NE(LZ4_XXH64_update(hash_state_, body, payload_size), XXH_ERROR);
-    CHECK_EQ(ByteSwap(footer_view.digest), LZ4_XXH64_digest(hash_state_));
+    return sample_ptr;
   }
 
   void ResetInstream() {
@@ -142,7 +157,13 @@ class OneRecDataset final : public Dataset<TensorBuffer> {
       std::shuffle(data_file_paths_.begin(), data_file_paths_.end(), g);
     }
     std::vector<std::string> file_paths = GetLocalFilePaths();
-    in_stream_.reset(new PersistentInStream(DataFS(), file_paths, false, false));
+    if (num_parallel_reads_ > 1) {
+      interleaved_reader_.reset();
+      interleaved_reader_.reset(
+          new InterleavedPartReader(DataFS(), file_paths, num_parallel_reads_, &ReadOneRecFrame));
+    } else {
+      in_stream_.reset(new PersistentInStream(DataFS(), file_paths, false, false));
+    }
   }
 
   std::vector<std::string> GetLocalFilePaths() {
@@ -153,13 +174,14 @@ class OneRecDataset final : public Dataset<TensorBuffer> {
 
   int32_t current_epoch_;
   bool shuffle_after_epoch_;
+  int32_t num_parallel_reads_;
 
   int32_t parallel_id_;
   int32_t parallel_num_;
   Range range_;
   std::vector<std::string> data_file_paths_;
   std::unique_ptr<PersistentInStream> in_stream_;
-  XXH64_state_t* hash_state_;
+  std::unique_ptr<InterleavedPartReader> interleaved_reader_;
   int32_t batch_size_;
 };
 
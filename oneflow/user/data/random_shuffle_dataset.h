@@ -60,6 +60,32 @@ class RandomShuffleDataset final : public Dataset<LoadTarget> {
     return ret;
   }
 
+  bool SaveState(DatasetState* state) const override {
+    if (!loader_->SaveState(state->mutable_base())) { return false; }
+    RandomShuffleDatasetState* shuffle_state = state->mutable_random_shuffle();
+    std::ostringstream rand_engine;
+    rand_engine << rand_engine_;
+    shuffle_state->set_rand_engine(rand_engine.str());
+    for (const auto& sample_ptr : sample_buffer_) {
+      if (!SaveSample(*sample_ptr, shuffle_state->add_sample_buffer())) { return false; }
+    }
+    return true;
+  }
+
+  void LoadState(const DatasetState& state) override {
+    CHECK(state.has_random_shuffle());
+    loader_->LoadState(state.base());
+    std::istringstream rand_engine(state.random_shuffle().rand_engine());
+    rand_engine >> rand_engine_;
+    // the buffer filled in constructor is replaced by the saved one
+    sample_buffer_.clear();
+    for (const auto& sample : state.random_shuffle().sample_buffer()) {
+      LoadTargetPtr sample_ptr(new LoadTarget());
+      LoadSample(sample, sample_ptr.get());
+      sample_buffer_.push_back(std::move(sample_ptr));
+    }
+  }
+
  private:
   std::unique_ptr<Dataset<LoadTarget>> loader_;
   std::vector<LoadTargetPtr> sample_buffer_;
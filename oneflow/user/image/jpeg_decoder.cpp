@@ -0,0 +1,211 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/image/jpeg_decoder.h"
+
+#include <csetjmp>
+#include <cstdio>
+#include <jpeglib.h>
+
+namespace oneflow {
+
+namespace {
+
+constexpr int kExifMarker = JPEG_APP0 + 1;
+constexpr int kExifOrientationTag = 0x0112;
+
+struct JpegErrorManager {
+  jpeg_error_mgr pub;
+  jmp_buf jump_buffer;
+};
+
+void OnJpegError(j_common_ptr cinfo) {
+  longjmp(reinterpret_cast<JpegErrorManager*>(cinfo->err)->jump_buffer, 1);
+}
+
+void OnJpegMessage(j_common_ptr cinfo) {
+  // Warnings about recoverable corrupt data are ignored, as cv::imdecode does.
+}
+
+uint32_t ReadExifUInt(const unsigned char* ptr, int num_bytes, bool little_endian) {
+  uint32_t value = 0;
+  FOR_RANGE(int, i, 0, num_bytes) {
+    const int byte_idx = little_endian ? num_bytes - 1 - i : i;
+    value = (value << 8) | ptr[byte_idx];
+  }
+  return value;
+}
+
+// Returns the EXIF orientation of the image, 1 (as stored) if there is none.
+int GetExifOrientation(const jpeg_decompress_struct& cinfo) {
+  for (jpeg_saved_marker_ptr marker = cinfo.marker_list; marker != nullptr;
+       marker = marker->next) {
+    if (marker->marker != kExifMarker || marker->data_length < 14) { continue; }
+    if (std::memcmp(marker->data, "Exif\0\0", 6) != 0) { continue; }
+    const unsigned char* tiff = marker->data + 6;
+    const size_t tiff_size = marker->data_length - 6;
+    bool little_endian = false;
+    if (tiff[0] == 'I' && tiff[1] == 'I') {
+      little_endian = true;
+    } else if (tiff[0] != 'M' || tiff[1] != 'M') {
+      continue;
+    }
+    const size_t ifd_offset = ReadExifUInt(tiff + 4, 4, little_endian);
+    if (ifd_offset + 2 > tiff_size) { continue; }
+    const size_t num_entries = ReadExifUInt(tiff + ifd_offset, 2, little_endian);
+    FOR_RANGE(size_t, i, 0, num_entries) {
+      const size_t entry_offset = ifd_offset + 2 + i * 12;
+      if (entry_offset + 12 > tiff_size) { break; }
+      if (ReadExifUInt(tiff + entry_offset, 2, little_endian) == kExifOrientationTag) {
+        return static_cast<int>(ReadExifUInt(tiff + entry_offset + 8, 2, little_endian));
+      }
+    }
+  }
+  return 1;
+}
+
+bool GetJpegColorSpace(const std::string& color_space, J_COLOR_SPACE* jpeg_color_space,
+                       int* channels) {
+  if (color_space == "RGB") {
+    *jpeg_color_space = JCS_EXT_RGB;
+    *channels = 3;
+  } else if (color_space == "BGR") {
+    *jpeg_color_space = JCS_EXT_BGR;
+    *channels = 3;
+  } else if (color_space == "GRAY") {
+    *jpeg_color_space = JCS_GRAYSCALE;
+    *channels = 1;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+struct JpegDecoder::Impl {
+  jpeg_decompress_struct cinfo;
+  JpegErrorManager error;
+  bool header_read = false;
+  std::vector<unsigned char> buffer;
+};
+
+JpegDecoder::JpegDecoder() : impl_(new Impl()) {
+  impl_->cinfo.err = jpeg_std_error(&impl_->error.pub);
+  impl_->error.pub.error_exit = OnJpegError;
+  impl_->error.pub.output_message = OnJpegMessage;
+  jpeg_create_decompress(&impl_->cinfo);
+}
+
+JpegDecoder::~JpegDecoder() { jpeg_destroy_decompress(&impl_->cinfo); }
+
+bool JpegDecoder::ReadHeader(const unsigned char* data, size_t length, int* width, int* height) {
+  static const bool enabled = ParseBooleanFromEnv("ONEFLOW_IMAGE_DECODE_WITH_LIBJPEG", true);
+  if (!enabled) { return false; }
+  jpeg_decompress_struct* cinfo = &impl_->cinfo;
+  if (impl_->header_read) {
+    jpeg_abort_decompress(cinfo);
+    impl_->header_read = false;
+  }
+  // SOI marker followed by the next marker
+  if (length < 3 || data[0] != 0xFF || data[1] != 0xD8 || data[2] != 0xFF) { return false; }
+  if (setjmp(impl_->error.jump_buffer)) {
+    jpeg_abort_decompress(cinfo);
+    return false;
+  }
+  jpeg_mem_src(cinfo, const_cast<unsigned char*>(data), length);
+  jpeg_save_markers(cinfo, kExifMarker, 0xFFFF);
+  if (jpeg_read_header(cinfo, TRUE) != JPEG_HEADER_OK
+      || (cinfo->num_components != 1 && cinfo->num_components != 3)
+      || GetExifOrientation(*cinfo) > 1) {
+    jpeg_abort_decompress(cinfo);
+    return false;
+  }
+  *width = static_cast<int>(cinfo->image_width);
+  *height = static_cast<int>(cinfo->image_height);
+  impl_->header_read = true;
+  return true;
+}
+
+bool JpegDecoder::DecodeCrop(int x, int y, int w, int h, int min_width, int min_height,
+                             const std::string& color_space, JpegImage* image) {
+  CHECK(impl_->header_read);
+  impl_->header_read = false;
+  jpeg_decompress_struct* cinfo = &impl_->cinfo;
+  CHECK(x >= 0 && y >= 0 && w > 0 && h > 0);
+  CHECK_LE(x + w, static_cast<int>(cinfo->image_width));
+  CHECK_LE(y + h, static_cast<int>(cinfo->image_height));
+  J_COLOR_SPACE out_color_space = JCS_UNKNOWN;
+  int channels = 0;
+  if (!GetJpegColorSpace(color_space, &out_color_space, &channels)) {
+    jpeg_abort_decompress(cinfo);
+    return false;
+  }
+  // The smallest M/8 that keeps the window at least min_width x min_height.
+  int scale = 8;
+  if (min_width > 0 && min_height > 0) {
+    while (scale > 1 && static_cast<int64_t>(w) * (scale - 1) >= 8 * min_width
+           && static_cast<int64_t>(h) * (scale - 1) >= 8 * min_height) {
+      --scale;
+    }
+  }
+  if (setjmp(impl_->error.jump_buffer)) {
+    jpeg_abort_decompress(cinfo);
+    return false;
+  }
+  cinfo->out_color_space = out_color_space;
+  cinfo->scale_num = scale;
+  cinfo->scale_denom = 8;
+  jpeg_start_decompress(cinfo);
+  CHECK_EQ(cinfo->output_components, channels);
+  // The window in the coordinates of the downscaled image.
+  const JDIMENSION x0 = static_cast<JDIMENSION>(x) * scale / 8;
+  const JDIMENSION y0 = static_cast<JDIMENSION>(y) * scale / 8;
+  const JDIMENSION x1 =
+      std::min<JDIMENSION>((static_cast<JDIMENSION>(x + w) * scale + 7) / 8, cinfo->output_width);
+  const JDIMENSION y1 =
+      std::min<JDIMENSION>((static_cast<JDIMENSION>(y + h) * scale + 7) / 8, cinfo->output_height);
+  // jpeg_crop_scanline widens the columns to iMCU boundaries. Chroma upsampling treats the edges
+  // of the cropped columns like image edges, so one more column is decoded on each side to keep the
+  // window identical to a full decode.
+  JDIMENSION crop_x = x0 > 0 ? x0 - 1 : 0;
+  JDIMENSION crop_width = std::min<JDIMENSION>(x1 + 1, cinfo->output_width) - crop_x;
+  if (crop_width < cinfo->output_width) { jpeg_crop_scanline(cinfo, &crop_x, &crop_width); }
+  if (y0 > 0) { jpeg_skip_scanlines(cinfo, y0); }
+  const size_t row_size = static_cast<size_t>(crop_width) * channels;
+  impl_->buffer.resize(row_size * (y1 - y0));
+  while (cinfo->output_scanline < y1) {
+    JSAMPROW row = impl_->buffer.data() + (cinfo->output_scanline - y0) * row_size;
+    jpeg_read_scanlines(cinfo, &row, 1);
+  }
+  jpeg_abort_decompress(cinfo);
+
+  // Drop the extra iMCU columns so that rows are packed.
+  const size_t out_row_size = static_cast<size_t>(x1 - x0) * channels;
+  const size_t col_offset = static_cast<size_t>(x0 - crop_x) * channels;
+  if (out_row_size != row_size) {
+    FOR_RANGE(size_t, i, 0, y1 - y0) {
+      std::memmove(impl_->buffer.data() + i * out_row_size,
+                   impl_->buffer.data() + i * row_size + col_offset, out_row_size);
+    }
+  }
+  image->data = impl_->buffer.data();
+  image->width = static_cast<int>(x1 - x0);
+  image->height = static_cast<int>(y1 - y0);
+  image->channels = channels;
+  return true;
+}
+
+}  // namespace oneflow
@@ -0,0 +1,61 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_IMAGE_JPEG_DECODER_H_
+#define ONEFLOW_USER_IMAGE_JPEG_DECODER_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// A decoded image, rows are packed (the row stride is width * channels).
+struct JpegImage {
+  const unsigned char* data;
+  int width;
+  int height;
+  int channels;
+};
+
+// Decodes JPEG images with libjpeg-turbo, touching only the part of the image that is needed:
+// scanlines outside the crop window are skipped, columns outside of it are cropped at iMCU
+// granularity, and the IDCT can downscale by M/8 while decoding. One decoder is meant to be used
+// by one thread; its output buffer is reused from image to image.
+//
+// ReadHeader rejects anything that cv::imdecode might decode differently (other formats, CMYK,
+// EXIF orientation), so callers fall back to OpenCV when it returns false.
+// Set ONEFLOW_IMAGE_DECODE_WITH_LIBJPEG=0 to always fall back.
+class JpegDecoder final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(JpegDecoder);
+  JpegDecoder();
+  ~JpegDecoder();
+
+  // Starts decoding a new image and returns its size.
+  bool ReadHeader(const unsigned char* data, size_t length, int* width, int* height);
+  // Decodes the window (x, y, w, h) of the image passed to the last successful ReadHeader, in
+  // color_space "RGB", "BGR" or "GRAY". If min_width and min_height are positive, the largest
+  // IDCT downscale that keeps the decoded window at least that large is used. The result stays
+  // valid until the next call on this decoder.
+  bool DecodeCrop(int x, int y, int w, int h, int min_width, int min_height,
+                  const std::string& color_space, JpegImage* image);
+
+ private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_IMAGE_JPEG_DECODER_H_
@@ -0,0 +1,260 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <random>
+#include <jpeglib.h>
+#include "oneflow/user/image/jpeg_decoder.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+enum class Sampling { k444, k422, k420, kGray, kCMYK };
+
+struct EncodeOptions {
+  Sampling sampling = Sampling::k420;
+  bool progressive = false;
+  // EXIF orientation to write in an APP1 marker, 0 for no EXIF
+  int exif_orientation = 0;
+};
+
+std::string ExifMarker(int orientation) {
+  // a big-endian TIFF header followed by one IFD holding the orientation tag
+  const unsigned char exif[] = {'E',  'x',  'i', 'f', 0, 0, 'M', 'M', 0, 0x2A, 0, 0, 0, 8, 0, 1,
+                                0x01, 0x12, 0,   3,   0, 0, 0,   1,   0, 0,    0, 0, 0, 0, 0, 0};
+  std::string marker(reinterpret_cast<const char*>(exif), sizeof(exif));
+  marker[25] = static_cast<char>(orientation);
+  return marker;
+}
+
+std::string EncodeJpeg(int width, int height, const EncodeOptions& options) {
+  jpeg_compress_struct cinfo;
+  jpeg_error_mgr error;
+  cinfo.err = jpeg_std_error(&error);
+  jpeg_create_compress(&cinfo);
+  unsigned char* out = nullptr;
+  unsigned long out_size = 0;
+  jpeg_mem_dest(&cinfo, &out, &out_size);
+  cinfo.image_width = width;
+  cinfo.image_height = height;
+  if (options.sampling == Sampling::kGray) {
+    cinfo.input_components = 1;
+    cinfo.in_color_space = JCS_GRAYSCALE;
+  } else if (options.sampling == Sampling::kCMYK) {
+    cinfo.input_components = 4;
+    cinfo.in_color_space = JCS_CMYK;
+  } else {
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_RGB;
+  }
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, 90, TRUE);
+  if (options.sampling == Sampling::k444) {
+    cinfo.comp_info[0].h_samp_factor = 1;
+    cinfo.comp_info[0].v_samp_factor = 1;
+  } else if (options.sampling == Sampling::k422) {
+    cinfo.comp_info[0].h_samp_factor = 2;
+    cinfo.comp_info[0].v_samp_factor = 1;
+  }
+  if (options.progressive) { jpeg_simple_progression(&cinfo); }
+  jpeg_start_compress(&cinfo, TRUE);
+  if (options.exif_orientation > 0) {
+    const std::string exif = ExifMarker(options.exif_orientation);
+    jpeg_write_marker(&cinfo, JPEG_APP0 + 1, reinterpret_cast<const JOCTET*>(exif.data()),
+                      exif.size());
+  }
+  // smooth gradients with some noise, so that both the DCT and the chroma upsampling matter
+  std::mt19937 gen(width * 31 + height);
+  std::vector<unsigned char> row(width * cinfo.input_components);
+  while (cinfo.next_scanline < cinfo.image_height) {
+    const int y = cinfo.next_scanline;
+    FOR_RANGE(int, x, 0, width) {
+      FOR_RANGE(int, c, 0, cinfo.input_components) {
+        row[x * cinfo.input_components + c] =
+            static_cast<unsigned char>((x * (c + 1) * 3 + y * (5 - c) + gen() % 32) % 256);
+      }
+    }
+    JSAMPROW row_ptr = row.data();
+    jpeg_write_scanlines(&cinfo, &row_ptr, 1);
+  }
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+  std::string jpeg(reinterpret_cast<const char*>(out), out_size);
+  free(out);
+  return jpeg;
+}
+
+// The whole image decoded by libjpeg at a scale of scale/8.
+std::vector<unsigned char> DecodeFull(const std::string& jpeg, int scale, J_COLOR_SPACE color_space,
+                                      int* width, int* height, int* channels) {
+  jpeg_decompress_struct cinfo;
+  jpeg_error_mgr error;
+  cinfo.err = jpeg_std_error(&error);
+  jpeg_create_decompress(&cinfo);
+  jpeg_mem_src(&cinfo, reinterpret_cast<const unsigned char*>(jpeg.data()), jpeg.size());
+  jpeg_read_header(&cinfo, TRUE);
+  cinfo.out_color_space = color_space;
+  cinfo.scale_num = scale;
+  cinfo.scale_denom = 8;
+  jpeg_start_decompress(&cinfo);
+  *width = cinfo.output_width;
+  *height = cinfo.output_height;
+  *channels = cinfo.output_components;
+  const size_t row_size = static_cast<size_t>(*width) * *channels;
+  std::vector<unsigned char> image(row_size * *height);
+  while (cinfo.output_scanline < cinfo.output_height) {
+    JSAMPROW row = image.data() + cinfo.output_scanline * row_size;
+    jpeg_read_scanlines(&cinfo, &row, 1);
+  }
+  jpeg_finish_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+  return image;
+}
+
+J_COLOR_SPACE JpegColorSpace(const std::string& color_space) {
+  if (color_space == "RGB") { return JCS_EXT_RGB; }
+  if (color_space == "BGR") { return JCS_EXT_BGR; }
+  return JCS_GRAYSCALE;
+}
+
+// Decodes random windows at random scales and compares them with a full decode at the same scale
+// followed by a crop.
+void CheckDecodeCrop(const std::string& jpeg, int width, int height) {
+  JpegDecoder decoder;
+  std::mt19937 gen(width + height);
+  FOR_RANGE(int, trial, 0, 40) {
+    const int w = 1 + gen() % width;
+    const int h = 1 + gen() % height;
+    const int x = gen() % (width - w + 1);
+    const int y = gen() % (height - h + 1);
+    // no downscale in the first trials, then a target size of 1/8 to 1 of the window
+    const int min_width = trial < 10 ? 0 : std::max<int>(1, w * (1 + gen() % 8) / 8);
+    const int min_height = trial < 10 ? 0 : std::max<int>(1, h * (1 + gen() % 8) / 8);
+    const std::string color_space = trial % 3 == 0 ? "RGB" : (trial % 3 == 1 ? "BGR" : "GRAY");
+    int header_width = 0;
+    int header_height = 0;
+    ASSERT_TRUE(decoder.ReadHeader(reinterpret_cast<const unsigned char*>(jpeg.data()),
+                                   jpeg.size(), &header_width, &header_height));
+    ASSERT_EQ(header_width, width);
+    ASSERT_EQ(header_height, height);
+    JpegImage image{};
+    ASSERT_TRUE(decoder.DecodeCrop(x, y, w, h, min_width, min_height, color_space, &image));
+
+    int scale = 8;
+    if (min_width > 0) {
+      while (scale > 1 && w * (scale - 1) >= 8 * min_width && h * (scale - 1) >= 8 * min_height) {
+        --scale;
+      }
+    }
+    int full_width = 0;
+    int full_height = 0;
+    int channels = 0;
+    const std::vector<unsigned char> full = DecodeFull(jpeg, scale, JpegColorSpace(color_space),
+                                                       &full_width, &full_height, &channels);
+    const int x0 = x * scale / 8;
+    const int y0 = y * scale / 8;
+    const int x1 = std::min(((x + w) * scale + 7) / 8, full_width);
+    const int y1 = std::min(((y + h) * scale + 7) / 8, full_height);
+    ASSERT_EQ(image.width, x1 - x0);
+    ASSERT_EQ(image.height, y1 - y0);
+    ASSERT_EQ(image.channels, channels);
+    ASSERT_GE(image.width, min_width);
+    ASSERT_GE(image.height, min_height);
+    FOR_RANGE(int, row, 0, image.height) {
+      const unsigned char* expected = full.data() + ((y0 + row) * full_width + x0) * channels;
+      const unsigned char* actual = image.data + row * image.width * channels;
+      ASSERT_EQ(std::memcmp(actual, expected, image.width * channels), 0)
+          << "window (" << x << ", " << y << ", " << w << ", " << h << ") at scale " << scale
+          << "/8 in " << color_space << ", row " << row;
+    }
+  }
+}
+
+bool ReadHeader(JpegDecoder* decoder, const std::string& data) {
+  int width = 0;
+  int height = 0;
+  return decoder->ReadHeader(reinterpret_cast<const unsigned char*>(data.data()), data.size(),
+                             &width, &height);
+}
+
+}  // namespace
+
+TEST(JpegDecoder, decode_crop_444) {
+  EncodeOptions options;
+  options.sampling = Sampling::k444;
+  CheckDecodeCrop(EncodeJpeg(97, 61, options), 97, 61);
+}
+
+TEST(JpegDecoder, decode_crop_422) {
+  EncodeOptions options;
+  options.sampling = Sampling::k422;
+  CheckDecodeCrop(EncodeJpeg(97, 61, options), 97, 61);
+}
+
+TEST(JpegDecoder, decode_crop_420) {
+  EncodeOptions options;
+  options.sampling = Sampling::k420;
+  CheckDecodeCrop(EncodeJpeg(101, 67, options), 101, 67);
+  CheckDecodeCrop(EncodeJpeg(64, 48, options), 64, 48);
+}
+
+TEST(JpegDecoder, decode_crop_grayscale) {
+  EncodeOptions options;
+  options.sampling = Sampling::kGray;
+  CheckDecodeCrop(EncodeJpeg(83, 70, options), 83, 70);
+}
+
+TEST(JpegDecoder, decode_crop_progressive) {
+  EncodeOptions options;
+  options.sampling = Sampling::k420;
+  options.progressive = true;
+  CheckDecodeCrop(EncodeJpeg(101, 67, options), 101, 67);
+}
+
+TEST(JpegDecoder, fall_back) {
+  JpegDecoder decoder;
+  EncodeOptions options;
+  // an EXIF orientation other than 1 has to be applied by OpenCV
+  options.exif_orientation = 6;
+  ASSERT_FALSE(ReadHeader(&decoder, EncodeJpeg(32, 24, options)));
+  options.exif_orientation = 1;
+  ASSERT_TRUE(ReadHeader(&decoder, EncodeJpeg(32, 24, options)));
+  // CMYK
+  options.exif_orientation = 0;
+  options.sampling = Sampling::kCMYK;
+  ASSERT_FALSE(ReadHeader(&decoder, EncodeJpeg(32, 24, options)));
+  // not a JPEG, or a truncated one
+  ASSERT_FALSE(ReadHeader(&decoder, std::string("\x89PNG\r\n\x1a\n", 8)));
+  ASSERT_FALSE(ReadHeader(&decoder, std::string()));
+  ASSERT_FALSE(ReadHeader(&decoder, std::string("\xFF\xD8\xFF\xE0", 4)));
+  // the decoder is still usable afterwards
+  options.sampling = Sampling::k420;
+  const std::string jpeg = EncodeJpeg(32, 24, options);
+  ASSERT_TRUE(ReadHeader(&decoder, jpeg));
+  JpegImage image{};
+  ASSERT_TRUE(decoder.DecodeCrop(3, 5, 20, 10, 0, 0, "RGB", &image));
+  ASSERT_EQ(image.width, 20);
+  ASSERT_EQ(image.height, 10);
+  // unknown color spaces are left to OpenCV
+  ASSERT_TRUE(ReadHeader(&decoder, jpeg));
+  ASSERT_FALSE(decoder.DecodeCrop(0, 0, 32, 24, 0, 0, "YUV", &image));
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -39,4 +39,16 @@ REGISTER_RELU_FORWARD_KERNEL(DeviceType::kCPU, int8_t);
 REGISTER_RELU_FORWARD_KERNEL(DeviceType::kCPU, int32_t);
 REGISTER_RELU_FORWARD_KERNEL(DeviceType::kCPU, int64_t);
 
+// bfloat16 does not convert implicitly from float, so mask dy in float and round once
+template<>
+struct ReluGradFunctor<bfloat16> {
+  explicit ReluGradFunctor() {}
+  bfloat16 operator()(bfloat16 y, bfloat16 dy) const {
+    return bfloat16((static_cast<float>(y) > 0.0f) * static_cast<float>(dy));
+  }
+};
+
+REGISTER_RELU_FORWARD_KERNEL(DeviceType::kCPU, bfloat16);
+REGISTER_RELU_BACKWARD_KERNEL(DeviceType::kCPU, bfloat16);
+
 }  // namespace oneflow
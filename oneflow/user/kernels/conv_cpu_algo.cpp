@@ -0,0 +1,370 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/conv_cpu_algo.h"
+#include <algorithm>
+#include "oneflow/core/kernel/new_kernel_util.h"
+#include "oneflow/core/thread/thread_manager.h"
+
+namespace oneflow {
+
+namespace {
+
+int64_t CeilDiv(int64_t x, int64_t y) { return (x + y - 1) / y; }
+
+// Transform matrices of Winograd minimal filtering F(m x m, 3 x 3), see Lavin & Gray,
+// "Fast Algorithms for Convolutional Neural Networks".
+struct WinogradTransform {
+  int m;
+  int alpha;
+  const double* bt;  // (alpha, alpha)
+  const double* g;   // (alpha, 3)
+  const double* at;  // (m, alpha)
+};
+
+const double kF2x3BT[] = {1, 0, -1, 0, 0, 1, 1, 0, 0, -1, 1, 0, 0, 1, 0, -1};
+const double kF2x3G[] = {1, 0, 0, 0.5, 0.5, 0.5, 0.5, -0.5, 0.5, 0, 0, 1};
+const double kF2x3AT[] = {1, 1, 1, 0, 0, 1, -1, -1};
+
+const double kF4x3BT[] = {4, 0, -5, 0,  1, 0, 0, -4, -4, 1,  1, 0, 0, 4, -4, -1, 1, 0,
+                          0, -2, -1, 2, 1, 0, 0, 2,  -1, -2, 1, 0, 0, 4, 0,  -5, 0, 1};
+const double kF4x3G[] = {1.0 / 4,  0,         0,         -1.0 / 6, -1.0 / 6, -1.0 / 6,
+                         -1.0 / 6, 1.0 / 6,   -1.0 / 6,  1.0 / 24, 1.0 / 12, 1.0 / 6,
+                         1.0 / 24, -1.0 / 12, 1.0 / 6,   0,        0,        1};
+const double kF4x3AT[] = {1, 1, 1, 1, 1, 0, 0, 1, -1, 2, -2, 0,
+                          0, 1, 1, 4, 4, 0, 0, 1, -1, 8, -8, 1};
+
+constexpr int kMaxWinogradAlpha = 6;
+
+WinogradTransform GetWinogradTransform(ConvCpuAlgo algo) {
+  if (algo == ConvCpuAlgo::kWinogradF2x3) {
+    return WinogradTransform{2, 4, kF2x3BT, kF2x3G, kF2x3AT};
+  }
+  CHECK(algo == ConvCpuAlgo::kWinogradF4x3);
+  return WinogradTransform{4, 6, kF4x3BT, kF4x3G, kF4x3AT};
+}
+
+// c(m, n) = a(m, k) * b(k, n), or a(m, k) * b(n, k)^T if trans_b
+template<typename T>
+void SmallMatmul(const T* a, const T* b, T* c, int m, int k, int n, bool trans_b) {
+  FOR_RANGE(int, i, 0, m) {
+    FOR_RANGE(int, j, 0, n) {
+      T sum = 0;
+      FOR_RANGE(int, p, 0, k) { sum += a[i * k + p] * (trans_b ? b[j * k + p] : b[p * n + j]); }
+      c[i * n + j] = sum;
+    }
+  }
+}
+
+bool IsAllEqualTo(const std::vector<int32_t>& vec, int32_t val) {
+  return std::all_of(vec.begin(), vec.end(), [val](int32_t x) { return x == val; });
+}
+
+}  // namespace
+
+ConvCpuAlgoParams MakeConvCpuAlgoParams(const Shape& in_shape, const Shape& out_shape,
+                                        const std::string& data_format, int32_t groups,
+                                        const std::vector<int32_t>& kernel_size,
+                                        const std::vector<int32_t>& strides,
+                                        const std::vector<int32_t>& dilation_rate,
+                                        const std::vector<int32_t>& padding_before,
+                                        bool is_dynamic) {
+  ConvCpuAlgoParams params;
+  params.ndims = in_shape.NumAxes() - 2;
+  params.is_dynamic = is_dynamic;
+  params.channels_last = data_format == "channels_last";
+  params.groups = groups;
+  params.batch = in_shape.At(0);
+  const int32_t c_axis = params.channels_last ? params.ndims + 1 : 1;
+  const int32_t spatial_offset = params.channels_last ? 1 : 2;
+  params.in_channels = in_shape.At(c_axis);
+  params.out_channels = out_shape.At(c_axis);
+  FOR_RANGE(int32_t, i, 0, params.ndims) {
+    params.in_spatial.push_back(in_shape.At(spatial_offset + i));
+    params.out_spatial.push_back(out_shape.At(spatial_offset + i));
+  }
+  params.kernel_size = kernel_size;
+  params.strides = strides;
+  params.dilation_rate = dilation_rate;
+  params.padding_before = padding_before;
+  if (params.ndims == 1) {
+    // NOTE: 1d conv is 2d conv with height 1, so the 2d algorithms also serve it.
+    params.ndims = 2;
+    params.in_spatial.insert(params.in_spatial.begin(), 1);
+    params.out_spatial.insert(params.out_spatial.begin(), 1);
+    params.kernel_size.insert(params.kernel_size.begin(), 1);
+    params.strides.insert(params.strides.begin(), 1);
+    params.dilation_rate.insert(params.dilation_rate.begin(), 1);
+    params.padding_before.insert(params.padding_before.begin(), 0);
+  }
+  return params;
+}
+
+ConvCpuAlgo SelectConvCpuAlgo(const ConvCpuAlgoParams& params) {
+  // NOTE: the algorithms other than im2col are planned with static shapes
+  if (params.is_dynamic) { return ConvCpuAlgo::kIm2ColGemm; }
+  if (params.groups > 1) {
+    // the other grouped convs run im2col group by group
+    const bool is_depthwise = params.ndims == 2 && params.groups == params.in_channels
+                              && params.groups == params.out_channels;
+    return is_depthwise ? ConvCpuAlgo::kDepthwise : ConvCpuAlgo::kIm2ColGemm;
+  }
+  if (IsAllEqualTo(params.kernel_size, 1) && IsAllEqualTo(params.strides, 1)
+      && IsAllEqualTo(params.padding_before, 0)) {
+    return ConvCpuAlgo::kDirect1x1;
+  }
+  // Winograd trades 2.25x (F4x3) to 4x (F2x3) fewer multiplications for transform overhead,
+  // which only pays off with enough channels to amortize it in the batched gemms.
+  const int64_t kWinogradMinChannels = 16;
+  if (params.ndims == 2 && !params.channels_last && IsAllEqualTo(params.kernel_size, 3)
+      && IsAllEqualTo(params.strides, 1) && IsAllEqualTo(params.dilation_rate, 1)
+      && params.in_channels >= kWinogradMinChannels
+      && params.out_channels >= kWinogradMinChannels) {
+    const int64_t min_out_size = std::min(params.out_spatial.at(0), params.out_spatial.at(1));
+    return min_out_size >= 8 ? ConvCpuAlgo::kWinogradF4x3 : ConvCpuAlgo::kWinogradF2x3;
+  }
+  return ConvCpuAlgo::kIm2ColGemm;
+}
+
+int64_t ConvCpuAlgoTmpElemCnt(ConvCpuAlgo algo, const ConvCpuAlgoParams& params) {
+  if (algo == ConvCpuAlgo::kDepthwise) {
+    // filters transposed to (kernel positions, channels) for channels_last
+    return params.channels_last
+               ? params.kernel_size.at(0) * params.kernel_size.at(1) * params.in_channels
+               : 0;
+  } else if (algo == ConvCpuAlgo::kWinogradF2x3 || algo == ConvCpuAlgo::kWinogradF4x3) {
+    const WinogradTransform transform = GetWinogradTransform(algo);
+    const int64_t tile_cnt = CeilDiv(params.out_spatial.at(0), transform.m)
+                             * CeilDiv(params.out_spatial.at(1), transform.m);
+    // transformed filters, input tiles and output tiles of one image
+    return transform.alpha * transform.alpha
+           * (params.out_channels * params.in_channels + params.in_channels * tile_cnt
+              + params.out_channels * tile_cnt);
+  } else {
+    return 0;
+  }
+}
+
+template<typename T>
+void ConvCpuAlgoUtil<T>::Direct1x1(const ConvCpuAlgoParams& params, const T* in, const T* weight,
+                                   const T* bias, T* out) {
+  int64_t spatial_size = 1;
+  for (int64_t dim : params.in_spatial) { spatial_size *= dim; }
+  const int64_t in_channels = params.in_channels;
+  const int64_t out_channels = params.out_channels;
+  if (params.channels_last) {
+    // out(n * spatial, oc) = in(n * spatial, ic) * weight(oc, ic)^T
+    const int64_t rows = params.batch * spatial_size;
+    NewKernelUtil<DeviceType::kCPU>::OFGemm(nullptr, CblasNoTrans, CblasTrans, rows, out_channels,
+                                            in_channels, static_cast<T>(1), in, weight,
+                                            static_cast<T>(0), out);
+    if (bias != nullptr) {
+      MultiThreadLoop(rows, [&](size_t row) {
+        T* out_row = out + row * out_channels;
+        FOR_RANGE(int64_t, c, 0, out_channels) { out_row[c] += bias[c]; }
+      });
+    }
+  } else {
+    // out[n](oc, spatial) = weight(oc, ic) * in[n](ic, spatial)
+    FOR_RANGE(int64_t, n, 0, params.batch) {
+      NewKernelUtil<DeviceType::kCPU>::OFGemm(
+          nullptr, CblasNoTrans, CblasNoTrans, out_channels, spatial_size, in_channels,
+          static_cast<T>(1), weight, in + n * in_channels * spatial_size, static_cast<T>(0),
+          out + n * out_channels * spatial_size);
+    }
+    if (bias != nullptr) {
+      MultiThreadLoop(params.batch * out_channels, [&](size_t plane) {
+        T* out_plane = out + plane * spatial_size;
+        const T bias_val = bias[plane % out_channels];
+        FOR_RANGE(int64_t, i, 0, spatial_size) { out_plane[i] += bias_val; }
+      });
+    }
+  }
+}
+
+template<typename T>
+void ConvCpuAlgoUtil<T>::Depthwise(const ConvCpuAlgoParams& params, const T* in, const T* weight,
+                                   const T* bias, T* tmp, T* out) {
+  const int64_t channels = params.in_channels;
+  const int64_t in_h = params.in_spatial.at(0);
+  const int64_t in_w = params.in_spatial.at(1);
+  const int64_t out_h = params.out_spatial.at(0);
+  const int64_t out_w = params.out_spatial.at(1);
+  const int64_t kernel_h = params.kernel_size.at(0);
+  const int64_t kernel_w = params.kernel_size.at(1);
+  const int64_t stride_h = params.strides.at(0);
+  const int64_t stride_w = params.strides.at(1);
+  const int64_t dilation_h = params.dilation_rate.at(0);
+  const int64_t dilation_w = params.dilation_rate.at(1);
+  const int64_t pad_h = params.padding_before.at(0);
+  const int64_t pad_w = params.padding_before.at(1);
+  if (params.channels_last) {
+    // Vectorized over the contiguous channels, filters are transposed to (kh, kw, c) first.
+    T* filter = tmp;
+    FOR_RANGE(int64_t, c, 0, channels) {
+      FOR_RANGE(int64_t, k, 0, kernel_h * kernel_w) {
+        filter[k * channels + c] = weight[c * kernel_h * kernel_w + k];
+      }
+    }
+    MultiThreadLoop(params.batch * out_h, [&](size_t row) {
+      const int64_t n = row / out_h;
+      const int64_t oh = row % out_h;
+      const T* in_n = in + n * in_h * in_w * channels;
+      FOR_RANGE(int64_t, ow, 0, out_w) {
+        T* out_pixel = out + (row * out_w + ow) * channels;
+        FOR_RANGE(int64_t, c, 0, channels) { out_pixel[c] = bias == nullptr ? 0 : bias[c]; }
+        FOR_RANGE(int64_t, kh, 0, kernel_h) {
+          const int64_t ih = oh * stride_h - pad_h + kh * dilation_h;
+          if (ih < 0 || ih >= in_h) { continue; }
+          FOR_RANGE(int64_t, kw, 0, kernel_w) {
+            const int64_t iw = ow * stride_w - pad_w + kw * dilation_w;
+            if (iw < 0 || iw >= in_w) { continue; }
+            const T* in_pixel = in_n + (ih * in_w + iw) * channels;
+            const T* filter_pixel = filter + (kh * kernel_w + kw) * channels;
+            FOR_RANGE(int64_t, c, 0, channels) { out_pixel[c] += in_pixel[c] * filter_pixel[c]; }
+          }
+        }
+      }
+    });
+  } else {
+    MultiThreadLoop(params.batch * channels, [&](size_t plane) {
+      const int64_t c = plane % channels;
+      const T* in_plane = in + plane * in_h * in_w;
+      const T* filter = weight + c * kernel_h * kernel_w;
+      T* out_plane = out + plane * out_h * out_w;
+      const T bias_val = bias == nullptr ? 0 : bias[c];
+      FOR_RANGE(int64_t, i, 0, out_h * out_w) { out_plane[i] = bias_val; }
+      FOR_RANGE(int64_t, oh, 0, out_h) {
+        T* out_row = out_plane + oh * out_w;
+        FOR_RANGE(int64_t, kh, 0, kernel_h) {
+          const int64_t ih = oh * stride_h - pad_h + kh * dilation_h;
+          if (ih < 0 || ih >= in_h) { continue; }
+          const T* in_row = in_plane + ih * in_w;
+          FOR_RANGE(int64_t, kw, 0, kernel_w) {
+            const T filter_val = filter[kh * kernel_w + kw];
+            FOR_RANGE(int64_t, ow, 0, out_w) {
+              const int64_t iw = ow * stride_w - pad_w + kw * dilation_w;
+              if (iw >= 0 && iw < in_w) { out_row[ow] += in_row[iw] * filter_val; }
+            }
+          }
+        }
+      }
+    });
+  }
+}
+
+template<typename T>
+void ConvCpuAlgoUtil<T>::Winograd(ConvCpuAlgo algo, const ConvCpuAlgoParams& params, const T* in,
+                                  const T* weight, const T* bias, T* tmp, T* out) {
+  const WinogradTransform transform = GetWinogradTransform(algo);
+  const int m = transform.m;
+  const int alpha = transform.alpha;
+  const int tile_elem_cnt = alpha * alpha;
+  T bt[kMaxWinogradAlpha * kMaxWinogradAlpha];
+  T g[kMaxWinogradAlpha * 3];
+  T at[kMaxWinogradAlpha * kMaxWinogradAlpha];
+  FOR_RANGE(int, i, 0, alpha * alpha) { bt[i] = static_cast<T>(transform.bt[i]); }
+  FOR_RANGE(int, i, 0, alpha * 3) { g[i] = static_cast<T>(transform.g[i]); }
+  FOR_RANGE(int, i, 0, m * alpha) { at[i] = static_cast<T>(transform.at[i]); }
+
+  const int64_t in_channels = params.in_channels;
+  const int64_t out_channels = params.out_channels;
+  const int64_t in_h = params.in_spatial.at(0);
+  const int64_t in_w = params.in_spatial.at(1);
+  const int64_t out_h = params.out_spatial.at(0);
+  const int64_t out_w = params.out_spatial.at(1);
+  const int64_t pad_h = params.padding_before.at(0);
+  const int64_t pad_w = params.padding_before.at(1);
+  const int64_t tiles_h = CeilDiv(out_h, m);
+  const int64_t tiles_w = CeilDiv(out_w, m);
+  const int64_t tile_cnt = tiles_h * tiles_w;
+
+  // u[xi](oc, ic), v[xi](ic, tile) and o[xi](oc, tile) for every position xi of a tile
+  T* u = tmp;
+  T* v = u + tile_elem_cnt * out_channels * in_channels;
+  T* o = v + tile_elem_cnt * in_channels * tile_cnt;
+
+  // u = g * filter * g^T
+  MultiThreadLoop(out_channels * in_channels, [&](size_t idx) {
+    T buf[kMaxWinogradAlpha * 3];
+    T u_tile[kMaxWinogradAlpha * kMaxWinogradAlpha];
+    SmallMatmul(g, weight + idx * 9, buf, alpha, 3, 3, false);
+    SmallMatmul(buf, g, u_tile, alpha, 3, alpha, true);
+    FOR_RANGE(int, xi, 0, tile_elem_cnt) {
+      u[xi * out_channels * in_channels + idx] = u_tile[xi];
+    }
+  });
+
+  FOR_RANGE(int64_t, n, 0, params.batch) {
+    const T* in_n = in + n * in_channels * in_h * in_w;
+    // v = bt * d * bt^T for every (alpha, alpha) input tile d with stride m
+    MultiThreadLoop(in_channels * tile_cnt, [&](size_t idx) {
+      const int64_t c = idx / tile_cnt;
+      const int64_t tile = idx % tile_cnt;
+      const int64_t h_begin = (tile / tiles_w) * m - pad_h;
+      const int64_t w_begin = (tile % tiles_w) * m - pad_w;
+      T d[kMaxWinogradAlpha * kMaxWinogradAlpha];
+      T buf[kMaxWinogradAlpha * kMaxWinogradAlpha];
+      T v_tile[kMaxWinogradAlpha * kMaxWinogradAlpha];
+      FOR_RANGE(int, i, 0, alpha) {
+        const int64_t ih = h_begin + i;
+        FOR_RANGE(int, j, 0, alpha) {
+          const int64_t iw = w_begin + j;
+          const bool inside = ih >= 0 && ih < in_h && iw >= 0 && iw < in_w;
+          d[i * alpha + j] = inside ? in_n[(c * in_h + ih) * in_w + iw] : 0;
+        }
+      }
+      SmallMatmul(bt, d, buf, alpha, alpha, alpha, false);
+      SmallMatmul(buf, bt, v_tile, alpha, alpha, alpha, true);
+      FOR_RANGE(int, xi, 0, tile_elem_cnt) { v[xi * in_channels * tile_cnt + idx] = v_tile[xi]; }
+    });
+    // the elementwise products of all the channels are summed up by one gemm per position
+    FOR_RANGE(int, xi, 0, tile_elem_cnt) {
+      NewKernelUtil<DeviceType::kCPU>::OFGemm(
+          nullptr, CblasNoTrans, CblasNoTrans, out_channels, tile_cnt, in_channels,
+          static_cast<T>(1), u + xi * out_channels * in_channels, v + xi * in_channels * tile_cnt,
+          static_cast<T>(0), o + xi * out_channels * tile_cnt);
+    }
+    // y = at * o * at^T, (m, m) output tile
+    T* out_n = out + n * out_channels * out_h * out_w;
+    MultiThreadLoop(out_channels * tile_cnt, [&](size_t idx) {
+      const int64_t oc = idx / tile_cnt;
+      const int64_t tile = idx % tile_cnt;
+      const int64_t h_begin = (tile / tiles_w) * m;
+      const int64_t w_begin = (tile % tiles_w) * m;
+      T o_tile[kMaxWinogradAlpha * kMaxWinogradAlpha];
+      T buf[kMaxWinogradAlpha * kMaxWinogradAlpha];
+      T y_tile[kMaxWinogradAlpha * kMaxWinogradAlpha];
+      FOR_RANGE(int, xi, 0, tile_elem_cnt) { o_tile[xi] = o[xi * out_channels * tile_cnt + idx]; }
+      SmallMatmul(at, o_tile, buf, m, alpha, alpha, false);
+      SmallMatmul(buf, at, y_tile, m, alpha, m, true);
+      const T bias_val = bias == nullptr ? 0 : bias[oc];
+      FOR_RANGE(int, i, 0, m) {
+        const int64_t oh = h_begin + i;
+        if (oh >= out_h) { break; }
+        FOR_RANGE(int, j, 0, m) {
+          const int64_t ow = w_begin + j;
+          if (ow >= out_w) { break; }
+          out_n[(oc * out_h + oh) * out_w + ow] = y_tile[i * m + j] + bias_val;
+        }
+      }
+    });
+  }
+}
+
+template struct ConvCpuAlgoUtil<float>;
+template struct ConvCpuAlgoUtil<double>;
+
+}  // namespace oneflow
@@ -0,0 +1,79 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_CONV_CPU_ALGO_H_
+#define ONEFLOW_USER_KERNELS_CONV_CPU_ALGO_H_
+
+#include "oneflow/core/common/shape.h"
+
+namespace oneflow {
+
+enum class ConvCpuAlgo {
+  // im2col into a full column buffer followed by one gemm per image
+  kIm2ColGemm = 0,
+  // 1x1 kernel, stride 1 and no padding, the input is already the column buffer
+  kDirect1x1 = 1,
+  // one filter per channel, direct loops without column buffer
+  kDepthwise = 2,
+  // Winograd F(2x2, 3x3) and F(4x4, 3x3) for 3x3 kernels with stride 1, channels_first only
+  kWinogradF2x3 = 3,
+  kWinogradF4x3 = 4,
+};
+
+struct ConvCpuAlgoParams {
+  int32_t ndims;
+  bool is_dynamic;
+  bool channels_last;
+  int32_t groups;
+  int64_t batch;
+  int64_t in_channels;
+  int64_t out_channels;
+  DimVector in_spatial;
+  DimVector out_spatial;
+  std::vector<int32_t> kernel_size;
+  std::vector<int32_t> strides;
+  std::vector<int32_t> dilation_rate;
+  std::vector<int32_t> padding_before;
+};
+
+ConvCpuAlgoParams MakeConvCpuAlgoParams(const Shape& in_shape, const Shape& out_shape,
+                                        const std::string& data_format, int32_t groups,
+                                        const std::vector<int32_t>& kernel_size,
+                                        const std::vector<int32_t>& strides,
+                                        const std::vector<int32_t>& dilation_rate,
+                                        const std::vector<int32_t>& padding_before,
+                                        bool is_dynamic);
+
+// Picks the algorithm by shape heuristics, dynamic shapes and grouped convs other than depthwise
+// ones fall back to kIm2ColGemm.
+ConvCpuAlgo SelectConvCpuAlgo(const ConvCpuAlgoParams& params);
+
+// Number of elements of the tmp buffer needed by the algorithms other than kIm2ColGemm.
+int64_t ConvCpuAlgoTmpElemCnt(ConvCpuAlgo algo, const ConvCpuAlgoParams& params);
+
+template<typename T>
+struct ConvCpuAlgoUtil final {
+  // All of them compute the whole batch and add bias when it is not nullptr.
+  static void Direct1x1(const ConvCpuAlgoParams& params, const T* in, const T* weight,
+                        const T* bias, T* out);
+  static void Depthwise(const ConvCpuAlgoParams& params, const T* in, const T* weight,
+                        const T* bias, T* tmp, T* out);
+  static void Winograd(ConvCpuAlgo algo, const ConvCpuAlgoParams& params, const T* in,
+                       const T* weight, const T* bias, T* tmp, T* out);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_CONV_CPU_ALGO_H_
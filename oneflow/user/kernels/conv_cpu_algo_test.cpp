@@ -0,0 +1,184 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <random>
+#include <gtest/gtest.h>
+#include "oneflow/user/kernels/conv_cpu_algo.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+struct ConvCase {
+  bool channels_last;
+  int32_t groups;
+  int64_t in_channels;
+  int64_t out_channels;
+  int64_t in_h;
+  int64_t in_w;
+  int32_t kernel;
+  int32_t stride;
+  int32_t dilation;
+  int32_t padding;
+  ConvCpuAlgo expected_algo;
+};
+
+int64_t OutSize(int64_t in, const ConvCase& c) {
+  return (in + 2 * c.padding - c.dilation * (c.kernel - 1) - 1) / c.stride + 1;
+}
+
+// The reference is the im2col + gemm path of the conv kernel, image by image and group by group,
+// with the column buffer laid out as (ic / groups * kh * kw, oh * ow).
+void Im2ColGemmConv(const ConvCase& c, int64_t batch, const double* in, const double* weight,
+                    const double* bias, double* out) {
+  const int64_t out_h = OutSize(c.in_h, c);
+  const int64_t out_w = OutSize(c.in_w, c);
+  const int64_t group_ic = c.in_channels / c.groups;
+  const int64_t group_oc = c.out_channels / c.groups;
+  const int64_t col_rows = group_ic * c.kernel * c.kernel;
+  const int64_t col_cols = out_h * out_w;
+  const auto InIndex = [&](int64_t n, int64_t ch, int64_t h, int64_t w) {
+    return c.channels_last ? ((n * c.in_h + h) * c.in_w + w) * c.in_channels + ch
+                           : ((n * c.in_channels + ch) * c.in_h + h) * c.in_w + w;
+  };
+  const auto OutIndex = [&](int64_t n, int64_t ch, int64_t h, int64_t w) {
+    return c.channels_last ? ((n * out_h + h) * out_w + w) * c.out_channels + ch
+                           : ((n * c.out_channels + ch) * out_h + h) * out_w + w;
+  };
+  // weight is (oc, ic / groups, kh, kw) or (oc, kh, kw, ic / groups)
+  const auto WeightIndex = [&](int64_t oc, int64_t ic, int64_t kh, int64_t kw) {
+    return c.channels_last ? ((oc * c.kernel + kh) * c.kernel + kw) * group_ic + ic
+                           : ((oc * group_ic + ic) * c.kernel + kh) * c.kernel + kw;
+  };
+  std::vector<double> col(col_rows * col_cols);
+  FOR_RANGE(int64_t, n, 0, batch) {
+    FOR_RANGE(int64_t, g, 0, c.groups) {
+      FOR_RANGE(int64_t, ic, 0, group_ic) {
+        FOR_RANGE(int64_t, kh, 0, c.kernel) {
+          FOR_RANGE(int64_t, kw, 0, c.kernel) {
+            const int64_t row = (ic * c.kernel + kh) * c.kernel + kw;
+            FOR_RANGE(int64_t, oh, 0, out_h) {
+              FOR_RANGE(int64_t, ow, 0, out_w) {
+                const int64_t ih = oh * c.stride - c.padding + kh * c.dilation;
+                const int64_t iw = ow * c.stride - c.padding + kw * c.dilation;
+                const bool inside = ih >= 0 && ih < c.in_h && iw >= 0 && iw < c.in_w;
+                col[row * col_cols + oh * out_w + ow] =
+                    inside ? in[InIndex(n, g * group_ic + ic, ih, iw)] : 0;
+              }
+            }
+          }
+        }
+      }
+      FOR_RANGE(int64_t, oc, g * group_oc, (g + 1) * group_oc) {
+        FOR_RANGE(int64_t, oh, 0, out_h) {
+          FOR_RANGE(int64_t, ow, 0, out_w) {
+            double sum = bias[oc];
+            FOR_RANGE(int64_t, ic, 0, group_ic) {
+              FOR_RANGE(int64_t, kh, 0, c.kernel) {
+                FOR_RANGE(int64_t, kw, 0, c.kernel) {
+                  const int64_t row = (ic * c.kernel + kh) * c.kernel + kw;
+                  const int64_t col_index = row * col_cols + oh * out_w + ow;
+                  sum += weight[WeightIndex(oc, ic, kh, kw)] * col[col_index];
+                }
+              }
+            }
+            out[OutIndex(n, oc, oh, ow)] = sum;
+          }
+        }
+      }
+    }
+  }
+}
+
+void TestMatchesIm2ColGemm(const ConvCase& c) {
+  const int64_t batch = 2;
+  const int64_t out_h = OutSize(c.in_h, c);
+  const int64_t out_w = OutSize(c.in_w, c);
+  const Shape in_shape = c.channels_last ? Shape({batch, c.in_h, c.in_w, c.in_channels})
+                                         : Shape({batch, c.in_channels, c.in_h, c.in_w});
+  const Shape out_shape = c.channels_last ? Shape({batch, out_h, out_w, c.out_channels})
+                                          : Shape({batch, c.out_channels, out_h, out_w});
+  const ConvCpuAlgoParams params = MakeConvCpuAlgoParams(
+      in_shape, out_shape, c.channels_last ? "channels_last" : "channels_first", c.groups,
+      {c.kernel, c.kernel}, {c.stride, c.stride}, {c.dilation, c.dilation},
+      {c.padding, c.padding}, /*is_dynamic=*/false);
+  const ConvCpuAlgo algo = SelectConvCpuAlgo(params);
+  ASSERT_EQ(algo, c.expected_algo);
+  ConvCpuAlgoParams dynamic_params = params;
+  dynamic_params.is_dynamic = true;
+  ASSERT_EQ(SelectConvCpuAlgo(dynamic_params), ConvCpuAlgo::kIm2ColGemm);
+
+  std::mt19937 rng(c.in_channels * 131 + c.out_channels * 7 + c.kernel);
+  std::uniform_real_distribution<double> dist(-1, 1);
+  const auto RandomVec = [&](int64_t n) {
+    std::vector<double> vec(n);
+    for (double& x : vec) { x = dist(rng); }
+    return vec;
+  };
+  const std::vector<double> in = RandomVec(in_shape.elem_cnt());
+  const std::vector<double> weight =
+      RandomVec(c.out_channels * c.in_channels / c.groups * c.kernel * c.kernel);
+  const std::vector<double> bias = RandomVec(c.out_channels);
+  std::vector<double> expected(out_shape.elem_cnt());
+  Im2ColGemmConv(c, batch, in.data(), weight.data(), bias.data(), expected.data());
+  if (algo == ConvCpuAlgo::kIm2ColGemm) { return; }
+
+  std::vector<double> out(out_shape.elem_cnt());
+  std::vector<double> tmp(ConvCpuAlgoTmpElemCnt(algo, params));
+  if (algo == ConvCpuAlgo::kDirect1x1) {
+    ConvCpuAlgoUtil<double>::Direct1x1(params, in.data(), weight.data(), bias.data(), out.data());
+  } else if (algo == ConvCpuAlgo::kDepthwise) {
+    ConvCpuAlgoUtil<double>::Depthwise(params, in.data(), weight.data(), bias.data(), tmp.data(),
+                                       out.data());
+  } else {
+    ConvCpuAlgoUtil<double>::Winograd(algo, params, in.data(), weight.data(), bias.data(),
+                                      tmp.data(), out.data());
+  }
+  FOR_RANGE(int64_t, i, 0, out_shape.elem_cnt()) { ASSERT_NEAR(out[i], expected[i], 1e-9); }
+}
+
+}  // namespace
+
+TEST(ConvCpuAlgo, matches_im2col_gemm) {
+  const bool own_thread_pool = Global<ThreadPool>::Get() == nullptr;
+  if (own_thread_pool) { Global<ThreadPool>::New(4); }
+  const std::vector<ConvCase> cases = {
+      // channels_last, groups, ic, oc, h, w, kernel, stride, dilation, padding, algo
+      {false, 1, 8, 12, 7, 9, 1, 1, 1, 0, ConvCpuAlgo::kDirect1x1},
+      {true, 1, 8, 12, 7, 9, 1, 1, 1, 0, ConvCpuAlgo::kDirect1x1},
+      {false, 1, 8, 12, 7, 9, 1, 2, 1, 0, ConvCpuAlgo::kIm2ColGemm},
+      {false, 6, 6, 6, 9, 11, 3, 1, 1, 1, ConvCpuAlgo::kDepthwise},
+      {true, 6, 6, 6, 9, 11, 3, 1, 1, 1, ConvCpuAlgo::kDepthwise},
+      {false, 5, 5, 5, 9, 11, 3, 2, 2, 2, ConvCpuAlgo::kDepthwise},
+      {true, 5, 5, 5, 9, 11, 5, 2, 1, 0, ConvCpuAlgo::kDepthwise},
+      // grouped convs other than depthwise run im2col group by group
+      {false, 2, 4, 6, 9, 11, 3, 1, 1, 1, ConvCpuAlgo::kIm2ColGemm},
+      {false, 4, 4, 8, 9, 11, 3, 1, 1, 1, ConvCpuAlgo::kIm2ColGemm},
+      {false, 1, 16, 16, 6, 7, 3, 1, 1, 1, ConvCpuAlgo::kWinogradF2x3},
+      {false, 1, 16, 24, 13, 17, 3, 1, 1, 1, ConvCpuAlgo::kWinogradF4x3},
+      {false, 1, 20, 16, 12, 12, 3, 1, 1, 0, ConvCpuAlgo::kWinogradF4x3},
+      {true, 1, 16, 16, 13, 17, 3, 1, 1, 1, ConvCpuAlgo::kIm2ColGemm},
+      {false, 1, 8, 8, 13, 17, 3, 1, 1, 1, ConvCpuAlgo::kIm2ColGemm},
+  };
+  for (const ConvCase& c : cases) { TestMatchesIm2ColGemm(c); }
+  if (own_thread_pool) { Global<ThreadPool>::Delete(); }
+}
+
+}  // namespace test
+
+}  // namespace oneflow
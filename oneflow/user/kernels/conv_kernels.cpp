@@ -18,6 +18,8 @@ limitations under the License.
 #include "oneflow/core/kernel/new_kernel_util.h"
 #include "oneflow/core/kernel/kernel_util.h"
 #include "oneflow/core/ep/include/primitive/add.h"
+#include "oneflow/core/common/blas.h"
+#include "oneflow/user/kernels/conv_cpu_algo.h"
 
 namespace oneflow {
 
@@ -309,6 +311,7 @@ struct ConvOpKernelState final : public user_op::OpKernelState {
 
   enum CBLAS_TRANSPOSE is_out_diff_need_trans_;
   int32_t idx_offset_;
+  int32_t groups_;
   bool is_dynamic_;
 
   void Update(const ShapeView& x_shape, const ShapeView& out_shape) {
@@ -327,8 +330,10 @@ struct ConvOpKernelState final : public user_op::OpKernelState {
   }
 };
 
-template<typename T>
-std::shared_ptr<ConvOpKernelState<T>> CreateConvOpKernelState(user_op::KernelComputeContext* ctx,
+// ContextT is user_op::KernelComputeContext or, for kernels that keep the state across steps,
+// user_op::KernelInitContext.
+template<typename T, typename ContextT>
+std::shared_ptr<ConvOpKernelState<T>> CreateConvOpKernelState(ContextT* ctx,
                                                               const std::string& in_name,
                                                               const std::string& out_name,
                                                               const std::string& weight_name) {
@@ -370,6 +375,7 @@ std::shared_ptr<ConvOpKernelState<T>> CreateConvOpKernelState(user_op::KernelCom
   state->strides_3d_ = Gen3DVec(ctx->Attr<std::vector<int32_t>>("strides"));
   state->dilation_rate_3d_ = Gen3DVec(ctx->Attr<std::vector<int32_t>>("dilation_rate"));
   state->is_dynamic_ = ctx->TensorDesc4ArgNameAndIndex(in_name, 0)->is_dynamic();
+  state->groups_ = ctx->Attr<int32_t>("groups");
   const auto& padding_before = ctx->Attr<std::vector<int32_t>>("padding_before");
   FOR_RANGE(uint8_t, dim, 0, 3) {
     int64_t index = static_cast<int64_t>(dim) - (3 - padding_before.size());
@@ -383,11 +389,102 @@ std::shared_ptr<ConvOpKernelState<T>> CreateConvOpKernelState(user_op::KernelCom
   return state;
 }
 
+// The im2col path runs the gemms group by group. The channels of a group are contiguous in a
+// channels_first image and interleaved with the other groups in a channels_last one, so a group
+// is addressed by its offset in the image together with the leading dimension of the image.
+template<typename T>
+class ConvGroupGemm final {
+ public:
+  explicit ConvGroupGemm(const ConvOpKernelState<T>& state)
+      : channels_last_(state.idx_offset_ == 1),
+        filters_(state.weight_5d_shape_.At(0)),
+        group_filters_(filters_ / state.groups_),
+        col_rows_(state.weight_5d_shape_.Count(1)),
+        out_spatial_(state.out_5d_shape_.Count(state.idx_offset_, state.idx_offset_ + 3)) {
+    const int64_t group_in_channels = state.weight_5d_shape_.At(channels_last_ ? 4 : 1);
+    in_group_offset_ =
+        channels_last_ ? group_in_channels : group_in_channels * state.in_5d_shape_.Count(2);
+    out_group_offset_ = channels_last_ ? group_filters_ : group_filters_ * out_spatial_;
+    out_ld_ = channels_last_ ? filters_ : out_spatial_;
+  }
+
+  // offset of group g in an image of the input, the im2col of a group starts there
+  int64_t InOffset(int64_t g) const { return g * in_group_offset_; }
+
+  // channels first: out[g] = weight[g] * col_buf
+  // channels last:  out[g] = (weight[g] * col_buf)(T)
+  void Forward(int64_t g, const T* weight, const T* col_buf, T* out_img) const {
+    const T* group_weight = weight + g * group_filters_ * col_rows_;
+    T* group_out = out_img + g * out_group_offset_;
+    if (channels_last_) {
+      cblas_gemm<T>(CblasRowMajor, CblasTrans, CblasTrans, out_spatial_, group_filters_,
+                    col_rows_, static_cast<T>(1), col_buf, out_spatial_, group_weight, col_rows_,
+                    static_cast<T>(0), group_out, out_ld_);
+    } else {
+      cblas_gemm<T>(CblasRowMajor, CblasNoTrans, CblasNoTrans, group_filters_, out_spatial_,
+                    col_rows_, static_cast<T>(1), group_weight, col_rows_, col_buf, out_spatial_,
+                    static_cast<T>(0), group_out, out_ld_);
+    }
+  }
+
+  // channels first:  col_buf' = weight[g](T) * out[g]'
+  // channels last :  col_buf' = weight[g](T) * out[g]'(T)
+  void DataGrad(int64_t g, const T* weight, const T* out_diff_img, T* col_buf) const {
+    cblas_gemm<T>(CblasRowMajor, CblasTrans, channels_last_ ? CblasTrans : CblasNoTrans, col_rows_,
+                  out_spatial_, group_filters_, static_cast<T>(1),
+                  weight + g * group_filters_ * col_rows_, col_rows_,
+                  out_diff_img + g * out_group_offset_, out_ld_, static_cast<T>(0), col_buf,
+                  out_spatial_);
+  }
+
+  // channels first:  weight[g]' += out[g]' * col_buf(T)
+  // channels last :  weight[g]' += out[g]'(T) * col_buf(T)
+  void FilterGrad(int64_t g, const T* out_diff_img, const T* col_buf, T* weight_diff) const {
+    cblas_gemm<T>(CblasRowMajor, channels_last_ ? CblasTrans : CblasNoTrans, CblasTrans,
+                  group_filters_, col_rows_, out_spatial_, static_cast<T>(1),
+                  out_diff_img + g * out_group_offset_, out_ld_, col_buf, out_spatial_,
+                  static_cast<T>(1), weight_diff + g * group_filters_ * col_rows_, col_rows_);
+  }
+
+ private:
+  bool channels_last_;
+  int64_t filters_;
+  int64_t group_filters_;
+  int64_t col_rows_;
+  int64_t out_spatial_;
+  int64_t in_group_offset_;
+  int64_t out_group_offset_;
+  int64_t out_ld_;
+};
+
+ConvCpuAlgoParams ConvCpuAlgoParams4InferContext(user_op::InferContext* ctx) {
+  const user_op::TensorDesc& in = ctx->InputTensorDesc("in", 0);
+  return MakeConvCpuAlgoParams(
+      in.shape(), ctx->OutputTensorDesc("out", 0)->shape(), ctx->Attr<std::string>("data_format"),
+      ctx->Attr<int32_t>("groups"), ctx->Attr<std::vector<int32_t>>("kernel_size"),
+      ctx->Attr<std::vector<int32_t>>("strides"), ctx->Attr<std::vector<int32_t>>("dilation_rate"),
+      ctx->Attr<std::vector<int32_t>>("padding_before"), in.is_dynamic());
+}
+
 template<typename T>
 void InitBiasMulBuf(T* dptr, int64_t num) {
   for (int64_t i = 0; i < num; ++i) { dptr[i] = 1; }
 }
 
+class ConvCpuAlgoKernelState final : public user_op::OpKernelState {
+ public:
+  explicit ConvCpuAlgoKernelState(const ConvCpuAlgoParams& params)
+      : params_(params), algo_(SelectConvCpuAlgo(params)) {}
+  ~ConvCpuAlgoKernelState() override = default;
+
+  const ConvCpuAlgoParams& params() const { return params_; }
+  ConvCpuAlgo algo() const { return algo_; }
+
+ private:
+  ConvCpuAlgoParams params_;
+  ConvCpuAlgo algo_;
+};
+
 template<typename T, size_t NDims>
 class ConvCpuKernel final : public user_op::OpKernel {
  public:
@@ -396,8 +493,53 @@ class ConvCpuKernel final : public user_op::OpKernel {
 
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    const user_op::TensorDesc* in = ctx->TensorDesc4ArgNameAndIndex("in", 0);
+    return std::make_shared<ConvCpuAlgoKernelState>(MakeConvCpuAlgoParams(
+        in->shape(), ctx->TensorDesc4ArgNameAndIndex("out", 0)->shape(),
+        ctx->Attr<std::string>("data_format"), ctx->Attr<int32_t>("groups"),
+        ctx->Attr<std::vector<int32_t>>("kernel_size"), ctx->Attr<std::vector<int32_t>>("strides"),
+        ctx->Attr<std::vector<int32_t>>("dilation_rate"),
+        ctx->Attr<std::vector<int32_t>>("padding_before"), in->is_dynamic()));
+  }
+
  private:
-  void Compute(user_op::KernelComputeContext* ctx) const override {
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
+    const auto* algo_state = dynamic_cast<ConvCpuAlgoKernelState*>(state);
+    CHECK_NOTNULL(algo_state);
+    if (algo_state->algo() == ConvCpuAlgo::kIm2ColGemm) {
+      Im2ColGemmCompute(ctx);
+      return;
+    }
+
+    const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
+    const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
+    const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    ConvCpuAlgoParams params = algo_state->params();
+    params.batch = in->shape().At(0);
+    const T* bias_dptr = bias == nullptr ? nullptr : bias->dptr<T>();
+    switch (algo_state->algo()) {
+      case ConvCpuAlgo::kDirect1x1:
+        ConvCpuAlgoUtil<T>::Direct1x1(params, in->dptr<T>(), weight->dptr<T>(), bias_dptr,
+                                      out->mut_dptr<T>());
+        break;
+      case ConvCpuAlgo::kDepthwise:
+        ConvCpuAlgoUtil<T>::Depthwise(params, in->dptr<T>(), weight->dptr<T>(), bias_dptr,
+                                      tmp_buffer->mut_dptr<T>(), out->mut_dptr<T>());
+        break;
+      case ConvCpuAlgo::kWinogradF2x3:
+      case ConvCpuAlgo::kWinogradF4x3:
+        ConvCpuAlgoUtil<T>::Winograd(algo_state->algo(), params, in->dptr<T>(), weight->dptr<T>(),
+                                     bias_dptr, tmp_buffer->mut_dptr<T>(), out->mut_dptr<T>());
+        break;
+      default: UNIMPLEMENTED();
+    }
+  }
+
+  void Im2ColGemmCompute(user_op::KernelComputeContext* ctx) const {
     const auto& conv_state = CreateConvOpKernelState<T>(ctx, "in", "out", "weight");
     CHECK_NOTNULL(conv_state.get());
 
@@ -407,25 +549,20 @@ class ConvCpuKernel final : public user_op::OpKernel {
     user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
 
     T* col_buf_dptr = tmp_buffer->mut_dptr<T>();
+    const ConvGroupGemm<T> group_gemm(*conv_state);
 
     bool is_bias_mul_inited = false;
     for (int64_t i = 0; i < in->shape().At(0); ++i) {
-      conv_state->im2col_func_(GetImgDptr<T>(in, i), ShapeView(conv_state->in_5d_shape_),
-                               ShapeView(conv_state->weight_5d_shape_),
-                               ShapeView(conv_state->out_5d_shape_), conv_state->strides_3d_.data(),
-                               conv_state->dilation_rate_3d_.data(),
-                               conv_state->padding_before_3d_.data(), col_buf_dptr);
+      FOR_RANGE(int64_t, g, 0, conv_state->groups_) {
+        conv_state->im2col_func_(
+            GetImgDptr<T>(in, i) + group_gemm.InOffset(g), ShapeView(conv_state->in_5d_shape_),
+            ShapeView(conv_state->weight_5d_shape_), ShapeView(conv_state->out_5d_shape_),
+            conv_state->strides_3d_.data(), conv_state->dilation_rate_3d_.data(),
+            conv_state->padding_before_3d_.data(), col_buf_dptr);
+        group_gemm.Forward(g, weight->dptr<T>(), col_buf_dptr, GetImgMutDptr<T>(out, i));
+      }
 
-      // channels first: out = weight * col_buf
-      // channels last:  out = (weight * col_buf)(T)
       int32_t idx_offset = conv_state->idx_offset_;
-      conv_state->forward_func_(
-          CblasNoTrans, CblasNoTrans,
-          conv_state->weight_5d_shape_.At(0),                           // filter
-          conv_state->out_5d_shape_.Count(idx_offset, idx_offset + 3),  // od * oh * ow
-          conv_state->weight_5d_shape_.Count(1),                        // ci * kd * kh * kw
-          static_cast<T>(1), weight->dptr<T>(), col_buf_dptr, static_cast<T>(0),
-          GetImgMutDptr<T>(out, i));
 
       const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
       if (bias != nullptr) {
@@ -457,12 +594,16 @@ class ConvCpuKernel final : public user_op::OpKernel {
   REGISTER_USER_KERNEL(#op_name)                                                            \
       .SetCreateFn<ConvCpuKernel<dtype, ndims>>()                                           \
       .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                       \
-                       && (user_op::HobAttr<int32_t>("groups") == 1)                        \
                        && (user_op::HobDataType("in", 0) == GetDataType<dtype>::value))     \
       .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                         \
         size_t tmp_buffer_size = 0;                                                         \
         const auto& out_shape = ctx->OutputTensorDesc("out", 0)->shape();                   \
         const auto& weight_shape = ctx->InputTensorDesc("weight", 0).shape();               \
+        const ConvCpuAlgoParams params = ConvCpuAlgoParams4InferContext(ctx);               \
+        const ConvCpuAlgo algo = SelectConvCpuAlgo(params);                                 \
+        if (algo != ConvCpuAlgo::kIm2ColGemm) {                                             \
+          return ConvCpuAlgoTmpElemCnt(algo, params) * sizeof(dtype);                       \
+        }                                                                                   \
                                                                                             \
         int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));              \
         tmp_buffer_size +=                                                                  \
@@ -505,24 +646,19 @@ class ConvDataGradCpuKernel final : public user_op::OpKernel {
     Memset<DeviceType::kCPU>(ctx->device_ctx(), dx->mut_dptr<T>(), 0,
                              dx->shape().elem_cnt() * sizeof(T));
 
-    int32_t idx_offset = conv_state->idx_offset_;
+    const ConvGroupGemm<T> group_gemm(*conv_state);
     FOR_RANGE(int64_t, i, 0, dy->shape().At(0)) {
-      // channels first:  col_buf' = weight(T) * out[i]'
-      // channels last :  col_buf' = weight(T) * out[i]'(T)
-      NewKernelUtil<DeviceType::kCPU>::OFGemm(
-          nullptr, CblasTrans, conv_state->is_out_diff_need_trans_,
-          conv_state->weight_5d_shape_.Count(1),                        //  ci * kd * kh * kw
-          conv_state->out_5d_shape_.Count(idx_offset, idx_offset + 3),  //  od * oh * ow
-          conv_state->weight_5d_shape_.At(0),                           //  filter
-          static_cast<T>(1), filter->dptr<T>(), GetImgDptr<T>(dy, i), static_cast<T>(0),
-          col_buf->mut_dptr<T>());
-
-      // in' = col2im(col_buf')
-      conv_state->col2im_func_(col_buf->dptr<T>(), ShapeView(conv_state->in_5d_shape_),
-                               ShapeView(conv_state->weight_5d_shape_),
-                               ShapeView(conv_state->out_5d_shape_), conv_state->strides_3d_.data(),
-                               conv_state->dilation_rate_3d_.data(),
-                               conv_state->padding_before_3d_.data(), GetImgMutDptr<T>(dx, i));
+      FOR_RANGE(int64_t, g, 0, conv_state->groups_) {
+        group_gemm.DataGrad(g, filter->dptr<T>(), GetImgDptr<T>(dy, i), col_buf->mut_dptr<T>());
+        // in[g]' = col2im(col_buf')
+        conv_state->col2im_func_(col_buf->dptr<T>(), ShapeView(conv_state->in_5d_shape_),
+                                 ShapeView(conv_state->weight_5d_shape_),
+                                 ShapeView(conv_state->out_5d_shape_),
+                                 conv_state->strides_3d_.data(),
+                                 conv_state->dilation_rate_3d_.data(),
+                                 conv_state->padding_before_3d_.data(),
+                                 GetImgMutDptr<T>(dx, i) + group_gemm.InOffset(g));
+      }
     }
     if (ctx->has_input("_add_to_output", 0)) {
       const user_op::Tensor* add_to_output = ctx->Tensor4ArgNameAndIndex("_add_to_output", 0);
@@ -542,7 +678,6 @@ class ConvDataGradCpuKernel final : public user_op::OpKernel {
   REGISTER_USER_KERNEL(#op_name)                                                           \
       .SetCreateFn<ConvDataGradCpuKernel<dtype>>()                                         \
       .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                      \
-                       && (user_op::HobAttr<int32_t>("groups") == 1)                       \
                        && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value))    \
       .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                        \
         size_t tmp_buffer_size = 0;                                                        \
@@ -579,23 +714,17 @@ class ConvFilterGradCpuKernel final : public user_op::OpKernel {
 
     Memset<DeviceType::kCPU>(ctx->device_ctx(), filter_diff->mut_dptr<T>(), 0,
                              filter_diff->shape().elem_cnt() * sizeof(T));
-    int32_t idx_offset = conv_state->idx_offset_;
+    const ConvGroupGemm<T> group_gemm(*conv_state);
     FOR_RANGE(int64_t, i, 0, dy->shape().At(0)) {
-      conv_state->im2col_func_(GetImgDptr<T>(x, i), ShapeView(conv_state->in_5d_shape_),
-                               ShapeView(conv_state->weight_5d_shape_),
-                               ShapeView(conv_state->out_5d_shape_), conv_state->strides_3d_.data(),
-                               conv_state->dilation_rate_3d_.data(),
-                               conv_state->padding_before_3d_.data(), col_buf->mut_dptr<T>());
-
-      // channels first:  weight' += out[i]' * col_buf(T)
-      // channels last :  weight' += out[i]'(T) * col_buf(T)
-      NewKernelUtil<DeviceType::kCPU>::OFGemm(
-          nullptr, conv_state->is_out_diff_need_trans_, CblasTrans,
-          conv_state->weight_5d_shape_.At(0),                           //  filter
-          conv_state->weight_5d_shape_.Count(1),                        //  ci * kd * kh * kw
-          conv_state->out_5d_shape_.Count(idx_offset, idx_offset + 3),  //  od * oh * ow
-          static_cast<T>(1), GetImgDptr<T>(dy, i), col_buf->dptr<T>(), static_cast<T>(1),
-          filter_diff->mut_dptr<T>());
+      FOR_RANGE(int64_t, g, 0, conv_state->groups_) {
+        conv_state->im2col_func_(
+            GetImgDptr<T>(x, i) + group_gemm.InOffset(g), ShapeView(conv_state->in_5d_shape_),
+            ShapeView(conv_state->weight_5d_shape_), ShapeView(conv_state->out_5d_shape_),
+            conv_state->strides_3d_.data(), conv_state->dilation_rate_3d_.data(),
+            conv_state->padding_before_3d_.data(), col_buf->mut_dptr<T>());
+        group_gemm.FilterGrad(g, GetImgDptr<T>(dy, i), col_buf->dptr<T>(),
+                              filter_diff->mut_dptr<T>());
+      }
     }
   }
 };
@@ -604,7 +733,6 @@ class ConvFilterGradCpuKernel final : public user_op::OpKernel {
   REGISTER_USER_KERNEL(#op_name)                                                                \
       .SetCreateFn<ConvFilterGradCpuKernel<dtype>>()                                            \
       .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                           \
-                       && (user_op::HobAttr<int32_t>("groups") == 1)                            \
                        && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value))         \
       .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                             \
         size_t tmp_buffer_size = 0;                                                             \
@@ -683,6 +811,241 @@ class ConvBiasGradCpuKernel final : public user_op::OpKernel {
 
 REGISTER_CONV_BIAS_GRAD_KERNEL(conv_bias_grad, float);
 REGISTER_CONV_BIAS_GRAD_KERNEL(conv_bias_grad, double);
+
+// bfloat16 convolutions run the float im2col + gemm path image by image: operands are widened
+// into the tmp buffer, accumulated in float and rounded back to bfloat16 once per output.
+size_t ConvBFloat16ForwardTmpElemCnt(user_op::InferContext* ctx) {
+  const auto& in_shape = ctx->InputTensorDesc("in", 0).shape();
+  const auto& weight_shape = ctx->InputTensorDesc("weight", 0).shape();
+  const auto& out_shape = ctx->OutputTensorDesc("out", 0)->shape();
+  const int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));
+  size_t elem_cnt = weight_shape.elem_cnt() + in_shape.Count(1) + out_shape.Count(1)
+                    + CalcElemNumOfColBuf(out_shape, weight_shape, idx_offset);
+  if (ctx->has_input("bias", 0)) {
+    const int ndims = out_shape.NumAxes() - 2;
+    elem_cnt += weight_shape.At(0) + out_shape.Count(idx_offset, idx_offset + ndims);
+  }
+  return elem_cnt;
+}
+
+class ConvBFloat16CpuKernel final : public user_op::OpKernel {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ConvBFloat16CpuKernel);
+  ConvBFloat16CpuKernel() = default;
+  ~ConvBFloat16CpuKernel() = default;
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return CreateConvOpKernelState<float>(ctx, "in", "out", "weight");
+  }
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
+    auto* conv_state = dynamic_cast<ConvOpKernelState<float>*>(state);
+    CHECK_NOTNULL(conv_state);
+
+    const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
+    const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
+    const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    conv_state->Update(in->shape(), out->shape());
+
+    const int32_t idx_offset = conv_state->idx_offset_;
+    const int64_t in_img_cnt = in->shape().Count(1);
+    const int64_t out_img_cnt = out->shape().Count(1);
+    const int64_t filters = conv_state->weight_5d_shape_.At(0);
+    const int64_t out_spatial_cnt = conv_state->out_5d_shape_.Count(idx_offset, idx_offset + 3);
+    float* weight_buf = tmp_buffer->mut_dptr<float>();
+    float* in_buf = weight_buf + weight->shape().elem_cnt();
+    float* out_buf = in_buf + in_img_cnt;
+    float* col_buf = out_buf + out_img_cnt;
+    float* bias_buf = col_buf + CalcElemNumOfColBuf(out->shape(), weight->shape(), idx_offset);
+    float* bias_mul_buf = bias_buf + filters;
+
+    ConvertBFloat16ToFloat(weight->dptr<bfloat16>(), weight_buf, weight->shape().elem_cnt());
+    if (bias != nullptr) {
+      ConvertBFloat16ToFloat(bias->dptr<bfloat16>(), bias_buf, filters);
+      InitBiasMulBuf(bias_mul_buf, out_spatial_cnt);
+    }
+    FOR_RANGE(int64_t, i, 0, in->shape().At(0)) {
+      ConvertBFloat16ToFloat(GetImgDptr<bfloat16>(in, i), in_buf, in_img_cnt);
+      conv_state->im2col_func_(in_buf, ShapeView(conv_state->in_5d_shape_),
+                               ShapeView(conv_state->weight_5d_shape_),
+                               ShapeView(conv_state->out_5d_shape_), conv_state->strides_3d_.data(),
+                               conv_state->dilation_rate_3d_.data(),
+                               conv_state->padding_before_3d_.data(), col_buf);
+      conv_state->forward_func_(CblasNoTrans, CblasNoTrans, filters, out_spatial_cnt,
+                                conv_state->weight_5d_shape_.Count(1), 1.f, weight_buf, col_buf,
+                                0.f, out_buf);
+      if (bias != nullptr) {
+        conv_state->forward_func_(CblasNoTrans, CblasNoTrans, filters, out_spatial_cnt, 1, 1.f,
+                                  bias_buf, bias_mul_buf, 1.f, out_buf);
+      }
+      ConvertFloatToBFloat16(out_buf, GetImgMutDptr<bfloat16>(out, i), out_img_cnt);
+    }
+  }
+};
+
+#define REGISTER_CONV_BFLOAT16_KERNEL(op_name)                                    \
+  REGISTER_USER_KERNEL(#op_name)                                                  \
+      .SetCreateFn<ConvBFloat16CpuKernel>()                                       \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)             \
+                       && (user_op::HobAttr<int32_t>("groups") == 1)              \
+                       && (user_op::HobDataType("in", 0) == DataType::kBFloat16)) \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {               \
+        return ConvBFloat16ForwardTmpElemCnt(ctx) * sizeof(float);                \
+      })
+
+REGISTER_CONV_BFLOAT16_KERNEL(conv1d);
+REGISTER_CONV_BFLOAT16_KERNEL(conv2d);
+REGISTER_CONV_BFLOAT16_KERNEL(conv3d);
+
+class ConvDataGradBFloat16CpuKernel final : public user_op::OpKernel {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ConvDataGradBFloat16CpuKernel);
+  ConvDataGradBFloat16CpuKernel() = default;
+  ~ConvDataGradBFloat16CpuKernel() = default;
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return CreateConvOpKernelState<float>(ctx, "dx", "dy", "filter");
+  }
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
+    auto* conv_state = dynamic_cast<ConvOpKernelState<float>*>(state);
+    CHECK_NOTNULL(conv_state);
+
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* filter = ctx->Tensor4ArgNameAndIndex("filter", 0);
+    user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    conv_state->Update(dx->shape(), dy->shape());
+
+    const int32_t idx_offset = conv_state->idx_offset_;
+    const int64_t dy_img_cnt = dy->shape().Count(1);
+    const int64_t dx_img_cnt = dx->shape().Count(1);
+    float* filter_buf = tmp_buffer->mut_dptr<float>();
+    float* dy_buf = filter_buf + filter->shape().elem_cnt();
+    float* dx_buf = dy_buf + dy_img_cnt;
+    float* col_buf = dx_buf + dx_img_cnt;
+
+    ConvertBFloat16ToFloat(filter->dptr<bfloat16>(), filter_buf, filter->shape().elem_cnt());
+    FOR_RANGE(int64_t, i, 0, dy->shape().At(0)) {
+      ConvertBFloat16ToFloat(GetImgDptr<bfloat16>(dy, i), dy_buf, dy_img_cnt);
+      NewKernelUtil<DeviceType::kCPU>::OFGemm(
+          nullptr, CblasTrans, conv_state->is_out_diff_need_trans_,
+          conv_state->weight_5d_shape_.Count(1),
+          conv_state->out_5d_shape_.Count(idx_offset, idx_offset + 3),
+          conv_state->weight_5d_shape_.At(0), 1.f, filter_buf, dy_buf, 0.f, col_buf);
+      std::fill(dx_buf, dx_buf + dx_img_cnt, 0.f);
+      conv_state->col2im_func_(col_buf, ShapeView(conv_state->in_5d_shape_),
+                               ShapeView(conv_state->weight_5d_shape_),
+                               ShapeView(conv_state->out_5d_shape_), conv_state->strides_3d_.data(),
+                               conv_state->dilation_rate_3d_.data(),
+                               conv_state->padding_before_3d_.data(), dx_buf);
+      ConvertFloatToBFloat16(dx_buf, GetImgMutDptr<bfloat16>(dx, i), dx_img_cnt);
+    }
+    if (ctx->has_input("_add_to_output", 0)) {
+      const user_op::Tensor* add_to_output = ctx->Tensor4ArgNameAndIndex("_add_to_output", 0);
+      CHECK_EQ(add_to_output->data_type(), dx->data_type());
+      CHECK_EQ(add_to_output->shape(), dx->shape());
+      std::unique_ptr<ep::primitive::Add> primitive =
+          ep::primitive::NewPrimitive<ep::primitive::AddFactory>(DeviceType::kCPU,
+                                                                 add_to_output->data_type());
+      CHECK(primitive);
+      primitive->Launch(ctx->stream(), add_to_output->dptr<bfloat16>(), dx->dptr<bfloat16>(),
+                        dx->mut_dptr<bfloat16>(), add_to_output->shape().elem_cnt());
+    }
+  }
+};
+
+REGISTER_USER_KERNEL("conv_data_grad")
+    .SetCreateFn<ConvDataGradBFloat16CpuKernel>()
+    .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)
+                     && (user_op::HobAttr<int32_t>("groups") == 1)
+                     && (user_op::HobDataType("dy", 0) == DataType::kBFloat16))
+    .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {
+      const auto& dy_shape = ctx->InputTensorDesc("dy", 0).shape();
+      const auto& filter_shape = ctx->InputTensorDesc("filter", 0).shape();
+      const auto& dx_shape = ctx->OutputTensorDesc("dx", 0)->shape();
+      const int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));
+      return (filter_shape.elem_cnt() + dy_shape.Count(1) + dx_shape.Count(1)
+              + CalcElemNumOfColBuf(dy_shape, filter_shape, idx_offset))
+             * sizeof(float);
+    });
+
+class ConvFilterGradBFloat16CpuKernel final : public user_op::OpKernel {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ConvFilterGradBFloat16CpuKernel);
+  ConvFilterGradBFloat16CpuKernel() = default;
+  ~ConvFilterGradBFloat16CpuKernel() = default;
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return CreateConvOpKernelState<float>(ctx, "x", "dy", "filter_diff");
+  }
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
+    auto* conv_state = dynamic_cast<ConvOpKernelState<float>*>(state);
+    CHECK_NOTNULL(conv_state);
+
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    user_op::Tensor* filter_diff = ctx->Tensor4ArgNameAndIndex("filter_diff", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    conv_state->Update(x->shape(), dy->shape());
+
+    const int32_t idx_offset = conv_state->idx_offset_;
+    const int64_t x_img_cnt = x->shape().Count(1);
+    const int64_t dy_img_cnt = dy->shape().Count(1);
+    const int64_t filter_diff_cnt = filter_diff->shape().elem_cnt();
+    float* filter_diff_buf = tmp_buffer->mut_dptr<float>();
+    float* x_buf = filter_diff_buf + filter_diff_cnt;
+    float* dy_buf = x_buf + x_img_cnt;
+    float* col_buf = dy_buf + dy_img_cnt;
+
+    std::fill(filter_diff_buf, filter_diff_buf + filter_diff_cnt, 0.f);
+    FOR_RANGE(int64_t, i, 0, dy->shape().At(0)) {
+      ConvertBFloat16ToFloat(GetImgDptr<bfloat16>(x, i), x_buf, x_img_cnt);
+      ConvertBFloat16ToFloat(GetImgDptr<bfloat16>(dy, i), dy_buf, dy_img_cnt);
+      conv_state->im2col_func_(x_buf, ShapeView(conv_state->in_5d_shape_),
+                               ShapeView(conv_state->weight_5d_shape_),
+                               ShapeView(conv_state->out_5d_shape_), conv_state->strides_3d_.data(),
+                               conv_state->dilation_rate_3d_.data(),
+                               conv_state->padding_before_3d_.data(), col_buf);
+      NewKernelUtil<DeviceType::kCPU>::OFGemm(
+          nullptr, conv_state->is_out_diff_need_trans_, CblasTrans,
+          conv_state->weight_5d_shape_.At(0), conv_state->weight_5d_shape_.Count(1),
+          conv_state->out_5d_shape_.Count(idx_offset, idx_offset + 3), 1.f, dy_buf, col_buf, 1.f,
+          filter_diff_buf);
+    }
+    ConvertFloatToBFloat16(filter_diff_buf, filter_diff->mut_dptr<bfloat16>(), filter_diff_cnt);
+  }
+};
+
+REGISTER_USER_KERNEL("conv_filter_grad")
+    .SetCreateFn<ConvFilterGradBFloat16CpuKernel>()
+    .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)
+                     && (user_op::HobAttr<int32_t>("groups") == 1)
+                     && (user_op::HobDataType("dy", 0) == DataType::kBFloat16))
+    .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {
+      const auto& dy_shape = ctx->InputTensorDesc("dy", 0).shape();
+      const auto& x_shape = ctx->InputTensorDesc("x", 0).shape();
+      const auto& filter_diff_shape = ctx->OutputTensorDesc("filter_diff", 0)->shape();
+      const int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));
+      return (filter_diff_shape.elem_cnt() + x_shape.Count(1) + dy_shape.Count(1)
+              + CalcElemNumOfColBuf(dy_shape, filter_diff_shape, idx_offset))
+             * sizeof(float);
+    });
 }  // namespace
 
 }  // namespace oneflow
@@ -16,7 +16,7 @@ limitations under the License.
 #include "oneflow/core/common/multi_client.h"
 #include "oneflow/core/common/nd_index_offset_helper.h"
 #include "oneflow/core/framework/framework.h"
-#include "oneflow/user/data/gpt_dataset.h"
+#include "oneflow/user/data/gpt_batch_prefetcher.h"
 #include "oneflow/core/rpc/include/global_process_ctx.h"
 
 namespace oneflow {
@@ -57,6 +57,11 @@ size_t GetShardIndex(const Shape& hierarchy, const cfg::NdSbp& nd_sbp, size_t ra
   return index;
 }
 
+// Number of batches assembled ahead by a background thread, 0 means assembling in Compute.
+size_t GetPrefetchDepth() {
+  return std::max<int64_t>(ParseIntegerFromEnv("ONEFLOW_GPT_DATA_LOADER_PREFETCH_DEPTH", 2), 0);
+}
+
 class GPTDataLoader final : public OpKernelState {
  public:
   GPTDataLoader(KernelInitContext* ctx) : batch_cnt_(0) {
@@ -73,37 +78,49 @@ class GPTDataLoader final : public OpKernelState {
 
     // NOTE(zwx): GPTDataLoader is not consistent since attr nd_sbp is empty,
     // we assume that it works in DDP
+    size_t num_shards = 0;
+    size_t shard_index = 0;
     auto nd_sbp_str_vec = ctx->Attr<std::vector<std::string>>("nd_sbp");
     if (nd_sbp_str_vec.empty() && CHECK_JUST(IsMultiClient())) {
-      num_shards_ = GlobalProcessCtx::WorldSize();
-      shard_index_ = GlobalProcessCtx::Rank();
+      num_shards = GlobalProcessCtx::WorldSize();
+      shard_index = GlobalProcessCtx::Rank();
     } else {
       const Shape& hierarchy = *ctx->parallel_desc().hierarchy();
       const cfg::NdSbp& paral_dist = ctx->NdSbp4ArgNameAndIndex("out", 0);
       CHECK_EQ(hierarchy.NumAxes(), paral_dist.sbp_parallel_size());
-      num_shards_ = GetNumShards(hierarchy, paral_dist);
-      CHECK_EQ(num_samples % num_shards_, 0);
-      shard_index_ = GetShardIndex(hierarchy, paral_dist, ctx->parallel_ctx().parallel_id());
+      num_shards = GetNumShards(hierarchy, paral_dist);
+      CHECK_EQ(num_samples % num_shards, 0);
+      shard_index = GetShardIndex(hierarchy, paral_dist, ctx->parallel_ctx().parallel_id());
 
       size_t logical_batch_size = ctx->LogicalTensorDesc4ArgNameAndIndex("out", 0)->shape().At(0);
-      CHECK_EQ(logical_batch_size % num_shards_, 0);
-      CHECK_EQ(logical_batch_size / num_shards_, batch_size_);
+      CHECK_EQ(logical_batch_size % num_shards, 0);
+      CHECK_EQ(logical_batch_size / num_shards, batch_size_);
+    }
+    prefetcher_ = std::make_unique<GPTBatchPrefetcher>(
+        dataset_.get(), seq_len_ + label_len_, batch_size_, num_shards, shard_index,
+        GetPrefetchDepth());
+  }
+  ~GPTDataLoader() {
+    const GPTBatchPrefetcherMetrics metrics = prefetcher_->metrics();
+    if (metrics.num_batches > 0) {
+      LOG(INFO) << "GPTDataLoader prefetched " << metrics.num_batches
+                << " batches, average queue depth: " << metrics.average_queue_depth()
+                << ", stalls: " << metrics.num_stalls << ", stall time: " << metrics.stall_seconds
+                << " s";
     }
-    CHECK_LT(shard_index_, num_shards_);
   }
-  ~GPTDataLoader() = default;
 
   template<typename T>
-  void GetBatch(size_t iter, user_op::Tensor* tokens) const {
-    const size_t sample_len = seq_len_ + label_len_;
+  void StartPrefetch() {
+    prefetcher_->Start<T>();
+  }
+
+  template<typename T>
+  void GetBatch(size_t iter, user_op::Tensor* tokens) {
     CHECK_EQ(tokens->shape().NumAxes(), 2);
     CHECK_EQ(tokens->shape().At(0), batch_size_);
-    CHECK_EQ(tokens->shape().At(1), sample_len);
-    T* dptr = tokens->mut_dptr<T>();
-    for (size_t i = 0; i < batch_size_; ++i) {
-      size_t sample_iter = iter * batch_size_ * num_shards_ + shard_index_ * batch_size_ + i;
-      dataset_->GetSample(sample_iter, dptr + i * sample_len);
-    }
+    CHECK_EQ(tokens->shape().At(1), seq_len_ + label_len_);
+    prefetcher_->GetBatch<T>(iter, tokens->mut_dptr<T>());
   }
 
   template<typename T>
@@ -112,13 +129,15 @@ class GPTDataLoader final : public OpKernelState {
     batch_cnt_ += 1;
   }
 
+  GPTBatchPrefetcherMetrics prefetch_metrics() const { return prefetcher_->metrics(); }
+
  private:
   std::unique_ptr<const MegatronGPTMMapDataset> dataset_;
+  // destructed before the dataset it reads
+  std::unique_ptr<GPTBatchPrefetcher> prefetcher_;
   size_t seq_len_;
   size_t label_len_;
   size_t batch_size_;
-  size_t num_shards_;
-  size_t shard_index_;
   size_t batch_cnt_;
 };
 
@@ -129,7 +148,8 @@ class GPTDataLoaderKernel final : public OpKernel {
   ~GPTDataLoaderKernel() = default;
 
   std::shared_ptr<OpKernelState> CreateOpKernelState(KernelInitContext* ctx) const override {
-    std::shared_ptr<OpKernelState> reader(new GPTDataLoader(ctx));
+    std::shared_ptr<GPTDataLoader> reader(new GPTDataLoader(ctx));
+    reader->StartPrefetch<T>();
     return reader;
   }
 
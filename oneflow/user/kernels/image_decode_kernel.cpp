@@ -16,17 +16,39 @@ limitations under the License.
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/core/thread/thread_manager.h"
 #include "oneflow/user/image/image_util.h"
+#include "oneflow/user/image/jpeg_decoder.h"
 #include <opencv2/opencv.hpp>
 
 namespace oneflow {
 
 namespace {
 
+// Decodes JPEGs with libjpeg-turbo directly in color_space, which saves the color conversion and
+// the intermediate cv::Mat. Returns false for images that have to go through cv::imdecode.
+bool DecodeJpegImage(const TensorBuffer& raw_bytes, TensorBuffer* image_buffer,
+                     const std::string& color_space) {
+  static thread_local JpegDecoder jpeg_decoder;
+  const auto* data = reinterpret_cast<const unsigned char*>(raw_bytes.data());
+  int width = 0;
+  int height = 0;
+  JpegImage image{};
+  if (!jpeg_decoder.ReadHeader(data, raw_bytes.elem_cnt(), &width, &height)
+      || !jpeg_decoder.DecodeCrop(0, 0, width, height, 0, 0, color_space, &image)) {
+    return false;
+  }
+  image_buffer->Resize(Shape({image.height, image.width, image.channels}), DataType::kUInt8);
+  memcpy(image_buffer->mut_data(), image.data, image_buffer->nbytes());
+  return true;
+}
+
 void DecodeImage(const TensorBuffer& raw_bytes, TensorBuffer* image_buffer,
                  const std::string& color_space, DataType data_type) {
   // should only support kChar, but numpy ndarray maybe cannot convert to char*
   CHECK(raw_bytes.data_type() == DataType::kChar || raw_bytes.data_type() == DataType::kInt8
         || raw_bytes.data_type() == DataType::kUInt8);
+  if (data_type == DataType::kUInt8 && DecodeJpegImage(raw_bytes, image_buffer, color_space)) {
+    return;
+  }
   cv::_InputArray raw_bytes_arr(raw_bytes.data<char>(), raw_bytes.elem_cnt());
   cv::Mat image_mat = cv::imdecode(
       raw_bytes_arr, (ImageUtil::IsColor(color_space) ? cv::IMREAD_COLOR : cv::IMREAD_GRAYSCALE)
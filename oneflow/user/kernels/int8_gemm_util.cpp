@@ -0,0 +1,131 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/int8_gemm_util.h"
+#include <vector>
+#if defined(__AVX512VNNI__) && defined(__AVX512BW__)
+#include <immintrin.h>
+#define ONEFLOW_INT8_GEMM_USE_VNNI
+#endif
+
+namespace oneflow {
+
+namespace {
+
+int32_t DotInt8(const int8_t* a, const int8_t* b, int64_t k) {
+  int32_t sum = 0;
+  for (int64_t p = 0; p < k; ++p) {
+    sum += static_cast<int32_t>(a[p]) * static_cast<int32_t>(b[p]);
+  }
+  return sum;
+}
+
+#ifdef ONEFLOW_INT8_GEMM_USE_VNNI
+
+constexpr int64_t kVecSize = 64;
+constexpr int64_t kColBlock = 4;
+
+// vpdpbusd multiplies unsigned by signed bytes, so a is shifted by 128 to be unsigned and
+// 128 * sum(b_row) is subtracted afterwards.
+void Int8GemmNTImpl(int64_t m, int64_t n, int64_t k, const int8_t* a, int64_t lda,
+                    const int8_t* b, int64_t ldb, int32_t* c, int64_t ldc) {
+  const int64_t k_vec = k / kVecSize * kVecSize;
+  std::vector<int32_t> b_compensation(n, 0);
+  for (int64_t j = 0; j < n; ++j) {
+    const int8_t* b_row = b + j * ldb;
+    int32_t sum = 0;
+    for (int64_t p = 0; p < k_vec; ++p) { sum += b_row[p]; }
+    b_compensation[j] = sum * 128;
+  }
+  const __m512i sign_flip = _mm512_set1_epi8(static_cast<char>(0x80));
+  for (int64_t i = 0; i < m; ++i) {
+    const int8_t* a_row = a + i * lda;
+    int32_t* c_row = c + i * ldc;
+    int64_t j = 0;
+    for (; j + kColBlock <= n; j += kColBlock) {
+      __m512i acc[kColBlock];
+      for (int64_t q = 0; q < kColBlock; ++q) { acc[q] = _mm512_setzero_si512(); }
+      for (int64_t p = 0; p < k_vec; p += kVecSize) {
+        const __m512i a_u8 = _mm512_xor_si512(_mm512_loadu_si512(a_row + p), sign_flip);
+        for (int64_t q = 0; q < kColBlock; ++q) {
+          acc[q] =
+              _mm512_dpbusd_epi32(acc[q], a_u8, _mm512_loadu_si512(b + (j + q) * ldb + p));
+        }
+      }
+      for (int64_t q = 0; q < kColBlock; ++q) {
+        const int8_t* b_row = b + (j + q) * ldb;
+        c_row[j + q] = _mm512_reduce_add_epi32(acc[q]) - b_compensation[j + q]
+                       + DotInt8(a_row + k_vec, b_row + k_vec, k - k_vec);
+      }
+    }
+    for (; j < n; ++j) {
+      const int8_t* b_row = b + j * ldb;
+      __m512i acc = _mm512_setzero_si512();
+      for (int64_t p = 0; p < k_vec; p += kVecSize) {
+        const __m512i a_u8 = _mm512_xor_si512(_mm512_loadu_si512(a_row + p), sign_flip);
+        acc = _mm512_dpbusd_epi32(acc, a_u8, _mm512_loadu_si512(b_row + p));
+      }
+      c_row[j] = _mm512_reduce_add_epi32(acc) - b_compensation[j]
+                 + DotInt8(a_row + k_vec, b_row + k_vec, k - k_vec);
+    }
+  }
+}
+
+#else
+
+constexpr int64_t kColBlock = 4;
+
+// Each row of a is reused for kColBlock rows of b, the inner loop is vectorized by the compiler.
+void Int8GemmNTImpl(int64_t m, int64_t n, int64_t k, const int8_t* a, int64_t lda,
+                    const int8_t* b, int64_t ldb, int32_t* c, int64_t ldc) {
+  for (int64_t i = 0; i < m; ++i) {
+    const int8_t* a_row = a + i * lda;
+    int32_t* c_row = c + i * ldc;
+    int64_t j = 0;
+    for (; j + kColBlock <= n; j += kColBlock) {
+      const int8_t* b0 = b + j * ldb;
+      const int8_t* b1 = b0 + ldb;
+      const int8_t* b2 = b1 + ldb;
+      const int8_t* b3 = b2 + ldb;
+      int32_t sum0 = 0;
+      int32_t sum1 = 0;
+      int32_t sum2 = 0;
+      int32_t sum3 = 0;
+      for (int64_t p = 0; p < k; ++p) {
+        const int32_t a_val = a_row[p];
+        sum0 += a_val * b0[p];
+        sum1 += a_val * b1[p];
+        sum2 += a_val * b2[p];
+        sum3 += a_val * b3[p];
+      }
+      c_row[j] = sum0;
+      c_row[j + 1] = sum1;
+      c_row[j + 2] = sum2;
+      c_row[j + 3] = sum3;
+    }
+    for (; j < n; ++j) { c_row[j] = DotInt8(a_row, b + j * ldb, k); }
+  }
+}
+
+#endif  // ONEFLOW_INT8_GEMM_USE_VNNI
+
+}  // namespace
+
+void Int8GemmNT(int64_t m, int64_t n, int64_t k, const int8_t* a, int64_t lda, const int8_t* b,
+                int64_t ldb, int32_t* c, int64_t ldc) {
+  Int8GemmNTImpl(m, n, k, a, lda, b, ldb, c, ldc);
+}
+
+}  // namespace oneflow
@@ -0,0 +1,32 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_INT8_GEMM_UTIL_H_
+#define ONEFLOW_USER_KERNELS_INT8_GEMM_UTIL_H_
+
+#include <cstdint>
+
+namespace oneflow {
+
+// c[i * ldc + j] = sum(a[i * lda + p] * b[j * ldb + p] for p in [0, k)), accumulated in int32.
+// Both a and b are row-major with the reduction dimension contiguous, so b holds one output
+// column per row, like the weights of conv and of matmul with transpose_b.
+// Uses AVX512-VNNI dot products when the build targets it, and a portable loop otherwise.
+void Int8GemmNT(int64_t m, int64_t n, int64_t k, const int8_t* a, int64_t lda, const int8_t* b,
+                int64_t ldb, int32_t* c, int64_t ldc);
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_INT8_GEMM_UTIL_H_
@@ -14,9 +14,91 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
 
+namespace {
+
+constexpr int kWelfordLanes = 8;
+
+// Single pass Welford over one row. Elements are striped across kWelfordLanes independent
+// accumulators so the inner loop vectorizes, the lanes are merged with Chan's formula and the
+// tail is folded in sequentially.
+template<typename T>
+void WelfordMeanInvVariance(const T* x, const int64_t norm_size, const double epsilon, T* mean,
+                            T* inv_variance) {
+  T lane_mean[kWelfordLanes] = {0};
+  T lane_m2[kWelfordLanes] = {0};
+  const int64_t vec_size = norm_size / kWelfordLanes * kWelfordLanes;
+  T lane_count = 0;
+  for (int64_t i = 0; i < vec_size; i += kWelfordLanes) {
+    lane_count += 1;
+    const T inv_count = static_cast<T>(1) / lane_count;
+    for (int l = 0; l < kWelfordLanes; ++l) {
+      const T delta = x[i + l] - lane_mean[l];
+      lane_mean[l] += delta * inv_count;
+      lane_m2[l] += delta * (x[i + l] - lane_mean[l]);
+    }
+  }
+  T row_mean = 0;
+  T row_m2 = 0;
+  for (int l = 0; l < kWelfordLanes; ++l) { row_mean += lane_mean[l]; }
+  row_mean /= static_cast<T>(kWelfordLanes);
+  for (int l = 0; l < kWelfordLanes; ++l) {
+    const T delta = lane_mean[l] - row_mean;
+    row_m2 += lane_m2[l] + lane_count * delta * delta;
+  }
+  T count = lane_count * kWelfordLanes;
+  for (int64_t i = vec_size; i < norm_size; ++i) {
+    count += 1;
+    const T delta = x[i] - row_mean;
+    row_mean += delta / count;
+    row_m2 += delta * (x[i] - row_mean);
+  }
+  const T variance = std::max(row_m2 / static_cast<T>(norm_size), static_cast<T>(0));
+  *mean = row_mean;
+  *inv_variance = static_cast<T>(1) / std::sqrt(variance + static_cast<T>(epsilon));
+}
+
+template<typename T>
+void NormalizeAndAffine(const int64_t n, const T* x, const T mean, const T inv_variance,
+                        const T* gamma, const T* beta, T* normalized, T* y) {
+  if (gamma != nullptr && beta != nullptr) {
+    for (int64_t i = 0; i < n; ++i) {
+      const T v = (x[i] - mean) * inv_variance;
+      normalized[i] = v;
+      y[i] = v * gamma[i] + beta[i];
+    }
+  } else if (gamma != nullptr) {
+    for (int64_t i = 0; i < n; ++i) {
+      const T v = (x[i] - mean) * inv_variance;
+      normalized[i] = v;
+      y[i] = v * gamma[i];
+    }
+  } else if (beta != nullptr) {
+    for (int64_t i = 0; i < n; ++i) { y[i] = (x[i] - mean) * inv_variance + beta[i]; }
+  } else {
+    for (int64_t i = 0; i < n; ++i) { y[i] = (x[i] - mean) * inv_variance; }
+  }
+}
+
+// Calls Fn(col, param_offset, len) over the pieces of a row that are contiguous in the affine
+// params, which may span less or more than one normalized row.
+template<typename Fn>
+void ForEachParamSegment(const int64_t row, const int64_t norm_size, const int64_t instance_size,
+                         const Fn& DoEach) {
+  int64_t col = 0;
+  while (col < norm_size) {
+    const int64_t offset = (row * norm_size + col) % instance_size;
+    const int64_t len = std::min(norm_size - col, instance_size - offset);
+    DoEach(col, offset, len);
+    col += len;
+  }
+}
+
+}  // namespace
+
 template<typename T>
 class LayerNormCpuKernel final : public user_op::OpKernel {
  public:
@@ -24,8 +106,59 @@ class LayerNormCpuKernel final : public user_op::OpKernel {
   ~LayerNormCpuKernel() = default;
 
  private:
+  using user_op::OpKernel::Compute;
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    const bool scale = ctx->Attr<bool>("scale");
+    const bool center = ctx->Attr<bool>("center");
+    user_op::Tensor* normalized = scale ? ctx->Tensor4ArgNameAndIndex("normalized", 0) : y;
+    const double epsilon = ctx->Attr<double>("epsilon");
+    const int64_t num_instances = mean->shape().elem_cnt();
+    if (num_instances == 0) { return; }
+    const int64_t norm_size = x->shape().elem_cnt() / num_instances;
+    int64_t instance_size = norm_size;
+    const T* gamma_ptr = nullptr;
+    const T* beta_ptr = nullptr;
+    if (scale) {
+      const user_op::Tensor* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+      instance_size = gamma->shape().elem_cnt();
+      gamma_ptr = gamma->dptr<T>();
+    }
+    if (center) {
+      const user_op::Tensor* beta = ctx->Tensor4ArgNameAndIndex("beta", 0);
+      if (gamma_ptr) {
+        CHECK_EQ(beta->shape().elem_cnt(), instance_size);
+      } else {
+        instance_size = beta->shape().elem_cnt();
+      }
+      beta_ptr = beta->dptr<T>();
+    }
+    CHECK_GT(instance_size, 0);
+    CHECK_EQ(y->shape().elem_cnt() % instance_size, 0);
+    const T* x_ptr = x->dptr<T>();
+    T* y_ptr = y->mut_dptr<T>();
+    T* normalized_ptr = normalized->mut_dptr<T>();
+    T* mean_ptr = mean->mut_dptr<T>();
+    T* inv_variance_ptr = inv_variance->mut_dptr<T>();
+    MultiThreadLoop(num_instances, [&](size_t row) {
+      const int64_t row_offset = row * norm_size;
+      WelfordMeanInvVariance<T>(x_ptr + row_offset, norm_size, epsilon, mean_ptr + row,
+                                inv_variance_ptr + row);
+      ForEachParamSegment(row, norm_size, instance_size,
+                          [&](int64_t col, int64_t param_offset, int64_t len) {
+                            const int64_t offset = row_offset + col;
+                            NormalizeAndAffine<T>(
+                                len, x_ptr + offset, mean_ptr[row], inv_variance_ptr[row],
+                                gamma_ptr ? gamma_ptr + param_offset : nullptr,
+                                beta_ptr ? beta_ptr + param_offset : nullptr,
+                                normalized_ptr + offset, y_ptr + offset);
+                          });
+    });
+  };
 };
 
 #define REGISTER_LAYER_NORM_CPU_KERNEL(dtype)                         \
@@ -44,15 +177,76 @@ class LayerNormGradCpuKernel final : public user_op::OpKernel {
   ~LayerNormGradCpuKernel() = default;
 
  private:
+  using user_op::OpKernel::Compute;
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    const user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    const T* add_to_output_ptr = nullptr;
+    if (ctx->has_input("_add_to_output", 0)) {
+      const user_op::Tensor* add_to_output = ctx->Tensor4ArgNameAndIndex("_add_to_output", 0);
+      CHECK_EQ(add_to_output->data_type(), dx->data_type());
+      CHECK_EQ(add_to_output->shape(), dx->shape());
+      add_to_output_ptr = add_to_output->dptr<T>();
+    }
+    const int64_t num_instances = mean->shape().elem_cnt();
+    if (num_instances == 0) { return; }
+    const int64_t norm_size = x->shape().elem_cnt() / num_instances;
+    const T inv_norm_size = static_cast<T>(1) / static_cast<T>(norm_size);
+    const T* dy_ptr = dy->dptr<T>();
+    const T* x_ptr = x->dptr<T>();
+    const T* mean_ptr = mean->dptr<T>();
+    const T* inv_variance_ptr = inv_variance->dptr<T>();
+    T* dx_ptr = dx->mut_dptr<T>();
+    // dx = inv_var * (dy - mean(dy) - x_hat * mean(dy * x_hat)), x_hat = (x - mean) * inv_var
+    MultiThreadLoop(num_instances, [&](size_t row) {
+      const int64_t row_offset = row * norm_size;
+      const T* dy_row = dy_ptr + row_offset;
+      const T* x_row = x_ptr + row_offset;
+      T* dx_row = dx_ptr + row_offset;
+      const T row_mean = mean_ptr[row];
+      const T row_inv_variance = inv_variance_ptr[row];
+      T sum_dy = 0;
+      T sum_dy_x_hat = 0;
+      for (int64_t i = 0; i < norm_size; ++i) {
+        sum_dy += dy_row[i];
+        sum_dy_x_hat += dy_row[i] * (x_row[i] - row_mean) * row_inv_variance;
+      }
+      const T mean_dy = sum_dy * inv_norm_size;
+      const T mean_dy_x_hat = sum_dy_x_hat * inv_norm_size;
+      if (add_to_output_ptr != nullptr) {
+        const T* add_to_output_row = add_to_output_ptr + row_offset;
+        for (int64_t i = 0; i < norm_size; ++i) {
+          const T x_hat = (x_row[i] - row_mean) * row_inv_variance;
+          dx_row[i] = add_to_output_row[i]
+                      + row_inv_variance * (dy_row[i] - mean_dy - x_hat * mean_dy_x_hat);
+        }
+      } else {
+        for (int64_t i = 0; i < norm_size; ++i) {
+          const T x_hat = (x_row[i] - row_mean) * row_inv_variance;
+          dx_row[i] = row_inv_variance * (dy_row[i] - mean_dy - x_hat * mean_dy_x_hat);
+        }
+      }
+    });
+  };
 };
 
-#define REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(dtype)                    \
-  REGISTER_USER_KERNEL("layer_norm_grad")                             \
-      .SetCreateFn<LayerNormGradCpuKernel<dtype>>()                   \
-      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
-                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value));
+#define REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(dtype)                                         \
+  REGISTER_USER_KERNEL("layer_norm_grad")                                                  \
+      .SetCreateFn<LayerNormGradCpuKernel<dtype>>()                                        \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                      \
+                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value))    \
+      .SetInplaceProposalFn(                                                               \
+          [](const user_op::InferContext& ctx,                                             \
+             const user_op::AddInplaceArgPair& AddInplaceArgPairFn) -> Maybe<void> {       \
+            if (ctx.has_input("_add_to_output", 0)) {                                      \
+              OF_RETURN_IF_ERROR(AddInplaceArgPairFn("dx", 0, "_add_to_output", 0, true)); \
+            }                                                                              \
+            return Maybe<void>::Ok();                                                      \
+          });
 
 REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(float)
 REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(double)
@@ -64,8 +258,103 @@ class LayerNormParamGradCpuKernel final : public user_op::OpKernel {
   ~LayerNormParamGradCpuKernel() = default;
 
  private:
+  using user_op::OpKernel::Compute;
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    user_op::Tensor* beta_diff = ctx->Tensor4ArgNameAndIndex("beta_diff", 0);
+    user_op::Tensor* gamma_diff = ctx->Tensor4ArgNameAndIndex("gamma_diff", 0);
+    user_op::Tensor* normalized_diff = ctx->Tensor4ArgNameAndIndex("normalized_diff", 0);
+    const user_op::Tensor* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+    const int64_t begin_params_axis = ctx->Attr<int64_t>("begin_params_axis");
+    const int64_t m = dy->shape().Count(begin_params_axis);
+    if (m == 0) { return; }
+    CHECK_EQ(dy->shape().elem_cnt() % m, 0);
+    const int64_t n = dy->shape().elem_cnt() / m;
+    const T* dy_ptr = dy->dptr<T>();
+    const T* normalized_ptr = nullptr;
+    T* gamma_diff_ptr = nullptr;
+    T* beta_diff_ptr = nullptr;
+    T* normalized_diff_ptr = nullptr;
+    const T* gamma_ptr = nullptr;
+    if (beta_diff != nullptr) {
+      CHECK_EQ(beta_diff->shape().elem_cnt(), m);
+      beta_diff_ptr = beta_diff->mut_dptr<T>();
+    }
+    if (gamma_diff != nullptr) {
+      CHECK_EQ(gamma_diff->shape().elem_cnt(), m);
+      gamma_diff_ptr = gamma_diff->mut_dptr<T>();
+      normalized_ptr = ctx->Tensor4ArgNameAndIndex("normalized", 0)->dptr<T>();
+    }
+    if (normalized_diff != nullptr) { normalized_diff_ptr = normalized_diff->mut_dptr<T>(); }
+    if (gamma != nullptr) {
+      CHECK_EQ(gamma->shape().elem_cnt(), m);
+      gamma_ptr = gamma->dptr<T>();
+    }
+    const bool need_reduce = gamma_diff_ptr != nullptr || beta_diff_ptr != nullptr;
+    const int64_t thread_num = Global<ThreadPool>::Get()->thread_num();
+    // Rows are split into chunks that accumulate partial gamma/beta sums into reduce_buf
+    // (n * m elements, so at most n / 2 chunks of 2 * m partials fit), then the partials are
+    // summed column-parallel. With a single chunk the partials are the outputs themselves.
+    int64_t num_chunks = std::max<int64_t>(std::min(thread_num, n), 1);
+    T* partial_ptr = nullptr;
+    if (need_reduce) {
+      num_chunks = std::max<int64_t>(std::min(thread_num, n / 2), 1);
+      if (num_chunks > 1) {
+        partial_ptr = ctx->Tensor4ArgNameAndIndex("reduce_buf", 0)->mut_dptr<T>();
+      }
+    }
+    BalancedSplitter row_splitter(n, num_chunks);
+    MultiThreadLoop(num_chunks, [&](size_t chunk) {
+      T* gamma_acc = partial_ptr ? partial_ptr + chunk * 2 * m : gamma_diff_ptr;
+      T* beta_acc = partial_ptr ? partial_ptr + chunk * 2 * m + m : beta_diff_ptr;
+      if (gamma_diff_ptr != nullptr) { std::fill(gamma_acc, gamma_acc + m, static_cast<T>(0)); }
+      if (beta_diff_ptr != nullptr) { std::fill(beta_acc, beta_acc + m, static_cast<T>(0)); }
+      const Range range = row_splitter.At(chunk);
+      for (int64_t row = range.begin(); row < range.end(); ++row) {
+        const T* dy_row = dy_ptr + row * m;
+        if (gamma_diff_ptr != nullptr) {
+          const T* normalized_row = normalized_ptr + row * m;
+          for (int64_t j = 0; j < m; ++j) { gamma_acc[j] += dy_row[j] * normalized_row[j]; }
+        }
+        if (beta_diff_ptr != nullptr) {
+          for (int64_t j = 0; j < m; ++j) { beta_acc[j] += dy_row[j]; }
+        }
+        if (normalized_diff_ptr != nullptr) {
+          T* normalized_diff_row = normalized_diff_ptr + row * m;
+          if (gamma_ptr != nullptr) {
+            for (int64_t j = 0; j < m; ++j) { normalized_diff_row[j] = dy_row[j] * gamma_ptr[j]; }
+          } else {
+            std::copy(dy_row, dy_row + m, normalized_diff_row);
+          }
+        }
+      }
+    });
+    if (partial_ptr == nullptr) { return; }
+    const int64_t num_col_blocks = std::min(thread_num, m);
+    BalancedSplitter col_splitter(m, num_col_blocks);
+    MultiThreadLoop(num_col_blocks, [&](size_t block) {
+      const Range range = col_splitter.At(block);
+      const int64_t begin = range.begin();
+      const int64_t len = range.size();
+      if (gamma_diff_ptr != nullptr) {
+        std::copy(partial_ptr + begin, partial_ptr + begin + len, gamma_diff_ptr + begin);
+      }
+      if (beta_diff_ptr != nullptr) {
+        std::copy(partial_ptr + m + begin, partial_ptr + m + begin + len, beta_diff_ptr + begin);
+      }
+      for (int64_t chunk = 1; chunk < num_chunks; ++chunk) {
+        const T* gamma_partial = partial_ptr + chunk * 2 * m + begin;
+        const T* beta_partial = gamma_partial + m;
+        if (gamma_diff_ptr != nullptr) {
+          for (int64_t j = 0; j < len; ++j) { gamma_diff_ptr[begin + j] += gamma_partial[j]; }
+        }
+        if (beta_diff_ptr != nullptr) {
+          for (int64_t j = 0; j < len; ++j) { beta_diff_ptr[begin + j] += beta_partial[j]; }
+        }
+      }
+    });
+  };
 };
 
 #define REGISTER_LAYER_NORM_PARAM_GRAD_CPU_KERNEL(dtype)              \
@@ -0,0 +1,240 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/thread/thread_manager.h"
+#include "oneflow/user/kernels/model_update_kernel_util.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr int64_t kMinElemNumPerUpdateTask = 32768;
+
+// Walks the models as one concatenated element space split evenly across threads, so a step
+// over thousands of small tensors costs one launch and one pass over memory. DoEach(i, begin,
+// end) updates elements [begin, end) of the i-th model.
+template<typename DoEachT>
+void MultiTensorForEachRange(const std::vector<int64_t>& elem_cnts, const DoEachT& DoEach) {
+  std::vector<int64_t> offsets(elem_cnts.size() + 1, 0);
+  FOR_RANGE(size_t, i, 0, elem_cnts.size()) { offsets.at(i + 1) = offsets.at(i) + elem_cnts.at(i); }
+  const int64_t total = offsets.back();
+  if (total == 0) { return; }
+  const int64_t thread_num = Global<ThreadPool>::Get()->thread_num();
+  const int64_t num_tasks =
+      std::max<int64_t>(std::min(thread_num, total / kMinElemNumPerUpdateTask), 1);
+  BalancedSplitter bs(total, num_tasks);
+  auto DoTask = [&](size_t task) {
+    const Range range = bs.At(task);
+    int64_t i = std::upper_bound(offsets.cbegin(), offsets.cend(), range.begin())
+                - offsets.cbegin() - 1;
+    for (int64_t pos = range.begin(); pos < range.end(); ++i) {
+      const int64_t end = std::min(offsets.at(i + 1), range.end());
+      if (end > pos) { DoEach(i, pos - offsets.at(i), end - offsets.at(i)); }
+      pos = end;
+    }
+  };
+  if (num_tasks == 1) {
+    DoTask(0);
+  } else {
+    MultiThreadLoop(num_tasks, DoTask);
+  }
+}
+
+std::vector<int64_t> ModelElemCnts(user_op::KernelComputeContext* ctx) {
+  std::vector<int64_t> elem_cnts(ctx->input_size("model"));
+  FOR_RANGE(size_t, i, 0, elem_cnts.size()) {
+    elem_cnts.at(i) = ctx->Tensor4ArgNameAndIndex("model", i)->shape().elem_cnt();
+  }
+  return elem_cnts;
+}
+
+template<typename T>
+std::vector<T*> MutPtrs(user_op::KernelComputeContext* ctx, const std::string& arg_name) {
+  std::vector<T*> ptrs(ctx->input_size(arg_name));
+  FOR_RANGE(size_t, i, 0, ptrs.size()) {
+    ptrs.at(i) = ctx->Tensor4ArgNameAndIndex(arg_name, i)->mut_dptr<T>();
+  }
+  return ptrs;
+}
+
+template<typename T>
+std::vector<const T*> Ptrs(user_op::KernelComputeContext* ctx, const std::string& arg_name) {
+  std::vector<const T*> ptrs(ctx->input_size(arg_name));
+  FOR_RANGE(size_t, i, 0, ptrs.size()) {
+    ptrs.at(i) = ctx->Tensor4ArgNameAndIndex(arg_name, i)->dptr<T>();
+  }
+  return ptrs;
+}
+
+// Resolves the tensor-or-attr hyperparameters shared by every update op. Returns false when
+// skip_if says the step must be skipped.
+template<typename T>
+bool ResolveCommonHyperParams(user_op::KernelComputeContext* ctx, float* learning_rate,
+                              T* scale) {
+  if (ctx->has_input("skip_if", 0)) {
+    const user_op::Tensor* skip_if = ctx->Tensor4ArgNameAndIndex("skip_if", 0);
+    CHECK_EQ(skip_if->shape().elem_cnt(), 1);
+    if (*skip_if->dptr<int64_t>() != 0) { return false; }
+  }
+  *learning_rate = ctx->Attr<float>("learning_rate_val");
+  if (ctx->has_input("learning_rate", 0)) {
+    *learning_rate = *ctx->Tensor4ArgNameAndIndex("learning_rate", 0)->dptr<float>();
+  }
+  *scale = static_cast<T>(ctx->Attr<double>("scale"));
+  if (ctx->has_input("scale_by_tensor", 0)) {
+    const user_op::Tensor* scale_by_tensor = ctx->Tensor4ArgNameAndIndex("scale_by_tensor", 0);
+    CHECK_EQ(scale_by_tensor->shape().elem_cnt(), 1);
+    *scale *= *scale_by_tensor->dptr<T>();
+  }
+  return true;
+}
+
+}  // namespace
+
+template<typename T, typename G>
+class MultiTensorSGDUpdateCpuKernel final : public user_op::OpKernel {
+ public:
+  MultiTensorSGDUpdateCpuKernel() = default;
+  ~MultiTensorSGDUpdateCpuKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    float learning_rate = 0;
+    T scale = 0;
+    if (!ResolveCommonHyperParams<T>(ctx, &learning_rate, &scale)) { return; }
+    const float l1 = ctx->Attr<float>("l1");
+    const float l2 = ctx->Attr<float>("l2");
+    const float weight_decay = ctx->Attr<float>("weight_decay");
+    const std::vector<T*> models = MutPtrs<T>(ctx, "model");
+    const std::vector<const G*> model_diffs = Ptrs<G>(ctx, "model_diff");
+    MultiTensorForEachRange(ModelElemCnts(ctx), [&](int64_t i, int64_t begin, int64_t end) {
+      T* model = models.at(i);
+      const G* model_diff = model_diffs.at(i);
+      for (int64_t j = begin; j < end; ++j) {
+        SGDUpdateFunctor<T, G>()(model_diff + j, model + j, scale, l1, l2, weight_decay,
+                                 learning_rate);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return true; }
+};
+
+#define REGISTER_MULTI_TENSOR_SGD_UPDATE_CPU_KERNEL(dtype, gtype)                         \
+  REGISTER_USER_KERNEL("multi_tensor_sgd_update")                                         \
+      .SetCreateFn<MultiTensorSGDUpdateCpuKernel<dtype, gtype>>()                         \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                     \
+                       && (user_op::HobDataType("model", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobDataType("model_diff", 0) == GetDataType<gtype>::value));
+
+REGISTER_MULTI_TENSOR_SGD_UPDATE_CPU_KERNEL(float, float);
+REGISTER_MULTI_TENSOR_SGD_UPDATE_CPU_KERNEL(double, double);
+
+template<typename T, typename G>
+class MultiTensorMomentumUpdateCpuKernel final : public user_op::OpKernel {
+ public:
+  MultiTensorMomentumUpdateCpuKernel() = default;
+  ~MultiTensorMomentumUpdateCpuKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    float learning_rate = 0;
+    T scale = 0;
+    if (!ResolveCommonHyperParams<T>(ctx, &learning_rate, &scale)) { return; }
+    const float l1 = ctx->Attr<float>("l1");
+    const float l2 = ctx->Attr<float>("l2");
+    const float beta = ctx->Attr<float>("beta");
+    const float weight_decay = ctx->Attr<float>("weight_decay");
+    const std::vector<T*> models = MutPtrs<T>(ctx, "model");
+    const std::vector<T*> momentums = MutPtrs<T>(ctx, "momentum");
+    const std::vector<const G*> model_diffs = Ptrs<G>(ctx, "model_diff");
+    MultiTensorForEachRange(ModelElemCnts(ctx), [&](int64_t i, int64_t begin, int64_t end) {
+      T* model = models.at(i);
+      T* momentum = momentums.at(i);
+      const G* model_diff = model_diffs.at(i);
+      for (int64_t j = begin; j < end; ++j) {
+        MomentumUpdateFunctor<T, G>()(model_diff + j, model + j, momentum + j, scale, l1, l2, beta,
+                                      weight_decay, learning_rate);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return true; }
+};
+
+#define REGISTER_MULTI_TENSOR_MOMENTUM_UPDATE_CPU_KERNEL(dtype, gtype)                    \
+  REGISTER_USER_KERNEL("multi_tensor_momentum_update")                                    \
+      .SetCreateFn<MultiTensorMomentumUpdateCpuKernel<dtype, gtype>>()                    \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                     \
+                       && (user_op::HobDataType("model", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobDataType("model_diff", 0) == GetDataType<gtype>::value));
+
+REGISTER_MULTI_TENSOR_MOMENTUM_UPDATE_CPU_KERNEL(float, float);
+REGISTER_MULTI_TENSOR_MOMENTUM_UPDATE_CPU_KERNEL(double, double);
+
+template<typename T, typename G>
+class MultiTensorAdamUpdateCpuKernel final : public user_op::OpKernel {
+ public:
+  MultiTensorAdamUpdateCpuKernel() = default;
+  ~MultiTensorAdamUpdateCpuKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    float learning_rate = 0;
+    T scale = 0;
+    if (!ResolveCommonHyperParams<T>(ctx, &learning_rate, &scale)) { return; }
+    const float l1 = ctx->Attr<float>("l1");
+    const float l2 = ctx->Attr<float>("l2");
+    const float beta1 = ctx->Attr<float>("beta1");
+    const float beta2 = ctx->Attr<float>("beta2");
+    const float epsilon = ctx->Attr<float>("epsilon");
+    const float weight_decay = ctx->Attr<float>("weight_decay");
+    float bias_correction1 = ctx->Attr<float>("bias_correction1_val");
+    if (ctx->has_input("bias_correction1", 0)) {
+      bias_correction1 = *ctx->Tensor4ArgNameAndIndex("bias_correction1", 0)->dptr<float>();
+    }
+    float bias_correction2 = ctx->Attr<float>("bias_correction2_val");
+    if (ctx->has_input("bias_correction2", 0)) {
+      bias_correction2 = *ctx->Tensor4ArgNameAndIndex("bias_correction2", 0)->dptr<float>();
+    }
+    const std::vector<T*> models = MutPtrs<T>(ctx, "model");
+    const std::vector<T*> ms = MutPtrs<T>(ctx, "m");
+    const std::vector<T*> vs = MutPtrs<T>(ctx, "v");
+    const std::vector<const G*> model_diffs = Ptrs<G>(ctx, "model_diff");
+    MultiTensorForEachRange(ModelElemCnts(ctx), [&](int64_t i, int64_t begin, int64_t end) {
+      T* model = models.at(i);
+      T* m = ms.at(i);
+      T* v = vs.at(i);
+      const G* model_diff = model_diffs.at(i);
+      for (int64_t j = begin; j < end; ++j) {
+        AdamUpdateFunctor<T, G>()(model_diff + j, model + j, m + j, v + j, nullptr, scale, l1, l2,
+                                  beta1, beta2, epsilon, weight_decay, false, bias_correction1,
+                                  bias_correction2, learning_rate);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return true; }
+};
+
+#define REGISTER_MULTI_TENSOR_ADAM_UPDATE_CPU_KERNEL(dtype, gtype)                        \
+  REGISTER_USER_KERNEL("multi_tensor_adam_update")                                        \
+      .SetCreateFn<MultiTensorAdamUpdateCpuKernel<dtype, gtype>>()                        \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                     \
+                       && (user_op::HobDataType("model", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobDataType("model_diff", 0) == GetDataType<gtype>::value));
+
+REGISTER_MULTI_TENSOR_ADAM_UPDATE_CPU_KERNEL(float, float);
+REGISTER_MULTI_TENSOR_ADAM_UPDATE_CPU_KERNEL(double, double);
+
+}  // namespace oneflow
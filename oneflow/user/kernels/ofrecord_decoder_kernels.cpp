@@ -20,8 +20,10 @@ limitations under the License.
 #include "oneflow/core/kernel/new_kernel_util.h"
 #include "oneflow/core/kernel/kernel_util.h"
 #include "oneflow/core/thread/thread_manager.h"
+#include "oneflow/user/data/ofrecord_view.h"
 #include "oneflow/user/image/random_crop_generator.h"
 #include "oneflow/user/image/image_util.h"
+#include "oneflow/user/image/jpeg_decoder.h"
 #include "oneflow/user/kernels/random_crop_kernel_state.h"
 #include "oneflow/user/kernels/op_kernel_state_wrapper.h"
 #include "oneflow/user/kernels/random_seed_util.h"
@@ -73,6 +75,58 @@ void DecodeOneRawOFRecord(const Feature& feature, T* dptr, int64_t sample_elem_c
   }
 }
 
+template<typename T>
+void DecodeOneRawOFRecord(const data::OFRecordFeatureView& feature, T* dptr,
+                          int64_t sample_elem_cnt, bool truncate, bool dim1_varying_length) {
+  if (feature.has_bytes_list()) {
+    CHECK_EQ(feature.value_size(), 1);
+    const data::OFRecordBytes value0 = feature.bytes(0);
+    auto in_dptr = reinterpret_cast<const int8_t*>(value0.data);
+    sample_elem_cnt = std::min<int64_t>(sample_elem_cnt, value0.size);
+    std::transform(in_dptr, in_dptr + sample_elem_cnt, dptr,
+                   [](int8_t v) { return static_cast<T>(v); });
+  } else if (feature.kind() != data::OFRecordFeatureView::kNone) {
+    const int64_t value_size = feature.value_size();
+    const int64_t padding_elem_num = truncate ? sample_elem_cnt - value_size : 0;
+    if (truncate) {
+      sample_elem_cnt = std::min<int64_t>(sample_elem_cnt, value_size);
+    } else {
+      if (dim1_varying_length) {
+        sample_elem_cnt = value_size;
+      } else {
+        CHECK_EQ(sample_elem_cnt, value_size);
+      }
+    }
+    feature.CopyValues(dptr, sample_elem_cnt);
+    if (padding_elem_num > 0) {
+      std::memset(dptr + sample_elem_cnt, 0, padding_elem_num * sizeof(T));
+    }
+  } else {
+    UNIMPLEMENTED();
+  }
+}
+
+// The single bytes_list value of a feature. Serialized records are read through OFRecordView, so
+// the returned bytes point into the record buffer and nothing is deserialized.
+data::OFRecordBytes GetOnlyBytesValue(const OFRecord& record, const std::string& name) {
+  auto it = record.feature().find(name);
+  CHECK(it != record.feature().end()) << "Field " << name << " not found";
+  const Feature& feature = it->second;
+  CHECK(feature.has_bytes_list());
+  CHECK_EQ(feature.bytes_list().value_size(), 1);
+  const std::string& value = feature.bytes_list().value(0);
+  return data::OFRecordBytes{value.data(), value.size()};
+}
+
+data::OFRecordBytes GetOnlyBytesValue(const TensorBuffer& serialized_record,
+                                      const std::string& name) {
+  const data::OFRecordView record(serialized_record);
+  const data::OFRecordFeatureView feature = record.Get(name);
+  CHECK(feature.has_bytes_list());
+  CHECK_EQ(feature.value_size(), 1);
+  return feature.bytes(0);
+}
+
 }  // namespace
 
 template<typename T>
@@ -89,13 +143,23 @@ class OFRecordRawDecoderKernel final : public user_op::OpKernel {
     int64_t record_num = in_blob->shape().At(0);
     int64_t sample_elem_cnt = out_blob->shape().Count(1);
     CHECK(record_num > 0);
-    const OFRecord* records = in_blob->dptr<OFRecord>();
     T* out_dptr = out_blob->mut_dptr<T>();
     const std::string& name = ctx->Attr<std::string>("name");
 
     bool truncate = ctx->Attr<bool>("truncate");
     bool dim1_varying_length = ctx->Attr<bool>("dim1_varying_length");
 
+    if (in_blob->data_type() == DataType::kTensorBuffer) {
+      const TensorBuffer* serialized_records = in_blob->dptr<TensorBuffer>();
+      MultiThreadLoop(record_num, [&](size_t i) {
+        const data::OFRecordView record(serialized_records[i]);
+        T* dptr = out_dptr + i * sample_elem_cnt;
+        DecodeOneRawOFRecord(record.Get(name), dptr, sample_elem_cnt, truncate,
+                             dim1_varying_length);
+      });
+      return;
+    }
+    const OFRecord* records = in_blob->dptr<OFRecord>();
     MultiThreadLoop(record_num, [&](size_t i) {
       const OFRecord& record = *(records + i);
       T* dptr = out_dptr + i * sample_elem_cnt;
@@ -108,11 +172,12 @@ class OFRecordRawDecoderKernel final : public user_op::OpKernel {
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
 
-#define REGISTER_RAW_DECODER_KERNEL(dtype)                                       \
-  REGISTER_USER_KERNEL("ofrecord_raw_decoder")                                   \
-      .SetCreateFn<OFRecordRawDecoderKernel<dtype>>()                            \
-      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)            \
-                       && (user_op::HobDataType("in", 0) == DataType::kOFRecord) \
+#define REGISTER_RAW_DECODER_KERNEL(dtype)                                                \
+  REGISTER_USER_KERNEL("ofrecord_raw_decoder")                                            \
+      .SetCreateFn<OFRecordRawDecoderKernel<dtype>>()                                     \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                     \
+                       && ((user_op::HobDataType("in", 0) == DataType::kOFRecord)         \
+                           || (user_op::HobDataType("in", 0) == DataType::kTensorBuffer)) \
                        && (user_op::HobDataType("out", 0) == GetDataType<dtype>::value));
 
 REGISTER_RAW_DECODER_KERNEL(char)
@@ -123,6 +188,21 @@ REGISTER_RAW_DECODER_KERNEL(int32_t)
 REGISTER_RAW_DECODER_KERNEL(int64_t)
 REGISTER_RAW_DECODER_KERNEL(uint8_t)
 
+namespace {
+
+template<typename RecordT>
+void DecodeBytes(const RecordT* records, int64_t num_instances, const std::string& name,
+                 TensorBuffer* buffers) {
+  MultiThreadLoop(num_instances, [&](size_t i) {
+    const data::OFRecordBytes value = GetOnlyBytesValue(records[i], name);
+    TensorBuffer* buffer = buffers + i;
+    buffer->Resize(Shape({static_cast<int64_t>(value.size)}), DataType::kUInt8);
+    memcpy(buffer->mut_data(), value.data, value.size);
+  });
+}
+
+}  // namespace
+
 class OFRecordBytesDecoderKernel final : public user_op::OpKernel {
  public:
   OFRecordBytesDecoderKernel() = default;
@@ -133,24 +213,16 @@ class OFRecordBytesDecoderKernel final : public user_op::OpKernel {
     const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
     user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
     CHECK_EQ(out->shape(), in->shape());
-    CHECK_EQ(in->data_type(), DataType::kOFRecord);
     CHECK_EQ(out->data_type(), DataType::kTensorBuffer);
     const int64_t num_instances = in->shape().elem_cnt();
-    const auto* records = in->dptr<OFRecord>();
     auto* buffers = out->mut_dptr<TensorBuffer>();
     const std::string& name = ctx->Attr<std::string>("name");
-    MultiThreadLoop(num_instances, [&](size_t i) {
-      const OFRecord& record = *(records + i);
-      TensorBuffer* buffer = buffers + i;
-      auto it = record.feature().find(name);
-      CHECK(it != record.feature().end()) << "Field " << name << " not found";
-      const Feature& feature = it->second;
-      CHECK(feature.has_bytes_list());
-      CHECK_EQ(feature.bytes_list().value_size(), 1);
-      const int64_t size = feature.bytes_list().value(0).size();
-      buffer->Resize(Shape({size}), DataType::kUInt8);
-      memcpy(buffer->mut_data(), feature.bytes_list().value(0).data(), size);
-    });
+    if (in->data_type() == DataType::kTensorBuffer) {
+      DecodeBytes(in->dptr<TensorBuffer>(), num_instances, name, buffers);
+    } else {
+      CHECK_EQ(in->data_type(), DataType::kOFRecord);
+      DecodeBytes(in->dptr<OFRecord>(), num_instances, name, buffers);
+    }
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
@@ -158,32 +230,41 @@ class OFRecordBytesDecoderKernel final : public user_op::OpKernel {
 REGISTER_USER_KERNEL("ofrecord_bytes_decoder")
     .SetCreateFn<OFRecordBytesDecoderKernel>()
     .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)
-                     && (user_op::HobDataType("in", 0) == DataType::kOFRecord)
+                     && ((user_op::HobDataType("in", 0) == DataType::kOFRecord)
+                         || (user_op::HobDataType("in", 0) == DataType::kTensorBuffer))
                      && (user_op::HobDataType("out", 0) == DataType::kTensorBuffer));
 
 namespace {
 
-void DecodeRandomCropImageFromOneRecord(const OFRecord& record, TensorBuffer* buffer,
+template<typename RecordT>
+void DecodeRandomCropImageFromOneRecord(const RecordT& record, TensorBuffer* buffer,
                                         const std::string& name, const std::string& color_space,
                                         RandomCropGenerator* random_crop_gen) {
-  CHECK(record.feature().find(name) != record.feature().end()) << "Field " << name << " not found";
-  const Feature& feature = record.feature().at(name);
-  CHECK(feature.has_bytes_list());
-  CHECK(feature.bytes_list().value_size() == 1);
-  const std::string& src_data = feature.bytes_list().value(0);
+  const data::OFRecordBytes src_data = GetOnlyBytesValue(record, name);
+  const auto* jpeg_data = reinterpret_cast<const unsigned char*>(src_data.data);
+  static thread_local JpegDecoder jpeg_decoder;
+  int W = 0;
+  int H = 0;
+  const bool is_jpeg = jpeg_decoder.ReadHeader(jpeg_data, src_data.size, &W, &H);
 
   // cv::_InputArray image_data(src_data.data(), src_data.size());
   // cv::Mat image = cv::imdecode(image_data, cv::IMREAD_ANYCOLOR);
-  cv::Mat image =
-      cv::imdecode(cv::Mat(1, src_data.size(), CV_8UC1, (void*)(src_data.data())),  // NOLINT
-                   ImageUtil::IsColor(color_space) ? cv::IMREAD_COLOR : cv::IMREAD_GRAYSCALE);
-  int W = image.cols;
-  int H = image.rows;
+  const auto DecodeWithOpenCV = [&]() {
+    return cv::imdecode(
+        cv::Mat(1, src_data.size, CV_8UC1, (void*)(src_data.data)),  // NOLINT
+        ImageUtil::IsColor(color_space) ? cv::IMREAD_COLOR : cv::IMREAD_GRAYSCALE);
+  };
+  cv::Mat image;
+  if (!is_jpeg) {
+    image = DecodeWithOpenCV();
+    W = image.cols;
+    H = image.rows;
+  }
 
   // random crop
+  cv::Rect roi(0, 0, W, H);
   if (random_crop_gen != nullptr) {
-    CHECK(image.data != nullptr);
-    cv::Mat image_roi;
+    CHECK(is_jpeg || image.data != nullptr);
     CropWindow crop;
     random_crop_gen->GenerateCropWindow({H, W}, &crop);
     const int y = crop.anchor.At(0);
@@ -192,14 +273,31 @@ void DecodeRandomCropImageFromOneRecord(const OFRecord& record, TensorBuffer* bu
     const int newW = crop.shape.At(1);
     CHECK(newW > 0 && newW <= W);
     CHECK(newH > 0 && newH <= H);
-    cv::Rect roi(x, y, newW, newH);
+    roi = cv::Rect(x, y, newW, newH);
+  }
+
+  // JPEGs are decoded by libjpeg-turbo, only within the crop window and directly in color_space
+  JpegImage cropped{};
+  if (is_jpeg
+      && jpeg_decoder.DecodeCrop(roi.x, roi.y, roi.width, roi.height, 0, 0, color_space,
+                                 &cropped)) {
+    CHECK_EQ(cropped.width, roi.width);
+    CHECK_EQ(cropped.height, roi.height);
+    Shape image_shape({cropped.height, cropped.width, cropped.channels});
+    buffer->Resize(image_shape, DataType::kUInt8);
+    memcpy(buffer->mut_data<uint8_t>(), cropped.data, image_shape.elem_cnt());
+    return;
+  }
+  if (image.empty()) { image = DecodeWithOpenCV(); }
+  if (random_crop_gen != nullptr) {
+    cv::Mat image_roi;
     image(roi).copyTo(image_roi);
     image = image_roi;
-    W = image.cols;
-    H = image.rows;
-    CHECK(W == newW);
-    CHECK(H == newH);
+    CHECK(image.cols == roi.width);
+    CHECK(image.rows == roi.height);
   }
+  W = image.cols;
+  H = image.rows;
 
   // convert color space
   if (ImageUtil::IsColor(color_space) && color_space != "BGR") {
@@ -216,6 +314,30 @@ void DecodeRandomCropImageFromOneRecord(const OFRecord& record, TensorBuffer* bu
   memcpy(buffer->mut_data<uint8_t>(), image.ptr(), image_shape.elem_cnt());
 }
 
+template<typename RecordT>
+void DecodeRandomCropImages(const RecordT* records, int64_t record_num, TensorBuffer* buffers,
+                            const std::string& name, const std::string& color_space,
+                            RandomCropKernelState* crop_window_generators) {
+  MultiThreadLoop(record_num, [&](size_t i) {
+    RandomCropGenerator* gen =
+        crop_window_generators == nullptr ? nullptr : crop_window_generators->GetGenerator(i);
+    DecodeRandomCropImageFromOneRecord(records[i], buffers + i, name, color_space, gen);
+  });
+}
+
+void DecodeRandomCropImagesFromBlob(const user_op::Tensor* in_blob, int64_t record_num,
+                                    TensorBuffer* buffers, const std::string& name,
+                                    const std::string& color_space,
+                                    RandomCropKernelState* crop_window_generators) {
+  if (in_blob->data_type() == DataType::kTensorBuffer) {
+    DecodeRandomCropImages(in_blob->dptr<TensorBuffer>(), record_num, buffers, name, color_space,
+                           crop_window_generators);
+  } else {
+    DecodeRandomCropImages(in_blob->dptr<OFRecord>(), record_num, buffers, name, color_space,
+                           crop_window_generators);
+  }
+}
+
 }  // namespace
 
 class OFRecordImageDecoderRandomCropKernel final : public user_op::OpKernel {
@@ -237,17 +359,11 @@ class OFRecordImageDecoderRandomCropKernel final : public user_op::OpKernel {
     CHECK(record_num > 0);
     user_op::Tensor* in_blob = ctx->Tensor4ArgNameAndIndex("in", 0);
     CHECK_EQ(out_blob->shape(), in_blob->shape());
-    const OFRecord* records = in_blob->dptr<OFRecord>();
     TensorBuffer* buffers = out_blob->mut_dptr<TensorBuffer>();
     const std::string& name = ctx->Attr<std::string>("name");
     const std::string& color_space = ctx->Attr<std::string>("color_space");
-
-    MultiThreadLoop(record_num, [&](size_t i) {
-      const OFRecord& record = *(records + i);
-      TensorBuffer* buffer = buffers + i;
-      RandomCropGenerator* gen = crop_window_generators->GetGenerator(i);
-      DecodeRandomCropImageFromOneRecord(record, buffer, name, color_space, gen);
-    });
+    DecodeRandomCropImagesFromBlob(in_blob, record_num, buffers, name, color_space,
+                                   crop_window_generators);
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
@@ -255,7 +371,8 @@ class OFRecordImageDecoderRandomCropKernel final : public user_op::OpKernel {
 REGISTER_USER_KERNEL("ofrecord_image_decoder_random_crop")
     .SetCreateFn<OFRecordImageDecoderRandomCropKernel>()
     .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)
-                     && (user_op::HobDataType("in", 0) == DataType::kOFRecord)
+                     && ((user_op::HobDataType("in", 0) == DataType::kOFRecord)
+                         || (user_op::HobDataType("in", 0) == DataType::kTensorBuffer))
                      && (user_op::HobDataType("out", 0) == DataType::kTensorBuffer));
 
 class OFRecordImageDecoderKernel final : public user_op::OpKernel {
@@ -270,16 +387,10 @@ class OFRecordImageDecoderKernel final : public user_op::OpKernel {
     CHECK(record_num > 0);
     user_op::Tensor* in_blob = ctx->Tensor4ArgNameAndIndex("in", 0);
     CHECK_EQ(out_blob->shape(), in_blob->shape());
-    const OFRecord* records = in_blob->dptr<OFRecord>();
     TensorBuffer* buffers = out_blob->mut_dptr<TensorBuffer>();
     const std::string& name = ctx->Attr<std::string>("name");
     const std::string& color_space = ctx->Attr<std::string>("color_space");
-
-    MultiThreadLoop(record_num, [&](size_t i) {
-      const OFRecord& record = *(records + i);
-      TensorBuffer* buffer = buffers + i;
-      DecodeRandomCropImageFromOneRecord(record, buffer, name, color_space, nullptr);
-    });
+    DecodeRandomCropImagesFromBlob(in_blob, record_num, buffers, name, color_space, nullptr);
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
@@ -287,7 +398,8 @@ class OFRecordImageDecoderKernel final : public user_op::OpKernel {
 REGISTER_USER_KERNEL("ofrecord_image_decoder")
     .SetCreateFn<OFRecordImageDecoderKernel>()
     .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)
-                     && (user_op::HobDataType("in", 0) == DataType::kOFRecord)
+                     && ((user_op::HobDataType("in", 0) == DataType::kOFRecord)
+                         || (user_op::HobDataType("in", 0) == DataType::kTensorBuffer))
                      && (user_op::HobDataType("out", 0) == DataType::kTensorBuffer));
 
 }  // namespace oneflow
@@ -0,0 +1,220 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/thread/thread_manager.h"
+#include "oneflow/user/kernels/int8_gemm_util.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr int64_t kRowBlock = 16;
+constexpr int64_t kColBlock = 64;
+
+int64_t CeilDiv(int64_t x, int64_t y) { return (x + y - 1) / y; }
+
+// c = a * b^T on (kRowBlock, kColBlock) tiles in parallel
+void ParallelInt8GemmNT(int64_t m, int64_t n, int64_t k, const int8_t* a, const int8_t* b,
+                        int32_t* c) {
+  const int64_t row_block_num = CeilDiv(m, kRowBlock);
+  const int64_t col_block_num = CeilDiv(n, kColBlock);
+  MultiThreadLoop(row_block_num * col_block_num, [&](size_t block) {
+    const int64_t row = (block / col_block_num) * kRowBlock;
+    const int64_t col = (block % col_block_num) * kColBlock;
+    Int8GemmNT(std::min(kRowBlock, m - row), std::min(kColBlock, n - col), k, a + row * k, k,
+               b + col * k, k, c + row * n + col, n);
+  });
+}
+
+// dst(cols, rows) = src(rows, cols)^T
+void TransposeInt8(int64_t rows, int64_t cols, const int8_t* src, int8_t* dst) {
+  FOR_RANGE(int64_t, i, 0, rows) {
+    FOR_RANGE(int64_t, j, 0, cols) { dst[j * rows + i] = src[i * cols + j]; }
+  }
+}
+
+size_t AlignedSize(size_t size) { return GetCudaAlignedSize(size); }
+
+}  // namespace
+
+class QuantizedMatmulCpuKernel final : public user_op::OpKernel {
+ public:
+  QuantizedMatmulCpuKernel() = default;
+  ~QuantizedMatmulCpuKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* a = ctx->Tensor4ArgNameAndIndex("a", 0);
+    const user_op::Tensor* b = ctx->Tensor4ArgNameAndIndex("b", 0);
+    const user_op::Tensor* a_scale = ctx->Tensor4ArgNameAndIndex("a_scale", 0);
+    const user_op::Tensor* b_scale = ctx->Tensor4ArgNameAndIndex("b_scale", 0);
+    const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const bool transpose_a = ctx->Attr<bool>("transpose_a");
+    const bool transpose_b = ctx->Attr<bool>("transpose_b");
+    const int64_t m = out->shape().At(0);
+    const int64_t n = out->shape().At(1);
+    const int64_t k = transpose_a ? a->shape().At(0) : a->shape().At(1);
+
+    // Both operands are made k-contiguous for the dot products.
+    char* buf_ptr = tmp_buffer->mut_dptr<char>();
+    int32_t* acc = reinterpret_cast<int32_t*>(buf_ptr);
+    buf_ptr += AlignedSize(m * n * sizeof(int32_t));
+    const int8_t* a_ptr = a->dptr<int8_t>();
+    if (transpose_a) {
+      int8_t* packed_a = reinterpret_cast<int8_t*>(buf_ptr);
+      TransposeInt8(k, m, a_ptr, packed_a);
+      a_ptr = packed_a;
+      buf_ptr += AlignedSize(m * k);
+    }
+    const int8_t* b_ptr = b->dptr<int8_t>();
+    if (!transpose_b) {
+      int8_t* packed_b = reinterpret_cast<int8_t*>(buf_ptr);
+      TransposeInt8(k, n, b_ptr, packed_b);
+      b_ptr = packed_b;
+    }
+    ParallelInt8GemmNT(m, n, k, a_ptr, b_ptr, acc);
+
+    const float a_scale_val = *a_scale->dptr<float>();
+    const float* b_scale_ptr = b_scale->dptr<float>();
+    const bool per_channel = b_scale->shape().elem_cnt() > 1;
+    const float* bias_ptr = bias == nullptr ? nullptr : bias->dptr<float>();
+    float* out_ptr = out->mut_dptr<float>();
+    FOR_RANGE(int64_t, i, 0, m) {
+      FOR_RANGE(int64_t, j, 0, n) {
+        const float scale = a_scale_val * b_scale_ptr[per_channel ? j : 0];
+        const float bias_val = bias_ptr == nullptr ? 0.f : bias_ptr[j];
+        out_ptr[i * n + j] = static_cast<float>(acc[i * n + j]) * scale + bias_val;
+      }
+    }
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+REGISTER_USER_KERNEL("quantized_matmul")
+    .SetCreateFn<QuantizedMatmulCpuKernel>()
+    .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)
+                     && (user_op::HobDataType("out", 0) == DataType::kFloat))
+    .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {
+      const Shape& a_shape = ctx->InputShape("a", 0);
+      const Shape& out_shape = *ctx->OutputShape("out", 0);
+      const int64_t m = out_shape.At(0);
+      const int64_t n = out_shape.At(1);
+      const int64_t k = ctx->Attr<bool>("transpose_a") ? a_shape.At(0) : a_shape.At(1);
+      size_t tmp_buffer_size = AlignedSize(m * n * sizeof(int32_t));
+      if (ctx->Attr<bool>("transpose_a")) { tmp_buffer_size += AlignedSize(m * k); }
+      if (!ctx->Attr<bool>("transpose_b")) { tmp_buffer_size += AlignedSize(n * k); }
+      return tmp_buffer_size;
+    });
+
+class QuantizedConv2dCpuKernel final : public user_op::OpKernel {
+ public:
+  QuantizedConv2dCpuKernel() = default;
+  ~QuantizedConv2dCpuKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
+    const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
+    const user_op::Tensor* in_scale = ctx->Tensor4ArgNameAndIndex("in_scale", 0);
+    const user_op::Tensor* weight_scale = ctx->Tensor4ArgNameAndIndex("weight_scale", 0);
+    const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const auto& padding_before = ctx->Attr<std::vector<int32_t>>("padding_before");
+    const auto& strides = ctx->Attr<std::vector<int32_t>>("strides");
+    const auto& dilation_rate = ctx->Attr<std::vector<int32_t>>("dilation_rate");
+    const int32_t groups = ctx->Attr<int32_t>("groups");
+
+    const int64_t batch = in->shape().At(0);
+    const int64_t in_channels = in->shape().At(1);
+    const int64_t in_h = in->shape().At(2);
+    const int64_t in_w = in->shape().At(3);
+    const int64_t out_channels = out->shape().At(1);
+    const int64_t out_h = out->shape().At(2);
+    const int64_t out_w = out->shape().At(3);
+    const int64_t kernel_h = weight->shape().At(2);
+    const int64_t kernel_w = weight->shape().At(3);
+    const int64_t group_in_channels = in_channels / groups;
+    const int64_t group_out_channels = out_channels / groups;
+    const int64_t out_spatial = out_h * out_w;
+    const int64_t col_size = group_in_channels * kernel_h * kernel_w;
+
+    // (out_spatial, col_size) patches, one row per output position, then int32 accumulators
+    int8_t* rows = tmp_buffer->mut_dptr<int8_t>();
+    int32_t* acc = reinterpret_cast<int32_t*>(rows + AlignedSize(out_spatial * col_size));
+
+    const float in_scale_val = *in_scale->dptr<float>();
+    const float* weight_scale_ptr = weight_scale->dptr<float>();
+    const bool per_channel = weight_scale->shape().elem_cnt() > 1;
+    const float* bias_ptr = bias == nullptr ? nullptr : bias->dptr<float>();
+    FOR_RANGE(int64_t, n, 0, batch) {
+      FOR_RANGE(int64_t, g, 0, groups) {
+        const int8_t* in_ptr =
+            in->dptr<int8_t>() + (n * in_channels + g * group_in_channels) * in_h * in_w;
+        MultiThreadLoop(out_spatial, [&](size_t pos) {
+          const int64_t oh = pos / out_w;
+          const int64_t ow = pos % out_w;
+          int8_t* row = rows + pos * col_size;
+          FOR_RANGE(int64_t, c, 0, group_in_channels) {
+            FOR_RANGE(int64_t, kh, 0, kernel_h) {
+              const int64_t ih =
+                  oh * strides.at(0) - padding_before.at(0) + kh * dilation_rate.at(0);
+              FOR_RANGE(int64_t, kw, 0, kernel_w) {
+                const int64_t iw =
+                    ow * strides.at(1) - padding_before.at(1) + kw * dilation_rate.at(1);
+                const bool inside = ih >= 0 && ih < in_h && iw >= 0 && iw < in_w;
+                *(row++) = inside ? in_ptr[(c * in_h + ih) * in_w + iw] : 0;
+              }
+            }
+          }
+        });
+        const int64_t oc_begin = g * group_out_channels;
+        ParallelInt8GemmNT(group_out_channels, out_spatial, col_size,
+                           weight->dptr<int8_t>() + oc_begin * col_size, rows, acc);
+        float* out_ptr = out->mut_dptr<float>() + (n * out_channels + oc_begin) * out_spatial;
+        FOR_RANGE(int64_t, oc, 0, group_out_channels) {
+          const float scale = in_scale_val * weight_scale_ptr[per_channel ? oc_begin + oc : 0];
+          const float bias_val = bias_ptr == nullptr ? 0.f : bias_ptr[oc_begin + oc];
+          FOR_RANGE(int64_t, p, 0, out_spatial) {
+            out_ptr[oc * out_spatial + p] =
+                static_cast<float>(acc[oc * out_spatial + p]) * scale + bias_val;
+          }
+        }
+      }
+    }
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+REGISTER_USER_KERNEL("quantized_conv2d")
+    .SetCreateFn<QuantizedConv2dCpuKernel>()
+    .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)
+                     && (user_op::HobDataType("out", 0) == DataType::kFloat))
+    .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {
+      const Shape& weight_shape = ctx->InputShape("weight", 0);
+      const Shape& out_shape = *ctx->OutputShape("out", 0);
+      const int64_t out_spatial = out_shape.At(2) * out_shape.At(3);
+      const int64_t col_size = weight_shape.Count(1);
+      const int64_t group_out_channels = out_shape.At(1) / ctx->Attr<int32_t>("groups");
+      return AlignedSize(out_spatial * col_size)
+             + AlignedSize(group_out_channels * out_spatial * sizeof(int32_t));
+    });
+
+}  // namespace oneflow
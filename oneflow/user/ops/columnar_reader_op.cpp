@@ -0,0 +1,79 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+
+namespace oneflow {
+
+namespace {
+
+Maybe<void> InferColumnarReaderOutShapes(user_op::InferContext* ctx, int64_t batch_size) {
+  const auto& columns = ctx->Attr<std::vector<std::string>>("columns");
+  const auto& shapes = ctx->Attr<std::vector<Shape>>("shapes");
+  CHECK_EQ_OR_RETURN(shapes.size(), columns.size());
+  CHECK_EQ_OR_RETURN(ctx->outputs().size(), columns.size());
+  FOR_RANGE(size_t, i, 0, columns.size()) {
+    DimVector dim_vec;
+    dim_vec.push_back(batch_size);
+    for (int64_t dim : shapes.at(i).dim_vec()) { dim_vec.push_back(dim); }
+    *ctx->OutputShape("out", i) = Shape(dim_vec);
+  }
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_NO_GRAD_CPU_ONLY_USER_OP("ColumnarReader")
+    .OutputWithMinimum("out", 1)
+    .Attr<std::vector<std::string>>("files")
+    .Attr<std::vector<std::string>>("columns")
+    .Attr<std::vector<Shape>>("shapes")
+    .Attr<std::vector<DataType>>("data_types")
+    .Attr<int32_t>("batch_size")
+    .Attr<bool>("shuffle_after_epoch", false)
+    .Attr<std::vector<std::string>>("nd_sbp")
+    .SetPhysicalTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      int64_t local_batch_size = ctx->Attr<int32_t>("batch_size");
+      const cfg::SbpParallel& sbp = ctx->SbpParallel4ArgNameAndIndex("out", 0);
+      int64_t parallel_num = ctx->parallel_ctx().parallel_num();
+      if (sbp.has_split_parallel() && parallel_num > 1) {
+        CHECK_EQ_OR_RETURN(local_batch_size % parallel_num, 0);
+        local_batch_size /= parallel_num;
+      }
+      return InferColumnarReaderOutShapes(ctx, local_batch_size);
+    })
+    .SetLogicalTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      return InferColumnarReaderOutShapes(ctx, ctx->Attr<int32_t>("batch_size"));
+    })
+    .SetGetSbpFn([](user_op::SbpContext* ctx) -> Maybe<void> {
+      ctx->NewBuilder().Split(ctx->outputs(), 0).Build();
+      return Maybe<void>::Ok();
+    })
+    .SetNdSbpInferFn([](user_op::InferNdSbpFnContext* ctx) -> Maybe<void> {
+      cfg::SbpParallel default_sbp;
+      default_sbp.mutable_split_parallel()->set_axis(0);
+      return user_op::InferNdSbp4SrcOp(ctx, default_sbp);
+    })
+    .SetDataTypeInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      const auto& data_types = ctx->Attr<std::vector<DataType>>("data_types");
+      CHECK_EQ_OR_RETURN(data_types.size(), ctx->outputs().size());
+      FOR_RANGE(size_t, i, 0, data_types.size()) {
+        CHECK_OR_RETURN(IsPODDataType(data_types.at(i)));
+        *ctx->OutputDType("out", i) = data_types.at(i);
+      }
+      return Maybe<void>::Ok();
+    });
+
+}  // namespace oneflow
@@ -0,0 +1,182 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+
+namespace oneflow {
+
+namespace {
+
+Maybe<void> CheckScalarInput(user_op::InferContext* ctx, const std::string& arg_name) {
+  if (ctx->has_input(arg_name, 0)) {
+    CHECK_EQ_OR_RETURN(ctx->InputShape(arg_name, 0), Shape({1}));
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> CheckScalarInputDataType(user_op::InferContext* ctx, const std::string& arg_name,
+                                     DataType data_type) {
+  if (ctx->has_input(arg_name, 0)) { CHECK_EQ_OR_RETURN(ctx->InputDType(arg_name, 0), data_type); }
+  return Maybe<void>::Ok();
+}
+
+// Every per-tensor input named in state_arg_names must have one entry per model.
+Maybe<void> InferMultiTensorUpdateTensorDesc(user_op::InferContext* ctx,
+                                             const std::vector<std::string>& state_arg_names) {
+  const int32_t num_models = ctx->input_size("model");
+  CHECK_EQ_OR_RETURN(ctx->input_size("model_diff"), num_models);
+  for (const auto& arg_name : state_arg_names) {
+    CHECK_EQ_OR_RETURN(ctx->input_size(arg_name), num_models) << arg_name;
+  }
+  FOR_RANGE(int32_t, i, 0, num_models) {
+    const Shape& model_shape = ctx->InputShape("model", i);
+    CHECK_EQ_OR_RETURN(ctx->InputShape("model_diff", i), model_shape);
+    for (const auto& arg_name : state_arg_names) {
+      CHECK_EQ_OR_RETURN(ctx->InputShape(arg_name, i), model_shape) << arg_name;
+    }
+  }
+  JUST(CheckScalarInput(ctx, "learning_rate"));
+  JUST(CheckScalarInput(ctx, "scale_by_tensor"));
+  JUST(CheckScalarInput(ctx, "skip_if"));
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> InferMultiTensorUpdateDataType(user_op::InferContext* ctx,
+                                           const std::vector<std::string>& state_arg_names) {
+  const DataType data_type = ctx->InputDType("model", 0);
+  FOR_RANGE(int32_t, i, 0, ctx->input_size("model")) {
+    CHECK_EQ_OR_RETURN(ctx->InputDType("model", i), data_type);
+    CHECK_EQ_OR_RETURN(ctx->InputDType("model_diff", i), ctx->InputDType("model_diff", 0));
+    for (const auto& arg_name : state_arg_names) {
+      CHECK_EQ_OR_RETURN(ctx->InputDType(arg_name, i), data_type) << arg_name;
+    }
+  }
+  JUST(CheckScalarInputDataType(ctx, "learning_rate", DataType::kFloat));
+  JUST(CheckScalarInputDataType(ctx, "scale_by_tensor", data_type));
+  return Maybe<void>::Ok();
+}
+
+// The grouped models have unrelated shapes, so the only signature shared by all of them is
+// broadcast; MultiTensorModelUpdatePass only groups models that are broadcast already.
+Maybe<void> GetMultiTensorUpdateSbp(user_op::SbpContext* ctx) {
+  ctx->NewBuilder().Broadcast(ctx->inputs()).Build();
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> SetInputArgModifierMutable(const user_op::GetInputArgModifier& GetInputArgModifierFn,
+                                       const user_op::UserOpConfWrapper& conf,
+                                       const std::string& arg_name) {
+  FOR_RANGE(int32_t, i, 0, conf.input_size(arg_name)) {
+    user_op::InputArgModifier* arg_modifier = GetInputArgModifierFn(arg_name, i);
+    CHECK_NOTNULL_OR_RETURN(arg_modifier);
+    arg_modifier->set_is_mutable(true);
+  }
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_NO_GRAD_USER_OP("multi_tensor_sgd_update")
+    .InputWithMinimum("model", 1)
+    .InputWithMinimum("model_diff", 1)
+    .OptionalInput("learning_rate")
+    .OptionalInput("scale_by_tensor")
+    .OptionalInput("skip_if")
+    .Attr<float>("learning_rate_val", 0.0)
+    .Attr<double>("scale", 1.0)
+    .Attr<float>("l1", 0.0)
+    .Attr<float>("l2", 0.0)
+    .Attr<float>("weight_decay", 0.0)
+    .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      return InferMultiTensorUpdateTensorDesc(ctx, {});
+    })
+    .SetGetSbpFn(GetMultiTensorUpdateSbp)
+    .SetInputArgModifyFn([](const user_op::GetInputArgModifier& GetInputArgModifierFn,
+                            const user_op::UserOpConfWrapper& conf) -> Maybe<void> {
+      return SetInputArgModifierMutable(GetInputArgModifierFn, conf, "model");
+    })
+    .SetDataTypeInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      return InferMultiTensorUpdateDataType(ctx, {});
+    });
+
+REGISTER_NO_GRAD_USER_OP("multi_tensor_momentum_update")
+    .InputWithMinimum("model", 1)
+    .InputWithMinimum("model_diff", 1)
+    .InputWithMinimum("momentum", 1)
+    .OptionalInput("learning_rate")
+    .OptionalInput("scale_by_tensor")
+    .OptionalInput("skip_if")
+    .Attr<float>("learning_rate_val", 0.0)
+    .Attr<double>("scale", 1.0)
+    .Attr<float>("l1", 0.0)
+    .Attr<float>("l2", 0.0)
+    .Attr<float>("beta", 0.9)
+    .Attr<float>("weight_decay", 0.0)
+    .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      return InferMultiTensorUpdateTensorDesc(ctx, {"momentum"});
+    })
+    .SetGetSbpFn(GetMultiTensorUpdateSbp)
+    .SetInputArgModifyFn([](const user_op::GetInputArgModifier& GetInputArgModifierFn,
+                            const user_op::UserOpConfWrapper& conf) -> Maybe<void> {
+      JUST(SetInputArgModifierMutable(GetInputArgModifierFn, conf, "model"));
+      JUST(SetInputArgModifierMutable(GetInputArgModifierFn, conf, "momentum"));
+      return Maybe<void>::Ok();
+    })
+    .SetDataTypeInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      return InferMultiTensorUpdateDataType(ctx, {"momentum"});
+    });
+
+// amsgrad is not supported, so there is no max_v list.
+REGISTER_NO_GRAD_USER_OP("multi_tensor_adam_update")
+    .InputWithMinimum("model", 1)
+    .InputWithMinimum("model_diff", 1)
+    .InputWithMinimum("m", 1)
+    .InputWithMinimum("v", 1)
+    .OptionalInput("learning_rate")
+    .OptionalInput("scale_by_tensor")
+    .OptionalInput("skip_if")
+    .OptionalInput("bias_correction1")
+    .OptionalInput("bias_correction2")
+    .Attr<float>("learning_rate_val", 0.0)
+    .Attr<float>("bias_correction1_val", 1.0)
+    .Attr<float>("bias_correction2_val", 1.0)
+    .Attr<double>("scale", 1.0)
+    .Attr<float>("l1", 0.0)
+    .Attr<float>("l2", 0.0)
+    .Attr<float>("beta1", 0.9)
+    .Attr<float>("beta2", 0.999)
+    .Attr<float>("epsilon", 1e-8)
+    .Attr<float>("weight_decay", 0.0)
+    .Attr<bool>("do_bias_correction", true)
+    .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      JUST(CheckScalarInput(ctx, "bias_correction1"));
+      JUST(CheckScalarInput(ctx, "bias_correction2"));
+      return InferMultiTensorUpdateTensorDesc(ctx, {"m", "v"});
+    })
+    .SetGetSbpFn(GetMultiTensorUpdateSbp)
+    .SetInputArgModifyFn([](const user_op::GetInputArgModifier& GetInputArgModifierFn,
+                            const user_op::UserOpConfWrapper& conf) -> Maybe<void> {
+      JUST(SetInputArgModifierMutable(GetInputArgModifierFn, conf, "model"));
+      JUST(SetInputArgModifierMutable(GetInputArgModifierFn, conf, "m"));
+      JUST(SetInputArgModifierMutable(GetInputArgModifierFn, conf, "v"));
+      return Maybe<void>::Ok();
+    })
+    .SetDataTypeInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      JUST(CheckScalarInputDataType(ctx, "bias_correction1", DataType::kFloat));
+      JUST(CheckScalarInputDataType(ctx, "bias_correction2", DataType::kFloat));
+      return InferMultiTensorUpdateDataType(ctx, {"m", "v"});
+    });
+
+}  // namespace oneflow
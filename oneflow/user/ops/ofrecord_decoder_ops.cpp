@@ -54,7 +54,8 @@ REGISTER_NO_GRAD_CPU_ONLY_USER_OP("ofrecord_raw_decoder")
     .SetDataTypeInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
       const user_op::TensorDesc& in_tensor = ctx->InputTensorDesc("in", 0);
       user_op::TensorDesc* out_tensor = ctx->OutputTensorDesc("out", 0);
-      CHECK_OR_RETURN(in_tensor.data_type() == DataType::kOFRecord);
+      CHECK_OR_RETURN(in_tensor.data_type() == DataType::kOFRecord
+                      || in_tensor.data_type() == DataType::kTensorBuffer);
       *out_tensor->mut_data_type() = ctx->Attr<DataType>("data_type");
       return Maybe<void>::Ok();
     });
@@ -81,7 +82,8 @@ REGISTER_NO_GRAD_CPU_ONLY_USER_OP("ofrecord_bytes_decoder")
     .SetDataTypeInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
       const user_op::TensorDesc& in = ctx->InputTensorDesc("in", 0);
       user_op::TensorDesc* out = ctx->OutputTensorDesc("out", 0);
-      CHECK_OR_RETURN(in.data_type() == DataType::kOFRecord);
+      CHECK_OR_RETURN(in.data_type() == DataType::kOFRecord
+                      || in.data_type() == DataType::kTensorBuffer);
       *out->mut_data_type() = DataType::kTensorBuffer;
       return Maybe<void>::Ok();
     });
@@ -115,7 +117,8 @@ REGISTER_NO_GRAD_CPU_ONLY_USER_OP("ofrecord_image_decoder")
     .SetDataTypeInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
       const user_op::TensorDesc& in_tensor = ctx->InputTensorDesc("in", 0);
       user_op::TensorDesc* out_tensor = ctx->OutputTensorDesc("out", 0);
-      CHECK_OR_RETURN(in_tensor.data_type() == DataType::kOFRecord);
+      CHECK_OR_RETURN(in_tensor.data_type() == DataType::kOFRecord
+                      || in_tensor.data_type() == DataType::kTensorBuffer);
       *out_tensor->mut_data_type() = DataType::kTensorBuffer;
       return Maybe<void>::Ok();
     });
@@ -154,7 +157,8 @@ REGISTER_NO_GRAD_CPU_ONLY_USER_OP("ofrecord_image_decoder_random_crop")
     .SetDataTypeInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
       const user_op::TensorDesc& in_tensor = ctx->InputTensorDesc("in", 0);
       user_op::TensorDesc* out_tensor = ctx->OutputTensorDesc("out", 0);
-      CHECK_OR_RETURN(in_tensor.data_type() == DataType::kOFRecord);
+      CHECK_OR_RETURN(in_tensor.data_type() == DataType::kOFRecord
+                      || in_tensor.data_type() == DataType::kTensorBuffer);
       *out_tensor->mut_data_type() = DataType::kTensorBuffer;
       return Maybe<void>::Ok();
     });
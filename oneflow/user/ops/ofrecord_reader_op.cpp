@@ -28,6 +28,9 @@ REGISTER_NO_GRAD_CPU_ONLY_USER_OP("OFRecordReader")
     .Attr<int64_t>("seed", -1)
     .Attr<int32_t>("shuffle_buffer_size", 1024)
     .Attr<bool>("shuffle_after_epoch", false)
+    .Attr<bool>("global_shuffle", false)
+    .Attr<bool>("lazy_parse", false)
+    .Attr<int32_t>("num_parallel_reads", 1)
     .Attr<std::vector<std::string>>("nd_sbp")
     .SetPhysicalTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
       user_op::TensorDesc* out_tensor = ctx->OutputTensorDesc("out", 0);
@@ -47,7 +50,8 @@ REGISTER_NO_GRAD_CPU_ONLY_USER_OP("OFRecordReader")
       return Maybe<void>::Ok();
     })
     .SetDataTypeInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
-      *ctx->OutputDType("out", 0) = DataType::kOFRecord;
+      *ctx->OutputDType("out", 0) =
+          ctx->Attr<bool>("lazy_parse") ? DataType::kTensorBuffer : DataType::kOFRecord;
       return Maybe<void>::Ok();
     })
     .SetGetSbpFn([](user_op::SbpContext* ctx) -> Maybe<void> {
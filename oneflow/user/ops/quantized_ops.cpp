@@ -0,0 +1,171 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/ops/nn_util.h"
+
+namespace oneflow {
+
+namespace {
+
+// NOTE: int8 ops lowered from quantization aware training graphs. The inputs are symmetrically
+// quantized int8 tensors with their float scales, the int32 accumulators are requantized to
+// float with `in_scale * weight_scale[c]`, where weight scale is per-layer or per output channel.
+Maybe<void> CheckScales(user_op::InferContext* ctx, const std::string& in_scale_name,
+                        const std::string& weight_scale_name, int64_t out_channels) {
+  CHECK_EQ_OR_RETURN(ctx->InputShape(in_scale_name, 0).elem_cnt(), 1);
+  const int64_t weight_scale_size = ctx->InputShape(weight_scale_name, 0).elem_cnt();
+  CHECK_OR_RETURN(weight_scale_size == 1 || weight_scale_size == out_channels)
+      << "weight scale should be per-layer or per output channel";
+  if (ctx->has_input("bias", 0)) {
+    CHECK_EQ_OR_RETURN(ctx->InputShape("bias", 0), Shape({out_channels}));
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> InferQuantizedDataType(user_op::InferContext* ctx, const std::string& in_name,
+                                   const std::string& weight_name, const std::string& scale_name) {
+  CHECK_EQ_OR_RETURN(ctx->InputDType(in_name, 0), DataType::kInt8);
+  CHECK_EQ_OR_RETURN(ctx->InputDType(weight_name, 0), DataType::kInt8);
+  const DataType scale_data_type = ctx->InputDType(scale_name, 0);
+  CHECK_EQ_OR_RETURN(scale_data_type, DataType::kFloat);
+  *ctx->OutputDType("out", 0) = scale_data_type;
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_USER_OP("quantized_matmul")
+    .Input("a")
+    .Input("b")
+    .Input("a_scale")
+    .Input("b_scale")
+    .OptionalInput("bias")
+    .Output("out")
+    .Attr<bool>("transpose_a", false)
+    .Attr<bool>("transpose_b", false)
+    .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      const Shape& a_shape = ctx->InputShape("a", 0);
+      const Shape& b_shape = ctx->InputShape("b", 0);
+      CHECK_EQ_OR_RETURN(a_shape.NumAxes(), 2);
+      CHECK_EQ_OR_RETURN(b_shape.NumAxes(), 2);
+      const bool transpose_a = ctx->Attr<bool>("transpose_a");
+      const bool transpose_b = ctx->Attr<bool>("transpose_b");
+      const int64_t m = transpose_a ? a_shape.At(1) : a_shape.At(0);
+      const int64_t k = transpose_a ? a_shape.At(0) : a_shape.At(1);
+      const int64_t n = transpose_b ? b_shape.At(0) : b_shape.At(1);
+      CHECK_EQ_OR_RETURN(k, transpose_b ? b_shape.At(1) : b_shape.At(0));
+      JUST(CheckScales(ctx, "a_scale", "b_scale", n));
+      *ctx->OutputShape("out", 0) = Shape({m, n});
+      *ctx->OutputIsDynamic("out", 0) = ctx->InputIsDynamic("a", 0);
+      return Maybe<void>::Ok();
+    })
+    .SetGetSbpFn([](user_op::SbpContext* ctx) -> Maybe<void> {
+      const bool transpose_a = ctx->Attr<bool>("transpose_a");
+      const bool transpose_b = ctx->Attr<bool>("transpose_b");
+      const bool per_channel =
+          ctx->LogicalTensorDesc4InputArgNameAndIndex("b_scale", 0).shape().elem_cnt() > 1;
+      const bool has_bias = ctx->user_op_conf().has_input("bias", 0);
+      {
+        auto builder = ctx->NewBuilder()
+                           .Split(user_op::OpArg("a", 0), transpose_a ? 1 : 0)
+                           .Broadcast(user_op::OpArg("b", 0))
+                           .Broadcast(user_op::OpArg("a_scale", 0))
+                           .Broadcast(user_op::OpArg("b_scale", 0))
+                           .Split(user_op::OpArg("out", 0), 0);
+        if (has_bias) { builder.Broadcast(user_op::OpArg("bias", 0)); }
+        builder.Build();
+      }
+      {
+        auto builder = ctx->NewBuilder()
+                           .Broadcast(user_op::OpArg("a", 0))
+                           .Split(user_op::OpArg("b", 0), transpose_b ? 0 : 1)
+                           .Broadcast(user_op::OpArg("a_scale", 0))
+                           .Split(user_op::OpArg("out", 0), 1);
+        if (per_channel) {
+          builder.Split(user_op::OpArg("b_scale", 0), 0);
+        } else {
+          builder.Broadcast(user_op::OpArg("b_scale", 0));
+        }
+        if (has_bias) { builder.Split(user_op::OpArg("bias", 0), 0); }
+        builder.Build();
+      }
+      return Maybe<void>::Ok();
+    })
+    .SetDataTypeInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      return InferQuantizedDataType(ctx, "a", "b", "a_scale");
+    });
+
+REGISTER_USER_OP("quantized_conv2d")
+    .Input("in")
+    .Input("weight")
+    .Input("in_scale")
+    .Input("weight_scale")
+    .OptionalInput("bias")
+    .Output("out")
+    .Attr<int32_t>("filters")
+    .Attr<std::vector<int32_t>>("padding_before")
+    .Attr<std::vector<int32_t>>("kernel_size")
+    .Attr<std::vector<int32_t>>("strides")
+    .Attr<std::vector<int32_t>>("dilation_rate")
+    .Attr<int32_t>("groups", 1)
+    .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      // NOTE: only channels_first layout, weight is (filters, in_channels / groups, kh, kw)
+      const Shape& in_shape = ctx->InputShape("in", 0);
+      const Shape& weight_shape = ctx->InputShape("weight", 0);
+      CHECK_EQ_OR_RETURN(in_shape.NumAxes(), 4);
+      const int32_t filters = ctx->Attr<int32_t>("filters");
+      const int32_t groups = ctx->Attr<int32_t>("groups");
+      const auto& padding_before = ctx->Attr<std::vector<int32_t>>("padding_before");
+      const auto& kernel_size = ctx->Attr<std::vector<int32_t>>("kernel_size");
+      const auto& strides = ctx->Attr<std::vector<int32_t>>("strides");
+      const auto& dilation_rate = ctx->Attr<std::vector<int32_t>>("dilation_rate");
+      CHECK_EQ_OR_RETURN(padding_before.size(), 2);
+      CHECK_EQ_OR_RETURN(kernel_size.size(), 2);
+      CHECK_EQ_OR_RETURN(strides.size(), 2);
+      CHECK_EQ_OR_RETURN(dilation_rate.size(), 2);
+      CHECK_GT_OR_RETURN(groups, 0);
+      CHECK_EQ_OR_RETURN(filters % groups, 0);
+      CHECK_EQ_OR_RETURN(in_shape.At(1) % groups, 0);
+      CHECK_EQ_OR_RETURN(weight_shape, Shape({filters, in_shape.At(1) / groups, kernel_size.at(0),
+                                              kernel_size.at(1)}));
+      DimVector out_dim_vec{in_shape.At(0), filters, 0, 0};
+      for (int32_t i = 0; i < 2; ++i) {
+        JUST(CalcConvOut(in_shape.At(2 + i), kernel_size.at(i), dilation_rate.at(i), strides.at(i),
+                         padding_before.at(i), &out_dim_vec.at(2 + i)));
+      }
+      JUST(CheckScales(ctx, "in_scale", "weight_scale", filters));
+      *ctx->OutputShape("out", 0) = Shape(out_dim_vec);
+      *ctx->OutputIsDynamic("out", 0) = ctx->InputIsDynamic("in", 0);
+      return Maybe<void>::Ok();
+    })
+    .SetGetSbpFn([](user_op::SbpContext* ctx) -> Maybe<void> {
+      auto builder = ctx->NewBuilder()
+                         .Split(user_op::OpArg("in", 0), 0)
+                         .Broadcast(user_op::OpArg("weight", 0))
+                         .Broadcast(user_op::OpArg("in_scale", 0))
+                         .Broadcast(user_op::OpArg("weight_scale", 0))
+                         .Split(user_op::OpArg("out", 0), 0);
+      if (ctx->user_op_conf().has_input("bias", 0)) {
+        builder.Broadcast(user_op::OpArg("bias", 0));
+      }
+      builder.Build();
+      return Maybe<void>::Ok();
+    })
+    .SetDataTypeInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      return InferQuantizedDataType(ctx, "in", "weight", "in_scale");
+    });
+
+}  // namespace oneflow
@@ -15,18 +15,36 @@ limitations under the License.
 */
 #include "oneflow/xrt/compilation_cache.h"
 
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "glog/logging.h"
+
 namespace oneflow {
 namespace xrt {
 
+namespace {
+
+constexpr char kPersistentMagic[] = "OFXRTEXE1";
+
+}  // namespace
+
 bool operator==(const Signature& lhs, const Signature& rhs) {
   return lhs.builder_name == rhs.builder_name && lhs.device_ordinal == rhs.device_ordinal
-         && lhs.entry_shapes == rhs.entry_shapes;
+         && lhs.entry_data_types == rhs.entry_data_types && lhs.entry_shapes == rhs.entry_shapes;
 }
 
 size_t SignatureHash::operator()(const Signature& signature) const {
   size_t hash_val =
       std::hash<std::string>()(signature.builder_name) ^ std::hash<int>()(signature.device_ordinal);
   for (const auto& shape : signature.entry_shapes) { hash_val ^= std::hash<Shape>()(shape); }
+  for (const auto& data_type : signature.entry_data_types) {
+    hash_val = hash_val * 31 + static_cast<size_t>(data_type);
+  }
   return hash_val;
 }
 
@@ -36,31 +54,152 @@ Signature ComputeSignature(const std::string& name, const int device_ordinal,
   signature.builder_name = name;
   signature.device_ordinal = device_ordinal;
   signature.entry_shapes.resize(entry_params.size());
+  signature.entry_data_types.resize(entry_params.size());
   for (int i = 0; i < entry_params.size(); ++i) {
     signature.entry_shapes[i] = entry_params[i].shape();
+    signature.entry_data_types[i] = entry_params[i].data_type();
   }
   return signature;
 }
 
-Executable* CompilationCache::GetRecord(const Signature& signature) const {
+std::string SignatureToString(const Signature& signature) {
+  std::ostringstream stream;
+  stream << signature.builder_name << ";device:" << signature.device_ordinal;
+  for (int i = 0; i < signature.entry_shapes.size(); ++i) {
+    stream << ";" << signature.entry_shapes[i].ToString();
+    if (i < signature.entry_data_types.size()) { stream << ":" << signature.entry_data_types[i]; }
+  }
+  return stream.str();
+}
+
+int64_t BucketDim(int64_t dim, const std::vector<int64_t>& buckets) {
+  const auto& it = std::lower_bound(buckets.begin(), buckets.end(), dim);
+  return it == buckets.end() ? dim : *it;
+}
+
+std::vector<int64_t> ParseShapeBuckets(const std::string& buckets) {
+  std::vector<int64_t> result;
+  std::istringstream stream(buckets);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (item.empty()) { continue; }
+    int64_t bucket = std::stoll(item);
+    CHECK_GT(bucket, 0) << "Shape bucket should be positive, but got " << item;
+    result.push_back(bucket);
+  }
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+  return result;
+}
+
+Executable* CompilationCache::GetRecord(const Signature& signature) {
   Executable* record = nullptr;
   // std::shared_lock<std::shared_mutex> lock(mutex_);
   std::lock_guard<std::mutex> lock(mutex_);
   const auto& it = records_.find(signature);
-  if (it != records_.end()) { record = it->second.get(); }
+  if (it != records_.end()) {
+    // Move the record to the front as the most recently used one.
+    lru_records_.splice(lru_records_.begin(), lru_records_, it->second);
+    record = it->second->second.get();
+    ++metrics_.hits;
+  } else {
+    ++metrics_.misses;
+  }
   return record;
 }
 
 void CompilationCache::Record(const Signature& signature,
-                              const std::shared_ptr<Executable>& result) {
+                              const std::shared_ptr<Executable>& result,
+                              double compile_seconds /*= 0.0*/) {
   // std::unique_lock<std::shared_mutex> lock(mutex_);
   std::lock_guard<std::mutex> lock(mutex_);
-  records_.emplace(signature, result);
+  ++metrics_.compile_count;
+  metrics_.compile_seconds += compile_seconds;
+  const auto& it = records_.find(signature);
+  if (it != records_.end()) {
+    it->second->second = result;
+    lru_records_.splice(lru_records_.begin(), lru_records_, it->second);
+    return;
+  }
+  lru_records_.emplace_front(signature, result);
+  records_.emplace(signature, lru_records_.begin());
+  while (options_.capacity > 0 && static_cast<int64_t>(lru_records_.size()) > options_.capacity) {
+    VLOG(2) << "Evict executable " << SignatureToString(lru_records_.back().first);
+    records_.erase(lru_records_.back().first);
+    lru_records_.pop_back();
+    ++metrics_.evictions;
+  }
+}
+
+std::string CompilationCache::PersistentPath(const std::string& key) const {
+  std::ostringstream stream;
+  stream << options_.persistent_dir << "/" << std::hex << std::hash<std::string>()(key)
+         << ".xrt";
+  return stream.str();
+}
+
+bool CompilationCache::LoadPersistentRecord(const std::string& key, std::string* data) {
+  if (!persistent()) { return false; }
+  std::ifstream file(PersistentPath(key), std::ios::in | std::ios::binary);
+  if (!file.good()) { return false; }
+  std::string magic, stored_key;
+  if (!std::getline(file, magic) || magic != kPersistentMagic) { return false; }
+  // The file name is only a hash of the key, so the full key is stored and
+  // checked to get rid of hash collisions.
+  if (!std::getline(file, stored_key) || stored_key != key) { return false; }
+  std::ostringstream buffer;
+  buffer << file.rdbuf();
+  *data = buffer.str();
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++metrics_.persistent_hits;
+  persisted_keys_.insert(key);
+  return true;
+}
+
+void CompilationCache::PersistRecord(const std::string& key, const Executable& executable) {
+  if (!persistent()) { return; }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!persisted_keys_.insert(key).second) { return; }
+  }
+  std::string data;
+  if (!executable.Serialize(&data)) {
+    VLOG(2) << "Executable " << executable.name() << " can not be serialized.";
+    return;
+  }
+  mkdir(options_.persistent_dir.c_str(), 0755);
+  const std::string path = PersistentPath(key);
+  // Write into a temporary file and rename it, so that other processes sharing
+  // the directory never see a partially written record.
+  const std::string tmp_path = path + ".tmp." + std::to_string(getpid());
+  {
+    std::ofstream file(tmp_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.good()) {
+      LOG(WARNING) << "Could not write the compilation cache file " << tmp_path;
+      return;
+    }
+    file << kPersistentMagic << "\n" << key << "\n";
+    file.write(data.data(), data.size());
+  }
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    LOG(WARNING) << "Could not rename the compilation cache file to " << path;
+    std::remove(tmp_path.c_str());
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++metrics_.persistent_writes;
+}
+
+CompilationCacheMetrics CompilationCache::metrics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return metrics_;
 }
 
 void CompilationCache::Release() {
-  util::Map<Signature, std::shared_ptr<Executable>, SignatureHash> empty_records;
+  std::lock_guard<std::mutex> lock(mutex_);
+  util::Map<Signature, RecordList::iterator, SignatureHash> empty_records;
   records_.swap(empty_records);
+  lru_records_.clear();
 }
 
 }  // namespace xrt
@@ -21,7 +21,7 @@ limitations under the License.
 #include <string>
 #include <vector>
 
-//#include "oneflow/core/common/data_type.pb.h"
+#include "oneflow/core/common/data_type.pb.h"
 #include "oneflow/core/common/shape.h"
 #include "oneflow/xrt/executable.h"
 #include "oneflow/xrt/parameter.h"
@@ -35,7 +35,7 @@ struct Signature {
   std::string builder_name;
   // Device ordinal
   int device_ordinal;
-  // std::vector<Shape> entry_data_types;
+  std::vector<DataType> entry_data_types;
   // It will lose efficacy if the entry shapes has been changed.
   std::vector<Shape> entry_shapes;
 };
@@ -49,18 +49,75 @@ struct SignatureHash {
 Signature ComputeSignature(const std::string& name, const int device_ordinal,
                            const std::vector<xrt::Parameter>& entry_params);
 
+// Returns a printable description of the signature, which is used to identify
+// the persistent records together with the fingerprint of the compiled graph.
+std::string SignatureToString(const Signature& signature);
+
+// Returns the smallest bucket which is not less than `dim`, or `dim` itself if
+// all the buckets are less than it. `buckets` should be sorted ascending.
+int64_t BucketDim(int64_t dim, const std::vector<int64_t>& buckets);
+
+// Parses comma separated bucket sizes such as "1,2,4,8", and the result is
+// sorted ascending with duplicates removed.
+std::vector<int64_t> ParseShapeBuckets(const std::string& buckets);
+
+struct CompilationCacheOptions {
+  // Maximum number of executables kept in memory, and the least recently used
+  // one will be evicted if it is exceeded. Non-positive means unlimited.
+  int64_t capacity = 0;
+  // Directory to persist the serialized executables. Empty means disabled.
+  std::string persistent_dir = "";
+};
+
+struct CompilationCacheMetrics {
+  int64_t hits = 0;
+  int64_t misses = 0;
+  int64_t evictions = 0;
+  int64_t persistent_hits = 0;
+  int64_t persistent_writes = 0;
+  int64_t compile_count = 0;
+  double compile_seconds = 0.0;
+};
+
 class CompilationCache {
  public:
-  Executable* GetRecord(const Signature& signature) const;
+  CompilationCache() = default;
+  explicit CompilationCache(const CompilationCacheOptions& options) : options_(options) {}
 
-  void Record(const Signature& signature, const std::shared_ptr<Executable>& result);
+  // The returned executable keeps valid until the next `Record` since it may be
+  // evicted by the new record.
+  Executable* GetRecord(const Signature& signature);
+
+  void Record(const Signature& signature, const std::shared_ptr<Executable>& result,
+              double compile_seconds = 0.0);
+
+  bool persistent() const { return !options_.persistent_dir.empty(); }
+
+  // Loads the serialized executable identified by `key` from the persistent
+  // directory. Returns false if it does not exist or does not match the key.
+  bool LoadPersistentRecord(const std::string& key, std::string* data);
+
+  // Serializes and writes the executable into the persistent directory only once
+  // for each key. Executables which can not be serialized are skipped.
+  void PersistRecord(const std::string& key, const Executable& executable);
+
+  CompilationCacheMetrics metrics() const;
 
   void Release();
 
  private:
+  using RecordList = util::List<std::pair<Signature, std::shared_ptr<Executable>>>;
+
+  std::string PersistentPath(const std::string& key) const;
+
+  CompilationCacheOptions options_;
+  CompilationCacheMetrics metrics_;
   // static std::shared_mutex mutex_;
   mutable std::mutex mutex_;
-  util::Map<Signature, std::shared_ptr<Executable>, SignatureHash> records_;
+  // Records are ordered from the most recently used to the least recently used.
+  RecordList lru_records_;
+  util::Map<Signature, RecordList::iterator, SignatureHash> records_;
+  util::Set<std::string> persisted_keys_;
 };
 
 }  // namespace xrt
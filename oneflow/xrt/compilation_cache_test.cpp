@@ -0,0 +1,112 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "oneflow/xrt/compilation_cache.h"
+
+namespace oneflow {
+namespace xrt {
+namespace test {
+
+namespace {
+
+class FakeExecutable : public Executable {
+ public:
+  explicit FakeExecutable(const std::string& name) : Executable(name, XrtEngine::XLA) {}
+
+  bool Run(const std::vector<Parameter>& inputs, const ExecutableRunOptions& run_options,
+           bool block_until_done = true) override {
+    return true;
+  }
+};
+
+Signature MakeSignature(int64_t batch) {
+  Signature signature;
+  signature.builder_name = "launch";
+  signature.device_ordinal = 0;
+  signature.entry_data_types = {DataType::kFloat};
+  signature.entry_shapes = {Shape({batch, 16})};
+  return signature;
+}
+
+void Record(CompilationCache* cache, int64_t batch) {
+  cache->Record(MakeSignature(batch),
+                std::make_shared<FakeExecutable>("batch_" + std::to_string(batch)));
+}
+
+}  // namespace
+
+TEST(CompilationCache, parse_shape_buckets) {
+  ASSERT_TRUE(ParseShapeBuckets("").empty());
+  ASSERT_EQ(ParseShapeBuckets("8,1,4,2"), (std::vector<int64_t>{1, 2, 4, 8}));
+  ASSERT_EQ(ParseShapeBuckets("4,,2,4,"), (std::vector<int64_t>{2, 4}));
+  ASSERT_DEATH(ParseShapeBuckets("1,0"), "positive");
+  ASSERT_DEATH(ParseShapeBuckets("-2"), "positive");
+}
+
+TEST(CompilationCache, bucket_dim) {
+  const std::vector<int64_t> buckets = {1, 4, 16};
+  ASSERT_EQ(BucketDim(1, buckets), 1);
+  ASSERT_EQ(BucketDim(2, buckets), 4);
+  ASSERT_EQ(BucketDim(4, buckets), 4);
+  ASSERT_EQ(BucketDim(5, buckets), 16);
+  ASSERT_EQ(BucketDim(16, buckets), 16);
+  // Dims beyond the last bucket are kept as they are.
+  ASSERT_EQ(BucketDim(17, buckets), 17);
+  ASSERT_EQ(BucketDim(3, {}), 3);
+}
+
+TEST(CompilationCache, evict_least_recently_used) {
+  CompilationCacheOptions options;
+  options.capacity = 2;
+  CompilationCache cache(options);
+  ASSERT_EQ(cache.GetRecord(MakeSignature(1)), nullptr);
+  Record(&cache, 1);
+  Record(&cache, 2);
+  // Refresh batch 1, so that batch 2 is the least recently used one.
+  Executable* executable = cache.GetRecord(MakeSignature(1));
+  ASSERT_NE(executable, nullptr);
+  ASSERT_EQ(executable->name(), "batch_1");
+  Record(&cache, 3);
+  ASSERT_EQ(cache.GetRecord(MakeSignature(2)), nullptr);
+  ASSERT_NE(cache.GetRecord(MakeSignature(1)), nullptr);
+  ASSERT_NE(cache.GetRecord(MakeSignature(3)), nullptr);
+  // Recording an existing signature replaces it without evicting another one.
+  Record(&cache, 3);
+  ASSERT_NE(cache.GetRecord(MakeSignature(1)), nullptr);
+  Record(&cache, 4);
+  ASSERT_EQ(cache.GetRecord(MakeSignature(3)), nullptr);
+  ASSERT_NE(cache.GetRecord(MakeSignature(1)), nullptr);
+  ASSERT_NE(cache.GetRecord(MakeSignature(4)), nullptr);
+
+  const CompilationCacheMetrics metrics = cache.metrics();
+  ASSERT_EQ(metrics.hits, 6);
+  ASSERT_EQ(metrics.misses, 3);
+  ASSERT_EQ(metrics.evictions, 2);
+  ASSERT_EQ(metrics.compile_count, 5);
+}
+
+TEST(CompilationCache, unlimited_capacity) {
+  CompilationCache cache;
+  for (int64_t batch = 1; batch <= 64; ++batch) { Record(&cache, batch); }
+  for (int64_t batch = 1; batch <= 64; ++batch) {
+    ASSERT_NE(cache.GetRecord(MakeSignature(batch)), nullptr);
+  }
+  ASSERT_EQ(cache.metrics().evictions, 0);
+}
+
+}  // namespace test
+}  // namespace xrt
+}  // namespace oneflow
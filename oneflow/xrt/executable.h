@@ -78,6 +78,10 @@ class Executable {
 
   const std::vector<Parameter>& Results() const { return results_; }
 
+  // Serializes the executable so that it can be restored by the graph compiler
+  // of the same engine. Returns false if it is not supported by the engine.
+  virtual bool Serialize(std::string* data) const { return false; }
+
  protected:
   // Executable name.
   std::string name_;
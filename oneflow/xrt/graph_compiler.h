@@ -67,6 +67,10 @@ class GraphCompiler {
                                                 const std::vector<Parameter>& return_params,
                                                 const std::vector<InputOutputAlias>& aliases) = 0;
 
+    // Restores the executable serialized by `Executable::Serialize`. Returns
+    // nullptr if the engine does not support it.
+    virtual std::shared_ptr<Executable> Deserialize(const std::string& data) { return nullptr; }
+
    protected:
     // Compiler name
     std::string name_ = "";
@@ -97,6 +101,10 @@ class GraphCompiler {
     return impl_->Compile(graph, entry_params, return_params, aliases);
   }
 
+  std::shared_ptr<Executable> Deserialize(const std::string& data) {
+    return impl_->Deserialize(data);
+  }
+
   const XrtEngine& engine() const { return engine_; }
 
  private:
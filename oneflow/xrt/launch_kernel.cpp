@@ -14,6 +14,13 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/xrt/launch_kernel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+#include "oneflow/core/kernel/kernel_util.h"
+#include "oneflow/core/memory/memory_allocator.h"
 #include "oneflow/xrt/api.h"
 #include "oneflow/xrt/compilation_cache.h"
 #include "oneflow/xrt/executable.h"
@@ -21,12 +28,29 @@ limitations under the License.
 #include "oneflow/xrt/platform.h"
 #include "oneflow/xrt/utility/env.h"
 
+#ifdef WITH_CUDA
+#include "oneflow/core/device/cuda_util.h"
+#endif  // WITH_CUDA
+#ifdef WITH_TENSORRT
+#include "NvInfer.h"
+#endif  // WITH_TENSORRT
+
 // General executable setup.
 DEFINE_int64(max_workspace_bytes, EnvToInt64(FLAGS_max_workspace_bytes, -1),
              "Maximum temporary workspace bytes.");
 // TENSORRT executable setup.
 DEFINE_int32(max_batch_size, EnvToInt(FLAGS_max_batch_size, 1),
              "Maximum batch size for builder of TENSORRT engine.");
+// Compilation cache setup.
+DEFINE_int64(xrt_compilation_cache_capacity, EnvToInt64(FLAGS_xrt_compilation_cache_capacity, 0),
+             "Maximum number of executables cached by each launch kernel, and the least "
+             "recently used one will be evicted. Non-positive means unlimited.");
+DEFINE_string(xrt_compilation_cache_dir, EnvToString(FLAGS_xrt_compilation_cache_dir, ""),
+              "Directory to persist the serialized executables across processes.");
+DEFINE_string(xrt_shape_buckets, EnvToString(FLAGS_xrt_shape_buckets, ""),
+              "Comma separated bucket sizes, and the first dimension of the dynamic entry "
+              "shapes will be padded up to the nearest bucket to reduce recompilation. Only "
+              "applies to launch ops whose rows along the first dimension are independent.");
 
 DECLARE_bool(tensorrt_fp16);
 DECLARE_bool(tensorrt_int8);
@@ -38,6 +62,91 @@ static Parameter BuildParameter(const Blob& blob, const std::string& name) {
   const auto& desc = blob.blob_desc();
   return Parameter(name, const_cast<void*>(blob.dptr<void>()), desc.shape(), desc.data_type());
 }
+
+static Parameter BuildParameter(const Blob& blob, const std::string& name, const Shape& shape) {
+  return Parameter(name, const_cast<void*>(blob.dptr<void>()), shape, blob.data_type());
+}
+
+// Pads the first dimension of the runtime shape up to the nearest bucket, and it
+// never exceeds the static shape. The static shape is returned if the other
+// dimensions are dynamic too.
+static Shape BucketShape(const Blob& blob, const std::vector<int64_t>& buckets) {
+  const Shape& static_shape = blob.static_shape();
+  const ShapeView& shape = blob.shape();
+  if (shape.NumAxes() == 0 || shape.NumAxes() != static_shape.NumAxes()) { return static_shape; }
+  for (int i = 1; i < shape.NumAxes(); ++i) {
+    if (shape.At(i) != static_shape.At(i)) { return static_shape; }
+  }
+  Shape bucket_shape(static_shape);
+  bucket_shape.Set(0, std::min(BucketDim(shape.At(0), buckets), static_shape.At(0)));
+  return bucket_shape;
+}
+
+bool IsRowIndependentFunction(const XrtLaunchOpConf& launch_conf) {
+  const XrtLaunchOpConf::Function& function = launch_conf.function();
+  // Ops whose inputs may all carry rows, each output row being computed from the same row of
+  // the inputs.
+  static const util::Set<std::string> row_wise_op_types = {
+      "relu",         "gelu",          "sigmoid",       "sigmoid_v2",    "tanh",
+      "identity",     "cast",          "scalar_add",    "scalar_mul",    "add_n",
+      "broadcast_add", "broadcast_sub", "broadcast_mul", "broadcast_div"};
+  // Ops mapping rows of the first input to rows of the output, with the other inputs being
+  // parameters shared by all rows.
+  static const util::Map<std::string, std::string> row_input_op_types = {
+      {"matmul", "a"}, {"broadcast_matmul", "a"}, {"bias_add", "a"},
+      {"conv1d", "in"}, {"conv2d", "in"},         {"conv3d", "in"}};
+  // Rows start from the dynamic entries, i.e. the dynamic arguments which are not produced by
+  // any node. Static entries such as the weights are never padded.
+  util::Set<std::string> produced_values;
+  for (const OperatorConf& node : function.node()) {
+    if (!node.has_user_conf()) { continue; }
+    for (const auto& pair : node.user_conf().output()) {
+      for (const std::string& value : pair.second.s()) { produced_values.insert(value); }
+    }
+  }
+  util::Set<std::string> row_values;
+  const auto& lbn2logical_blob_desc = launch_conf.lbn2logical_blob_desc();
+  for (const auto& argument : function.argument()) {
+    const std::string& value = argument.value();
+    if (produced_values.count(value) > 0) { continue; }
+    const auto& it = lbn2logical_blob_desc.find(value);
+    if (it != lbn2logical_blob_desc.end() && it->second.is_dynamic()) { row_values.insert(value); }
+  }
+  // The nodes are not necessarily in topological order, so propagate until nothing changes.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (const OperatorConf& node : function.node()) {
+      if (node.has_variable_conf()) { continue; }
+      if (!node.has_user_conf()) { return false; }
+      const UserOpConf& user_conf = node.user_conf();
+      std::vector<std::string> row_input_names;
+      for (const auto& pair : user_conf.input()) {
+        for (const std::string& value : pair.second.s()) {
+          if (row_values.count(value) > 0) { row_input_names.push_back(pair.first); }
+        }
+      }
+      if (row_input_names.empty()) { continue; }
+      const std::string& op_type = user_conf.op_type_name();
+      if (row_wise_op_types.count(op_type) == 0) {
+        const auto& it = row_input_op_types.find(op_type);
+        if (it == row_input_op_types.end()) { return false; }
+        for (const std::string& name : row_input_names) {
+          if (name != it->second) { return false; }
+        }
+        const auto& attrs = user_conf.attr();
+        if (op_type == "matmul" && attrs.at("transpose_a").at_bool()) { return false; }
+        if (op_type == "bias_add" && attrs.at("axis").at_int32() == 0) { return false; }
+      }
+      for (const auto& pair : user_conf.output()) {
+        for (const std::string& value : pair.second.s()) {
+          changed |= row_values.insert(value).second;
+        }
+      }
+    }
+  }
+  return true;
+}
 }  // namespace xrt
 
 namespace {
@@ -46,6 +155,11 @@ const LogicalBlobId& BnInOp2Lbi(const Kernel& kernel, const std::string& bn_in_o
   return kernel.op_attribute().arg_signature().bn_in_op2lbi().at(bn_in_op);
 }
 
+const std::vector<int64_t>& ShapeBuckets() {
+  static const std::vector<int64_t> buckets = xrt::ParseShapeBuckets(FLAGS_xrt_shape_buckets);
+  return buckets;
+}
+
 }  // namespace
 
 template<DeviceType device_type>
@@ -63,16 +177,82 @@ void BlobDescGetter<device_type>::DumpEntryBlobDescTo(
   }
 }
 
+template<DeviceType device_type>
+XrtLaunchKernel<device_type>::~XrtLaunchKernel() {
+  for (const auto& pair : bucket_buffers_) {
+    MemoryAllocatorImpl::Deallocate(pair.second.first, pair.second.second);
+  }
+}
+
+template<DeviceType device_type>
+void XrtLaunchKernel<device_type>::VirtualKernelInit(KernelContext* ctx) {
+  if (ShapeBuckets().empty()) { return; }
+  bucketing_ = xrt::IsRowIndependentFunction(this->op_conf().xrt_launch_conf());
+  if (!bucketing_) {
+    LOG(WARNING) << "Shape bucketing is disabled for launch op " << this->op_conf().name()
+                 << " since its rows along the first dimension are not independent";
+  }
+}
+
+template<DeviceType device_type>
+void* XrtLaunchKernel<device_type>::BucketBuffer4Bn(const std::string& bn,
+                                                    const Blob& blob) const {
+  auto it = bucket_buffers_.find(bn);
+  if (it == bucket_buffers_.end()) {
+    const int64_t bytes = blob.static_shape().elem_cnt() * GetSizeOfDataType(blob.data_type());
+    const size_t size = RoundUp(bytes, kHostAlignSize);
+    void* buffer = MemoryAllocatorImpl::Allocate(blob.mem_case(), size);
+    it = bucket_buffers_.emplace(bn, std::make_pair(buffer, blob.mem_case())).first;
+  }
+  return it->second.first;
+}
+
+template<DeviceType device_type>
+std::string XrtLaunchKernel<device_type>::PersistentKey(const xrt::Signature& signature) const {
+  if (function_fingerprint_.empty()) {
+    const auto& launch_conf = this->op_conf().xrt_launch_conf();
+    std::ostringstream stream;
+    stream << std::hex << std::hash<std::string>()(launch_conf.function().SerializeAsString())
+           << ";" << launch_conf.engine() << std::dec;
+#ifdef WITH_CUDA
+    // Serialized engines only run on the GPU architecture they were built for.
+    if (device_type == DeviceType::kGPU) {
+      int major = 0;
+      int minor = 0;
+      OF_CUDA_CHECK(cudaDeviceGetAttribute(&major, cudaDevAttrComputeCapabilityMajor,
+                                           signature.device_ordinal));
+      OF_CUDA_CHECK(cudaDeviceGetAttribute(&minor, cudaDevAttrComputeCapabilityMinor,
+                                           signature.device_ordinal));
+      stream << ";sm_" << major << minor;
+    }
+#endif  // WITH_CUDA
+    if (xrt::StringToXrtEngine(launch_conf.engine()) == xrt::XrtEngine::TENSORRT) {
+#ifdef WITH_TENSORRT
+      // ... and with the TensorRT library that serialized them.
+      stream << ";tensorrt:" << getInferLibVersion();
+#endif  // WITH_TENSORRT
+      stream << ";max_batch_size:" << FLAGS_max_batch_size << ";fp16:" << FLAGS_tensorrt_fp16
+             << ";int8:" << FLAGS_tensorrt_int8;
+    }
+    function_fingerprint_ = stream.str();
+  }
+  return function_fingerprint_ + ";" + xrt::SignatureToString(signature);
+}
+
 template<DeviceType device_type>
 xrt::Executable* XrtLaunchKernel<device_type>::BuildExecutable(
-    const std::vector<xrt::Parameter>& entry_params,
-    const std::vector<xrt::Parameter>& return_params,
+    const xrt::Signature& signature, const std::vector<xrt::Parameter>& entry_params,
+    std::vector<xrt::Parameter>* return_params,
     const std::vector<xrt::InputOutputAlias>& aliases, const int device_ordinal) const {
-  if (!compilation_cache_) { compilation_cache_.reset(new xrt::CompilationCache); }
+  if (!compilation_cache_) {
+    xrt::CompilationCacheOptions options;
+    options.capacity = FLAGS_xrt_compilation_cache_capacity;
+    options.persistent_dir = FLAGS_xrt_compilation_cache_dir;
+    compilation_cache_.reset(new xrt::CompilationCache(options));
+  }
+  const bool bucketing = bucketing_;
 
   xrt::Executable* executable = nullptr;
-  xrt::Signature signature =
-      xrt::ComputeSignature(this->op_conf().name(), device_ordinal, entry_params);
   bool force_compile = false;
   if (!force_compile) { executable = compilation_cache_->GetRecord(signature); }
 
@@ -93,6 +273,12 @@ xrt::Executable* XrtLaunchKernel<device_type>::BuildExecutable(
 
       std::unordered_map<std::string, BlobDesc> entry_blob_descs;
       desc_getter_.DumpEntryBlobDescTo(&entry_blob_descs);
+      if (bucketing) {
+        // Infer with the bucketed entry shapes instead of the static shapes.
+        for (const xrt::Parameter& param : entry_params) {
+          entry_blob_descs.at(param.name()).mut_shape() = param.shape();
+        }
+      }
       auto options = xrt::CreateDefaultXrtPassOptions();
       xrt::util::PbMap<std::string, cfg::SbpSignature> cfg_sbp_signatures;
       for (auto& pair : sbp_signatures) {
@@ -105,20 +291,66 @@ xrt::Executable* XrtLaunchKernel<device_type>::BuildExecutable(
       // Update argument meta data
       // xrt::RunXrtPass("UpdateArgMetaData", graph.get(), options,
       //                 &this->job_desc());
+      if (bucketing) {
+        std::vector<Shape>* return_shapes = &bucket_return_shapes_[signature];
+        return_shapes->clear();
+        for (const xrt::Parameter& param : *return_params) {
+          const auto& it = entry_blob_descs.find(param.name());
+          return_shapes->push_back(it == entry_blob_descs.end() ? param.shape()
+                                                                : it->second.shape());
+        }
+      }
     }
+    if (bucketing) { UpdateReturnShapes(signature, return_params); }
+
     xrt::XrtEngine engine = xrt::StringToXrtEngine(launch_conf.engine());
     xrt::XrtDevice device = xrt::DeviceTypeToXrtDevice(device_type);
     xrt::GraphCompiler compiler(this->op_conf().name(), engine, device, device_ordinal);
-    auto result = compiler.Compile(graph.get(), entry_params, return_params, aliases);
+    std::shared_ptr<xrt::Executable> result;
+    std::string serialized;
+    if (compilation_cache_->LoadPersistentRecord(PersistentKey(signature), &serialized)) {
+      result = compiler.Deserialize(serialized);
+    }
+    double compile_seconds = 0.0;
+    if (result) {
+      VLOG(2) << "Restore executable for launch op " << this->op_conf().name()
+              << " from the persistent compilation cache";
+    } else {
+      const auto start = std::chrono::steady_clock::now();
+      result = compiler.Compile(graph.get(), entry_params, *return_params, aliases);
+      compile_seconds =
+          std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
     // Record new compilation result
-    compilation_cache_->Record(signature, result);
+    compilation_cache_->Record(signature, result, compile_seconds);
+    const xrt::CompilationCacheMetrics metrics = compilation_cache_->metrics();
+    LOG(INFO) << "Built executable for launch op " << this->op_conf().name() << " in "
+              << compile_seconds << "s, compilation cache hits: " << metrics.hits
+              << ", misses: " << metrics.misses << ", evictions: " << metrics.evictions
+              << ", persistent hits: " << metrics.persistent_hits
+              << ", compiles: " << metrics.compile_count
+              << ", total compile time: " << metrics.compile_seconds << "s";
     // Get compilation result from cache
-    executable = compilation_cache_->GetRecord(signature);
+    executable = result.get();
+  } else if (bucketing) {
+    UpdateReturnShapes(signature, return_params);
   }
 
   return std::move(executable);
 }
 
+template<DeviceType device_type>
+void XrtLaunchKernel<device_type>::UpdateReturnShapes(
+    const xrt::Signature& signature, std::vector<xrt::Parameter>* return_params) const {
+  const auto& it = bucket_return_shapes_.find(signature);
+  CHECK(it != bucket_return_shapes_.end());
+  CHECK_EQ(it->second.size(), return_params->size());
+  for (int i = 0; i < return_params->size(); ++i) {
+    xrt::Parameter& param = return_params->at(i);
+    param = xrt::Parameter(param.name(), param.data(), it->second[i], param.data_type());
+  }
+}
+
 template<DeviceType device_type>
 void XrtLaunchKernel<device_type>::MakeInputOutputAlias(
     const std::vector<xrt::Parameter>& entry_params, std::vector<xrt::Parameter>* return_params,
@@ -159,11 +391,32 @@ void XrtLaunchKernel<device_type>::ForwardDataContent(KernelContext* ctx) const
   desc_getter_ = BlobDescGetter<device_type>(this, BnInOp2Blob);
   // Prepare input and output parameters
   std::vector<xrt::Parameter> entry_params, return_params;
+  const auto& mutability_table = this->op_conf().xrt_launch_conf().input_mutability();
   for (const std::string& bn : this->op_attribute().input_bns()) {
     const LogicalBlobId& lbi = BnInOp2Lbi(*this, bn);
     std::string blob_name = xrt::BlobIdToName(lbi);
-    xrt::Parameter input = xrt::BuildParameter(*BnInOp2Blob(bn), blob_name);
-    entry_params.push_back(input);
+    Blob* blob = BnInOp2Blob(bn);
+    // Mutable entries are updated in place, so they are never redirected to a padded copy.
+    if (!bucketing_ || mutability_table.count(blob_name) > 0) {
+      entry_params.push_back(xrt::BuildParameter(*blob, blob_name));
+      continue;
+    }
+    const Shape bucket_shape = xrt::BucketShape(*blob, ShapeBuckets());
+    const int64_t elem_cnt = blob->shape().elem_cnt();
+    if (bucket_shape.elem_cnt() == elem_cnt) {
+      entry_params.push_back(xrt::BuildParameter(*blob, blob_name, bucket_shape));
+      continue;
+    }
+    // Copy the rows into the kernel's buffer and zero the padding, so that the padded rows are
+    // deterministic and the input blob is left untouched. The function is row independent, so
+    // the padded rows only reach the results past the rows that are kept.
+    void* buffer = BucketBuffer4Bn(bn, *blob);
+    const size_t size_of_data_type = GetSizeOfDataType(blob->data_type());
+    AutoMemcpy(ctx->device_ctx(), buffer, blob->dptr(), elem_cnt * size_of_data_type,
+               blob->mem_case(), blob->mem_case());
+    AutoMemset(ctx->device_ctx(), static_cast<char*>(buffer) + elem_cnt * size_of_data_type, 0,
+               (bucket_shape.elem_cnt() - elem_cnt) * size_of_data_type, blob->mem_case());
+    entry_params.push_back(xrt::Parameter(blob_name, buffer, bucket_shape, blob->data_type()));
   }
   for (const std::string& bn : this->op_attribute().output_bns()) {
     const LogicalBlobId& lbi = BnInOp2Lbi(*this, bn);
@@ -179,7 +432,10 @@ void XrtLaunchKernel<device_type>::ForwardDataContent(KernelContext* ctx) const
   // Mapping parameter names to function input and output names.
   MappingParamsToFunctionNames(&entry_params, &return_params);
   // Build executable.
-  auto executable = BuildExecutable(entry_params, return_params, aliases, device_ordinal);
+  xrt::Signature signature =
+      xrt::ComputeSignature(this->op_conf().name(), device_ordinal, entry_params);
+  auto executable =
+      BuildExecutable(signature, entry_params, &return_params, aliases, device_ordinal);
   if (!executable) { LOG(FATAL) << "Executable is built failed."; }
   // Run executable.
   xrt::ExecutableRunOptions run_options;
@@ -204,6 +460,11 @@ void XrtLaunchKernel<device_type>::ForwardDataContent(KernelContext* ctx) const
   }
   bool status = executable->Run(entry_params, run_options, block_until_done);
   CHECK(status) << "Executable is running failed.";
+  // Some engines such as TensorRT build the executable lazily at the first run,
+  // so it is persisted after running.
+  if (compilation_cache_->persistent() && !FLAGS_tensorrt_int8) {
+    compilation_cache_->PersistRecord(PersistentKey(signature), *executable);
+  }
 
   const std::vector<xrt::Parameter>& results = executable->Results();
   CHECK_EQ(results.size(), return_params.size());
@@ -26,6 +26,15 @@ limitations under the License.
 #include "oneflow/xrt/types.h"
 
 namespace oneflow {
+namespace xrt {
+
+// Whether row i along axis 0 of every value in the function only depends on row i of the dynamic
+// entries, so that padding these entries with zero rows up to a shape bucket leaves the leading
+// rows of the results unchanged. Ops reducing or mixing rows, such as axis 0 reductions or batch
+// normalization, make it false.
+bool IsRowIndependentFunction(const XrtLaunchOpConf& launch_conf);
+
+}  // namespace xrt
 
 template<DeviceType device_type>
 class BlobDescGetter {
@@ -45,16 +54,27 @@ template<DeviceType device_type>
 class XrtLaunchKernel : public Kernel {
  public:
   XrtLaunchKernel() = default;
-  virtual ~XrtLaunchKernel() {}
+  virtual ~XrtLaunchKernel();
 
  private:
+  void VirtualKernelInit(KernelContext* ctx) override;
   void ForwardDataContent(KernelContext* ctx) const override;
 
-  xrt::Executable* BuildExecutable(const std::vector<xrt::Parameter>& entry_params,
-                                   const std::vector<xrt::Parameter>& return_params,
+  // Returns the buffer which the entry blob `bn` is copied into and padded up to its bucket.
+  void* BucketBuffer4Bn(const std::string& bn, const Blob& blob) const;
+
+  xrt::Executable* BuildExecutable(const xrt::Signature& signature,
+                                   const std::vector<xrt::Parameter>& entry_params,
+                                   std::vector<xrt::Parameter>* return_params,
                                    const std::vector<xrt::InputOutputAlias>& aliases,
                                    const int device_ordinal) const;
 
+  // Updates the return shapes which are inferred from the bucketed entry shapes.
+  void UpdateReturnShapes(const xrt::Signature& signature,
+                          std::vector<xrt::Parameter>* return_params) const;
+
+  std::string PersistentKey(const xrt::Signature& signature) const;
+
   void MakeInputOutputAlias(                            // NOLINT
       const std::vector<xrt::Parameter>& entry_params,  // NOLINT
       std::vector<xrt::Parameter>* return_params,
@@ -68,6 +88,13 @@ class XrtLaunchKernel : public Kernel {
  private:
   mutable BlobDescGetter<device_type> desc_getter_;
   mutable std::shared_ptr<xrt::CompilationCache> compilation_cache_;
+  mutable xrt::util::Map<xrt::Signature, std::vector<Shape>, xrt::SignatureHash>
+      bucket_return_shapes_;
+  mutable std::string function_fingerprint_;
+  // Entry blobs are read-only, so the padded entries live in buffers owned by the kernel, which
+  // are large enough for the static shape of the blob.
+  mutable std::unordered_map<std::string, std::pair<void*, MemoryCase>> bucket_buffers_;
+  bool bucketing_ = false;
 };
 
 }  // namespace oneflow
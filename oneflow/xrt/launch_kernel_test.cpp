@@ -0,0 +1,131 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "oneflow/core/common/protobuf.h"
+#include "oneflow/core/register/blob_desc.h"
+#include "oneflow/xrt/launch_kernel.h"
+
+namespace oneflow {
+namespace xrt {
+namespace test {
+
+namespace {
+
+// A launch op computing `matmul(relu(x), w)` followed by `node`, which consumes the matmul
+// result. Only the first dimension of `x` is dynamic.
+XrtLaunchOpConf MakeLaunchConf(const std::string& node) {
+  XrtLaunchOpConf launch_conf;
+  auto* lbn2logical_blob_desc = launch_conf.mutable_lbn2logical_blob_desc();
+  BlobDesc(Shape({64, 16}), DataType::kFloat, true).ToProto(&(*lbn2logical_blob_desc)["x/out"]);
+  BlobDesc(Shape({16, 16}), DataType::kFloat, false).ToProto(&(*lbn2logical_blob_desc)["w/out"]);
+  const std::string function_str = R"(
+    argument { name: "x" value: "x/out" device_type: kGPU }
+    argument { name: "w" value: "w/out" device_type: kGPU }
+    argument { name: "y" value: "tail/y_0" device_type: kGPU }
+    node {
+      name: "relu"
+      user_conf {
+        op_type_name: "relu"
+        input { key: "x" value { s: "x/out" } }
+        output { key: "y" value { s: "relu/y_0" } }
+      }
+    }
+    node {
+      name: "matmul"
+      user_conf {
+        op_type_name: "matmul"
+        input { key: "a" value { s: "relu/y_0" } }
+        input { key: "b" value { s: "w/out" } }
+        output { key: "out" value { s: "matmul/out_0" } }
+        attr { key: "transpose_a" value { at_bool: false } }
+        attr { key: "transpose_b" value { at_bool: false } }
+      }
+    }
+  )";
+  CHECK(TxtString2PbMessage(function_str + node, launch_conf.mutable_function()));
+  return launch_conf;
+}
+
+}  // namespace
+
+TEST(XrtLaunchKernel, row_independent_function) {
+  ASSERT_TRUE(IsRowIndependentFunction(MakeLaunchConf(R"(
+    node {
+      name: "tail"
+      user_conf {
+        op_type_name: "scalar_mul"
+        input { key: "in" value { s: "matmul/out_0" } }
+        output { key: "out" value { s: "tail/y_0" } }
+      }
+    }
+  )")));
+  ASSERT_TRUE(IsRowIndependentFunction(MakeLaunchConf(R"(
+    node {
+      name: "tail"
+      user_conf {
+        op_type_name: "bias_add"
+        input { key: "a" value { s: "matmul/out_0" } }
+        input { key: "b" value { s: "w/out" } }
+        output { key: "out" value { s: "tail/y_0" } }
+        attr { key: "axis" value { at_int32: 1 } }
+      }
+    }
+  )")));
+}
+
+TEST(XrtLaunchKernel, row_dependent_function) {
+  // Reductions mix the rows.
+  ASSERT_FALSE(IsRowIndependentFunction(MakeLaunchConf(R"(
+    node {
+      name: "tail"
+      user_conf {
+        op_type_name: "reduce_sum"
+        input { key: "input_tensor" value { s: "matmul/out_0" } }
+        output { key: "output_tensor" value { s: "tail/y_0" } }
+      }
+    }
+  )")));
+  // The rows are the reduced dimension of the second matmul.
+  ASSERT_FALSE(IsRowIndependentFunction(MakeLaunchConf(R"(
+    node {
+      name: "tail"
+      user_conf {
+        op_type_name: "matmul"
+        input { key: "a" value { s: "w/out" } }
+        input { key: "b" value { s: "matmul/out_0" } }
+        output { key: "out" value { s: "tail/y_0" } }
+        attr { key: "transpose_a" value { at_bool: false } }
+        attr { key: "transpose_b" value { at_bool: false } }
+      }
+    }
+  )")));
+  ASSERT_FALSE(IsRowIndependentFunction(MakeLaunchConf(R"(
+    node {
+      name: "tail"
+      user_conf {
+        op_type_name: "bias_add"
+        input { key: "a" value { s: "matmul/out_0" } }
+        input { key: "b" value { s: "w/out" } }
+        output { key: "out" value { s: "tail/y_0" } }
+        attr { key: "axis" value { at_int32: 0 } }
+      }
+    }
+  )")));
+}
+
+}  // namespace test
+}  // namespace xrt
+}  // namespace oneflow
@@ -186,6 +186,14 @@ bool TrtExecutable::Run(const std::vector<Parameter>& inputs,
                        block_until_done);
 }
 
+bool TrtExecutable::Serialize(std::string* data) const {
+  if (!engine_ || calibrator_) { return false; }
+  auto serialized = nv::unique_ptr<nvinfer1::IHostMemory>(engine_->serialize());
+  if (!serialized) { return false; }
+  data->assign(static_cast<const char*>(serialized->data()), serialized->size());
+  return true;
+}
+
 }  // namespace tensorrt
 
 }  // namespace xrt
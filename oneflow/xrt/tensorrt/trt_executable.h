@@ -53,6 +53,10 @@ class TrtExecutable : public Executable {
   bool Run(const std::vector<Parameter>& inputs, const ExecutableRunOptions& run_options,
            bool block_until_done = true) override;
 
+  // Only the engines built without int8 calibration are serialized, since the
+  // engine is built lazily at the first run and may be rebuilt for calibration.
+  bool Serialize(std::string* data) const override;
+
  private:
   nvinfer1::ICudaEngine* CreateExecutableEngine(const ExecutableRunOptions& run_options,
                                                 const int batch_size = 1,
@@ -101,6 +101,17 @@ std::shared_ptr<Executable> TrtGraphCompiler::Compile(
                                          builder_->ReleaseNetwork(), builder_->host_weights());
 }
 
+std::shared_ptr<Executable> TrtGraphCompiler::Deserialize(const std::string& data) {
+  static nv::Logger logger;
+  auto runtime = nv::unique_ptr<nvinfer1::IRuntime>(nvinfer1::createInferRuntime(logger));
+  nv::unique_ptr<nvinfer1::ICudaEngine> engine(
+      runtime->deserializeCudaEngine(data.data(), data.size(), nullptr));
+  if (!engine) { return nullptr; }
+  // The weights have been built into the serialized engine.
+  util::Map<std::string, std::shared_ptr<std::vector<uint8_t>>> host_weights;
+  return std::make_shared<TrtExecutable>(name_, std::move(engine), host_weights);
+}
+
 REGISTER_GRAPH_COMPILER(XrtEngine::TENSORRT, TrtGraphCompiler);
 
 }  // namespace tensorrt
@@ -41,6 +41,8 @@ class TrtGraphCompiler : public GraphCompiler::Impl {
                                       const std::vector<Parameter>& return_params,
                                       const std::vector<InputOutputAlias>& aliases) override;
 
+  std::shared_ptr<Executable> Deserialize(const std::string& data) override;
+
  private:
   void SetupKernelContextParam(const XrtNode* node, TrtOpContext::Param* context_param);
 
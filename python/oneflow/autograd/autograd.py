@@ -28,6 +28,7 @@ def grad(
     out_grads: Union[Tensor, Sequence[Tensor], None] = None,
     retain_graph: bool = False,
     create_graph: bool = False,
+    thread_num: int = 1,
 ) -> Tuple[Tensor]:
     in_grads = grad_api(
         convert_to_tensor_tuple(outputs),
@@ -35,6 +36,7 @@ def grad(
         convert_to_tensor_tuple(out_grads),
         retain_graph,
         create_graph,
+        thread_num,
     )
     return tuple([Tensor(x) for x in in_grads])
 
@@ -44,10 +46,12 @@ def backward(
     out_grads: Union[Tensor, Sequence[Tensor], None],
     retain_graph: bool = False,
     create_graph: bool = False,
+    thread_num: int = 1,
 ) -> None:
     backward_api(
         convert_to_tensor_tuple(outputs),
         convert_to_tensor_tuple(out_grads),
         retain_graph,
         create_graph,
+        thread_num,
     )
@@ -742,6 +742,11 @@ def set_qat_symmetric(func_desc, value: str):
     func_desc.job_config_proto.mutable_qat_config().set_target_backend(value)
 
 
+@oneflow_function_config("qat.lower_to_int8_inference")
+def set_qat_lower_to_int8_inference(func_desc, value=True):
+    func_desc.job_config_proto.mutable_qat_config().set_lower_to_int8_inference(value)
+
+
 @oneflow_function_config("enable_auto_mixed_precision")
 def set_enable_auto_mixed_precision(func_desc, value=True):
     """If true, then job will use mixed precision mode, it means use both float16 and float32 during model training.
@@ -753,6 +758,17 @@ def set_enable_auto_mixed_precision(func_desc, value=True):
     func_desc.job_config_proto.set_enable_auto_mixed_precision(value)
 
 
+@oneflow_function_config("auto_mixed_precision_use_bfloat16")
+def set_auto_mixed_precision_use_bfloat16(func_desc, value=True):
+    """If true, mixed precision mode casts CPU ops having bfloat16 kernels to bfloat16 instead of casting GPU ops to float16.
+
+    Args:
+        func_desc ([type]): [description]
+        value (bool, optional): [description]. Defaults to True.
+    """
+    func_desc.job_config_proto.set_auto_mixed_precision_use_bfloat16(value)
+
+
 @oneflow_function_config("enable_keep_header_only")
 def set_enable_keep_header_only(func_desc, value=True):
     """deprecated api.
@@ -817,6 +833,75 @@ def set_enable_fuse_model_update_ops(func_desc, value=True):
     func_desc.job_config_proto.set_enable_fuse_model_update_ops(value)
 
 
+@oneflow_function_config("enable_multi_tensor_model_update")
+def set_enable_multi_tensor_model_update(func_desc, value=True):
+    """Whether enable multi_tensor_model_update.
+            If enabled, CPU sgd/momentum/adam update ops sharing the same hyper-parameters are grouped into one multi-tensor update op.
+
+    Args:
+        func_desc ([type]): [description]
+        value ([type]): [description]
+    """
+    func_desc.job_config_proto.set_enable_multi_tensor_model_update(value)
+
+
+@oneflow_function_config("enable_auto_parallel")
+def set_enable_auto_parallel(func_desc, value=True):
+    """Whether enable auto_parallel.
+            If enabled, sbp signatures of ops without user constraints are searched jointly with a cost model of computation, boxing and memory instead of picked greedily op by op.
+
+    Args:
+        func_desc ([type]): [description]
+        value ([type]): [description]
+    """
+    func_desc.job_config_proto.set_enable_auto_parallel(value)
+
+
+@oneflow_function_config("auto_parallel_memory_limit_mbyte")
+def set_auto_parallel_memory_limit_mbyte(func_desc, value):
+    """Set the per-device memory limit of the auto_parallel search, e.g. 16384mb. 0 means unlimited.
+
+    Args:
+        func_desc ([type]): [description]
+        value ([type]): [description]
+    """
+    func_desc.job_config_proto.set_auto_parallel_memory_limit_mbyte(value)
+
+
+@oneflow_function_config("auto_parallel_computation_cost_ratio")
+def set_auto_parallel_computation_cost_ratio(func_desc, value):
+    """Set the cost of touching one byte in computation relative to transferring one byte in boxing for auto_parallel.
+
+    Args:
+        func_desc ([type]): [description]
+        value ([type]): [description]
+    """
+    func_desc.job_config_proto.set_auto_parallel_computation_cost_ratio(value)
+
+
+@oneflow_function_config("auto_checkpointing_memory_budget_mbyte")
+def set_auto_checkpointing_memory_budget_mbyte(func_desc, value):
+    """Set the per-device activation memory budget, e.g. 8192mb. If greater than 0, forward ops are chosen for recomputation automatically until the activations kept for backward fit the budget.
+
+    Args:
+        func_desc ([type]): [description]
+        value ([type]): [description]
+    """
+    func_desc.job_config_proto.set_auto_checkpointing_memory_budget_mbyte(value)
+
+
+@oneflow_function_config("enable_memory_aware_task_reorder")
+def set_enable_memory_aware_task_reorder(func_desc, value=True):
+    """Whether enable memory_aware_task_reorder.
+            If enabled, tasks in each chain are reordered before memory sharing to lower the peak of live registers.
+
+    Args:
+        func_desc ([type]): [description]
+        value ([type]): [description]
+    """
+    func_desc.job_config_proto.set_enable_memory_aware_task_reorder(value)
+
+
 @oneflow_function_config("enable_gradients_stats_aggregation")
 def set_enable_gradients_stats_aggregation(func_desc, value=True):
     """Whether enable gradients_stats_aggregation.
@@ -438,6 +438,7 @@ def onerec_reader(
     shuffle_buffer_size=1024,
     shuffle_after_epoch=False,
     verify_example=True,
+    num_parallel_reads=1,
     name=None,
 ):
     assert isinstance(files, (list, tuple))
@@ -454,6 +455,7 @@ def onerec_reader(
         .Attr("shuffle_buffer_size", shuffle_buffer_size)
         .Attr("shuffle_after_epoch", shuffle_after_epoch)
         .Attr("verify_example", verify_example)
+        .Attr("num_parallel_reads", num_parallel_reads)
         .Build()
         .InferAndTryRun()
         .RemoteBlobList()[0]
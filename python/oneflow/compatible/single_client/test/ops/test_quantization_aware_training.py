@@ -52,6 +52,48 @@ def _test(test_case, per_channel, symmetric, target_backend, build_backbone_fn):
     res_qat = run_with_func_config(build_backbone_fn, qat_func_config)
 
 
+def _test_int8_lowering(test_case, per_channel):
+    flow.clear_default_session()
+    INPUT_SHAPE = (2, 3, 8, 8)
+
+    def build_backbone(x):
+        y = flow.layers.conv2d(x, 4, 3, 1, "SAME", use_bias=True, name="conv1")
+        y = flow.reshape(y, (INPUT_SHAPE[0], -1))
+        return flow.layers.dense(y, 6, name="fc1")
+
+    def make_func_config(lower_to_int8):
+        func_config = flow.FunctionConfig()
+        func_config.default_placement_scope(flow.scope.placement("cpu", "0:0"))
+        func_config.enable_qat(True)
+        func_config.qat.symmetric(True)
+        func_config.qat.per_channel_weight_quantization(per_channel)
+        func_config.qat.moving_min_max_stop_update_after_iters(1000)
+        func_config.qat.lower_to_int8_inference(lower_to_int8)
+        return func_config
+
+    @flow.global_function(type="train", function_config=make_func_config(False))
+    def Train(x: tp.Numpy.Placeholder(INPUT_SHAPE)) -> tp.Numpy:
+        y = build_backbone(x)
+        flow.optimizer.SGD(
+            flow.optimizer.PiecewiseConstantScheduler([], [1e-3]), momentum=0
+        ).minimize(y)
+        return y
+
+    @flow.global_function(type="predict", function_config=make_func_config(False))
+    def FakeQuantInfer(x: tp.Numpy.Placeholder(INPUT_SHAPE)) -> tp.Numpy:
+        return build_backbone(x)
+
+    @flow.global_function(type="predict", function_config=make_func_config(True))
+    def Int8Infer(x: tp.Numpy.Placeholder(INPUT_SHAPE)) -> tp.Numpy:
+        return build_backbone(x)
+
+    x = np.random.uniform(-1, 1, INPUT_SHAPE).astype(np.float32)
+    for _ in range(3):
+        Train(x)
+    # the int8 graph only differs from the fake quantization graph by float rounding
+    test_case.assertTrue(np.allclose(FakeQuantInfer(x), Int8Infer(x), rtol=1e-3, atol=1e-4))
+
+
 @unittest.skipIf(os.getenv("ONEFLOW_DRY_RUN"), "can't run in dry run")
 class TestQAT(flow.unittest.TestCase):
     def test_qat(test_case):
@@ -77,6 +119,10 @@ class TestQAT(flow.unittest.TestCase):
                 continue
             _test(test_case, *arg)
 
+    def test_qat_int8_lowering(test_case):
+        for per_channel in [True, False]:
+            _test_int8_lowering(test_case, per_channel)
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -70,6 +70,7 @@ from oneflow.nn.modules.quantization import Quantization
 
 from oneflow.nn.modules.dataset import (
     COCOReader,
+    ColumnarReader,
     CoinFlip,
     CropMirrorNormalize,
     OFRecordImageDecoder,
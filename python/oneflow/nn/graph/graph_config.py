@@ -64,6 +64,17 @@ class GraphConfig(object):
         assert type(mode) is bool
         self.proto.set_enable_auto_mixed_precision(mode)
 
+    def enable_amp_bfloat16(self, mode: bool = True):
+        """If true, mixed precision mode casts the CPU ops having bfloat16 kernels (matmul, conv2d, relu, ...)
+        to bfloat16 instead of casting the GPU ops to float16. Model weights are kept in float32.
+        Takes effect together with ``enable_amp``.
+
+        Args:
+            mode (bool, optional): [description]. Default is True.
+        """
+        assert type(mode) is bool
+        self.proto.set_auto_mixed_precision_use_bfloat16(mode)
+
     def allow_fuse_model_update_ops(self, mode: bool = True):
         """If true, try to fuse cast + scale + l1_l2_regularize_gradient + model_update to one op to improve performance.
 
@@ -72,6 +83,63 @@ class GraphConfig(object):
         """
         self.proto.set_enable_fuse_model_update_ops(mode)
 
+    def allow_multi_tensor_model_update(self, mode: bool = True):
+        """If true, group CPU sgd/momentum/adam update ops sharing the same hyper-parameters into one multi-tensor update op.
+
+        Args:
+            mode (bool, optional): [description]. Default is True.
+        """
+        self.proto.set_enable_multi_tensor_model_update(mode)
+
+    def enable_auto_parallel(self, mode: bool = True):
+        """If true, search the sbp signatures of ops without user-specified sbp jointly with a cost model
+        of computation, boxing and memory instead of choosing them greedily op by op.
+        The chosen plan and its estimated cost are written to the log directory.
+
+        Args:
+            mode (bool, optional): [description]. Default is True.
+        """
+        self.proto.set_enable_auto_parallel(mode)
+
+    def set_auto_parallel_memory_limit_mbyte(self, value: int):
+        """Set the per-device memory limit in MB the auto parallel search has to respect.
+        0 means unlimited.
+
+        Args:
+            value (int): memory limit in MB.
+        """
+        self.proto.set_auto_parallel_memory_limit_mbyte(value)
+
+    def set_auto_parallel_computation_cost_ratio(self, value: float):
+        """Set the cost of touching one byte in computation relative to transferring one byte
+        in boxing, used by the auto parallel search. Default is 0.05.
+
+        Args:
+            value (float): cost ratio.
+        """
+        self.proto.set_auto_parallel_computation_cost_ratio(value)
+
+    def set_auto_checkpointing_memory_budget_mbyte(self, value: int):
+        """Set the per-device activation memory budget in MB for automatic activation checkpointing.
+        If greater than 0, forward ops are chosen for recomputation in backward, cheapest first,
+        until the activations kept for backward fit the budget. Blocks configured with
+        ``activation_checkpointing`` are always recomputed. 0 (default) disables the automatic mode.
+
+        Args:
+            value (int): memory budget in MB.
+        """
+        self.proto.set_auto_checkpointing_memory_budget_mbyte(value)
+
+    def enable_memory_aware_task_reorder(self, mode: bool = True):
+        """If true, reorder the tasks in each execution chain before memory sharing so that
+        tasks freeing their inputs run first, which lowers the peak memory of the graph.
+        The peak memory of each chain before and after reordering is logged.
+
+        Args:
+            mode (bool, optional): [description]. Default is True.
+        """
+        self.proto.set_enable_memory_aware_task_reorder(mode)
+
     def allow_fuse_add_to_output(self, mode: bool = True):
         """If true, try to fuse a binary element-wise add to one of the predecessors to improve performance.
 
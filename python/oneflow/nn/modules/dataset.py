@@ -51,6 +51,9 @@ class OFRecordReader(Module):
         placement: flow.placement = None,
         sbp: Union[flow.sbp.sbp, List[flow.sbp.sbp]] = None,
         name: Optional[str] = None,
+        global_shuffle: bool = False,
+        lazy_parse: bool = False,
+        num_parallel_reads: int = 1,
     ):
         super().__init__()
 
@@ -91,6 +94,9 @@ class OFRecordReader(Module):
             .Attr("random_shuffle", random_shuffle)
             .Attr("shuffle_buffer_size", shuffle_buffer_size)
             .Attr("shuffle_after_epoch", shuffle_after_epoch)
+            .Attr("global_shuffle", global_shuffle)
+            .Attr("lazy_parse", lazy_parse)
+            .Attr("num_parallel_reads", num_parallel_reads)
             .Attr("part_name_suffix_length", part_name_suffix_length)
             .Attr("seed", seed)
             .Attr("nd_sbp", nd_sbp)
@@ -106,6 +112,67 @@ class OFRecordReader(Module):
         return res
 
 
+class ColumnarReader(Module):
+    """Reads the columns ``columns`` of the columnar data files ``files``, and returns a
+    tensor of shape ``(batch_size, *shape)`` for each of them. The other columns are never
+    read from disk.
+
+    The file format is described in ``oneflow/user/data/columnar_format.proto``. The files
+    are split among the ranks of ``placement``, or among the processes if there is no
+    placement, as in DDP.
+    """
+
+    def __init__(
+        self,
+        files: List[str],
+        columns: List[str],
+        shapes: Sequence[Sequence[int]],
+        dtypes: Sequence[flow.dtype],
+        batch_size: int = 1,
+        shuffle_after_epoch: bool = False,
+        device: Union[flow.device, str] = None,
+        placement: flow.placement = None,
+        sbp: Union[flow.sbp.sbp, List[flow.sbp.sbp]] = None,
+    ):
+        super().__init__()
+        assert len(columns) == len(shapes) == len(dtypes)
+        nd_sbp = []
+        self.placement = placement
+        if placement is None:
+            self.device = device or flow.device("cpu")
+            assert sbp is None, "sbp: %s" % sbp
+        else:
+            assert device is None
+            assert isinstance(sbp, (flow.sbp.sbp, tuple, list)), "sbp: %s" % sbp
+            if isinstance(sbp, flow.sbp.sbp):
+                sbp = (sbp,)
+            for elem in sbp:
+                assert isinstance(elem, flow.sbp.sbp), "sbp: %s" % sbp
+                nd_sbp.append(elem._ToAttrStr())
+            assert len(nd_sbp) == len(placement.hierarchy)
+        self.sbp = sbp
+        self._op = (
+            flow.builtin_op("ColumnarReader")
+            .Output("out", len(columns))
+            .Attr("files", files)
+            .Attr("columns", columns)
+            .Attr("shapes", [list(shape) for shape in shapes])
+            .Attr("data_types", list(dtypes))
+            .Attr("batch_size", batch_size)
+            .Attr("shuffle_after_epoch", shuffle_after_epoch)
+            .Attr("nd_sbp", nd_sbp)
+            .Build()
+        )
+        self.attrs = flow._oneflow_internal.MutableCfgAttrMap()
+
+    def forward(self):
+        if self.placement is not None:
+            res = self._op.apply(self.placement, self.sbp, self.attrs)
+        else:
+            res = self._op.apply(self.device, self.attrs)
+        return list(res)
+
+
 class OFRecordRawDecoder(Module):
     def __init__(
         self,
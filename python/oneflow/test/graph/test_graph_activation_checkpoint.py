@@ -116,6 +116,63 @@ class TestGraphActivationCheckpoint(flow.unittest.TestCase):
                         print(name)
                 test_case.assertTrue(find_ctrl)
 
+    def test_auto_activation_checkpointing(test_case):
+        # Each activation of this MLP takes 2MB, about 30MB in total.
+        layers = []
+        for _ in range(6):
+            layers += [flow.nn.Linear(512, 512), flow.nn.ReLU()]
+        init_state = {
+            k: flow.tensor(v.numpy())
+            for (k, v) in flow.nn.Sequential(*layers).state_dict().items()
+        }
+        x = flow.randn(1024, 512)
+
+        def compile_and_train(budget_mbyte):
+            model = flow.nn.Sequential(*layers)
+            model.load_state_dict(init_state)
+            optimizer = flow.optim.SGD(model.parameters(), lr=1e-3)
+
+            class MLPTrainGraph(flow.nn.Graph):
+                def __init__(self):
+                    super().__init__()
+                    self.model = model
+                    self.add_optimizer(optimizer)
+                    self.config.set_auto_checkpointing_memory_budget_mbyte(
+                        budget_mbyte
+                    )
+
+                def build(self, x):
+                    loss = self.model(x).sum()
+                    loss.backward()
+                    return loss
+
+            graph = MLPTrainGraph()
+            losses = [graph(x).numpy() for _ in range(2)]
+            prefix = "OneFlow-System-Checkpointing-Fake-Fw-Op_"
+            recomputed_ops = set(
+                op.name[len(prefix) :]
+                for op in graph._full_graph_proto.net.op
+                if op.name.startswith(prefix)
+            )
+            return (recomputed_ops, losses)
+
+        (ref_ops, ref_losses) = compile_and_train(0)
+        test_case.assertEqual(len(ref_ops), 0)
+        prev_ops = None
+        # Ops are picked in the same order until the estimated peak fits, so a
+        # looser budget never recomputes more ops than a tighter one, and a
+        # budget above the estimated peak recomputes nothing.
+        for budget_mbyte in [4, 12, 20, 1024]:
+            (ops, losses) = compile_and_train(budget_mbyte)
+            if prev_ops is not None:
+                test_case.assertTrue(len(ops) <= len(prev_ops))
+            else:
+                test_case.assertTrue(len(ops) > 0)
+            for (loss, ref_loss) in zip(losses, ref_losses):
+                test_case.assertTrue(np.allclose(loss, ref_loss, 1e-4, 1e-4))
+            prev_ops = ops
+        test_case.assertEqual(len(prev_ops), 0)
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -0,0 +1,128 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+# Op types of AutoMixedPrecisionLists::CpuBFloat16List
+_cpu_bfloat16_op_types = {
+    "matmul",
+    "batch_matmul",
+    "broadcast_matmul",
+    "conv2d",
+    "amp_white_identity",
+    "add_n",
+    "relu",
+    "identity",
+    "reshape",
+    "flatten",
+    "transpose",
+    "parallel_cast",
+}
+
+
+class _Model(flow.nn.Module):
+    def __init__(self):
+        super().__init__()
+        self.conv = flow.nn.Conv2d(3, 8, 3, padding=1, bias=False)
+        self.fc = flow.nn.Linear(8 * 6 * 6, 4)
+
+    def forward(self, x):
+        return self.fc(flow.flatten(flow.relu(self.conv(x)), 1))
+
+
+def _train(model, use_amp, data):
+    optimizer = flow.optim.SGD(model.parameters(), lr=0.01)
+
+    class TrainGraph(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+            self.model = model
+            self.add_optimizer(optimizer)
+            if use_amp:
+                self.config.enable_amp(True)
+                self.config.enable_amp_bfloat16(True)
+
+        def build(self, x):
+            loss = self.model(x).sum()
+            loss.backward()
+            return loss
+
+    graph = TrainGraph()
+    losses = [graph(x).numpy() for x in data]
+    return (graph._full_graph_proto, losses)
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestGraphAmpBFloat16(flow.unittest.TestCase):
+    def test_casts_around_white_list_ops(test_case):
+        data = [
+            flow.tensor(np.random.randn(2, 3, 6, 6).astype(np.float32))
+            for _ in range(3)
+        ]
+        model = _Model()
+        ref_model = _Model()
+        ref_model.load_state_dict(model.state_dict())
+        (job, losses) = _train(model, True, data)
+        (_, ref_losses) = _train(ref_model, False, data)
+
+        op_name2type = {}
+        lbn2consumer_types = {}
+        for op in job.net.op:
+            if not op.HasField("user_conf"):
+                op_name2type[op.name] = None
+                continue
+            op_name2type[op.name] = op.user_conf.op_type_name
+            for lbns in op.user_conf.input.values():
+                for lbn in lbns.s:
+                    lbn2consumer_types.setdefault(lbn, []).append(
+                        op.user_conf.op_type_name
+                    )
+        f2h_casts = []
+        h2f_casts = []
+        for op in job.net.op:
+            if op.name.endswith("-cast_f2h"):
+                f2h_casts.append(op)
+            elif op.name.endswith("-cast_h2f"):
+                h2f_casts.append(op)
+        test_case.assertTrue(len(f2h_casts) > 0)
+        test_case.assertTrue(len(h2f_casts) > 0)
+        casted_op_types = set()
+        # Values are cast to bfloat16 only on their way into white list ops and back
+        # to float only on their way out of them.
+        for op in f2h_casts:
+            test_case.assertEqual(op.user_conf.op_type_name, "cast")
+            for lbn in op.user_conf.output["out"].s:
+                for consumer_type in lbn2consumer_types.get(lbn, []):
+                    test_case.assertIn(consumer_type, _cpu_bfloat16_op_types)
+                    casted_op_types.add(consumer_type)
+        for op in h2f_casts:
+            test_case.assertEqual(op.user_conf.op_type_name, "cast")
+            producer = op.user_conf.input["in"].s[0].split("/")[0]
+            test_case.assertIn(op_name2type[producer], _cpu_bfloat16_op_types)
+        test_case.assertIn("conv2d", casted_op_types)
+        test_case.assertTrue(
+            "matmul" in casted_op_types or "broadcast_matmul" in casted_op_types
+        )
+        for (loss, ref_loss) in zip(losses, ref_losses):
+            test_case.assertTrue(np.allclose(loss, ref_loss, rtol=5e-2, atol=5e-2))
+
+
+if __name__ == "__main__":
+    unittest.main()
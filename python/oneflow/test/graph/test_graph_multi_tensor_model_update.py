@@ -0,0 +1,124 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+class _Model(flow.nn.Module):
+    def __init__(self):
+        super().__init__()
+        self.fc0 = flow.nn.Linear(4, 8)
+        self.fc1 = flow.nn.Linear(8, 8)
+        self.head = flow.nn.Linear(8, 1)
+        self.scale = flow.nn.Parameter(flow.ones(1))
+
+    def forward(self, x):
+        return self.head(flow.relu(self.fc1(flow.relu(self.fc0(x))))) * self.scale
+
+
+def _make_optimizer(model, optim_type):
+    # Each param group has its own learning rate, so its update ops form a
+    # separate multi-tensor group. The scale is alone and has nothing to join.
+    body = list(model.fc0.parameters()) + list(model.fc1.parameters())
+    if optim_type == "sgd":
+        return flow.optim.SGD(
+            [
+                {"params": body, "lr": 0.1, "momentum": 0.9},
+                {"params": model.head.parameters(), "lr": 0.01, "momentum": 0.9},
+                {"params": [model.scale], "lr": 0.05, "momentum": 0.9},
+            ]
+        )
+    return flow.optim.Adam(
+        [
+            {"params": body, "lr": 0.01},
+            {"params": model.head.parameters(), "lr": 0.001},
+            {"params": [model.scale], "lr": 0.005},
+        ]
+    )
+
+
+def _train(model, optim_type, enable_multi_tensor, data):
+    optimizer = _make_optimizer(model, optim_type)
+
+    class TrainGraph(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+            self.model = model
+            self.add_optimizer(optimizer)
+            self.config.allow_multi_tensor_model_update(enable_multi_tensor)
+
+        def build(self, x):
+            loss = self.model(x).sum()
+            loss.backward()
+            return loss
+
+    graph = TrainGraph()
+    for x in data:
+        graph(x)
+    return graph._full_graph_proto
+
+
+def _test_multi_tensor_model_update_pass(test_case, optim_type):
+    update_op_type = "momentum_update" if optim_type == "sgd" else "adam_update"
+    data = [flow.tensor(np.random.randn(6, 4).astype(np.float32)) for _ in range(4)]
+    model = _Model()
+    ref_model = _Model()
+    ref_model.load_state_dict(model.state_dict())
+    job = _train(model, optim_type, True, data)
+    ref_job = _train(ref_model, optim_type, False, data)
+
+    multi_tensor_ops = []
+    single_tensor_ops = []
+    for op in job.net.op:
+        if not op.HasField("user_conf"):
+            continue
+        if op.user_conf.op_type_name == "multi_tensor_" + update_op_type:
+            multi_tensor_ops.append(op)
+        elif op.user_conf.op_type_name == update_op_type:
+            single_tensor_ops.append(op)
+    # fc0 and fc1 share one op, the head gets another and the scale is left alone.
+    test_case.assertEqual(len(multi_tensor_ops), 2)
+    test_case.assertEqual(len(single_tensor_ops), 1)
+    model_counts = sorted(len(op.user_conf.input["model"].s) for op in multi_tensor_ops)
+    test_case.assertEqual(model_counts, [2, 4])
+    for op in ref_job.net.op:
+        if op.HasField("user_conf"):
+            test_case.assertFalse(op.user_conf.op_type_name.startswith("multi_tensor_"))
+
+    for (name, param) in model.state_dict().items():
+        test_case.assertTrue(
+            np.allclose(
+                param.numpy(), ref_model.state_dict()[name].numpy(), 1e-5, 1e-5
+            ),
+            name,
+        )
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestGraphMultiTensorModelUpdate(flow.unittest.TestCase):
+    def test_multi_tensor_momentum_update(test_case):
+        _test_multi_tensor_model_update_pass(test_case, "sgd")
+
+    def test_multi_tensor_adam_update(test_case):
+        _test_multi_tensor_model_update_pass(test_case, "adam")
+
+
+if __name__ == "__main__":
+    unittest.main()
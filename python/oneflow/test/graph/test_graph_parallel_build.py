@@ -0,0 +1,107 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+_MIN_OP_NUM_ENV = "ONEFLOW_OP_GRAPH_PARALLEL_BUILD_MIN_OP_NUM"
+
+
+def _blob_descs_per_op(job):
+    # Op names differ between graphs, so ops are identified by their order in the job.
+    op_name2descs = {}
+    for lbn, desc in job.helper.lbn2logical_blob_desc.items():
+        op_name, blob_name = lbn.split("/", 1)
+        op_name2descs.setdefault(op_name, []).append(
+            (blob_name, tuple(desc.shape.dim), desc.data_type, desc.is_dynamic)
+        )
+    result = []
+    for op in job.net.op:
+        op_type = op.WhichOneof("op_type")
+        if op_type == "user_conf":
+            op_type = op.user_conf.op_type_name
+        result.append((op_type, sorted(op_name2descs.get(op.name, []))))
+    return result
+
+
+def _build_and_train(test_case, device, min_op_num):
+    flow.manual_seed(0)
+    layers = []
+    for _ in range(8):
+        layers += [flow.nn.Linear(16, 16), flow.nn.ReLU()]
+    model = flow.nn.Sequential(*layers).to(device)
+    sgd = flow.optim.SGD(model.parameters(), lr=0.1, momentum=0.9)
+
+    class TrainGraph(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+            self.model = model
+            self.add_optimizer(sgd)
+            # Gradient accumulation gives the ops different time shapes, and both the
+            # passes and the runtime check that they are consistent.
+            self.config.set_gradient_accumulation_steps(4)
+
+        def build(self, x):
+            loss = self.model(x).sum()
+            loss.backward()
+            return loss
+
+    graph = TrainGraph()
+    np.random.seed(0)
+    x = flow.tensor(np.random.randn(8, 16).astype(np.float32), device=device)
+    old_min_op_num = os.environ.get(_MIN_OP_NUM_ENV)
+    os.environ[_MIN_OP_NUM_ENV] = str(min_op_num)
+    try:
+        losses = [graph(x).numpy() for _ in range(3)]
+    finally:
+        if old_min_op_num is None:
+            del os.environ[_MIN_OP_NUM_ENV]
+        else:
+            os.environ[_MIN_OP_NUM_ENV] = old_min_op_num
+    params = [p.numpy() for p in model.parameters()]
+    return _blob_descs_per_op(graph._full_graph_proto), losses, params
+
+
+def _test_parallel_build(test_case, device):
+    # A threshold of 1 builds every graph in parallel, and 0 builds them serially.
+    parallel_descs, parallel_losses, parallel_params = _build_and_train(
+        test_case, device, 1
+    )
+    serial_descs, serial_losses, serial_params = _build_and_train(test_case, device, 0)
+    test_case.assertGreater(len(serial_descs), 0)
+    test_case.assertEqual(parallel_descs, serial_descs)
+    for parallel_loss, serial_loss in zip(parallel_losses, serial_losses):
+        test_case.assertTrue(np.allclose(parallel_loss, serial_loss, 1e-5, 1e-5))
+    for parallel_param, serial_param in zip(parallel_params, serial_params):
+        test_case.assertTrue(np.allclose(parallel_param, serial_param, 1e-5, 1e-5))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestGraphParallelBuild(oneflow.unittest.TestCase):
+    def test_parallel_build_cpu(test_case):
+        _test_parallel_build(test_case, flow.device("cpu"))
+
+    @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+    def test_parallel_build_gpu(test_case):
+        _test_parallel_build(test_case, flow.device("cuda"))
+
+
+if __name__ == "__main__":
+    unittest.main()
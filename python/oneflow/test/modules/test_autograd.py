@@ -77,11 +77,35 @@ def _test_autograd_grad(test_case, shape, device):
     test_case.assertTrue(np.allclose(grad.numpy(), np_input * 6, 0.0001, 0.0001))
 
 
+def _test_autograd_parallel_backward(test_case, shape, device):
+    np_input = np.random.rand(*shape)
+    of_input = flow.tensor(
+        np_input, dtype=flow.float32, device=flow.device(device), requires_grad=True
+    )
+    branches = [of_input * (i + 1) for i in range(8)]
+    of_out_sum = sum([(x ** 2).sum() for x in branches])
+    flow.autograd.backward(of_out_sum, None, thread_num=4)
+    expected = np_input * 2 * sum([(i + 1) ** 2 for i in range(8)])
+    test_case.assertTrue(np.allclose(of_input.grad.numpy(), expected, 0.0001, 0.0001))
+    of_input = flow.tensor(
+        np_input, dtype=flow.float32, device=flow.device(device), requires_grad=True
+    )
+    branches = [of_input * (i + 1) for i in range(8)]
+    of_out_sum = sum([(x ** 2).sum() for x in branches])
+    grad = flow.autograd.grad(of_out_sum, of_input, thread_num=4)[0]
+    test_case.assertTrue(of_input.grad is None)
+    test_case.assertTrue(np.allclose(grad.numpy(), expected, 0.0001, 0.0001))
+
+
 @flow.unittest.skip_unless_1n1d()
 class TestAutograd(flow.unittest.TestCase):
     def test_autograd_interface(test_case):
         arg_dict = OrderedDict()
-        arg_dict["case"] = [_test_autograd_backward, _test_autograd_grad]
+        arg_dict["case"] = [
+            _test_autograd_backward,
+            _test_autograd_grad,
+            _test_autograd_parallel_backward,
+        ]
         arg_dict["shape"] = [(2, 3), (2, 3, 4, 5)]
         arg_dict["device"] = ["cpu", "cuda"]
         for arg in GenArgList(arg_dict):
@@ -110,6 +110,47 @@ class TestAutogradFunction(flow.unittest.TestCase):
         test_case.assertTrue(np.allclose(a.grad.numpy(), np_arr1))
         test_case.assertTrue(np.allclose(b.grad.numpy(), np_arr0))
 
+    @flow.unittest.skip_unless_1n1d()
+    def test_parallel_backward(test_case):
+        class MyMul(autograd.Function):
+            @staticmethod
+            def forward(ctx, x, y):
+                ctx.save_for_backward(x, y)
+                return x * y
+
+            @staticmethod
+            def backward(ctx, z_grad):
+                x, y = ctx.saved_tensors
+                return y * z_grad, x * z_grad
+
+        np_arr0 = np.random.randn(4, 5)
+        np_arr1 = np.random.randn(4, 5)
+
+        def run(thread_num):
+            a = flow.tensor(np_arr0).requires_grad_()
+            b = flow.tensor(np_arr1).requires_grad_()
+            hook_calls = []
+
+            def hook(grad):
+                hook_calls.append(grad.shape)
+                return grad * 2
+
+            b.register_hook(hook)
+            # independent branches, whose python backward functions and the hook
+            # run on the worker threads with thread_num > 1
+            branches = [MyMul.apply(a * (i + 1), b) for i in range(8)]
+            out = sum([(x ** 2).sum() for x in branches])
+            flow.autograd.backward(out, None, thread_num=thread_num)
+            return a.grad.numpy(), b.grad.numpy(), len(hook_calls)
+
+        (a_grad, b_grad, num_hook_calls) = run(1)
+        test_case.assertTrue(num_hook_calls > 0)
+        for thread_num in [2, 4]:
+            (par_a_grad, par_b_grad, par_num_hook_calls) = run(thread_num)
+            test_case.assertTrue(np.allclose(par_a_grad, a_grad))
+            test_case.assertTrue(np.allclose(par_b_grad, b_grad))
+            test_case.assertEqual(par_num_hook_calls, num_hook_calls)
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -0,0 +1,112 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+from test_util import GenArgDict
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _bf16_leaf(np_arr):
+    x = flow.tensor(np_arr, dtype=flow.float32).to(flow.bfloat16)
+    x.requires_grad = True
+    return x
+
+
+def _float_leaf(bf16_tensor):
+    # Start from the same bfloat16-rounded values, so only the bfloat16 rounding
+    # of the results separates the two paths.
+    x = bf16_tensor.detach().to(flow.float32)
+    x.requires_grad = True
+    return x
+
+
+def _to_numpy(x):
+    return x.to(flow.float32).numpy()
+
+
+def _assert_bf16_close(test_case, bf16_tensor, float_tensor):
+    test_case.assertEqual(bf16_tensor.dtype, flow.bfloat16)
+    test_case.assertTrue(
+        np.allclose(_to_numpy(bf16_tensor), float_tensor.numpy(), rtol=1e-2, atol=1e-2)
+    )
+
+
+def _test_conv2d(test_case, stride, padding):
+    (n, c, h, w, filters) = (2, 5, 9, 8, 7)
+    x = _bf16_leaf(np.random.randn(n, c, h, w))
+    weight = _bf16_leaf(np.random.randn(filters, c, 3, 3) / 3)
+    (x_ref, weight_ref) = (_float_leaf(x), _float_leaf(weight))
+    kwargs = {"stride": [stride] * 2, "padding": [padding] * 2, "dilation": [1, 1]}
+    y = flow._C.conv2d(x, weight, **kwargs)
+    y_ref = flow._C.conv2d(x_ref, weight_ref, **kwargs)
+    _assert_bf16_close(test_case, y, y_ref)
+    dy = np.random.randn(*y_ref.shape)
+    y.backward(flow.tensor(dy, dtype=flow.float32).to(flow.bfloat16))
+    y_ref.backward(flow.tensor(dy, dtype=flow.float32))
+    _assert_bf16_close(test_case, x.grad, x_ref.grad)
+    _assert_bf16_close(test_case, weight.grad, weight_ref.grad)
+
+
+def _test_matmul(test_case, transpose_a, transpose_b):
+    (m, k, n) = (13, 37, 11)
+    a = _bf16_leaf(np.random.randn(*((k, m) if transpose_a else (m, k))))
+    b = _bf16_leaf(np.random.randn(*((n, k) if transpose_b else (k, n))))
+    (a_ref, b_ref) = (_float_leaf(a), _float_leaf(b))
+    kwargs = {"transpose_a": transpose_a, "transpose_b": transpose_b}
+    y = flow._C.matmul(a, b, **kwargs)
+    y_ref = flow._C.matmul(a_ref, b_ref, **kwargs)
+    _assert_bf16_close(test_case, y, y_ref)
+    dy = np.random.randn(m, n)
+    y.backward(flow.tensor(dy, dtype=flow.float32).to(flow.bfloat16))
+    y_ref.backward(flow.tensor(dy, dtype=flow.float32))
+    _assert_bf16_close(test_case, a.grad, a_ref.grad)
+    _assert_bf16_close(test_case, b.grad, b_ref.grad)
+
+
+def _test_batch_matmul(test_case):
+    a = _bf16_leaf(np.random.randn(3, 6, 10))
+    b = _bf16_leaf(np.random.randn(3, 10, 4))
+    y = flow.matmul(a, b)
+    y_ref = flow.matmul(_float_leaf(a), _float_leaf(b))
+    _assert_bf16_close(test_case, y, y_ref)
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestBFloat16CpuKernels(flow.unittest.TestCase):
+    def test_conv2d(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["stride"] = [1, 2]
+        arg_dict["padding"] = [0, 1]
+        for arg in GenArgDict(arg_dict):
+            _test_conv2d(test_case, **arg)
+
+    def test_matmul(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["transpose_a"] = [False, True]
+        arg_dict["transpose_b"] = [False, True]
+        for arg in GenArgDict(arg_dict):
+            _test_matmul(test_case, **arg)
+
+    def test_batch_matmul(test_case):
+        _test_batch_matmul(test_case)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,163 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+from test_util import GenArgDict
+
+import oneflow as flow
+import oneflow.unittest
+
+_shapes = [(3,), (4, 5), (2, 3, 7), (1,), (64, 33)]
+
+
+def _make_tensors(device, shapes):
+    return [
+        flow.tensor(np.random.uniform(-1, 1, size=s).astype(np.float32), device=device)
+        for s in shapes
+    ]
+
+
+def _clone(tensors):
+    return [flow.tensor(t.numpy(), device=t.device) for t in tensors]
+
+
+def _assert_all_close(test_case, lhs, rhs):
+    for (l, r) in zip(lhs, rhs):
+        test_case.assertTrue(np.allclose(l.numpy(), r.numpy(), rtol=1e-5, atol=1e-6))
+
+
+def _test_multi_tensor_sgd_update(test_case, device, momentum, weight_decay):
+    n = len(_shapes)
+    models = _make_tensors(device, _shapes)
+    momenta = [flow.zeros_like(m) for m in models]
+    ref_models = _clone(models)
+    ref_momenta = _clone(momenta)
+    kwargs = {"learning_rate_val": 0.1, "l2": 0.01, "weight_decay": weight_decay}
+    if momentum == 0.0:
+        op = (
+            flow.builtin_op("multi_tensor_sgd_update")
+            .Input("model", n)
+            .Input("model_diff", n)
+            .Build()
+        )
+        ref_op = (
+            flow.builtin_op("sgd_update")
+            .Input("model")
+            .Input("model_diff")
+            .Build()
+        )
+    else:
+        kwargs["beta"] = momentum
+        op = (
+            flow.builtin_op("multi_tensor_momentum_update")
+            .Input("model", n)
+            .Input("model_diff", n)
+            .Input("momentum", n)
+            .Build()
+        )
+        ref_op = (
+            flow.builtin_op("momentum_update")
+            .Input("model")
+            .Input("model_diff")
+            .Input("momentum")
+            .Build()
+        )
+    for _ in range(3):
+        grads = _make_tensors(device, _shapes)
+        if momentum == 0.0:
+            op(*models, *grads, **kwargs)
+            for (model, grad) in zip(ref_models, grads):
+                ref_op(model, grad, **kwargs)
+        else:
+            op(*models, *grads, *momenta, **kwargs)
+            for (model, grad, mom) in zip(ref_models, grads, ref_momenta):
+                ref_op(model, grad, mom, **kwargs)
+    _assert_all_close(test_case, models, ref_models)
+    _assert_all_close(test_case, momenta, ref_momenta)
+
+
+def _test_multi_tensor_adam_update(test_case, device, weight_decay, do_bias_correction):
+    n = len(_shapes)
+    models = _make_tensors(device, _shapes)
+    ms = [flow.zeros_like(m) for m in models]
+    vs = [flow.zeros_like(m) for m in models]
+    ref_models = _clone(models)
+    ref_ms = _clone(ms)
+    ref_vs = _clone(vs)
+    max_vs = [flow.zeros_like(m) for m in models]
+    op = (
+        flow.builtin_op("multi_tensor_adam_update")
+        .Input("model", n)
+        .Input("model_diff", n)
+        .Input("m", n)
+        .Input("v", n)
+        .Build()
+    )
+    ref_op = (
+        flow.builtin_op("adam_update")
+        .Input("model")
+        .Input("model_diff")
+        .Input("m")
+        .Input("v")
+        .Input("max_v")
+        .Build()
+    )
+    (beta1, beta2) = (0.9, 0.999)
+    for step in range(1, 4):
+        kwargs = {
+            "learning_rate_val": 0.01,
+            "l2": 0.01,
+            "weight_decay": weight_decay,
+            "beta1": beta1,
+            "beta2": beta2,
+            "epsilon": 1e-8,
+            "do_bias_correction": do_bias_correction,
+            "bias_correction1_val": 1.0 - beta1 ** step,
+            "bias_correction2_val": 1.0 - beta2 ** step,
+        }
+        grads = _make_tensors(device, _shapes)
+        op(*models, *grads, *ms, *vs, **kwargs)
+        ref_states = zip(ref_models, grads, ref_ms, ref_vs, max_vs)
+        for (model, grad, m, v, max_v) in ref_states:
+            ref_op(model, grad, m, v, max_v, amsgrad=False, **kwargs)
+    _assert_all_close(test_case, models, ref_models)
+    _assert_all_close(test_case, ms, ref_ms)
+    _assert_all_close(test_case, vs, ref_vs)
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestMultiTensorModelUpdate(flow.unittest.TestCase):
+    def test_multi_tensor_sgd_update(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["device"] = ["cpu"]
+        arg_dict["momentum"] = [0.0, 0.9]
+        arg_dict["weight_decay"] = [0.0, 0.05]
+        for arg in GenArgDict(arg_dict):
+            _test_multi_tensor_sgd_update(test_case, **arg)
+
+    def test_multi_tensor_adam_update(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["device"] = ["cpu"]
+        arg_dict["weight_decay"] = [0.0, 0.05]
+        arg_dict["do_bias_correction"] = [True, False]
+        for arg in GenArgDict(arg_dict):
+            _test_multi_tensor_adam_update(test_case, **arg)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,132 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import shutil
+import struct
+import tempfile
+import unittest
+from unittest import mock
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+from oneflow.core.record import record_pb2
+
+_PART_SIZES = [10, 5, 9]
+_BATCH_SIZE = 4
+# 6 batches of 4 make an epoch of the 24 records
+_NUM_BATCHES = 12
+
+
+def _write_parts(data_dir):
+    record_id = 0
+    for part_id, part_size in enumerate(_PART_SIZES):
+        with open(os.path.join(data_dir, "part-" + str(part_id)), "wb") as f:
+            for _ in range(part_size):
+                record = record_pb2.OFRecord()
+                record.feature["id"].int64_list.value.append(record_id)
+                serialized = record.SerializeToString()
+                f.write(struct.pack("<q", len(serialized)))
+                f.write(serialized)
+                record_id += 1
+
+
+class _IdReader(flow.nn.Module):
+    def __init__(self, data_dir, op_name, **kwargs):
+        super().__init__()
+        # Readers are saved and restored by op name, which is the same for the same
+        # reader after restarting, so the test names the readers explicitly.
+        with mock.patch("oneflow.framework.id_util.UniqueStr", return_value=op_name):
+            self.reader = flow.nn.OFRecordReader(
+                data_dir,
+                batch_size=_BATCH_SIZE,
+                data_part_num=len(_PART_SIZES),
+                **kwargs,
+            )
+        self.decoder = flow.nn.OFRecordRawDecoder("id", shape=(1,), dtype=flow.int64)
+
+    def forward(self):
+        return self.decoder(self.reader()).numpy().flatten().tolist()
+
+
+def _copy_state(state_dir, from_op_name, to_op_name):
+    # the state files are named by "<op_name>-<rank>-<parallel_id>.state"
+    for file_name in os.listdir(state_dir):
+        if file_name.startswith(from_op_name + "-"):
+            shutil.copy(
+                os.path.join(state_dir, file_name),
+                os.path.join(state_dir, to_op_name + file_name[len(from_op_name) :]),
+            )
+
+
+def _test_save_and_restore(test_case, name, **kwargs):
+    with tempfile.TemporaryDirectory() as data_dir:
+        _write_parts(data_dir)
+        expected_reader = _IdReader(data_dir, name + "_expected", **kwargs)
+        expected = [expected_reader() for _ in range(_NUM_BATCHES)]
+        if not kwargs.get("random_shuffle", False):
+            # every record is read once in each epoch
+            num_records = sum(_PART_SIZES)
+            for epoch in range(2):
+                ids = sum(expected, [])[epoch * num_records : (epoch + 1) * num_records]
+                test_case.assertEqual(sorted(ids), list(range(num_records)))
+        # save in the first epoch, right at an epoch boundary and in the second epoch
+        for num_saved_batches in [2, 6, 8]:
+            saved_name = "%s_saved_%d" % (name, num_saved_batches)
+            restored_name = "%s_restored_%d" % (name, num_saved_batches)
+            with tempfile.TemporaryDirectory() as state_dir:
+                reader = _IdReader(data_dir, saved_name, **kwargs)
+                batches = [reader() for _ in range(num_saved_batches)]
+                flow.utils.data.save_reader_states(state_dir)
+                batches += [reader() for _ in range(_NUM_BATCHES - num_saved_batches)]
+                test_case.assertEqual(batches, expected)
+
+                _copy_state(state_dir, saved_name, restored_name)
+                flow.utils.data.restore_reader_states(state_dir)
+                try:
+                    restored_reader = _IdReader(data_dir, restored_name, **kwargs)
+                    restored_batches = [
+                        restored_reader()
+                        for _ in range(_NUM_BATCHES - num_saved_batches)
+                    ]
+                finally:
+                    flow.utils.data.restore_reader_states("")
+                test_case.assertEqual(restored_batches, expected[num_saved_batches:])
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestOFRecordReaderState(flow.unittest.TestCase):
+    def test_plain_reader(test_case):
+        _test_save_and_restore(test_case, "plain_reader")
+
+    def test_random_shuffle_reader(test_case):
+        _test_save_and_restore(
+            test_case,
+            "random_shuffle_reader",
+            random_shuffle=True,
+            shuffle_buffer_size=8,
+            random_seed=1234,
+        )
+
+    def test_shuffle_after_epoch_reader(test_case):
+        _test_save_and_restore(
+            test_case, "shuffle_after_epoch_reader", shuffle_after_epoch=True
+        )
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -36,6 +36,7 @@ from oneflow.utils.data.decorator import (
     non_deterministic,
 )
 from oneflow.utils.data.distributed import DistributedSampler
+from oneflow.utils.data.reader_state import save_reader_states, restore_reader_states
 
 
 __all__ = [
@@ -57,4 +58,6 @@ __all__ = [
     "guaranteed_datapipes_determinism",
     "non_deterministic",
     "DistributedSampler",
+    "save_reader_states",
+    "restore_reader_states",
 ]
@@ -0,0 +1,42 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import oneflow._oneflow_internal
+
+
+def save_reader_states(path: str):
+    """Saves the reading positions of the OFRecordReader modules in this process into the
+    directory ``path``, typically next to a model snapshot.
+
+    The position of a reader is the one right after the last batch it returned. Batches
+    loaded ahead are saved too, so no sample is skipped or repeated after restoring.
+
+    Args:
+        path (str): The directory to save the states into.
+    """
+    oneflow._oneflow_internal.SaveDataReaderStates(path)
+
+
+def restore_reader_states(path: str):
+    """Makes the OFRecordReader modules restore the states saved by
+    :func:`save_reader_states` in the directory ``path``.
+
+    It must be called before the readers produce their first batches, because readers are
+    restored when their kernels are created.
+
+    Args:
+        path (str): The directory the states were saved into.
+    """
+    oneflow._oneflow_internal.SetDataReaderRestoreDir(path)